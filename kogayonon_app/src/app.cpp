@@ -1,4 +1,5 @@
 #include "app/app.hpp"
+#include <chrono>
 #include <fstream>
 #include <glm/gtc/type_ptr.hpp>
 #include <imgui_impl_sdl2.h>
@@ -8,6 +9,7 @@
 #include <spdlog/sinks/daily_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
+#include <unordered_map>
 #include "core/ecs/components/directional_light_component.hpp"
 #include "core/ecs/components/identifier_component.hpp"
 #include "core/ecs/components/index_component.hpp"
@@ -37,8 +39,12 @@
 #include "gui/scene_hierarchy.hpp"
 #include "gui/scene_viewport.hpp"
 #include "physics/nvidia_physx.hpp"
+#include "rendering/profiler.hpp"
+#include "rendering/render_target_pool.hpp"
+#include "rendering/renderer.hpp"
 #include "utilities/asset_manager/asset_manager.hpp"
 #include "utilities/configurator/configurator.hpp"
+#include "utilities/cpu_profiler/cpu_profiler.hpp"
 #include "utilities/input/mouse_codes.hpp"
 #include "utilities/utils/yaml_utils.hpp"
 #include "utilities/yaml_serializer/yaml_serializer.hpp"
@@ -99,6 +105,8 @@ App::~App()
 void App::cleanup() const
 {
   spdlog::info( "Closing app and cleaning up" );
+  AssetManager::getInstance().getTextureStreamer().destroy();
+  kogayonon_rendering::Profiler::shutdown();
   NvidiaPhysx::getInstance().releasePhysx();
 }
 
@@ -207,13 +215,28 @@ void App::run()
 
   while ( m_running )
   {
+    kogayonon_rendering::Profiler::beginFrame();
     pTimeTracker->update( "deltaTime" );
-    pollEvents();
+    {
+      KOGAYONON_PROFILE_ZONE( "events" );
+      pollEvents();
+    }
     if ( nvidiaPhysics.isRunning() )
     {
+      KOGAYONON_PROFILE_ZONE( "physics" );
       nvidiaPhysics.simulate( pTimeTracker->getDuration( "deltaTime" ).count() );
     }
-    pImGuiManager->draw();
+    {
+      KOGAYONON_PROFILE_ZONE( "texture uploads" );
+      AssetManager::getInstance().getTextureStreamer().update();
+    }
+    {
+      KOGAYONON_PROFILE_ZONE( "ui" );
+      pImGuiManager->draw();
+    }
+    kogayonon_rendering::RenderTargetPool::endFrame();
+    kogayonon_rendering::Renderer::endFrame();
+    kogayonon_rendering::Profiler::endFrame();
     m_pWindow->swapWindow();
   }
 }
@@ -258,11 +281,11 @@ bool App::initSDL()
   glDebugMessageControl( GL_DEBUG_SOURCE_API, GL_DEBUG_TYPE_ERROR, GL_DEBUG_SEVERITY_HIGH, 0, nullptr, GL_TRUE );
   glDebugMessageCallback( glDebugCallback, nullptr );
 #endif
-  glEnable( GL_DEPTH_TEST );
-  glEnable( GL_STENCIL_TEST );
-  glDepthFunc( GL_LESS );
-  glEnable( GL_CULL_FACE );
-  glCullFace( GL_BACK );
+  kogayonon_rendering::Renderer::enableDepth();
+  kogayonon_rendering::Renderer::enableStencil();
+  kogayonon_rendering::Renderer::setDepthFunc( GL_LESS );
+  kogayonon_rendering::Renderer::enableCullFace();
+  kogayonon_rendering::Renderer::setCullFace( GL_BACK );
   glFrontFace( GL_CCW );
   rescaleMainViewport( pWinProps->width, pWinProps->height );
   return true;
@@ -302,6 +325,7 @@ bool App::initRegistries() const
   mainRegistry.addToContext<std::shared_ptr<kogayonon_utilities::TaskManager>>( std::move( taskManager ) );
 
   // init shader manager
+  const auto shaderStart = std::chrono::steady_clock::now();
   auto shaderManager = std::make_shared<kogayonon_utilities::ShaderManager>();
   assert( shaderManager && "could not initialise shader manager" );
   shaderManager->pushShader( "resources/shaders/3d_vertex.glsl", "resources/shaders/3d_fragment.glsl", "3d" );
@@ -312,10 +336,17 @@ bool App::initRegistries() const
   shaderManager->pushShader( "resources/shaders/depth_vert.glsl", "resources/shaders/depth_frag.glsl", "depth" );
   shaderManager->pushShader(
     "resources/shaders/depth_vert.glsl", "resources/shaders/depth_debug_frag.glsl", "depthDebug" );
+  shaderManager->pushShader( "resources/shaders/depth_cascade_vert.glsl",
+                             "resources/shaders/depth_cascade_geom.glsl",
+                             "resources/shaders/depth_frag.glsl",
+                             "depthCascades" );
   shaderManager->pushShader(
     "resources/shaders/outlining_vert.glsl", "resources/shaders/outlining_frag.glsl", "outlining" );
+  shaderManager->pushComputeShader( "resources/shaders/cull_compute.glsl", "cull" );
 
-  shaderManager->compileMarkedShaders();
+  // the driver compiles while we load the icons below, we only wait for it once they are done
+  shaderManager->beginCompilation();
+  auto pShaderManager = shaderManager;
 
   mainRegistry.addToContext<std::shared_ptr<kogayonon_utilities::ShaderManager>>( std::move( shaderManager ) );
 
@@ -335,6 +366,14 @@ bool App::initRegistries() const
   assetManager.addTexture( "shader_icon.png" );
   assetManager.addTexture( "png_icon.png" );
 
+  const auto waitStart = std::chrono::steady_clock::now();
+  pShaderManager->finishCompilation();
+  const auto shaderEnd = std::chrono::steady_clock::now();
+  spdlog::info( "Shaders ready after {:.2f} ms, waited {:.2f} ms for the driver, {} programs from the binary cache",
+                std::chrono::duration<double, std::milli>( shaderEnd - shaderStart ).count(),
+                std::chrono::duration<double, std::milli>( shaderEnd - waitStart ).count(),
+                pShaderManager->getProgramCacheHits() );
+
   // ugly init but it is what it is
   auto& physics = NvidiaPhysx::getInstance();
 
@@ -379,6 +418,7 @@ bool App::initGuiForProject()
   auto sceneHierarchy = std::make_unique<kogayonon_gui::SceneHierarchyWindow>( "Scene hierarchy" );
   auto performanceWindow = std::make_unique<kogayonon_gui::PerformanceWindow>( "Performance" );
   auto entityPropertiesWindow = std::make_unique<kogayonon_gui::EntityPropertiesWindow>( "Object properties" );
+  entityPropertiesWindow->setTextureResidency( &sceneViewport->getTextureResidency() );
 
   auto pImguiManager = MainRegistry::getInstance().getImGuiManager();
 
@@ -393,6 +433,7 @@ bool App::initGuiForProject()
 
 bool App::init()
 {
+  const auto startupStart = std::chrono::steady_clock::now();
   m_pWindow = std::make_shared<kogayonon_window::Window>( "kogayonon engine", 600, 400, 1, false );
   // initialize the keyboard state
   KeyboardState::initState();
@@ -418,13 +459,15 @@ bool App::init()
   eventDispatcher->addHandler<kogayonon_core::ProjectLoadEvent, &App::onProjectLoad>( *this );
   eventDispatcher->addHandler<kogayonon_core::ProjectCreateEvent, &App::onProjectCreate>( *this );
 
+  spdlog::info( "Startup took {:.2f} ms",
+                std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - startupStart ).count() );
   return true;
 }
 
 void App::rescaleMainViewport( int w, int h )
 {
   m_pWindow->resize();
-  glViewport( 0, 0, w, h );
+  kogayonon_rendering::Renderer::setViewport( 0, 0, w, h );
 }
 
 bool App::onWindowResize( const WindowResizeEvent& e )
@@ -598,6 +641,9 @@ void App::onProjectLoad( const kogayonon_core::ProjectLoadEvent& e )
   auto& assetManager = AssetManager::getInstance();
   const auto& pTaskManager = MainRegistry::getInstance().getTaskManager();
 
+  // the texture memory and load time reported from here on belong to this project
+  assetManager.getTextureStreamer().resetLoadStats();
+
   std::ifstream ifs( e.getPath().string(), std::ios::in );
   rapidjson::IStreamWrapper isw( ifs );
 
@@ -624,6 +670,8 @@ void App::onProjectLoad( const kogayonon_core::ProjectLoadEvent& e )
     Document sceneDoc{};
     sceneDoc.ParseStream( sceneIws );
 
+    // entities of every mesh file, each file gets imported once
+    std::unordered_map<std::string, std::vector<entt::entity>> meshEntities;
     for ( auto j = 0u; j < sceneDoc["meshEntities"].Size(); j++ )
     {
       auto& ent = sceneDoc["meshEntities"][j];
@@ -634,20 +682,29 @@ void App::onProjectLoad( const kogayonon_core::ProjectLoadEvent& e )
                             .rotation = std::move( getVec3( ent["transformComponent"]["rotation"] ) ),
                             .scale = std::move( getVec3( ent["transformComponent"]["scale"] ) ) } );
 
-      // create the entity
-      const auto path = std::filesystem::path{ ent["meshPath"].GetString() };
-      const auto& enttId = entity.getEntityId();
-
-      pTaskManager->enqueue( [scene_, path, enttId, &assetManager]() {
-        const auto mesh = assetManager.addMesh( path.stem().string(), path.string() );
-        scene_->addMeshToEntity( enttId, mesh );
-      } );
+      meshEntities[ent["meshPath"].GetString()].emplace_back( entity.getEntityId() );
 
       entity.replaceComponent<IdentifierComponent>(
         IdentifierComponent{ .name = ent["identifierComponent"]["name"].GetString(),
                              .type = stringToType( ent["identifierComponent"]["type"].GetString() ),
                              .group = ent["identifierComponent"]["group"].GetString() } );
     }
+
+    // a job per file instead of per entity, entities sharing a mesh would park workers waiting on the same import
+    // while its primitives need those workers. The scene is only edited here, the workers hand the mesh back
+    for ( auto& [meshPath, entities] : meshEntities )
+    {
+      pTaskManager->enqueue( [scene_,
+                              path = std::filesystem::path{ meshPath },
+                              entities = std::move( entities ),
+                              &assetManager,
+                              pTasks = pTaskManager.get()]() {
+        const auto mesh = assetManager.addMesh( path.stem().string(), path.string(), pTasks );
+        for ( const auto enttId : entities )
+          scene_->queueMeshForEntity( enttId, mesh );
+      } );
+    }
+
     for ( auto j = 0u; j < sceneDoc["directionalLightEntities"].Size(); j++ )
     {
       const auto& light = sceneDoc["directionalLightEntities"][j];
@@ -668,6 +725,15 @@ void App::onProjectLoad( const kogayonon_core::ProjectLoadEvent& e )
 
       };
       comp.directionalLightIndex = 0;
+
+      // older projects were saved before the light had cascades
+      const auto& lightComponent = light["directionalLightComponent"];
+      if ( lightComponent.HasMember( "cascadeCount" ) )
+        comp.cascadeCount = lightComponent["cascadeCount"].GetInt();
+      if ( lightComponent.HasMember( "cascadeSplitLambda" ) )
+        comp.cascadeSplitLambda = lightComponent["cascadeSplitLambda"].GetFloat();
+      if ( lightComponent.HasMember( "cascadeDistance" ) )
+        comp.cascadeDistance = lightComponent["cascadeDistance"].GetFloat();
     }
 
     for ( auto j = 0u; j < sceneDoc["pointLightEntities"].Size(); j++ )
@@ -840,6 +906,9 @@ void App::onWindowClose( const kogayonon_core::WindowCloseEvent& e )
                     .addKeyValuePair("nearPlane",directionalLightComponent.nearPlane)
                     .addKeyValuePair("farPlane",directionalLightComponent.farPlane)
                     .addKeyValuePair("positionFactor",directionalLightComponent.positionFactor)
+                    .addKeyValuePair("cascadeCount",directionalLightComponent.cascadeCount)
+                    .addKeyValuePair("cascadeSplitLambda",directionalLightComponent.cascadeSplitLambda)
+                    .addKeyValuePair("cascadeDistance",directionalLightComponent.cascadeDistance)
                 .endObject()
             .startObject("directionalLight")
                     .addKeyValuePair("diffuse",light.diffuse)
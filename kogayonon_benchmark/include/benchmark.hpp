@@ -1,10 +1,40 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
 #include <benchmark/benchmark.h>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
+#include <mutex>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
 #include <rapidjson/istreamwrapper.h>
+#include "core/ecs/components/index_component.hpp"
+#include "core/ecs/components/mesh_component.hpp"
 #include "core/ecs/components/transform_component.hpp"
 #include "core/ecs/entity.hpp"
 #include "core/ecs/registry.hpp"
+#include "core/scene/instance_data.hpp"
+#include "core/scene/render_list.hpp"
+#include "core/systems/culling_system.hpp"
+#include "core/systems/indirect_draw_list.hpp"
+#include "core/systems/light_clusters.hpp"
+#include "core/systems/lod_selector.hpp"
+#include "core/systems/picking_bvh.hpp"
+#include "resources/bounds.hpp"
+#include "resources/mesh.hpp"
+#include "resources/texture.hpp"
+#include "utilities/asset_manager/asset_manager.hpp"
+#include "utilities/cpu_profiler/cpu_profiler.hpp"
+#include "utilities/mesh_simplifier/mesh_simplifier.hpp"
+#include "utilities/shader/uniform_table.hpp"
+#include "utilities/task_manager/task_manager.hpp"
+#include "utilities/texture_cook/texture_cook.hpp"
 #include "utilities/yaml_serializer/yaml_serializer.hpp"
 
 // provide overloads
@@ -19,6 +49,8 @@ glm::vec3 getVec3( const Value& value )
 
 namespace kogayonon_benchmark
 {
+// bumped by the global operator new in main.cpp
+inline std::atomic<std::size_t> allocationCount{ 0 };
 
 // define functions here
 static void BM_CreateEntities( benchmark::State& state )
@@ -175,4 +207,947 @@ static void BM_JsonSerialization( benchmark::State& state )
 }
 }
 
+// builds the indirect draw list for range(0) meshes with 3 submeshes and 64 instances each, spread over 8 textures
+static void BM_IndirectDrawListBuild( benchmark::State& state )
+{
+  constexpr uint32_t submeshCount = 3;
+  constexpr uint32_t instanceCount = 64;
+  constexpr uint32_t textureCount = 8;
+
+  std::vector<kogayonon_resources::Texture> textures( textureCount );
+  std::vector<std::unique_ptr<kogayonon_resources::Mesh>> meshes;
+  meshes.reserve( state.range( 0 ) );
+
+  for ( auto i = 0u; i < state.range( 0 ); i++ )
+  {
+    std::vector<kogayonon_resources::Submesh> submeshes;
+    for ( auto j = 0u; j < submeshCount; j++ )
+      submeshes.emplace_back(
+        kogayonon_resources::Submesh{ .vertexOffest = j * 24, .indexOffset = j * 36, .indexCount = 36 } );
+
+    meshes.emplace_back( std::make_unique<kogayonon_resources::Mesh>(
+      "mesh" + std::to_string( i ),
+      std::vector<kogayonon_resources::Vertex>{},
+      std::vector<uint32_t>{},
+      std::vector<kogayonon_resources::Texture*>{ &textures.at( i % textureCount ) },
+      std::move( submeshes ) ) );
+  }
+
+  kogayonon_core::InstanceData instances;
+  for ( auto i = 0u; i < instanceCount; i++ )
+    instances.addInstance( static_cast<entt::entity>( i ), kogayonon_core::GPUInstance{} );
+
+  kogayonon_core::IndirectDrawList drawList;
+
+  for ( auto _ : state )
+  {
+    drawList.clear();
+    uint32_t vertexOffset = 0;
+    uint32_t indexOffset = 0;
+    for ( const auto& mesh : meshes )
+    {
+      drawList.addMesh( mesh.get(), vertexOffset, indexOffset, instances, instanceCount );
+      vertexOffset += submeshCount * 24;
+      indexOffset += submeshCount * 36;
+    }
+    benchmark::DoNotOptimize( drawList.getCommands().data() );
+  }
+
+  state.counters["indirectCommands"] = static_cast<double>( drawList.getCommands().size() );
+}
+
+// range(0) mesh entities sharing 32 meshes, every frame gathers the unique meshes once per pass (depth, geometry,
+// picking) the same way RenderingSystem::makeMeshesUnique used to
+static void BM_LegacyMeshGather( benchmark::State& state )
+{
+  constexpr uint32_t meshCount = 32;
+  constexpr uint32_t passCount = 3;
+
+  std::vector<kogayonon_resources::Mesh> meshes( meshCount );
+  kogayonon_core::Registry registry;
+  auto& enttRegistry = registry.getRegistry();
+
+  for ( auto i = 0u; i < state.range( 0 ); i++ )
+  {
+    auto entity = registry.createEntity();
+    enttRegistry.emplace<kogayonon_core::TransformComponent>( entity );
+    enttRegistry.emplace<kogayonon_core::MeshComponent>(
+      entity, kogayonon_core::MeshComponent{ .pMesh = &meshes.at( i % meshCount ), .loaded = true } );
+    enttRegistry.emplace<kogayonon_core::IndexComponent>( entity, kogayonon_core::IndexComponent{ .index = i } );
+  }
+
+  std::size_t allocations = 0;
+  for ( auto _ : state )
+  {
+    const auto before = allocationCount.load();
+    for ( auto pass = 0u; pass < passCount; pass++ )
+    {
+      std::vector<kogayonon_resources::Mesh*> orderedMeshes;
+      std::unordered_set<kogayonon_resources::Mesh*> uniqueMeshes;
+      const auto& view = enttRegistry.view<kogayonon_core::TransformComponent,
+                                           kogayonon_core::MeshComponent,
+                                           kogayonon_core::IndexComponent>();
+
+      view.each( [&]( const auto entity, auto& transformComp, auto& meshComp, auto& indexComp ) {
+        if ( uniqueMeshes.insert( meshComp.pMesh ).second )
+          orderedMeshes.emplace_back( meshComp.pMesh );
+      } );
+      benchmark::DoNotOptimize( orderedMeshes.data() );
+    }
+    allocations += allocationCount.load() - before;
+  }
+
+  state.counters["allocationsPerFrame"] =
+    benchmark::Counter( static_cast<double>( allocations ), benchmark::Counter::kAvgIterations );
+}
+
+// same scene as BM_LegacyMeshGather but the passes iterate the RenderList kept up to date by the entt signals
+static void BM_RenderListGather( benchmark::State& state )
+{
+  constexpr uint32_t meshCount = 32;
+  constexpr uint32_t passCount = 3;
+
+  std::vector<kogayonon_resources::Mesh> meshes( meshCount );
+  kogayonon_core::Registry registry;
+  auto& enttRegistry = registry.getRegistry();
+
+  kogayonon_core::RenderList renderList;
+  renderList.connect( enttRegistry );
+
+  for ( auto i = 0u; i < state.range( 0 ); i++ )
+  {
+    auto entity = registry.createEntity();
+    enttRegistry.emplace<kogayonon_core::TransformComponent>( entity );
+    enttRegistry.emplace<kogayonon_core::MeshComponent>(
+      entity, kogayonon_core::MeshComponent{ .pMesh = &meshes.at( i % meshCount ), .loaded = true } );
+    enttRegistry.emplace<kogayonon_core::IndexComponent>( entity, kogayonon_core::IndexComponent{ .index = i } );
+  }
+
+  std::size_t allocations = 0;
+  for ( auto _ : state )
+  {
+    const auto before = allocationCount.load();
+    for ( auto pass = 0u; pass < passCount; pass++ )
+    {
+      for ( auto pMesh : renderList.getMeshes() )
+        benchmark::DoNotOptimize( pMesh );
+    }
+    allocations += allocationCount.load() - before;
+  }
+
+  state.counters["allocationsPerFrame"] =
+    benchmark::Counter( static_cast<double>( allocations ), benchmark::Counter::kAvgIterations );
+
+  renderList.disconnect( enttRegistry );
+}
+
+static void BM_FrustumCull( benchmark::State& state )
+{
+  const auto count = static_cast<uint32_t>( state.range( 0 ) );
+
+  // instances laid out on a square grid around the origin, the camera sees roughly a quarter of them
+  std::vector<kogayonon_core::GPUInstance> instances( count );
+  const auto side = static_cast<uint32_t>( std::ceil( std::sqrt( static_cast<float>( count ) ) ) );
+  for ( auto i = 0u; i < count; i++ )
+  {
+    const auto x = static_cast<float>( i % side ) - side * 0.5f;
+    const auto z = static_cast<float>( i / side ) - side * 0.5f;
+    instances.at( i ).instanceMatrix =
+      glm::mat4x3{ glm::translate( glm::mat4{ 1.0f }, glm::vec3{ x * 2.0f, 0.0f, z * 2.0f } ) };
+  }
+
+  const auto view =
+    glm::lookAt( glm::vec3{ 0.0f, 10.0f, 0.0f }, glm::vec3{ 0.0f, 10.0f, -1.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f } );
+  const auto projection = glm::perspective( glm::radians( 90.0f ), 16.0f / 9.0f, 0.1f, 300.0f );
+  const auto frustum = kogayonon_core::Frustum::fromMatrix( projection * view );
+
+  kogayonon_core::CullingSystem cullingSystem;
+  const kogayonon_resources::BoundingSphere sphere{ .center = glm::vec3{ 0.0f }, .radius = 1.0f };
+  std::vector<uint32_t> visible;
+  visible.reserve( count );
+
+  uint32_t visibleCount = 0;
+  for ( auto _ : state )
+  {
+    cullingSystem.clear();
+    visible.clear();
+    const auto first = cullingSystem.addInstances( sphere, instances, count );
+    visibleCount = cullingSystem.cull( frustum, first, count, visible );
+    benchmark::DoNotOptimize( visible.data() );
+  }
+
+  state.counters["visible"] = visibleCount;
+  state.SetItemsProcessed( state.iterations() * count );
+}
+
+// uniform names the passes of a frame used to set by string before the per frame constants block
+inline constexpr const char* passUniforms[]{ "projection", "view", "projection", "view", "lightVP",
+                                             "projection", "view", "projection", "view" };
+
+// camera, projection and light matrices plus the camera position, the size of the FrameConstants block
+struct BenchmarkFrameConstants
+{
+  glm::mat4 view{ 1.0f };
+  glm::mat4 projection{ 1.0f };
+  glm::mat4 lightVP{ 1.0f };
+  glm::vec4 viewPosition{ 0.0f };
+};
+
+// range(0) draws in a frame that set u_MaterialIndex, plus the matrices every pass set on its own shader. Locations
+// come from a string keyed map that builds a std::string per lookup, a driver lookup can not be timed without a context
+static void BM_UniformUpdatesByName( benchmark::State& state )
+{
+  std::unordered_map<std::string, int> locations{
+    { "projection", 0 }, { "view", 1 }, { "lightVP", 2 }, { "u_MaterialIndex", 3 }, { "u_DrawOffset", 4 } };
+  std::vector<glm::mat4> uploaded;
+  uploaded.reserve( std::size( passUniforms ) );
+
+  for ( auto _ : state )
+  {
+    uploaded.clear();
+    int sum = 0;
+    for ( const auto name : passUniforms )
+    {
+      sum += locations.at( name );
+      uploaded.emplace_back( 1.0f );
+    }
+
+    for ( auto i = 0; i < state.range( 0 ); i++ )
+      sum += locations.at( "u_MaterialIndex" );
+
+    benchmark::DoNotOptimize( sum );
+    benchmark::DoNotOptimize( uploaded.data() );
+  }
+
+  state.counters["lookupsPerFrame"] = static_cast<double>( std::size( passUniforms ) + state.range( 0 ) );
+  state.counters["matrixBytesPerFrame"] = static_cast<double>( std::size( passUniforms ) * sizeof( glm::mat4 ) );
+}
+
+// same frame with the reflected hash table, the matrices are written once into the frame constants
+static void BM_UniformUpdatesReflected( benchmark::State& state )
+{
+  kogayonon_utilities::UniformTable table;
+  table.add( "u_MaterialIndex", 3 );
+  table.add( "u_DrawOffset", 4 );
+
+  BenchmarkFrameConstants uploaded{};
+  BenchmarkFrameConstants constants{};
+  std::size_t bytes = 0;
+
+  for ( auto _ : state )
+  {
+    // the constants only go up when they changed, move the camera every frame so they always do
+    constants.viewPosition.x += 1.0f;
+    if ( std::memcmp( &uploaded, &constants, sizeof( BenchmarkFrameConstants ) ) != 0 )
+    {
+      std::memcpy( &uploaded, &constants, sizeof( BenchmarkFrameConstants ) );
+      bytes = sizeof( BenchmarkFrameConstants );
+    }
+
+    int sum = 0;
+    for ( auto i = 0; i < state.range( 0 ); i++ )
+      sum += table.find( kogayonon_utilities::UniformName{ "u_MaterialIndex" } );
+
+    benchmark::DoNotOptimize( sum );
+    benchmark::DoNotOptimize( &uploaded );
+  }
+
+  state.counters["lookupsPerFrame"] = static_cast<double>( state.range( 0 ) );
+  state.counters["matrixBytesPerFrame"] = static_cast<double>( bytes );
+}
+
+// scene for the light benchmarks, count point lights scattered in front of the camera and fragments sampled over
+// the screen at increasing depths
+struct LightBenchmarkScene
+{
+  std::vector<kogayonon_resources::PointLight> lights;
+  glm::mat4 view;
+  glm::mat4 projection;
+
+  // xy ndc, z view depth, w unused
+  std::vector<glm::vec4> fragmentsNdc;
+  std::vector<glm::vec3> fragmentsWorld;
+};
+
+inline auto makeLightBenchmarkScene( uint32_t count ) -> LightBenchmarkScene
+{
+  LightBenchmarkScene scene;
+  scene.view =
+    glm::lookAt( glm::vec3{ 0.0f, 10.0f, 0.0f }, glm::vec3{ 0.0f, 10.0f, -1.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f } );
+  scene.projection = glm::perspective( glm::radians( 90.0f ), 16.0f / 9.0f, 0.1f, 300.0f );
+
+  // fixed seed so every run bins the same lights
+  std::mt19937 generator{ 1337 };
+  std::uniform_real_distribution<float> spreadX{ -80.0f, 80.0f };
+  std::uniform_real_distribution<float> spreadY{ 0.0f, 20.0f };
+  std::uniform_real_distribution<float> spreadZ{ -150.0f, 0.0f };
+
+  scene.lights.resize( count );
+  for ( auto& light : scene.lights )
+  {
+    light.translation = glm::vec4{ spreadX( generator ), spreadY( generator ), spreadZ( generator ), 1.0f };
+
+    // reaches roughly 12 units
+    light.params = glm::vec4{ 1.0f, 0.7f, 1.8f, 1.0f };
+  }
+
+  // a 64x36 grid of fragments, every row a bit deeper than the one above it
+  const auto inverseView = glm::inverse( scene.view );
+  for ( auto y = 0u; y < 36; y++ )
+  {
+    for ( auto x = 0u; x < 64; x++ )
+    {
+      const auto ndcX = ( static_cast<float>( x ) + 0.5f ) / 32.0f - 1.0f;
+      const auto ndcY = ( static_cast<float>( y ) + 0.5f ) / 18.0f - 1.0f;
+      const auto depth = 1.0f + static_cast<float>( ( x * 7 + y * 13 ) % 150 );
+
+      const auto viewPosition =
+        glm::vec4{ ndcX * depth / scene.projection[0][0], ndcY * depth / scene.projection[1][1], -depth, 1.0f };
+      scene.fragmentsNdc.emplace_back( ndcX, ndcY, depth, 0.0f );
+      scene.fragmentsWorld.emplace_back( inverseView * viewPosition );
+    }
+  }
+
+  return scene;
+}
+
+// the attenuation part of CalcPointLight in 3d_fragment
+inline auto shadeLight( const kogayonon_resources::PointLight& light, const glm::vec3& fragment ) -> glm::vec3
+{
+  const auto distance = glm::length( glm::vec3{ light.translation } - fragment );
+  const auto attenuation =
+    1.0f / ( light.params.x + light.params.y * distance + light.params.z * ( distance * distance ) );
+  return glm::vec3{ light.color } * attenuation;
+}
+
+static void BM_LightClusterBuild( benchmark::State& state )
+{
+  const auto scene = makeLightBenchmarkScene( static_cast<uint32_t>( state.range( 0 ) ) );
+  kogayonon_core::LightClusters clusters;
+
+  for ( auto _ : state )
+  {
+    clusters.build( scene.lights, scene.view, scene.projection );
+    benchmark::DoNotOptimize( clusters.getLightIndices().data() );
+  }
+
+  state.counters["binnedLights"] = clusters.getBinnedLightCount();
+  state.counters["clusterEntries"] = static_cast<double>( clusters.getLightIndices().size() );
+}
+
+// every fragment walks every light, what the fragment shader did before the clusters
+static void BM_LightShadingBruteForce( benchmark::State& state )
+{
+  const auto scene = makeLightBenchmarkScene( static_cast<uint32_t>( state.range( 0 ) ) );
+
+  for ( auto _ : state )
+  {
+    glm::vec3 result{ 0.0f };
+    for ( const auto& fragment : scene.fragmentsWorld )
+    {
+      for ( const auto& light : scene.lights )
+        result += shadeLight( light, fragment );
+    }
+    benchmark::DoNotOptimize( result );
+  }
+
+  state.counters["lightsPerFragment"] = static_cast<double>( scene.lights.size() );
+  state.SetItemsProcessed( state.iterations() * scene.fragmentsWorld.size() );
+}
+
+// the fragment only walks the lights of its froxel, the clusters are built once per frame so it is part of the time
+static void BM_LightShadingClustered( benchmark::State& state )
+{
+  const auto scene = makeLightBenchmarkScene( static_cast<uint32_t>( state.range( 0 ) ) );
+  kogayonon_core::LightClusters clusters;
+  std::size_t lightsShaded = 0;
+
+  for ( auto _ : state )
+  {
+    clusters.build( scene.lights, scene.view, scene.projection );
+    const auto& indices = clusters.getLightIndices();
+
+    glm::vec3 result{ 0.0f };
+    lightsShaded = 0;
+    for ( auto i = 0u; i < scene.fragmentsWorld.size(); i++ )
+    {
+      const auto& ndc = scene.fragmentsNdc[i];
+      const auto& cluster = clusters.getClusters()[clusters.getClusterIndex( glm::vec2{ ndc }, ndc.z )];
+      for ( auto j = cluster.offset; j < cluster.offset + cluster.count; j++ )
+        result += shadeLight( scene.lights[indices[j]], scene.fragmentsWorld[i] );
+
+      lightsShaded += cluster.count;
+    }
+    benchmark::DoNotOptimize( result );
+  }
+
+  state.counters["lightsPerFragment"] =
+    static_cast<double>( lightsShaded ) / static_cast<double>( scene.fragmentsWorld.size() );
+  state.SetItemsProcessed( state.iterations() * scene.fragmentsWorld.size() );
+}
+
+// range(0) entities sharing one mesh with their instance data, the ones range(1) deletes are spread evenly over them
+struct InstanceRemovalScene
+{
+  kogayonon_core::Registry registry;
+  kogayonon_core::InstanceData data{ .count = 0 };
+  std::vector<entt::entity> toDelete;
+};
+
+inline void makeInstanceRemovalScene( InstanceRemovalScene& scene, uint32_t count, uint32_t deletions )
+{
+  static kogayonon_resources::Mesh mesh;
+  auto& enttRegistry = scene.registry.getRegistry();
+  const auto step = std::max( count / std::max( deletions, 1u ), 1u );
+  scene.data.pMesh = &mesh;
+
+  for ( auto i = 0u; i < count; i++ )
+  {
+    const auto entity = scene.registry.createEntity();
+    const auto index = scene.data.addInstance( entity, kogayonon_core::GPUInstance{} );
+    enttRegistry.emplace<kogayonon_core::MeshComponent>(
+      entity, kogayonon_core::MeshComponent{ .pMesh = &mesh, .loaded = true } );
+    enttRegistry.emplace<kogayonon_core::IndexComponent>( entity, kogayonon_core::IndexComponent{ .index = index } );
+
+    if ( i % step == 0 && scene.toDelete.size() < deletions )
+      scene.toDelete.emplace_back( entity );
+  }
+}
+
+// what removeInstanceData used to do, erase from the middle, shift the index of every later instance by walking the
+// registry and upload the whole buffer again
+static void BM_InstanceRemoveErase( benchmark::State& state )
+{
+  const auto count = static_cast<uint32_t>( state.range( 0 ) );
+  const auto deletions = static_cast<uint32_t>( state.range( 1 ) );
+  std::size_t uploadBytes = 0;
+
+  for ( auto _ : state )
+  {
+    state.PauseTiming();
+    auto pScene = std::make_unique<InstanceRemovalScene>();
+    makeInstanceRemovalScene( *pScene, count, deletions );
+    auto& enttRegistry = pScene->registry.getRegistry();
+    uploadBytes = 0;
+    state.ResumeTiming();
+
+    for ( const auto entity : pScene->toDelete )
+    {
+      const auto toErase = enttRegistry.get<kogayonon_core::IndexComponent>( entity ).index;
+      pScene->data.instances.erase( pScene->data.instances.begin() + toErase );
+      --pScene->data.count;
+
+      for ( const auto& [other, indexComp, meshComp] :
+            enttRegistry.view<kogayonon_core::IndexComponent, kogayonon_core::MeshComponent>().each() )
+      {
+        if ( meshComp.pMesh == pScene->data.pMesh && indexComp.index > toErase )
+          --indexComp.index;
+      }
+
+      uploadBytes += sizeof( kogayonon_core::GPUInstance ) * pScene->data.instances.size();
+      enttRegistry.destroy( entity );
+    }
+    benchmark::DoNotOptimize( pScene->data.instances.data() );
+
+    state.PauseTiming();
+    pScene.reset();
+    state.ResumeTiming();
+  }
+
+  state.counters["uploadBytes"] = static_cast<double>( uploadBytes );
+}
+
+// the dense pool, the last instance moves into the hole and only its owner gets patched
+static void BM_InstanceRemoveSwapPop( benchmark::State& state )
+{
+  const auto count = static_cast<uint32_t>( state.range( 0 ) );
+  const auto deletions = static_cast<uint32_t>( state.range( 1 ) );
+  std::size_t uploadBytes = 0;
+
+  for ( auto _ : state )
+  {
+    state.PauseTiming();
+    auto pScene = std::make_unique<InstanceRemovalScene>();
+    makeInstanceRemovalScene( *pScene, count, deletions );
+    auto& enttRegistry = pScene->registry.getRegistry();
+    uploadBytes = 0;
+    state.ResumeTiming();
+
+    for ( const auto entity : pScene->toDelete )
+    {
+      const auto slot = enttRegistry.get<kogayonon_core::IndexComponent>( entity ).index;
+      const auto moved = pScene->data.removeInstance( slot );
+      if ( moved != entt::null )
+      {
+        enttRegistry.get<kogayonon_core::IndexComponent>( moved ).index = slot;
+        uploadBytes += sizeof( kogayonon_core::GPUInstance );
+      }
+      enttRegistry.destroy( entity );
+    }
+    benchmark::DoNotOptimize( pScene->data.instances.data() );
+
+    state.PauseTiming();
+    pScene.reset();
+    state.ResumeTiming();
+  }
+
+  state.counters["uploadBytes"] = static_cast<double>( uploadBytes );
+}
+
+// the instance layout before the compact one, the selection flag and the entity went up with every matrix
+struct LegacyGPUInstance
+{
+  uint32_t selected{ 0 };
+  int entityId{ -1 };
+  glm::mat4 instanceMatrix{ 1.0f };
+};
+
+// rotated and non uniformly scaled so the normal matrix is not just the model matrix
+template <typename TInstance>
+inline auto makeVertexBenchmarkInstances( uint32_t count ) -> std::vector<TInstance>
+{
+  std::mt19937 generator{ 7 };
+  std::uniform_real_distribution<float> distribution{ 0.5f, 2.0f };
+
+  std::vector<TInstance> instances( count );
+  for ( auto& instance : instances )
+  {
+    auto model = glm::translate( glm::mat4{ 1.0f }, glm::vec3{ distribution( generator ) } );
+    model = glm::rotate( model, distribution( generator ), glm::vec3{ 0.0f, 1.0f, 0.0f } );
+    model = glm::scale( model, glm::vec3{ distribution( generator ), 1.0f, distribution( generator ) } );
+    instance.instanceMatrix = decltype( instance.instanceMatrix ){ model };
+  }
+  return instances;
+}
+
+// the vertices of a cube, every instance runs its matrix over all of them like the vertex shader would
+inline constexpr uint32_t vertexBenchmarkVertices = 24;
+
+// what 3d_vertex did per vertex, a full matrix and the inverse transpose of its upper 3x3
+static void BM_InstanceVertexInverse( benchmark::State& state )
+{
+  const auto instances = makeVertexBenchmarkInstances<LegacyGPUInstance>( static_cast<uint32_t>( state.range( 0 ) ) );
+  const glm::vec3 position{ 0.5f, -0.5f, 0.5f };
+  const glm::vec3 normal{ 0.0f, 1.0f, 0.0f };
+
+  for ( auto _ : state )
+  {
+    glm::vec3 sum{ 0.0f };
+    for ( const auto& instance : instances )
+    {
+      for ( auto v = 0u; v < vertexBenchmarkVertices; v++ )
+      {
+        const auto fragPos = glm::vec3{ instance.instanceMatrix * glm::vec4{ position, 1.0f } };
+        const auto normalMatrix = glm::transpose( glm::inverse( glm::mat3{ instance.instanceMatrix } ) );
+        sum += fragPos + glm::normalize( normalMatrix * normal );
+      }
+    }
+    benchmark::DoNotOptimize( sum );
+  }
+
+  state.counters["instanceBytes"] = static_cast<double>( sizeof( LegacyGPUInstance ) * instances.size() );
+}
+
+// the compact layout, 3 rows of the matrix and the normal matrix from the column lengths
+static void BM_InstanceVertexColumnScale( benchmark::State& state )
+{
+  const auto instances =
+    makeVertexBenchmarkInstances<kogayonon_core::GPUInstance>( static_cast<uint32_t>( state.range( 0 ) ) );
+  const glm::vec3 position{ 0.5f, -0.5f, 0.5f };
+  const glm::vec3 normal{ 0.0f, 1.0f, 0.0f };
+
+  for ( auto _ : state )
+  {
+    glm::vec3 sum{ 0.0f };
+    for ( const auto& instance : instances )
+    {
+      for ( auto v = 0u; v < vertexBenchmarkVertices; v++ )
+      {
+        const auto fragPos = instance.instanceMatrix * glm::vec4{ position, 1.0f };
+        const glm::mat3 model{ instance.instanceMatrix };
+        const glm::mat3 normalMatrix{ model[0] / glm::dot( model[0], model[0] ),
+                                      model[1] / glm::dot( model[1], model[1] ),
+                                      model[2] / glm::dot( model[2], model[2] ) };
+        sum += fragPos + glm::normalize( normalMatrix * normal );
+      }
+    }
+    benchmark::DoNotOptimize( sum );
+  }
+
+  state.counters["instanceBytes"] = static_cast<double>( sizeof( kogayonon_core::GPUInstance ) * instances.size() );
+}
+
+// unit cubes scattered in a 200 unit box and rays from around the origin into it
+struct PickingBenchmarkScene
+{
+  std::vector<kogayonon_resources::AABB> boxes;
+  std::vector<std::pair<glm::vec3, glm::vec3>> rays;
+};
+
+inline auto makePickingBenchmarkScene( uint32_t count ) -> PickingBenchmarkScene
+{
+  std::mt19937 generator{ 11 };
+  std::uniform_real_distribution<float> position{ -100.0f, 100.0f };
+  std::uniform_real_distribution<float> direction{ -1.0f, 1.0f };
+  const kogayonon_resources::AABB cube{ .min = glm::vec3{ -0.5f }, .max = glm::vec3{ 0.5f } };
+
+  PickingBenchmarkScene scene;
+  for ( auto i = 0u; i < count; i++ )
+  {
+    const auto model = glm::translate( glm::mat4{ 1.0f }, glm::vec3{ position( generator ) } );
+    scene.boxes.emplace_back( kogayonon_core::PickingBVH::transformBounds( cube, glm::mat4x3{ model } ) );
+  }
+
+  for ( auto i = 0u; i < 64; i++ )
+  {
+    scene.rays.emplace_back(
+      glm::vec3{ 0.0f },
+      glm::normalize( glm::vec3{ direction( generator ), direction( generator ), direction( generator ) } ) );
+  }
+  return scene;
+}
+
+// every ray against every box, what picking on the cpu costs without a tree
+static void BM_PickRayBruteForce( benchmark::State& state )
+{
+  const auto scene = makePickingBenchmarkScene( static_cast<uint32_t>( state.range( 0 ) ) );
+
+  for ( auto _ : state )
+  {
+    for ( const auto& [origin, direction] : scene.rays )
+    {
+      const auto inverseDirection = 1.0f / direction;
+      auto closest = FLT_MAX;
+      auto hit = entt::entity{ entt::null };
+      for ( auto i = 0u; i < scene.boxes.size(); i++ )
+      {
+        const auto t0 = ( scene.boxes[i].min - origin ) * inverseDirection;
+        const auto t1 = ( scene.boxes[i].max - origin ) * inverseDirection;
+        const auto entries = glm::min( t0, t1 );
+        const auto exits = glm::max( t0, t1 );
+        const auto entry = std::max( { entries.x, entries.y, entries.z } );
+        const auto exit = std::min( { exits.x, exits.y, exits.z } );
+        if ( entry > exit || exit < 0.0f )
+          continue;
+
+        const auto distance = entry >= 0.0f ? entry : exit;
+        if ( distance < closest )
+        {
+          closest = distance;
+          hit = static_cast<entt::entity>( i );
+        }
+      }
+      benchmark::DoNotOptimize( hit );
+    }
+  }
+}
+
+// the tree is rebuilt inside the loop since a pick builds it from scratch too
+static void BM_PickRayBVH( benchmark::State& state )
+{
+  const auto scene = makePickingBenchmarkScene( static_cast<uint32_t>( state.range( 0 ) ) );
+  kogayonon_core::PickingBVH bvh;
+
+  for ( auto _ : state )
+  {
+    bvh.clear();
+    for ( auto i = 0u; i < scene.boxes.size(); i++ )
+      bvh.add( scene.boxes[i], static_cast<entt::entity>( i ) );
+    bvh.build();
+
+    for ( const auto& [origin, direction] : scene.rays )
+      benchmark::DoNotOptimize( bvh.raycast( origin, direction ) );
+  }
+
+  state.counters["nodes"] = static_cast<double>( bvh.getNodes().size() );
+}
+
+/**
+ * @brief What TimeTracker does on every call, a mutex and a string keyed map, the real one needs sol to be included
+ */
+class StringKeyedTracker
+{
+public:
+  void update( const std::string& key )
+  {
+    std::lock_guard lock{ m_mutex };
+    const auto now = std::chrono::steady_clock::now();
+    auto& [last, duration] = m_durations[key];
+    duration = now - last;
+    last = now;
+  }
+
+private:
+  std::mutex m_mutex;
+  std::unordered_map<std::string, std::pair<std::chrono::steady_clock::time_point, std::chrono::duration<double>>>
+    m_durations;
+};
+
+static void BM_ProfileScopeStringKeyed( benchmark::State& state )
+{
+  static StringKeyedTracker tracker;
+
+  for ( auto _ : state )
+  {
+    // a scope needs a call when it starts and one when it ends
+    tracker.update( "AssetManager::addMesh" );
+    tracker.update( "AssetManager::addMesh" );
+  }
+}
+
+static void BM_ProfileScopeZone( benchmark::State& state )
+{
+  // the macro might be compiled out in this build so the scope is used directly
+  static constexpr kogayonon_utilities::ProfileZone zone{ "AssetManager::addMesh", __FILE__, __LINE__ };
+
+  for ( auto _ : state )
+  {
+    kogayonon_utilities::ZoneScope scope{ &zone };
+    benchmark::ClobberMemory();
+  }
+
+  // only the first thread drains, the others keep writing like worker threads would
+  if ( state.thread_index() == 0 )
+    kogayonon_utilities::CpuProfiler::drain( []( const kogayonon_utilities::ZoneSample&, uint32_t ) {} );
+}
+
+/**
+ * @brief Closed uv sphere of radius 1 with rows * rows * 2 triangles
+ */
+static auto makeSimplifierSphere( uint32_t rows, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices )
+{
+  const auto columns = rows * 2;
+  positions.clear();
+  indices.clear();
+
+  for ( auto row = 0u; row <= rows; row++ )
+  {
+    for ( auto column = 0u; column < columns; column++ )
+    {
+      const auto theta = glm::pi<float>() * row / rows;
+      const auto phi = glm::two_pi<float>() * column / columns;
+      positions.emplace_back(
+        std::sin( theta ) * std::cos( phi ), std::cos( theta ), std::sin( theta ) * std::sin( phi ) );
+    }
+  }
+
+  for ( auto row = 0u; row < rows; row++ )
+  {
+    for ( auto column = 0u; column < columns; column++ )
+    {
+      const auto a = row * columns + column;
+      const auto b = row * columns + ( column + 1 ) % columns;
+      indices.insert( indices.end(), { a, a + columns, b, b, a + columns, b + columns } );
+    }
+  }
+}
+
+// what AssetManager::addMesh does for a primitive, one level after the other
+static void BM_MeshSimplify( benchmark::State& state )
+{
+  std::vector<glm::vec3> positions;
+  std::vector<uint32_t> indices;
+  makeSimplifierSphere( static_cast<uint32_t>( state.range( 0 ) ), positions, indices );
+
+  float error = 0.0f;
+  for ( auto _ : state )
+  {
+    auto level = indices;
+    for ( const auto ratio : { 0.5f, 0.25f, 0.125f } )
+    {
+      auto simplified = kogayonon_utilities::simplifyMesh(
+        positions, level, static_cast<std::size_t>( indices.size() * ratio ) / 3 * 3, 0.08f );
+      error = simplified.error;
+      level = std::move( simplified.indices );
+    }
+    benchmark::DoNotOptimize( level.data() );
+  }
+
+  state.counters["triangles"] = static_cast<double>( indices.size() / 3 );
+  state.counters["error"] = error;
+}
+
+// range instances of a simplified sphere spread up to 200 units away from a 1080p camera
+static void BM_LodSelect( benchmark::State& state )
+{
+  std::vector<glm::vec3> positions;
+  std::vector<uint32_t> indices;
+  makeSimplifierSphere( 128, positions, indices );
+
+  std::vector<kogayonon_resources::Vertex> vertices( positions.size() );
+  for ( auto i = 0u; i < positions.size(); i++ )
+    vertices[i].translation = positions[i];
+
+  kogayonon_resources::Submesh submesh{ .indexCount = static_cast<uint32_t>( indices.size() ) };
+  submesh.bounds.expand( glm::vec3{ -1.0f } );
+  submesh.bounds.expand( glm::vec3{ 1.0f } );
+  submesh.sphere = kogayonon_resources::BoundingSphere{ .center = glm::vec3{ 0.0f }, .radius = 1.0f };
+
+  auto level = indices;
+  auto allIndices = indices;
+  for ( const auto ratio : { 0.5f, 0.25f, 0.125f } )
+  {
+    auto simplified =
+      kogayonon_utilities::simplifyMesh( positions, level, static_cast<std::size_t>( indices.size() * ratio ) / 3 * 3,
+                                         0.08f );
+    submesh.lods[submesh.lodCount - 1] =
+      kogayonon_resources::SubmeshLod{ .indexOffset = static_cast<uint32_t>( allIndices.size() ),
+                                       .indexCount = static_cast<uint32_t>( simplified.indices.size() ),
+                                       .error = simplified.error };
+    ++submesh.lodCount;
+    allIndices.insert( allIndices.end(), simplified.indices.begin(), simplified.indices.end() );
+    level = std::move( simplified.indices );
+  }
+
+  kogayonon_resources::Mesh mesh{ "lod", std::move( vertices ), std::move( allIndices ), { submesh } };
+  mesh.computeBounds();
+
+  std::mt19937 random{ 7 };
+  std::uniform_real_distribution<float> spread{ -200.0f, 200.0f };
+  const auto count = static_cast<uint32_t>( state.range( 0 ) );
+  std::vector<glm::mat4x3> models( count );
+  for ( auto& model : models )
+    model = glm::mat4x3{ glm::translate( glm::mat4{ 1.0f }, glm::vec3{ spread( random ), 0.0f, spread( random ) } ) };
+
+  kogayonon_core::LodSelector selector;
+  selector.setView(
+    glm::vec3{ 0.0f }, glm::perspective( glm::radians( 60.0f ), 16.0f / 9.0f, 0.1f, 1000.0f ), 1080.0f );
+
+  std::vector<uint8_t> lods( count, 0 );
+  for ( auto _ : state )
+  {
+    for ( auto i = 0u; i < count; i++ )
+      lods[i] = selector.select( mesh, models[i], lods[i] );
+    benchmark::DoNotOptimize( lods.data() );
+  }
+
+  // the index count is what the vertex shader runs over, minus the post transform cache
+  double lodIndices = 0.0;
+  for ( const auto lod : lods )
+    lodIndices += submesh.getLod( lod ).indexCount;
+
+  state.counters["indexReduction"] = static_cast<double>( indices.size() ) * count / lodIndices;
+}
+
+// every glTF in resources/models, run the benchmark from the folder resources is in
+static auto findBenchmarkModels() -> std::vector<std::string>
+{
+  std::vector<std::string> models;
+  std::error_code error;
+  for ( const auto& entry : std::filesystem::directory_iterator{ "resources/models", error } )
+  {
+    if ( entry.path().extension() == ".gltf" )
+      models.emplace_back( entry.path().string() );
+  }
+
+  std::sort( models.begin(), models.end() );
+  return models;
+}
+
+// reads every vertex and index like the buffer upload would, a mapping that is never touched costs nothing
+static auto touchGeometry( const kogayonon_resources::Mesh& mesh ) -> uint64_t
+{
+  uint64_t sum = 0;
+  for ( const auto& vertex : mesh.getVertexData() )
+    sum += static_cast<uint64_t>( vertex.translation.x );
+  for ( const auto index : mesh.getIndexData() )
+    sum += index;
+
+  return sum;
+}
+
+static void runMeshImport( benchmark::State& state, bool useCooked,
+                           kogayonon_utilities::TaskManager* pTaskManager = nullptr )
+{
+  const auto models = findBenchmarkModels();
+  if ( models.empty() )
+  {
+    state.SkipWithError( "no glTF in resources/models" );
+    return;
+  }
+
+  auto& assetManager = kogayonon_utilities::AssetManager::getInstance();
+
+  // cooks whatever is missing or stale so the loop only reads
+  if ( useCooked )
+  {
+    for ( const auto& model : models )
+      assetManager.importMesh( model, true );
+  }
+
+  uint64_t bytes = 0;
+  for ( auto _ : state )
+  {
+    for ( const auto& model : models )
+    {
+      const auto pMesh = assetManager.importMesh( model, useCooked, pTaskManager );
+      if ( !pMesh )
+        continue;
+
+      benchmark::DoNotOptimize( touchGeometry( *pMesh ) );
+      bytes += pMesh->getVertexData().size_bytes() + pMesh->getIndexData().size_bytes();
+    }
+  }
+
+  state.SetBytesProcessed( static_cast<int64_t>( bytes ) );
+  state.counters["models"] = static_cast<double>( models.size() );
+}
+
+static void BM_MeshImportGltf( benchmark::State& state )
+{
+  runMeshImport( state, false );
+}
+
+static void BM_MeshImportCooked( benchmark::State& state )
+{
+  runMeshImport( state, true );
+}
+
+static void BM_MeshImportGltfParallel( benchmark::State& state )
+{
+  kogayonon_utilities::TaskManager taskManager;
+  runMeshImport( state, false, &taskManager );
+}
+
+// gradients with some noise on top, flat colors would make every block trivial
+static auto makeCookImage( int size ) -> std::vector<uint8_t>
+{
+  std::mt19937 random{ 7 };
+  std::uniform_int_distribution<int> noise{ -12, 12 };
+  std::vector<uint8_t> pixels( static_cast<std::size_t>( size ) * size * 4 );
+  for ( auto y = 0; y < size; y++ )
+  {
+    for ( auto x = 0; x < size; x++ )
+    {
+      auto* pPixel = &pixels[( static_cast<std::size_t>( y ) * size + x ) * 4];
+      pPixel[0] = static_cast<uint8_t>( std::clamp( x * 255 / size + noise( random ), 0, 255 ) );
+      pPixel[1] = static_cast<uint8_t>( std::clamp( y * 255 / size + noise( random ), 0, 255 ) );
+      pPixel[2] = static_cast<uint8_t>( ( ( x / 16 + y / 16 ) % 2 ) * 160 + 40 );
+      pPixel[3] = 255;
+    }
+  }
+  return pixels;
+}
+
+static void BM_TextureCook( benchmark::State& state )
+{
+  const auto size = static_cast<int>( state.range( 0 ) );
+  const auto usage = state.range( 1 ) != 0 ? kogayonon_utilities::TextureUsage::Normal
+                                           : kogayonon_utilities::TextureUsage::Color;
+  const auto pixels = makeCookImage( size );
+
+  std::size_t cookedBytes = 0;
+  for ( auto _ : state )
+  {
+    const auto cooked = kogayonon_utilities::cookTexture( pixels.data(), size, size, usage );
+    cookedBytes = cooked.storage.size();
+    benchmark::DoNotOptimize( cooked.storage.data() );
+  }
+
+  // rgba8 with a full mip chain is a third bigger than the top level
+  const auto rgba8Bytes = static_cast<double>( pixels.size() ) * 4.0 / 3.0;
+  state.SetBytesProcessed( static_cast<int64_t>( state.iterations() * pixels.size() ) );
+  state.counters["compression"] = rgba8Bytes / static_cast<double>( std::max<std::size_t>( cookedBytes, 1 ) );
+}
+
 } // namespace kogayonon_benchmark
\ No newline at end of file
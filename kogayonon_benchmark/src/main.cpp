@@ -1,4 +1,26 @@
 #include "benchmark.hpp"
+#include <cstdlib>
+#include <new>
+
+// count every heap allocation so benchmarks can report allocations per frame
+void* operator new( std::size_t size )
+{
+  ++kogayonon_benchmark::allocationCount;
+  if ( auto p = std::malloc( size == 0 ? 1 : size ) )
+    return p;
+
+  throw std::bad_alloc{};
+}
+
+void operator delete( void* p ) noexcept
+{
+  std::free( p );
+}
+
+void operator delete( void* p, std::size_t ) noexcept
+{
+  std::free( p );
+}
 /**
  * @brief Performance benchmarks for core Kogayonon systems.
  *
@@ -110,6 +132,190 @@ BENCHMARK( kogayonon_benchmark::BM_JsonDeserialization )
   ->Arg( 1000000 )
   ->Unit( benchmark::kSecond );
 
+/**
+ * @brief Indirect draw list build, range is the amount of unique meshes (3 submeshes, 64 instances, 8 textures).
+ * The time is the CPU cost of rebuilding the command list every frame and the counter is how many commands it packs.
+ * Draw calls need a gl context, the performance window shows the ones a frame really issues.
+ */
+BENCHMARK( kogayonon_benchmark::BM_IndirectDrawListBuild )
+  ->Arg( 16 )
+  ->Arg( 256 )
+  ->Arg( 4096 )
+  ->Unit( benchmark::kMicrosecond );
+
+/**
+ * @brief Gathering the unique meshes for the three passes of a frame, range is the amount of mesh entities
+ * (32 unique meshes). BM_LegacyMeshGather is the old makeMeshesUnique walk, BM_RenderListGather iterates the
+ * RenderList owned by the scene. Both report time per frame and the allocationsPerFrame counter.
+ */
+BENCHMARK( kogayonon_benchmark::BM_LegacyMeshGather )
+  ->Arg( 1000 )
+  ->Arg( 10000 )
+  ->Arg( 100000 )
+  ->Unit( benchmark::kMicrosecond );
+
+BENCHMARK( kogayonon_benchmark::BM_RenderListGather )
+  ->Arg( 1000 )
+  ->Arg( 10000 )
+  ->Arg( 100000 )
+  ->Unit( benchmark::kMicrosecond );
+
+/**
+ * @brief Frustum culling of a grid of instances, range is the amount of instances. Includes gathering the world
+ * space spheres from the instance matrices, which prepareFrame does once, and one cull against a perspective
+ * frustum. The visible counter is how many instances survived.
+ */
+BENCHMARK( kogayonon_benchmark::BM_FrustumCull )
+  ->Arg( 1000 )
+  ->Arg( 10000 )
+  ->Arg( 100000 )
+  ->Unit( benchmark::kMicrosecond );
+
+/**
+ * @brief Uniform updates of one frame, range is the amount of draws that set a per draw uniform. ByName looks every
+ * location up by string and sets the camera matrices on every pass, Reflected uses the table built after linking and
+ * writes the matrices once into the frame constants block. lookupsPerFrame and matrixBytesPerFrame show what each
+ * frame sends.
+ */
+BENCHMARK( kogayonon_benchmark::BM_UniformUpdatesByName )
+  ->Arg( 64 )
+  ->Arg( 1024 )
+  ->Arg( 16384 )
+  ->Unit( benchmark::kMicrosecond );
+
+BENCHMARK( kogayonon_benchmark::BM_UniformUpdatesReflected )
+  ->Arg( 64 )
+  ->Arg( 1024 )
+  ->Arg( 16384 )
+  ->Unit( benchmark::kMicrosecond );
+
+/**
+ * @brief Point light shading against the light count, range is the amount of lights scattered in front of the camera.
+ * The shading runs the attenuation of the fragment shader for 64x36 sampled fragments on the CPU as a stand in for
+ * the fragment cost. BruteForce walks every light per fragment, Clustered only the lights of the fragment froxel and
+ * includes building the clusters, lightsPerFragment is the average amount of lights a fragment shaded.
+ */
+BENCHMARK( kogayonon_benchmark::BM_LightClusterBuild )
+  ->Arg( 64 )
+  ->Arg( 256 )
+  ->Arg( 1024 )
+  ->Arg( 4096 )
+  ->Unit( benchmark::kMicrosecond );
+
+BENCHMARK( kogayonon_benchmark::BM_LightShadingBruteForce )
+  ->Arg( 64 )
+  ->Arg( 256 )
+  ->Arg( 1024 )
+  ->Arg( 4096 )
+  ->Unit( benchmark::kMicrosecond );
+
+BENCHMARK( kogayonon_benchmark::BM_LightShadingClustered )
+  ->Arg( 64 )
+  ->Arg( 256 )
+  ->Arg( 1024 )
+  ->Arg( 4096 )
+  ->Unit( benchmark::kMicrosecond );
+
+/**
+ * @brief Deleting range(1) of range(0) instances that share a mesh, one at a time like the editor does. Erase is the
+ * old removeInstanceData, SwapPop the dense pool with the slot to entity back pointer. uploadBytes is what each
+ * approach sends to the instance buffer for all the deletions together. Erase is quadratic so it only runs once.
+ */
+BENCHMARK( kogayonon_benchmark::BM_InstanceRemoveErase )
+  ->Args( { 100000, 10000 } )
+  ->Iterations( 1 )
+  ->Unit( benchmark::kMillisecond );
+
+BENCHMARK( kogayonon_benchmark::BM_InstanceRemoveSwapPop )
+  ->Args( { 100000, 10000 } )
+  ->Unit( benchmark::kMillisecond );
+
+/**
+ * @brief The per vertex work of 3d_vertex on the CPU for range instances of a 24 vertex mesh. Inverse is the old 72
+ * byte instance with a mat4 and an inverse per vertex, ColumnScale the 48 byte 3x4 matrix with the normal matrix built
+ * from the column lengths. instanceBytes is what the whole instance buffer takes for each layout.
+ */
+BENCHMARK( kogayonon_benchmark::BM_InstanceVertexInverse )
+  ->Arg( 1024 )
+  ->Arg( 16384 )
+  ->Unit( benchmark::kMicrosecond );
+
+BENCHMARK( kogayonon_benchmark::BM_InstanceVertexColumnScale )
+  ->Arg( 1024 )
+  ->Arg( 16384 )
+  ->Unit( benchmark::kMicrosecond );
+
+/**
+ * @brief The cpu picking fallback, 64 rays against range boxes. BruteForce tests every box for every ray, BVH builds
+ * the tree like a click does and walks it, nodes is the size of the tree.
+ */
+BENCHMARK( kogayonon_benchmark::BM_PickRayBruteForce )
+  ->Arg( 1000 )
+  ->Arg( 10000 )
+  ->Arg( 100000 )
+  ->Unit( benchmark::kMicrosecond );
+
+BENCHMARK( kogayonon_benchmark::BM_PickRayBVH )
+  ->Arg( 1000 )
+  ->Arg( 10000 )
+  ->Arg( 100000 )
+  ->Unit( benchmark::kMicrosecond );
+
+/**
+ * @brief Cost of timing one scope. StringKeyed is the TimeTracker way with a mutex and a string hash per call, Zone the
+ * static zone written into the ring of the calling thread. The threaded runs show the mutex being fought over.
+ */
+BENCHMARK( kogayonon_benchmark::BM_ProfileScopeStringKeyed )
+  ->Threads( 1 )
+  ->Threads( 4 )
+  ->Unit( benchmark::kNanosecond );
+
+BENCHMARK( kogayonon_benchmark::BM_ProfileScopeZone )
+  ->Threads( 1 )
+  ->Threads( 4 )
+  ->Unit( benchmark::kNanosecond );
+
+/**
+ * @brief Level of detail. Simplify is the import cost of the three levels of a sphere with range rows, Select picks a
+ * level for range instances and indexReduction is how many times fewer indices they draw than at full detail.
+ */
+BENCHMARK( kogayonon_benchmark::BM_MeshSimplify )
+  ->Arg( 64 )
+  ->Arg( 256 )
+  ->Unit( benchmark::kMillisecond );
+
+BENCHMARK( kogayonon_benchmark::BM_LodSelect )
+  ->Arg( 10000 )
+  ->Arg( 100000 )
+  ->Unit( benchmark::kMicrosecond );
+
+/**
+ * @brief Loading every glTF in resources/models. Gltf parses them with cgltf and builds the levels of detail like the
+ * first import does, Cooked maps the .kmesh files next to them. Both read the whole geometry once like the upload does.
+ */
+BENCHMARK( kogayonon_benchmark::BM_MeshImportGltf )
+  ->Unit( benchmark::kMillisecond );
+
+BENCHMARK( kogayonon_benchmark::BM_MeshImportCooked )
+  ->Unit( benchmark::kMillisecond );
+
+/**
+ * @brief The glTF import with the primitives decoded and simplified on a task manager with a worker per core, the
+ * calling thread decodes too. Files with a single primitive gain nothing
+ */
+BENCHMARK( kogayonon_benchmark::BM_MeshImportGltfParallel )
+  ->Unit( benchmark::kMillisecond );
+
+/**
+ * @brief The texture cook, resampling, mips and block compression of a range square image. The second argument picks
+ * BC5 normals over BC7 color and compression is how many times smaller the result is than RGBA8 with mips.
+ */
+BENCHMARK( kogayonon_benchmark::BM_TextureCook )
+  ->Args( { 256, 0 } )
+  ->Args( { 1024, 0 } )
+  ->Args( { 1024, 1 } )
+  ->Unit( benchmark::kMillisecond );
+
 // this is very slow, for 100k transforms we would get 40seconds and for a million 436seconds, roughly 7 minutes
 // compared to 34s on json
 // JSON IS 10 TIMES FASTER
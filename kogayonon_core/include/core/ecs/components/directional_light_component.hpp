@@ -15,6 +15,15 @@ struct DirectionalLightComponent
   float orthoSize{ 70.0f };
   float positionFactor{ 20.0f };
 
+  // 1 keeps the single shadow map above, 2 to 4 split the camera frustum into cascades and ignore the ortho box
+  int cascadeCount{ 1 };
+
+  // 0 splits the cascades evenly, 1 logarithmically which gives the ones close to the camera more texels
+  float cascadeSplitLambda{ 0.75f };
+
+  // where the last cascade ends, the camera far plane is usually too far for shadows
+  float cascadeDistance{ 100.0f };
+
   static void createLuaBindings( sol::state& lua )
   {
     lua.new_usertype<DirectionalLightComponent>(
@@ -36,7 +45,13 @@ struct DirectionalLightComponent
       "orthoSize",
       &DirectionalLightComponent::orthoSize,
       "positionFactor",
-      &DirectionalLightComponent::positionFactor );
+      &DirectionalLightComponent::positionFactor,
+      "cascadeCount",
+      &DirectionalLightComponent::cascadeCount,
+      "cascadeSplitLambda",
+      &DirectionalLightComponent::cascadeSplitLambda,
+      "cascadeDistance",
+      &DirectionalLightComponent::cascadeDistance );
   }
 };
 } // namespace kogayonon_core
@@ -53,6 +68,9 @@ struct convert<kogayonon_core::DirectionalLightComponent>
     node["farPlane"] = directionalLightComp.farPlane;
     node["orthoSize"] = directionalLightComp.orthoSize;
     node["positionFactor"] = directionalLightComp.positionFactor;
+    node["cascadeCount"] = directionalLightComp.cascadeCount;
+    node["cascadeSplitLambda"] = directionalLightComp.cascadeSplitLambda;
+    node["cascadeDistance"] = directionalLightComp.cascadeDistance;
     return node;
   }
 
@@ -62,6 +80,14 @@ struct convert<kogayonon_core::DirectionalLightComponent>
     directionalLightComp.farPlane = node["farPlane"].as<float>();
     directionalLightComp.positionFactor = node["positionFactor"].as<float>();
     directionalLightComp.orthoSize = node["orthoSize"].as<float>();
+
+    // scenes saved before cascades existed keep the defaults
+    if ( node["cascadeCount"] )
+      directionalLightComp.cascadeCount = node["cascadeCount"].as<int>();
+    if ( node["cascadeSplitLambda"] )
+      directionalLightComp.cascadeSplitLambda = node["cascadeSplitLambda"].as<float>();
+    if ( node["cascadeDistance"] )
+      directionalLightComp.cascadeDistance = node["cascadeDistance"].as<float>();
     return true;
   }
 };
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace kogayonon_resources
+{
+class Mesh;
+} // namespace kogayonon_resources
+
+namespace kogayonon_core
+{
+// the picking pass reads the entity of every instance from here, indexed like the instance stream
+inline constexpr uint32_t instanceEntityBinding = 12;
+
+// entities of the mesh being culled, the culling shader copies the visible ones to instanceEntityBinding
+inline constexpr uint32_t cullEntityBinding = 13;
+
+/**
+ * @brief What every pass reads per instance, the model matrix without its last row which is always 0 0 0 1. The
+ * entity ids and the selection live in their own arrays since only picking and outlining care about them
+ */
+struct GPUInstance
+{
+  glm::mat4x3 instanceMatrix{ 1.0f };
+};
+
+static_assert( sizeof( GPUInstance ) == 48, "the shaders read GPUInstance as 4 vec3 columns" );
+static_assert( sizeof( entt::entity ) == sizeof( uint32_t ), "entity ids are uploaded as uint" );
+
+struct InstanceData
+{
+  // the buffer in which we upload the instance matrices
+  uint32_t instanceBuffer{ 0 };
+
+  // the entities of the instances, same order as instanceBuffer
+  uint32_t entityBuffer{ 0 };
+
+  // instance vector
+  std::vector<GPUInstance> instances;
+
+  // the entity that owns each slot, the IndexComponent of an entity points back into this
+  std::vector<entt::entity> entities;
+
+  // 1 for the instance that is outlined, never uploaded
+  std::vector<uint8_t> selected;
+
+  // level of detail the instance was drawn at last, the next level is picked relative to it
+  std::vector<uint8_t> lods;
+
+  // slots changed since the last flush, may hold duplicates and slots that were removed in the meantime
+  std::vector<uint32_t> dirtySlots;
+
+  // the amount of instances that will be drawn for a specific model using glDrawElementsInstanced
+  int count{ 1 };
+
+  // pointer to the mesh, we use this as a key in unordered_map<Model*,unique_ptr<InstanceData>>
+  kogayonon_resources::Mesh* pMesh{ nullptr };
+
+  /**
+   * @brief Appends an instance owned by entity
+   * @return The slot of the new instance
+   */
+  inline auto addInstance( entt::entity entity, const GPUInstance& instance ) -> uint32_t
+  {
+    instances.emplace_back( instance );
+    entities.emplace_back( entity );
+    selected.emplace_back( 0 );
+    lods.emplace_back( 0 );
+    count = static_cast<int>( instances.size() );
+    return static_cast<uint32_t>( instances.size() - 1 );
+  }
+
+  /**
+   * @brief Removes the instance in slot by moving the last one into it, the other slots keep their index
+   * @return The entity whose instance now lives in slot, entt::null if slot was the last one and nothing moved
+   */
+  inline auto removeInstance( uint32_t slot ) -> entt::entity
+  {
+    const auto last = static_cast<uint32_t>( instances.size() - 1 );
+    auto moved = entt::entity{ entt::null };
+    if ( slot != last )
+    {
+      instances[slot] = instances[last];
+      entities[slot] = entities[last];
+      selected[slot] = selected[last];
+      lods[slot] = lods[last];
+      moved = entities[slot];
+    }
+
+    instances.pop_back();
+    entities.pop_back();
+    selected.pop_back();
+    lods.pop_back();
+    count = static_cast<int>( instances.size() );
+    return moved;
+  }
+};
+} // namespace kogayonon_core
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <entt/entt.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace kogayonon_resources
+{
+class Mesh;
+} // namespace kogayonon_resources
+
+namespace kogayonon_core
+{
+/**
+ * @brief Flat list of the unique meshes used by the entities of a registry. It listens to MeshComponent
+ * construct/update/destroy signals so it is only touched when a mesh is added, swapped or removed and the passes can
+ * iterate it every frame without allocating. The signals fire on whatever thread edits the registry, so that has to
+ * be the render thread, workers go through Scene::queueMeshForEntity
+ */
+class RenderList
+{
+public:
+  RenderList() = default;
+  ~RenderList() = default;
+
+  RenderList( const RenderList& ) = delete;
+  RenderList& operator=( const RenderList& ) = delete;
+
+  /**
+   * @brief Hooks the list to the MeshComponent signals of a registry, entities that already have a mesh are added
+   * @param registry The registry we listen to
+   */
+  void connect( entt::registry& registry );
+
+  /**
+   * @brief Stops listening and clears the list
+   * @param registry Same registry passed to connect
+   */
+  void disconnect( entt::registry& registry );
+
+  inline auto getMeshes() const -> const std::vector<kogayonon_resources::Mesh*>&
+  {
+    return m_meshes;
+  }
+
+  /**
+   * @brief How many entities use the mesh at index
+   */
+  inline auto getRefCount( std::size_t index ) const -> uint32_t
+  {
+    return m_refCounts.at( index );
+  }
+
+  inline auto size() const -> std::size_t
+  {
+    return m_meshes.size();
+  }
+
+private:
+  void onMeshConstruct( entt::registry& registry, entt::entity entity );
+  void onMeshUpdate( entt::registry& registry, entt::entity entity );
+  void onMeshDestroy( entt::registry& registry, entt::entity entity );
+
+  void addMesh( kogayonon_resources::Mesh* pMesh );
+  void removeMesh( kogayonon_resources::Mesh* pMesh );
+
+private:
+  // m_meshes and m_refCounts are parallel arrays, m_slots gives the index of a mesh in both
+  std::vector<kogayonon_resources::Mesh*> m_meshes;
+  std::vector<uint32_t> m_refCounts;
+  std::unordered_map<kogayonon_resources::Mesh*, std::size_t> m_slots;
+
+  // the mesh each entity added to the list, on_update only gives us the new component
+  std::unordered_map<entt::entity, kogayonon_resources::Mesh*> m_entityMeshes;
+};
+} // namespace kogayonon_core
@@ -1,10 +1,15 @@
 #pragma once
 #include <entt/entt.hpp>
 #include <memory>
+#include <mutex>
 #include <spdlog/spdlog.h>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include "core/ecs/entity.hpp"
+#include "core/scene/instance_data.hpp"
+#include "core/scene/render_list.hpp"
 #include "rendering/light_shader_storagebuffer.hpp"
 #include "rendering/lightcount_uniformbuffer.hpp"
 #include "resources/directional_light.hpp"
@@ -18,34 +23,11 @@ struct DirectionalLightComponent;
 
 namespace kogayonon_core
 {
-struct GPUInstance
-{
-  // this flag might get tossed out
-  uint32_t selected{ 0 };
-  int entityId{ -1 };
-  glm::mat4 instanceMatrix;
-};
-
-struct InstanceData
-{
-  // the buffer in which we upload the instance matrices
-  uint32_t instanceBuffer{ 0 };
-
-  // instance vector
-  std::vector<GPUInstance> instances;
-
-  // the amount of instances that will be drawn for a specific model using glDrawElementsInstanced
-  int count{ 1 };
-
-  // pointer to the mesh, we use this as a key in unordered_map<Model*,unique_ptr<InstanceData>>
-  kogayonon_resources::Mesh* pMesh{ nullptr };
-};
-
 class Scene
 {
 public:
   Scene( const std::string& name );
-  ~Scene() = default;
+  ~Scene();
 
   /**
    * @brief This returns the wrapper around entt::registry
@@ -62,14 +44,9 @@ public:
   auto getName() const -> std::string;
   void changeName( const std::string& name );
 
-  inline auto getRegistryMutex() -> std::mutex&
-  {
-    return m_registryMutex;
-  }
-
   /**
    * @brief Goes through all the entities that were loaded async on another thread and require OpenGL calls to upload
-   * mesh geometry and textures to the gpu and does that
+   * mesh geometry and textures to the gpu and does that. Meshes queued by the workers get attached first
    */
   void prepareForRendering();
 
@@ -105,6 +82,14 @@ public:
    */
   void addMeshToEntity( entt::entity entity, kogayonon_resources::Mesh* pMesh );
 
+  /**
+   * @brief The only scene call the workers may make, the mesh gets attached by the next prepareForRendering on the
+   * render thread since neither the registry nor the render list can be touched from two threads
+   * @param entity The entity id, skipped if it is gone by then
+   * @param pMesh The mesh the worker imported
+   */
+  void queueMeshForEntity( entt::entity entity, kogayonon_resources::Mesh* pMesh );
+
   /**
    * @brief Removes the MeshComponent from the entity and clears the related data in the instance data struct
    * @param entity The entity we edit
@@ -131,11 +116,16 @@ public:
   auto getData( kogayonon_resources::Mesh* pModel ) -> InstanceData*;
 
   /**
-   * @brief Updates the already existing buffers,
-   * call only when updating existing entities
+   * @brief Marks one instance as changed, everything marked during a frame goes up together in flushInstances
    * @param data Pointer to the instance data that the model belongs to
+   * @param index Slot of the instance, the index of its IndexComponent
    */
-  void updateInstances( InstanceData* data );
+  void markInstanceDirty( InstanceData* data, uint32_t index );
+
+  /**
+   * @brief Uploads the marked instances, slots close to each other are merged so every mesh needs a few uploads at most
+   */
+  void flushInstances();
 
   /**
    * @brief Uploads the data to the GPU, call when
@@ -143,6 +133,26 @@ public:
    */
   void setupInstances( InstanceData* data );
 
+  /**
+   * @brief Links an instance buffer to binding 1 of a vao and describes the GPUInstance layout
+   * @param vao The vao the instance attributes are added to
+   * @param instanceBuffer Buffer that holds GPUInstance elements
+   */
+  static void bindInstanceBuffer( uint32_t vao, uint32_t instanceBuffer );
+
+  /**
+   * @brief Unique meshes of the scene, kept up to date by MeshComponent signals
+   */
+  inline auto getRenderList() const -> const RenderList&
+  {
+    return m_renderList;
+  }
+
+  inline auto getInstances() -> std::unordered_map<kogayonon_resources::Mesh*, std::unique_ptr<InstanceData>>&
+  {
+    return m_instances;
+  }
+
   /**
    * @brief Iterates through the entities that have rigid bodies and
    * take the transforms from there and apply them to the models
@@ -159,9 +169,23 @@ public:
   void bindLightBuffers();
   void unbindLightBuffers();
 
+  /**
+   * @brief Uploads the lights marked dirty and the light counts
+   */
   void updateLightBuffers();
 
+  /**
+   * @brief Call after editing a light through getPointLight or getDirectionalLight, only that light is uploaded on the
+   * next frame
+   */
+  void markLightDirty( const kogayonon_resources::LightType& type, uint32_t index );
+
   auto getPointLight( uint32_t index ) -> kogayonon_resources::PointLight&;
+
+  /**
+   * @brief Every point light in the order of the light buffer
+   */
+  auto getPointLights() -> const std::vector<kogayonon_resources::PointLight>&;
   auto getDirectionalLight( uint32_t index = 0 ) -> kogayonon_resources::DirectionalLight&;
 
   auto getLightCount( const kogayonon_resources::LightType& type ) -> uint32_t;
@@ -180,12 +204,19 @@ private:
   // this bool should be used to prepare entities for rendering
   bool m_registryModified{ false };
 
-  std::mutex m_registryMutex;
+  // meshes the workers finished, only this is shared with them
+  std::mutex m_pendingMutex;
+  std::vector<std::pair<entt::entity, kogayonon_resources::Mesh*>> m_pendingMeshes;
+
   uint32_t m_entityCount;
   std::string m_name;
   std::unique_ptr<Registry> m_pRegistry;
   std::unordered_map<kogayonon_resources::Mesh*, std::unique_ptr<InstanceData>> m_instances;
 
+  // instance data with marked slots, each one is in here once
+  std::vector<InstanceData*> m_dirtyInstances;
+  RenderList m_renderList;
+
   kogayonon_rendering::LightCountUniformbuffer m_lightUBO;
   kogayonon_rendering::LightShaderStoragebuffer m_lightSSBO;
 };
@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+#include "core/scene/instance_data.hpp"
+
+namespace kogayonon_resources
+{
+struct BoundingSphere;
+} // namespace kogayonon_resources
+
+namespace kogayonon_core
+{
+/**
+ * @brief The 6 planes of a view frustum, xyz is the normal pointing inside and w the distance
+ */
+struct Frustum
+{
+  std::array<glm::vec4, 6> planes;
+
+  /**
+   * @brief Extracts the planes from projection * view, works for perspective and ortho projections
+   */
+  static auto fromMatrix( const glm::mat4& viewProjection ) -> Frustum;
+};
+
+/**
+ * @brief Keeps the world space bounding spheres of every instance in SoA form and tests them against a frustum four
+ * at a time. Spheres are gathered once per frame and every pass culls them against its own frustum
+ */
+class CullingSystem
+{
+public:
+  CullingSystem() = default;
+  ~CullingSystem() = default;
+
+  void clear();
+
+  /**
+   * @brief Transforms the mesh sphere by every instance matrix and stores the result
+   * @param localSphere Object space sphere of the mesh
+   * @param instances Instances of the mesh
+   * @param count How many instances are drawn
+   * @return Index of the first sphere that belongs to these instances
+   */
+  auto addInstances( const kogayonon_resources::BoundingSphere& localSphere, const std::vector<GPUInstance>& instances,
+                     uint32_t count ) -> uint32_t;
+
+  /**
+   * @brief Tests count spheres starting from first and appends the indices of the visible ones relative to first
+   * @param frustum The frustum of the pass
+   * @param first First sphere
+   * @param count Amount of spheres
+   * @param visible Output, not cleared
+   * @return How many spheres were visible
+   */
+  auto cull( const Frustum& frustum, uint32_t first, uint32_t count, std::vector<uint32_t>& visible ) -> uint32_t;
+
+  inline auto size() const -> std::size_t
+  {
+    return m_radius.size();
+  }
+
+private:
+  std::vector<float> m_centerX;
+  std::vector<float> m_centerY;
+  std::vector<float> m_centerZ;
+  std::vector<float> m_radius;
+};
+} // namespace kogayonon_core
@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "core/scene/instance_data.hpp"
+
+namespace kogayonon_resources
+{
+class Mesh;
+} // namespace kogayonon_resources
+
+namespace kogayonon_core
+{
+/**
+ * @brief Layout expected by glMultiDrawElementsIndirect, do not reorder the fields
+ */
+struct DrawElementsIndirectCommand
+{
+  uint32_t count{ 0 };
+  uint32_t instanceCount{ 0 };
+  uint32_t firstIndex{ 0 };
+  int32_t baseVertex{ 0 };
+  uint32_t baseInstance{ 0 };
+};
+
+/**
+ * @brief The commands that belong to a single mesh, used when the meshes are drawn with their own vao. A mesh drawn at
+ * more than one level of detail gets a range per level
+ */
+struct IndirectMeshRange
+{
+  kogayonon_resources::Mesh* pMesh{ nullptr };
+  uint32_t firstCommand{ 0 };
+  uint32_t commandCount{ 0 };
+};
+
+/**
+ * @brief Builds the indirect commands and the flat instance array for a frame, the vectors keep their capacity
+ * between frames so after the first few frames building the list does not allocate. The entity of every packed
+ * instance is kept in a parallel array for the picking pass
+ */
+class IndirectDrawList
+{
+public:
+  IndirectDrawList() = default;
+  ~IndirectDrawList() = default;
+
+  void clear();
+
+  /**
+   * @brief Appends one command per submesh, every command of the mesh points to the same instance range
+   * @param pMesh The mesh we draw
+   * @param vertexOffset Where the mesh vertices start in the shared vertex buffer
+   * @param indexOffset Where the mesh indices start in the shared index buffer
+   * @param data Instances of the mesh and the entities that own them
+   * @param count How many of the instances are drawn
+   */
+  void addMesh( kogayonon_resources::Mesh* pMesh, uint32_t vertexOffset, uint32_t indexOffset,
+                const InstanceData& data, uint32_t count );
+
+  /**
+   * @brief Same as addMesh but only the instances at the visible indices are packed
+   * @param visible Indices into the instances that survived culling
+   * @param firstVisible First index in visible that belongs to this mesh
+   * @param visibleCount How many indices belong to this mesh
+   * @param lod Level of detail the commands draw, submeshes with fewer levels draw their coarsest one
+   */
+  void addMesh( kogayonon_resources::Mesh* pMesh, uint32_t vertexOffset, uint32_t indexOffset,
+                const InstanceData& data, const std::vector<uint32_t>& visible, uint32_t firstVisible,
+                uint32_t visibleCount, uint32_t lod = 0 );
+
+  /**
+   * @brief Appends the commands of a mesh with no instances, used when the instance counts are written on the gpu
+   * @param baseInstance Where the instances of the mesh start in the buffer the gpu fills
+   */
+  void addMeshCommands( kogayonon_resources::Mesh* pMesh, uint32_t vertexOffset, uint32_t indexOffset,
+                        uint32_t baseInstance );
+
+  inline auto getCommands() const -> const std::vector<DrawElementsIndirectCommand>&
+  {
+    return m_commands;
+  }
+
+  inline auto getInstances() const -> const std::vector<GPUInstance>&
+  {
+    return m_instances;
+  }
+
+  inline auto getEntities() const -> const std::vector<entt::entity>&
+  {
+    return m_entities;
+  }
+
+  inline auto getMeshRanges() const -> const std::vector<IndirectMeshRange>&
+  {
+    return m_meshRanges;
+  }
+
+  inline auto empty() const -> bool
+  {
+    return m_commands.empty();
+  }
+
+private:
+  void addCommands( kogayonon_resources::Mesh* pMesh, uint32_t vertexOffset, uint32_t indexOffset,
+                    uint32_t baseInstance, uint32_t count, uint32_t lod = 0 );
+
+private:
+  std::vector<DrawElementsIndirectCommand> m_commands;
+  std::vector<GPUInstance> m_instances;
+  std::vector<entt::entity> m_entities;
+  std::vector<IndirectMeshRange> m_meshRanges;
+};
+} // namespace kogayonon_core
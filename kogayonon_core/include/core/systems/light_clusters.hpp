@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+#include "resources/pointlight.hpp"
+
+namespace kogayonon_core
+{
+/**
+ * @brief Where the lights of a cluster start in the index list and how many there are, mirrored by the LightCluster struct in 3d_fragment
+ */
+struct LightCluster
+{
+  uint32_t offset{ 0 };
+  uint32_t count{ 0 };
+};
+
+/**
+ * @brief Bins the point lights into a grid of froxels, screen tiles split into slices that get exponentially deeper,
+ * so a fragment only loops over the lights whose sphere touches its froxel instead of every light in the scene
+ */
+class LightClusters
+{
+public:
+  static constexpr uint32_t gridX = 16;
+  static constexpr uint32_t gridY = 9;
+  static constexpr uint32_t gridZ = 24;
+  static constexpr uint32_t clusterCount = gridX * gridY * gridZ;
+
+  static constexpr uint32_t clusterBinding = 10;
+  static constexpr uint32_t lightIndexBinding = 11;
+
+  LightClusters() = default;
+  ~LightClusters() = default;
+
+  /**
+   * @brief Rebuilds the clusters for a camera, disabled lights and lights outside the frustum are left out
+   * @param lights Point lights in the order of the light buffer, the indices point into it
+   * @param view View matrix of the camera
+   * @param projection Perspective projection of the camera, near and far are read back from it
+   */
+  void build( const std::vector<kogayonon_resources::PointLight>& lights, const glm::mat4& view,
+              const glm::mat4& projection );
+
+  /**
+   * @brief Distance where the attenuation in params drops the light below 1/256 of its brightest channel
+   */
+  static auto computeLightRadius( const kogayonon_resources::PointLight& light ) -> float;
+
+  /**
+   * @brief Froxel of a fragment, the same math the fragment shader does
+   * @param ndc Normalized device xy of the fragment
+   * @param viewDepth Positive view space depth
+   */
+  auto getClusterIndex( const glm::vec2& ndc, float viewDepth ) const -> uint32_t;
+
+  inline auto getClusters() const -> const std::vector<LightCluster>&
+  {
+    return m_clusters;
+  }
+
+  inline auto getLightIndices() const -> const std::vector<uint32_t>&
+  {
+    return m_lightIndices;
+  }
+
+  /**
+   * @brief slice = log(depth) * scale + bias
+   */
+  inline auto getSliceScale() const -> float
+  {
+    return m_sliceScale;
+  }
+
+  inline auto getSliceBias() const -> float
+  {
+    return m_sliceBias;
+  }
+
+  /**
+   * @brief How many lights ended up in at least one cluster
+   */
+  inline auto getBinnedLightCount() const -> uint32_t
+  {
+    return static_cast<uint32_t>( m_bounds.size() );
+  }
+
+private:
+  // froxel range a light covers, kept between the counting and the filling pass
+  struct LightBounds
+  {
+    uint32_t light;
+    uint32_t minX, maxX;
+    uint32_t minY, maxY;
+    uint32_t minZ, maxZ;
+  };
+
+  auto getSlice( float viewDepth ) const -> uint32_t;
+
+private:
+  std::vector<LightCluster> m_clusters;
+  std::vector<uint32_t> m_lightIndices;
+  std::vector<LightBounds> m_bounds;
+  float m_sliceScale{ 0.0f };
+  float m_sliceBias{ 0.0f };
+};
+} // namespace kogayonon_core
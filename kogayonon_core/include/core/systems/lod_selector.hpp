@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace kogayonon_resources
+{
+class Mesh;
+} // namespace kogayonon_resources
+
+namespace kogayonon_core
+{
+/**
+ * @brief Picks the level of detail of an instance from how many pixels the error of every level covers on screen. The
+ * coarsest level whose error stays under the pixel budget wins, a level only changes once the error crosses the budget
+ * by the hysteresis margin so an instance sitting right at the threshold does not flicker between two levels
+ */
+class LodSelector
+{
+public:
+  LodSelector() = default;
+  ~LodSelector() = default;
+
+  /**
+   * @brief Camera the levels are picked for, call it once per frame before the passes
+   * @param cameraPosition World position of the camera
+   * @param projection Projection of the camera, perspective or orthographic
+   * @param viewportHeight Height of the viewport in pixels
+   */
+  void setView( const glm::vec3& cameraPosition, const glm::mat4& projection, float viewportHeight );
+
+  /**
+   * @brief Level an instance should be drawn at
+   * @param mesh The mesh of the instance
+   * @param model Instance matrix
+   * @param current Level the instance got the last time
+   */
+  auto select( const kogayonon_resources::Mesh& mesh, const glm::mat4x3& model, uint8_t current ) const -> uint8_t;
+
+  /**
+   * @brief On screen size of an error of one mesh space unit, for an instance of the mesh
+   */
+  auto getPixelsPerUnit( const kogayonon_resources::Mesh& mesh, const glm::mat4x3& model ) const -> float;
+
+  inline void setPixelError( float value )
+  {
+    m_pixelError = value;
+  }
+
+  inline auto getPixelError() const -> float
+  {
+    return m_pixelError;
+  }
+
+  /**
+   * @brief Share of the pixel error a level has to cross the budget by before the instance switches
+   */
+  inline void setHysteresis( float value )
+  {
+    m_hysteresis = value;
+  }
+
+  inline auto getHysteresis() const -> float
+  {
+    return m_hysteresis;
+  }
+
+private:
+  /**
+   * @brief Coarsest level whose error covers at most threshold pixels
+   */
+  auto findLevel( const kogayonon_resources::Mesh& mesh, float pixelsPerUnit, float threshold ) const -> uint8_t;
+
+private:
+  glm::vec3 m_cameraPosition{ 0.0f };
+
+  // half the viewport height times the focal length, pixels per unit at a distance of 1
+  float m_pixelScale{ 0.0f };
+  bool m_orthographic{ false };
+
+  float m_pixelError{ 1.0f };
+  float m_hysteresis{ 0.25f };
+};
+} // namespace kogayonon_core
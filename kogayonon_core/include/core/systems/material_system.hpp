@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace kogayonon_rendering
+{
+class GPUBuffer;
+} // namespace kogayonon_rendering
+
+namespace kogayonon_resources
+{
+class Mesh;
+class Texture;
+struct Submesh;
+} // namespace kogayonon_resources
+
+namespace kogayonon_core
+{
+class TextureResidency;
+
+/**
+ * @brief Material as the geometry shader reads it from the material buffer, keep it in sync with 3d_fragment.glsl
+ */
+struct GPUMaterial
+{
+  uint32_t page{ 0 };
+  uint32_t layer{ 0 };
+
+  // bit 0 is set when the material samples a base color texture
+  uint32_t flags{ 0 };
+  uint32_t padding{ 0 };
+  glm::vec4 baseColorFactor{ 1.0f };
+};
+
+/**
+ * @brief Owns every material the renderer knows about, their textures live in texture array pages so switching
+ * materials never binds a texture. Index 0 is an untextured white material used by meshes without materials.
+ * A material samples nothing until the residency gave its texture a layer, it follows the layer from then on
+ */
+class MaterialSystem
+{
+public:
+  static constexpr uint32_t materialBinding = 8;
+  static constexpr uint32_t drawMaterialBinding = 9;
+  static constexpr uint32_t firstPageUnit = 5;
+
+  MaterialSystem();
+  ~MaterialSystem();
+
+  /**
+   * @brief Copies the materials of a mesh into the material buffer and hands their textures to the residency
+   * @param pMesh The mesh
+   */
+  void registerMesh( kogayonon_resources::Mesh* pMesh );
+
+  auto contains( kogayonon_resources::Mesh* pMesh ) const -> bool;
+
+  /**
+   * @brief Index of the material of a submesh inside the material buffer, the default material if the mesh was not
+   * registered yet
+   */
+  auto getMaterialIndex( kogayonon_resources::Mesh* pMesh, const kogayonon_resources::Submesh& submesh ) const
+    -> uint32_t;
+
+  /**
+   * @brief Tells the residency how big the textures of a registered mesh show up this frame
+   * @param pixels On screen size of the whole mesh at its closest instance
+   */
+  void useTextures( kogayonon_resources::Mesh* pMesh, float pixels );
+
+  /**
+   * @brief Lets the residency stream and evict, the materials of textures that moved get their new layer
+   */
+  void updateResidency();
+
+  /**
+   * @brief Uploads the materials if they changed and binds the material buffer plus the texture pages
+   */
+  void bind();
+
+  inline auto getMaterialCount() const -> std::size_t
+  {
+    return m_materials.size();
+  }
+
+  inline auto getResidency() -> TextureResidency&
+  {
+    return *m_pResidency;
+  }
+
+private:
+  bool m_dirty{ true };
+  std::vector<GPUMaterial> m_materials;
+  std::unordered_map<kogayonon_resources::Mesh*, uint32_t> m_firstMaterial;
+
+  // materials that sample a texture and the textures each mesh samples
+  std::unordered_map<kogayonon_resources::Texture*, std::vector<uint32_t>> m_textureMaterials;
+  std::unordered_map<kogayonon_resources::Mesh*, std::vector<kogayonon_resources::Texture*>> m_meshTextures;
+
+  std::unique_ptr<kogayonon_rendering::GPUBuffer> m_pMaterialBuffer;
+  std::unique_ptr<TextureResidency> m_pResidency;
+};
+} // namespace kogayonon_core
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include "resources/bounds.hpp"
+
+namespace kogayonon_core
+{
+/**
+ * @brief A node covers the boxes [first, first + count) of the sorted order when it is a leaf, otherwise count is 0 and
+ * its children are first and first + 1
+ */
+struct PickingNode
+{
+  kogayonon_resources::AABB bounds;
+  uint32_t first{ 0 };
+  uint32_t count{ 0 };
+};
+
+/**
+ * @brief Bounding volume hierarchy over the world space boxes of the instances, used to pick an entity with a ray on
+ * the cpu when the picking pass is disabled or its readback does not come back in time. It only knows the mesh bounds
+ * so the closest box wins, not the closest triangle
+ */
+class PickingBVH
+{
+public:
+  // a leaf stops splitting once it holds this many boxes
+  static constexpr uint32_t leafSize = 4;
+
+  PickingBVH() = default;
+  ~PickingBVH() = default;
+
+  void clear();
+
+  /**
+   * @brief Adds the box of an instance, call build once every box was added
+   */
+  void add( const kogayonon_resources::AABB& bounds, entt::entity entity );
+
+  /**
+   * @brief Builds the tree by splitting every node at the median of its longest axis
+   */
+  void build();
+
+  /**
+   * @brief Closest box the ray goes through, a box the origin is inside of counts at the distance where the ray leaves
+   * it so the camera being inside a large box does not hide everything in it
+   * @param origin Start of the ray
+   * @param direction Direction of the ray, does not need to be normalized
+   * @return The entity of the box or entt::null if the ray misses everything
+   */
+  auto raycast( const glm::vec3& origin, const glm::vec3& direction ) const -> entt::entity;
+
+  /**
+   * @brief Box around a mesh space box after it got transformed by an instance matrix
+   */
+  static auto transformBounds( const kogayonon_resources::AABB& bounds, const glm::mat4x3& model )
+    -> kogayonon_resources::AABB;
+
+  inline auto getNodes() const -> const std::vector<PickingNode>&
+  {
+    return m_nodes;
+  }
+
+  inline auto getBoxCount() const -> uint32_t
+  {
+    return static_cast<uint32_t>( m_bounds.size() );
+  }
+
+private:
+  std::vector<kogayonon_resources::AABB> m_bounds;
+  std::vector<entt::entity> m_entities;
+
+  // indices into m_bounds, the leaves own contiguous ranges of it
+  std::vector<uint32_t> m_order;
+  std::vector<PickingNode> m_nodes;
+
+  // nodes left to split while building
+  std::vector<uint32_t> m_pending;
+};
+} // namespace kogayonon_core
@@ -0,0 +1,147 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "rendering/render_target_pool.hpp"
+
+namespace kogayonon_core
+{
+// index of a resource in the graph of the current frame
+using RenderResource = uint32_t;
+
+/**
+ * @brief Something the passes read or write. Imported resources live outside of the graph (framebuffers, the draw
+ * lists of the culling passes), transient ones are textures the graph owns only between their first and last use
+ */
+struct RenderGraphResource
+{
+  std::string name;
+  kogayonon_rendering::RenderTargetKey key;
+  bool transient{ false };
+
+  // shown or read after the graph ran, the passes that write it are never culled
+  bool output{ false };
+  uint32_t texture{ 0 };
+
+  // positions in the execution order, only valid after compile
+  uint32_t firstPass{ UINT32_MAX };
+  uint32_t lastPass{ 0 };
+};
+
+struct RenderGraphPass
+{
+  std::string name;
+  std::vector<RenderResource> reads;
+  std::vector<RenderResource> writes;
+  std::function<void()> execute;
+  bool culled{ false };
+};
+
+/**
+ * @brief Orders the passes of a frame by the resources they read and write, culls the ones nothing depends on and lets
+ * transient textures whose lifetimes do not overlap share the same storage. Every pass that runs is a profiler scope
+ * on the cpu and the gpu so a new pass only has to be added here to be scheduled and costed.
+ * The graph is rebuilt every frame: reset, declare resources and passes, compile, execute
+ */
+class RenderGraph
+{
+public:
+  RenderGraph();
+  ~RenderGraph();
+
+  RenderGraph( const RenderGraph& ) = delete;
+  RenderGraph& operator=( const RenderGraph& ) = delete;
+
+  /**
+   * @brief Drops the passes and resources of the last frame, the textures and timers are kept for the next one
+   */
+  void reset();
+
+  /**
+   * @brief A resource owned by someone else
+   * @param texture Texture the passes can look up with getTexture, 0 if it is not a texture
+   */
+  auto importResource( std::string name, uint32_t texture = 0 ) -> RenderResource;
+
+  /**
+   * @brief A texture that only lives while the passes that use it run, read it with getTexture inside the passes
+   */
+  auto createTexture( std::string name, const kogayonon_rendering::RenderTargetKey& key ) -> RenderResource;
+
+  /**
+   * @brief Keeps a resource alive, everything it depends on runs
+   */
+  void markOutput( RenderResource resource );
+
+  /**
+   * @brief Adds a pass, the order does not matter since a pass always runs after the passes that write what it reads
+   * @param name Name of the pass, its timer is kept by this name across frames
+   * @param reads Resources the pass samples or draws from
+   * @param writes Resources the pass renders into, a pass is culled when none of them is needed
+   * @param execute Records the pass
+   */
+  void addPass( std::string name, std::vector<RenderResource> reads, std::vector<RenderResource> writes,
+                std::function<void()> execute );
+
+  /**
+   * @brief Orders the passes, culls the unused ones and assigns the storage of the transient textures
+   */
+  void compile();
+
+  /**
+   * @brief Runs the passes that survived compile in order, each one inside its profiler scope, and publishes the
+   * latest gpu time of every pass
+   */
+  void execute();
+
+  /**
+   * @brief Texture of a resource, transient textures only have one after compile
+   */
+  auto getTexture( RenderResource resource ) const -> uint32_t;
+
+  inline auto getPasses() const -> const std::vector<RenderGraphPass>&
+  {
+    return m_passes;
+  }
+
+  inline auto getResources() const -> const std::vector<RenderGraphResource>&
+  {
+    return m_resources;
+  }
+
+  /**
+   * @brief Indices into getPasses in the order they run, culled passes are left out
+   */
+  inline auto getOrder() const -> const std::vector<uint32_t>&
+  {
+    return m_order;
+  }
+
+private:
+  /**
+   * @brief Sorts the passes so that every pass runs after the writers of its reads, writers of the same resource keep
+   * the order they were added in. A cycle falls back to the order they were added in
+   */
+  void sortPasses();
+  void cullPasses();
+  void assignTextures();
+
+private:
+  // storage a transient texture can alias, kept across frames
+  struct PhysicalTexture
+  {
+    kogayonon_rendering::RenderTargetKey key;
+    uint32_t texture{ 0 };
+
+    // last pass of the current frame that uses it, -1 while it is free
+    int32_t busyUntil{ -1 };
+    bool used{ false };
+  };
+
+  std::vector<RenderGraphPass> m_passes;
+  std::vector<RenderGraphResource> m_resources;
+  std::vector<uint32_t> m_order;
+  std::vector<PhysicalTexture> m_textures;
+};
+} // namespace kogayonon_core
@@ -1,12 +1,28 @@
 #pragma once
+#include <array>
 #include <cstdint>
 #include <glm/glm.hpp>
 #include <memory>
+#include <unordered_set>
+#include <vector>
+#include "core/systems/culling_system.hpp"
+#include "core/systems/indirect_draw_list.hpp"
+#include "core/systems/light_clusters.hpp"
+#include "core/systems/lod_selector.hpp"
+#include "core/systems/material_system.hpp"
+#include "core/systems/picking_bvh.hpp"
+#include "core/systems/render_graph.hpp"
+#include "core/systems/shadow_cascades.hpp"
 
 namespace kogayonon_rendering
 {
 class Camera;
+class FrameUniformbuffer;
 class OpenGLFramebuffer;
+class GPUBuffer;
+class GPUFence;
+class MeshArena;
+struct FrameConstants;
 } // namespace kogayonon_rendering
 
 namespace kogayonon_utilities
@@ -51,13 +67,17 @@ struct OutliningPassContext
 struct DepthPassContext
 {
   kogayonon_utilities::Shader* shader;
+
+  // with more than one cascade every cascade is drawn in a single layered pass and the view and projection of the
+  // frame are ignored
+  kogayonon_utilities::Shader* cascadeShader{ nullptr };
+  const ShadowCascades* cascades{ nullptr };
 };
 
 struct GeometryPassContext
 {
   kogayonon_utilities::Shader* shader;
   uint32_t* depthMap;
-  glm::mat4* lightVP;
 };
 
 struct PickingPassContext
@@ -67,28 +87,242 @@ struct PickingPassContext
   int y{ 0 };
 };
 
+// the picking pass only draws and reads back a square this wide around the cursor
+inline constexpr int pickingRegionSize = 5;
+
+// polls we give the picking readback before the pick falls back to the cpu
+inline constexpr uint32_t maxPickingFrames = 4;
+
+enum class PickingStatus : uint8_t
+{
+  Idle,
+  Pending,
+  Resolved,
+  Expired
+};
+
+/**
+ * @brief The square the picking pass drew and where the cursor sits in it, the pixels get copied into pBuffer and are
+ * only read once pFence is signaled
+ */
+struct PickingReadback
+{
+  std::unique_ptr<kogayonon_rendering::GPUBuffer> pBuffer;
+  std::unique_ptr<kogayonon_rendering::GPUFence> pFence;
+
+  // framebuffer coordinates with the origin at the bottom
+  int x{ 0 };
+  int y{ 0 };
+  int w{ 0 };
+  int h{ 0 };
+  int cursorX{ 0 };
+  int cursorY{ 0 };
+
+  // polls since the copy was queued
+  uint32_t frames{ 0 };
+};
+
+/**
+ * @brief Passes that draw the whole scene, each one gets its own draw data when culling is enabled
+ */
+enum class PassType : uint8_t
+{
+  Depth = 0,
+  Geometry,
+  Picking,
+  Count
+};
+
+/**
+ * @brief What a pass draws from, the draw list plus the buffers it gets uploaded into
+ */
+struct PassDrawData
+{
+  IndirectDrawList drawList;
+  std::unique_ptr<kogayonon_rendering::GPUBuffer> pInstanceBuffer;
+  std::unique_ptr<kogayonon_rendering::GPUBuffer> pCommandBuffer;
+
+  // entity of every instance in pInstanceBuffer, only the picking shader reads it
+  std::unique_ptr<kogayonon_rendering::GPUBuffer> pEntityBuffer;
+
+  // material of every command, the geometry shader indexes it with gl_DrawID
+  std::unique_ptr<kogayonon_rendering::GPUBuffer> pMaterialBuffer;
+
+  // gpu culling writes the instance counts, we read them back once the fence says the gpu is done with them
+  std::unique_ptr<kogayonon_rendering::GPUFence> pFence;
+  uint32_t gpuVisible{ 0 };
+
+  // the instance counts of the commands were written by the culling pass and only exist on the gpu
+  bool gpuCounts{ false };
+};
+
+struct CullingPassContext
+{
+  kogayonon_utilities::Shader* shader;
+  PassType target;
+};
+
 class RenderingSystem
 {
 public:
-  RenderingSystem() = default;
-  ~RenderingSystem() = default;
+  RenderingSystem();
+  ~RenderingSystem();
+
+  /**
+   * @brief Builds the indirect commands and uploads the instances for this frame, call it once before the passes.
+   * With culling enabled it gathers the instance bounds instead and every pass builds its own list.
+   * Materials of new meshes are registered no matter which path is enabled
+   * @param scene The scene we are about to draw
+   */
+  void prepareFrame( Scene* scene );
+
+  /**
+   * @brief Pages the textures the geometry pass of the last frame reported and requests the sizes it asked for, call
+   * it once per frame before prepareFrame
+   */
+  void updateTextures();
+
+  inline void setIndirectEnabled( bool value )
+  {
+    m_indirectEnabled = value;
+  }
+
+  inline auto isIndirectEnabled() const -> bool
+  {
+    return m_indirectEnabled;
+  }
+
+  inline void setCullingEnabled( bool value )
+  {
+    m_cullingEnabled = value;
+  }
+
+  inline auto isCullingEnabled() const -> bool
+  {
+    return m_cullingEnabled;
+  }
+
+  /**
+   * @brief Culls on the gpu instead, takes priority over the cpu culling when both are enabled
+   */
+  inline void setGpuCullingEnabled( bool value )
+  {
+    m_gpuCullingEnabled = value;
+  }
+
+  inline auto isGpuCullingEnabled() const -> bool
+  {
+    return m_gpuCullingEnabled;
+  }
+
+  /**
+   * @brief Draws the culled instances at a level of detail picked from their size on screen, only the cpu culling
+   * path picks levels, every other path draws the full meshes
+   */
+  inline void setLodEnabled( bool value )
+  {
+    m_lodEnabled = value;
+  }
+
+  inline auto isLodEnabled() const -> bool
+  {
+    return m_lodEnabled;
+  }
+
+  /**
+   * @brief Camera and pixel budget the levels of detail are picked with, the viewport sets the view every frame
+   */
+  inline auto getLodSelector() -> LodSelector&
+  {
+    return m_lodSelector;
+  }
+
+  inline auto getMaterialSystem() -> MaterialSystem&
+  {
+    return m_materialSystem;
+  }
+
+  /**
+   * @brief Picks with the picking pass and a readback, otherwise every pick is a ray against the instance bounds
+   */
+  inline void setGpuPickingEnabled( bool value )
+  {
+    m_gpuPickingEnabled = value;
+  }
+
+  inline auto isGpuPickingEnabled() const -> bool
+  {
+    return m_gpuPickingEnabled;
+  }
+
+  /**
+   * @brief Writes the camera and light matrices every shader reads from the FrameConstants block, call it before the
+   * passes. Nothing is uploaded if the constants did not change
+   */
+  void updateFrameConstants( const kogayonon_rendering::FrameConstants& constants );
+
+  /**
+   * @brief The constants of the last update, useful to change only the camera and keep the light
+   */
+  auto getFrameConstants() const -> const kogayonon_rendering::FrameConstants&;
+
+  /**
+   * @brief Graph the passes of a frame are declared in, the viewport resets and fills it every frame
+   */
+  inline auto getRenderGraph() -> RenderGraph&
+  {
+    return m_renderGraph;
+  }
 
   void renderOutliningPass( FrameContext& frame, OutliningPassContext& pass );
   void renderDepthPass( FrameContext& frame, DepthPassContext& pass );
   void renderGeometryPass( FrameContext& frame, GeometryPassContext& pass );
-  auto renderPickingPass( FrameContext& frame, PickingPassContext& pass ) -> int;
+
+  /**
+   * @brief Draws the entity ids into a small scissored square around the cursor and queues the copy of it into a pack
+   * buffer, nothing waits for the gpu. The result comes out of pollPicking a frame or so later
+   */
+  void renderPickingPass( FrameContext& frame, PickingPassContext& pass );
+
+  /**
+   * @brief Checks on the queued picking readback without waiting for the gpu, call it once per frame
+   * @param result The entity id under the cursor when resolved, -1 for the background
+   * @return Resolved once the ids are in, Expired when the gpu took more than maxPickingFrames polls and the pick
+   * should go through pickClosest instead
+   */
+  auto pollPicking( int& result ) -> PickingStatus;
+
+  /**
+   * @brief Picks on the cpu by casting a ray against the world bounds of every instance of the scene
+   * @param scene Scene to pick from
+   * @param origin Start of the ray, usually the cursor on the near plane
+   * @param direction Direction of the ray
+   * @return The closest entity the ray hits or entt::null
+   */
+  auto pickClosest( Scene* scene, const glm::vec3& origin, const glm::vec3& direction ) -> entt::entity;
+
+  /**
+   * @brief Compute pass that culls the instances of every mesh against the frustum of the frame and compacts the
+   * visible ones into the buffers of the target pass, the instance counts of the indirect commands get written on the
+   * gpu. Call it before the target pass, does nothing unless gpu culling is enabled
+   */
+  void renderCullingPass( FrameContext& frame, CullingPassContext& pass );
 
 private:
-  void renderOutlinedEntity( Scene* scene, glm::mat4* viewMatrix, glm::mat4* projection,
-                             kogayonon_utilities::Shader* shader, uint32_t* depthMap );
+  void renderOutlinedEntity( Scene* scene, kogayonon_utilities::Shader* shader, uint32_t* depthMap );
 
-  void render( Scene* scene, glm::mat4* viewMatrix, glm::mat4* projection, kogayonon_utilities::Shader* shader );
+  void render( Scene* scene, glm::mat4* viewMatrix, glm::mat4* projection, kogayonon_utilities::Shader* shader,
+               PassType pass );
 
-  void renderWithDepth( Scene* scene, glm::mat4* viewMatrix, glm::mat4* projection, glm::mat4* lightSpaceMatrix,
-                        kogayonon_utilities::Shader* shader, uint32_t* depthMap );
+  /**
+   * @brief Bins the point lights for the camera of the geometry pass and uploads the clusters
+   */
+  void buildLightClusters( Scene* scene, const glm::mat4& view, const glm::mat4& projection );
+
+  void renderWithDepth( Scene* scene, glm::mat4* viewMatrix, glm::mat4* projection, kogayonon_utilities::Shader* shader,
+                        uint32_t* depthMap );
 
   void begin( kogayonon_utilities::Shader* shader ) const;
-  void end( kogayonon_utilities::Shader* shader ) const;
 
   void beginOutliningPass( Canvas& canvas ) const;
   void beginGeometryPass( Canvas& canvas ) const;
@@ -100,10 +334,124 @@ private:
   void endPickingPass( Canvas& canvas ) const;
   void endDepthPass( Canvas& canvas ) const;
 
-  void makeMeshesUnique( Scene* scene, std::vector<kogayonon_resources::Mesh*>& orderedMeshes );
   void drawMeshes( Scene* scene, const std::vector<kogayonon_resources::Mesh*>& orderedMeshes );
 
   void drawMeshesWithDepth( Scene* scene, const std::vector<kogayonon_resources::Mesh*>& orderedMeshes,
-                            const uint32_t* depthMap );
+                            const uint32_t* depthMap, kogayonon_utilities::Shader* shader );
+
+  /**
+   * @brief Culls the instances gathered in prepareFrame against the frustum of a pass and uploads the visible ones
+   * @param scene The scene we draw
+   * @param viewProjection Projection * view of the pass
+   * @param pass The pass we cull for
+   */
+  void cullPass( Scene* scene, const glm::mat4& viewProjection, PassType pass );
+
+  /**
+   * @brief Appends the instances of every frame mesh that survive the frustum to the draw list of a pass, grouped by
+   * their level of detail when it is enabled
+   * @param reportTextures The frustum is the camera, the textures of the visible instances get reported as used
+   */
+  void appendVisible( Scene* scene, const Frustum& frustum, PassDrawData& passData, bool reportTextures = false );
+
+  /**
+   * @brief Tells the material system how many pixels the closest of the given instances of a mesh covers
+   */
+  void useTextures( kogayonon_resources::Mesh* pMesh, const InstanceData& data, const uint32_t* pSlots,
+                    uint32_t count );
+
+  /**
+   * @brief Culls the casters against every cascade and packs the survivors cascade after cascade into the depth pass
+   * draw list, a caster that touches two cascades is drawn twice
+   * @param firstInstance Output, where the instances of every cascade start
+   */
+  void cullCascades( Scene* scene, const ShadowCascades& cascades, glm::uvec4& firstInstance );
+
+  /**
+   * @brief Draws the casters of every cascade into its layer of the shadow map with one draw list
+   */
+  void renderCascades( Scene* scene, DepthPassContext& pass );
+
+  /**
+   * @brief Collects the meshes that have instances this frame and adds the new ones to the arena if needed
+   */
+  void gatherFrameMeshes( Scene* scene );
+
+  /**
+   * @brief Transforms the bounds of every frame mesh into the culling system, once per frame
+   */
+  void gatherBounds( Scene* scene );
+
+  /**
+   * @brief The draw data a pass should use, the shared frame data unless culling is enabled
+   */
+  auto getDrawData( PassType pass ) -> PassDrawData&;
+
+  void uploadDrawData( PassDrawData& data );
+
+  /**
+   * @brief Uploads the material index of every command of the draw list
+   */
+  void uploadDrawMaterials( PassDrawData& data );
+
+  /**
+   * @brief Reads the visible instance counts the culling shader wrote the last time, only if the gpu is done
+   * @return False if nothing was read, m_readback still holds an older pass then
+   */
+  auto readbackVisible( PassDrawData& data ) -> bool;
+
+  /**
+   * @brief Draws a whole draw list with a single glMultiDrawElementsIndirect from the mesh arena
+   * @param data Draw data prepared for the pass
+   * @param useMaterials Binds the per command materials, only the geometry pass samples them
+   */
+  void drawIndirect( PassDrawData& data, bool useMaterials );
+
+  /**
+   * @brief Draws a culled draw list with the vao of every mesh, used when the indirect path is disabled. With gpu
+   * culling the instance counts only exist on the gpu so every command is drawn with glDrawElementsIndirect
+   */
+  void drawCulled( Scene* scene, PassDrawData& data, kogayonon_utilities::Shader* materialShader );
+
+private:
+  bool m_indirectEnabled{ false };
+  bool m_cullingEnabled{ false };
+  bool m_gpuCullingEnabled{ false };
+  bool m_gpuPickingEnabled{ true };
+  bool m_lodEnabled{ true };
+  bool m_boundsGathered{ false };
+
+  // the arena vao gets the instance attribute layout the first time we draw from it
+  bool m_arenaInstanceLayout{ false };
+
+  // meshes that have instances this frame
+  std::vector<kogayonon_resources::Mesh*> m_frameMeshes;
+
+  // first sphere of every mesh in m_frameMeshes inside the culling system and how many spheres it owns
+  std::vector<uint32_t> m_cullFirst;
+  std::vector<uint32_t> m_cullCount;
+  std::vector<uint32_t> m_visible;
+  std::vector<DrawElementsIndirectCommand> m_readback;
+
+  // meshes the last readback of the gpu culled geometry pass drew, the culled instances never come back to the cpu
+  std::unordered_set<const kogayonon_resources::Mesh*> m_gpuVisibleMeshes;
+  std::vector<uint32_t> m_drawMaterials;
+  CullingSystem m_cullingSystem;
+  MaterialSystem m_materialSystem;
+  LightClusters m_lightClusters;
+  LodSelector m_lodSelector;
+  RenderGraph m_renderGraph;
+
+  // only filled when a pick falls back to the cpu
+  PickingBVH m_pickingBVH;
+  PickingReadback m_pickingReadback;
+
+  PassDrawData m_frameData;
+  std::array<PassDrawData, static_cast<std::size_t>( PassType::Count )> m_passData;
+
+  std::unique_ptr<kogayonon_rendering::MeshArena> m_pMeshArena;
+  std::unique_ptr<kogayonon_rendering::FrameUniformbuffer> m_pFrameUniforms;
+  std::unique_ptr<kogayonon_rendering::GPUBuffer> m_pClusterBuffer;
+  std::unique_ptr<kogayonon_rendering::GPUBuffer> m_pClusterLightBuffer;
 };
 } // namespace kogayonon_core
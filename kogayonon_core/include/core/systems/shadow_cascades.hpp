@@ -0,0 +1,49 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace kogayonon_core
+{
+inline constexpr uint32_t maxShadowCascades = 4;
+
+// every cascade is square, a fixed size keeps the texel snapping stable while the viewport gets resized
+inline constexpr uint32_t shadowCascadeResolution = 2048;
+
+struct ShadowCascadeSettings
+{
+  uint32_t count{ 1 };
+
+  // 0 splits the distance evenly, 1 logarithmically
+  float splitLambda{ 0.75f };
+
+  // how far from the camera the last cascade ends, clamped to the camera far plane
+  float distance{ 100.0f };
+
+  // how far towards the light the casters are still picked up
+  float casterDistance{ 20.0f };
+  uint32_t resolution{ shadowCascadeResolution };
+};
+
+/**
+ * @brief Light matrices of every cascade and where each of them ends in view space
+ */
+struct ShadowCascades
+{
+  uint32_t count{ 0 };
+  std::array<glm::mat4, maxShadowCascades> viewProjection{};
+  std::array<float, maxShadowCascades> splits{};
+};
+
+/**
+ * @brief Splits the camera frustum into count slices and fits an ortho projection around each one. The projections
+ * are fitted to a sphere so rotating the camera does not change their size and they only move in whole texels, both
+ * keep the shadow edges from swimming
+ * @param view View matrix of the camera
+ * @param projection Perspective projection of the camera, near and far are read back from it
+ * @param lightDirection Direction the light travels in
+ * @param settings Cascade count and how they are fitted
+ */
+auto computeShadowCascades( const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDirection,
+                            const ShadowCascadeSettings& settings ) -> ShadowCascades;
+} // namespace kogayonon_core
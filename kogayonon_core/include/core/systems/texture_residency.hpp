@@ -0,0 +1,169 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "rendering/texture_pages.hpp"
+
+namespace kogayonon_resources
+{
+class Texture;
+} // namespace kogayonon_resources
+
+namespace kogayonon_core
+{
+/**
+ * @brief Decides which size of every material texture lives in the texture pages. Each frame the renderer reports how
+ * many pixels a texture covers on screen, the page size class that matches becomes the wanted size. Textures that
+ * want more than they have are streamed in again at the bigger size, only the mips that fit are loaded and the
+ * temporary texture is dropped once its layer is filled. The budget covers the whole arrays of the pages and the
+ * temporary textures in flight. When it is exceeded the least recently used textures lose their biggest mip first and
+ * leave the pages once they are at the smallest size, then the pages are trimmed down to the layers left
+ */
+class TextureResidency
+{
+public:
+  static constexpr std::size_t defaultBudget = 256ull << 20;
+
+  // requests handed to the streamer that did not arrive yet
+  static constexpr uint32_t maxStreamsInFlight = 4;
+
+  TextureResidency();
+  ~TextureResidency();
+
+  TextureResidency( const TextureResidency& ) = delete;
+  TextureResidency& operator=( const TextureResidency& ) = delete;
+
+  /**
+   * @brief Starts managing a texture, nothing is loaded until it is used. The asset manager will not delete it from
+   * then on
+   */
+  void track( kogayonon_resources::Texture* pTexture );
+
+  /**
+   * @brief Marks a texture as drawn this frame
+   * @param pixels Biggest on screen size of the surface it covers, the largest report of a frame wins
+   */
+  void use( kogayonon_resources::Texture* pTexture, float pixels );
+
+  /**
+   * @brief Pages what arrived, shrinks or evicts under pressure and requests the bigger sizes, once per frame
+   * @return Textures whose slot changed or went away since the last update
+   */
+  auto update() -> const std::vector<kogayonon_resources::Texture*>&;
+
+  auto getSlot( kogayonon_resources::Texture* pTexture ) const -> std::optional<kogayonon_rendering::TexturePageSlot>;
+
+  inline auto contains( kogayonon_resources::Texture* pTexture ) const -> bool
+  {
+    return m_entries.contains( pTexture );
+  }
+
+  /**
+   * @brief A gl texture showing the layer of a texture for the editor, 0 while it has none. Ask for it every frame,
+   * the pages can be recreated by an update and the view is deleted one update later
+   */
+  auto getPreview( kogayonon_resources::Texture* pTexture ) -> uint32_t;
+
+  void bind( uint32_t firstUnit ) const;
+
+  inline void setBudget( std::size_t bytes )
+  {
+    m_budget = bytes;
+  }
+
+  inline auto getBudget() const -> std::size_t
+  {
+    return m_budget;
+  }
+
+  inline auto getResidentBytes() const -> std::size_t
+  {
+    return m_pPages->getAllocatedBytes();
+  }
+
+  /**
+   * @brief Textures that hold a layer
+   */
+  auto getResidentCount() const -> std::size_t;
+
+  inline auto getStreamingCount() const -> std::size_t
+  {
+    return m_streaming;
+  }
+
+private:
+  struct Entry
+  {
+    std::optional<kogayonon_rendering::TexturePageSlot> slot;
+
+    // page size the screen asked for the last frame it was used
+    uint32_t requiredSize{ 0 };
+
+    // size of the request in flight, 0 when there is none
+    uint32_t streamSize{ 0 };
+    uint64_t lastUsedFrame{ 0 };
+
+    // the file could not be read, it is never requested again
+    bool failed{ false };
+
+    // the last copy came from raw pixels, the next request most likely will too
+    bool raw{ false };
+  };
+
+  /**
+   * @brief Copies a texture the streamer finished into the pages and frees the gl texture it came in
+   */
+  void page( kogayonon_resources::Texture* pTexture, Entry& entry );
+
+  /**
+   * @brief Shrinks or evicts layers until the pages trimmed to what is left plus the requests in flight fit the
+   * budget, then trims them
+   */
+  void relievePressure();
+
+  void requestSizes();
+
+  /**
+   * @brief Page a request of that size ends up in
+   */
+  auto getStreamPage( const Entry& entry, uint32_t size ) const -> uint32_t;
+
+  /**
+   * @brief Bytes a request of that size takes until it is paged, its layer and the texture the streamer loads it into
+   */
+  auto getStreamBytes( const kogayonon_resources::Texture* pTexture, const Entry& entry, uint32_t size ) const
+    -> std::size_t;
+
+  /**
+   * @brief What the requests in flight will take once they arrive
+   */
+  auto getReservedBytes() const -> std::size_t;
+
+  void setSlot( kogayonon_resources::Texture* pTexture, Entry& entry,
+                std::optional<kogayonon_rendering::TexturePageSlot> slot );
+
+  /**
+   * @brief Deletes the views handed out before the last update, the ones of this frame are kept one more
+   */
+  void releasePreviews();
+
+  /**
+   * @brief Points the entries whose layer a trim moved at the new one
+   */
+  void followMoves( const std::vector<kogayonon_rendering::TexturePageMove>& moves );
+
+private:
+  uint64_t m_frame{ 1 };
+  std::size_t m_budget{ defaultBudget };
+  std::size_t m_streaming{ 0 };
+
+  std::unordered_map<kogayonon_resources::Texture*, Entry> m_entries;
+  std::vector<kogayonon_resources::Texture*> m_changed;
+  std::unordered_map<kogayonon_resources::Texture*, uint32_t> m_previews;
+  std::vector<uint32_t> m_stalePreviews;
+  std::unique_ptr<kogayonon_rendering::TexturePages> m_pPages;
+};
+} // namespace kogayonon_core
@@ -0,0 +1,133 @@
+#include "core/systems/culling_system.hpp"
+#include <algorithm>
+#include <cmath>
+#include "resources/bounds.hpp"
+
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#define KOGAYONON_CULL_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace kogayonon_core
+{
+auto Frustum::fromMatrix( const glm::mat4& viewProjection ) -> Frustum
+{
+  // glm is column major so each row is built by hand
+  auto row = [&]( int i ) {
+    return glm::vec4{ viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i] };
+  };
+
+  const auto r0 = row( 0 );
+  const auto r1 = row( 1 );
+  const auto r2 = row( 2 );
+  const auto r3 = row( 3 );
+
+  Frustum frustum{ .planes = { r3 + r0, r3 - r0, r3 + r1, r3 - r1, r3 + r2, r3 - r2 } };
+
+  // normalize so the plane distance can be compared against a radius
+  for ( auto& plane : frustum.planes )
+  {
+    const auto length = glm::length( glm::vec3{ plane } );
+    if ( length > 0.0f )
+      plane /= length;
+  }
+
+  return frustum;
+}
+
+void CullingSystem::clear()
+{
+  m_centerX.clear();
+  m_centerY.clear();
+  m_centerZ.clear();
+  m_radius.clear();
+}
+
+auto CullingSystem::addInstances( const kogayonon_resources::BoundingSphere& localSphere,
+                                  const std::vector<GPUInstance>& instances,
+                                  uint32_t count ) -> uint32_t
+{
+  const auto first = static_cast<uint32_t>( m_radius.size() );
+  count = std::min( count, static_cast<uint32_t>( instances.size() ) );
+
+  const auto center = glm::vec4{ localSphere.center, 1.0f };
+  for ( auto i = 0u; i < count; i++ )
+  {
+    const auto& model = instances[i].instanceMatrix;
+    const auto worldCenter = model * center;
+
+    // non uniform scale grows the sphere by the largest axis
+    const auto scale = std::max( { glm::dot( glm::vec3{ model[0] }, glm::vec3{ model[0] } ),
+                                   glm::dot( glm::vec3{ model[1] }, glm::vec3{ model[1] } ),
+                                   glm::dot( glm::vec3{ model[2] }, glm::vec3{ model[2] } ) } );
+
+    m_centerX.emplace_back( worldCenter.x );
+    m_centerY.emplace_back( worldCenter.y );
+    m_centerZ.emplace_back( worldCenter.z );
+    m_radius.emplace_back( localSphere.radius * std::sqrt( scale ) );
+  }
+
+  return first;
+}
+
+auto CullingSystem::cull( const Frustum& frustum, uint32_t first, uint32_t count, std::vector<uint32_t>& visible )
+  -> uint32_t
+{
+  const auto* x = m_centerX.data() + first;
+  const auto* y = m_centerY.data() + first;
+  const auto* z = m_centerZ.data() + first;
+  const auto* r = m_radius.data() + first;
+
+  const auto before = visible.size();
+  uint32_t i = 0;
+
+#ifdef KOGAYONON_CULL_SSE
+  // a sphere is outside if it is fully behind any plane, four spheres per iteration
+  for ( ; i + 4 <= count; i += 4 )
+  {
+    const auto cx = _mm_loadu_ps( x + i );
+    const auto cy = _mm_loadu_ps( y + i );
+    const auto cz = _mm_loadu_ps( z + i );
+    const auto negativeRadius = _mm_sub_ps( _mm_setzero_ps(), _mm_loadu_ps( r + i ) );
+
+    // all bits set, every lane starts as visible
+    auto inside = _mm_cmpeq_ps( cx, cx );
+    for ( const auto& plane : frustum.planes )
+    {
+      auto distance = _mm_mul_ps( cx, _mm_set1_ps( plane.x ) );
+      distance = _mm_add_ps( distance, _mm_mul_ps( cy, _mm_set1_ps( plane.y ) ) );
+      distance = _mm_add_ps( distance, _mm_mul_ps( cz, _mm_set1_ps( plane.z ) ) );
+      distance = _mm_add_ps( distance, _mm_set1_ps( plane.w ) );
+      inside = _mm_and_ps( inside, _mm_cmpge_ps( distance, negativeRadius ) );
+    }
+
+    const auto mask = _mm_movemask_ps( inside );
+    for ( auto lane = 0u; lane < 4; lane++ )
+    {
+      if ( mask & ( 1 << lane ) )
+        visible.emplace_back( i + lane );
+    }
+  }
+#endif
+
+  // whatever did not fit in a 4 wide batch
+  for ( ; i < count; i++ )
+  {
+    bool inside = true;
+    for ( const auto& plane : frustum.planes )
+    {
+      const auto distance = plane.x * x[i] + plane.y * y[i] + plane.z * z[i] + plane.w;
+      if ( distance < -r[i] )
+      {
+        inside = false;
+        break;
+      }
+    }
+
+    if ( inside )
+      visible.emplace_back( i );
+  }
+
+  return static_cast<uint32_t>( visible.size() - before );
+}
+} // namespace kogayonon_core
@@ -0,0 +1,75 @@
+#include "core/systems/indirect_draw_list.hpp"
+#include <algorithm>
+#include "resources/mesh.hpp"
+
+namespace kogayonon_core
+{
+void IndirectDrawList::clear()
+{
+  m_commands.clear();
+  m_instances.clear();
+  m_entities.clear();
+  m_meshRanges.clear();
+}
+
+void IndirectDrawList::addMesh( kogayonon_resources::Mesh* pMesh, uint32_t vertexOffset, uint32_t indexOffset,
+                                const InstanceData& data, uint32_t count )
+{
+  if ( !pMesh || count == 0 )
+    return;
+
+  count = std::min( count, static_cast<uint32_t>( data.instances.size() ) );
+  const auto baseInstance = static_cast<uint32_t>( m_instances.size() );
+  m_instances.insert( m_instances.end(), data.instances.begin(), data.instances.begin() + count );
+  m_entities.insert( m_entities.end(), data.entities.begin(), data.entities.begin() + count );
+
+  addCommands( pMesh, vertexOffset, indexOffset, baseInstance, count );
+}
+
+void IndirectDrawList::addMesh( kogayonon_resources::Mesh* pMesh, uint32_t vertexOffset, uint32_t indexOffset,
+                                const InstanceData& data, const std::vector<uint32_t>& visible, uint32_t firstVisible,
+                                uint32_t visibleCount, uint32_t lod )
+{
+  if ( !pMesh || visibleCount == 0 )
+    return;
+
+  const auto baseInstance = static_cast<uint32_t>( m_instances.size() );
+  for ( auto i = firstVisible; i < firstVisible + visibleCount; i++ )
+  {
+    m_instances.emplace_back( data.instances[visible[i]] );
+    m_entities.emplace_back( data.entities[visible[i]] );
+  }
+
+  addCommands( pMesh, vertexOffset, indexOffset, baseInstance, visibleCount, lod );
+}
+
+void IndirectDrawList::addMeshCommands( kogayonon_resources::Mesh* pMesh, uint32_t vertexOffset, uint32_t indexOffset,
+                                        uint32_t baseInstance )
+{
+  if ( !pMesh )
+    return;
+
+  addCommands( pMesh, vertexOffset, indexOffset, baseInstance, 0 );
+}
+
+void IndirectDrawList::addCommands( kogayonon_resources::Mesh* pMesh, uint32_t vertexOffset, uint32_t indexOffset,
+                                    uint32_t baseInstance, uint32_t count, uint32_t lod )
+{
+  auto& meshRange = m_meshRanges.emplace_back(
+    IndirectMeshRange{ .pMesh = pMesh, .firstCommand = static_cast<uint32_t>( m_commands.size() ) } );
+
+  for ( const auto& submesh : pMesh->getSubmeshes() )
+  {
+    // every level indexes the vertices of the submesh so only the index range changes
+    const auto level = submesh.getLod( lod );
+    m_commands.emplace_back( DrawElementsIndirectCommand{
+      .count = level.indexCount,
+      .instanceCount = count,
+      .firstIndex = indexOffset + level.indexOffset,
+      .baseVertex = static_cast<int32_t>( vertexOffset + submesh.vertexOffest ),
+      .baseInstance = baseInstance,
+    } );
+    ++meshRange.commandCount;
+  }
+}
+} // namespace kogayonon_core
@@ -0,0 +1,136 @@
+#include "core/systems/light_clusters.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace kogayonon_core
+{
+namespace
+{
+auto toTile( float ndc, uint32_t tiles ) -> uint32_t
+{
+  const auto tile = std::floor( ( ndc * 0.5f + 0.5f ) * static_cast<float>( tiles ) );
+  return static_cast<uint32_t>( std::clamp( tile, 0.0f, static_cast<float>( tiles - 1 ) ) );
+}
+
+// the lowest and highest ndc a span of view space x or y reaches between two depths, the closest depth stretches
+// whichever end points away from the center
+auto projectSpan( float low, float high, float scale, float nearDepth, float farDepth ) -> glm::vec2
+{
+  return glm::vec2{ low * scale / ( low >= 0.0f ? farDepth : nearDepth ),
+                    high * scale / ( high >= 0.0f ? nearDepth : farDepth ) };
+}
+} // namespace
+
+auto LightClusters::computeLightRadius( const kogayonon_resources::PointLight& light ) -> float
+{
+  const auto constant = light.params.x;
+  const auto linear = light.params.y;
+  const auto quadratic = light.params.z;
+
+  // 1 / attenuation reaches this at the radius
+  const auto cutoff = 256.0f * std::max( { light.color.r, light.color.g, light.color.b } );
+  if ( cutoff <= constant )
+    return 0.0f;
+
+  if ( quadratic > 0.0f )
+    return ( -linear + std::sqrt( linear * linear + 4.0f * quadratic * ( cutoff - constant ) ) ) / ( 2.0f * quadratic );
+
+  if ( linear > 0.0f )
+    return ( cutoff - constant ) / linear;
+
+  // no falloff, the light reaches everything
+  return FLT_MAX;
+}
+
+auto LightClusters::getSlice( float viewDepth ) const -> uint32_t
+{
+  const auto slice = std::floor( std::log( viewDepth ) * m_sliceScale + m_sliceBias );
+  return static_cast<uint32_t>( std::clamp( slice, 0.0f, static_cast<float>( gridZ - 1 ) ) );
+}
+
+auto LightClusters::getClusterIndex( const glm::vec2& ndc, float viewDepth ) const -> uint32_t
+{
+  return toTile( ndc.x, gridX ) + gridX * ( toTile( ndc.y, gridY ) + gridY * getSlice( viewDepth ) );
+}
+
+void LightClusters::build( const std::vector<kogayonon_resources::PointLight>& lights, const glm::mat4& view,
+                           const glm::mat4& projection )
+{
+  // same as the cascades, near and far solved from the perspective matrix
+  const auto a = projection[2][2];
+  const auto b = projection[3][2];
+  const auto nearPlane = b / ( a - 1.0f );
+  const auto farPlane = b / ( a + 1.0f );
+
+  m_sliceScale = static_cast<float>( gridZ ) / std::log( farPlane / nearPlane );
+  m_sliceBias = -std::log( nearPlane ) * m_sliceScale;
+
+  m_clusters.assign( clusterCount, LightCluster{} );
+  m_bounds.clear();
+
+  for ( auto i = 0u; i < lights.size(); i++ )
+  {
+    const auto& light = lights[i];
+    if ( light.params.w == 0.0f )
+      continue;
+
+    const auto radius = computeLightRadius( light );
+    const auto center = view * glm::vec4{ glm::vec3{ light.translation }, 1.0f };
+    const auto depth = -center.z;
+
+    if ( depth + radius < nearPlane || depth - radius > farPlane )
+      continue;
+
+    const auto nearDepth = std::max( depth - radius, nearPlane );
+    const auto farDepth = std::min( depth + radius, farPlane );
+
+    const auto spanX = projectSpan( center.x - radius, center.x + radius, projection[0][0], nearDepth, farDepth );
+    const auto spanY = projectSpan( center.y - radius, center.y + radius, projection[1][1], nearDepth, farDepth );
+    if ( spanX.x > 1.0f || spanX.y < -1.0f || spanY.x > 1.0f || spanY.y < -1.0f )
+      continue;
+
+    const auto& bounds = m_bounds.emplace_back( LightBounds{ .light = i,
+                                                             .minX = toTile( spanX.x, gridX ),
+                                                             .maxX = toTile( spanX.y, gridX ),
+                                                             .minY = toTile( spanY.x, gridY ),
+                                                             .maxY = toTile( spanY.y, gridY ),
+                                                             .minZ = getSlice( nearDepth ),
+                                                             .maxZ = getSlice( farDepth ) } );
+
+    for ( auto z = bounds.minZ; z <= bounds.maxZ; z++ )
+    {
+      for ( auto y = bounds.minY; y <= bounds.maxY; y++ )
+      {
+        for ( auto x = bounds.minX; x <= bounds.maxX; x++ )
+          ++m_clusters[x + gridX * ( y + gridY * z )].count;
+      }
+    }
+  }
+
+  // counts become offsets, then every light is written into the ranges it counted itself in
+  uint32_t offset = 0;
+  for ( auto& cluster : m_clusters )
+  {
+    cluster.offset = offset;
+    offset += cluster.count;
+    cluster.count = 0;
+  }
+
+  m_lightIndices.resize( offset );
+  for ( const auto& bounds : m_bounds )
+  {
+    for ( auto z = bounds.minZ; z <= bounds.maxZ; z++ )
+    {
+      for ( auto y = bounds.minY; y <= bounds.maxY; y++ )
+      {
+        for ( auto x = bounds.minX; x <= bounds.maxX; x++ )
+        {
+          auto& cluster = m_clusters[x + gridX * ( y + gridY * z )];
+          m_lightIndices[cluster.offset + cluster.count++] = bounds.light;
+        }
+      }
+    }
+  }
+}
+} // namespace kogayonon_core
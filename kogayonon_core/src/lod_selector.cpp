@@ -0,0 +1,63 @@
+#include "core/systems/lod_selector.hpp"
+#include <algorithm>
+#include "resources/mesh.hpp"
+
+namespace kogayonon_core
+{
+void LodSelector::setView( const glm::vec3& cameraPosition, const glm::mat4& projection, float viewportHeight )
+{
+  m_cameraPosition = cameraPosition;
+  m_pixelScale = projection[1][1] * viewportHeight * 0.5f;
+
+  // the last column of a perspective projection is 0 0 -1 0
+  m_orthographic = projection[3][3] == 1.0f;
+}
+
+auto LodSelector::getPixelsPerUnit( const kogayonon_resources::Mesh& mesh, const glm::mat4x3& model ) const -> float
+{
+  const auto scale = std::max( { glm::length( model[0] ), glm::length( model[1] ), glm::length( model[2] ) } );
+  if ( m_orthographic )
+    return m_pixelScale * scale;
+
+  // the closest point of the bounding sphere, the camera being inside of it counts as very close
+  const auto& sphere = mesh.getBoundingSphere();
+  const auto center = model * glm::vec4{ sphere.center, 1.0f };
+  const auto distance = std::max( glm::length( center - m_cameraPosition ) - sphere.radius * scale, 0.01f );
+
+  return m_pixelScale * scale / distance;
+}
+
+auto LodSelector::select( const kogayonon_resources::Mesh& mesh, const glm::mat4x3& model, uint8_t current ) const
+  -> uint8_t
+{
+  if ( mesh.getLodCount() <= 1 )
+    return 0;
+
+  const auto pixelsPerUnit = getPixelsPerUnit( mesh, model );
+
+  // going coarser needs the error to be well under the budget, going finer only once it is well over it
+  const auto coarser = findLevel( mesh, pixelsPerUnit, m_pixelError * ( 1.0f - m_hysteresis ) );
+  const auto finer = findLevel( mesh, pixelsPerUnit, m_pixelError * ( 1.0f + m_hysteresis ) );
+
+  if ( current < coarser )
+    return coarser;
+
+  return std::min( current, finer );
+}
+
+auto LodSelector::findLevel( const kogayonon_resources::Mesh& mesh, float pixelsPerUnit, float threshold ) const
+  -> uint8_t
+{
+  // the errors only grow with the level
+  uint8_t level = 0;
+  for ( auto i = 1u; i < mesh.getLodCount(); i++ )
+  {
+    if ( mesh.getLodError( i ) * pixelsPerUnit > threshold )
+      break;
+
+    level = static_cast<uint8_t>( i );
+  }
+
+  return level;
+}
+} // namespace kogayonon_core
@@ -0,0 +1,118 @@
+#include "core/systems/material_system.hpp"
+#include <algorithm>
+#include <glad/glad.h>
+#include "core/systems/texture_residency.hpp"
+#include "rendering/gpu_buffer.hpp"
+#include "resources/mesh.hpp"
+
+namespace kogayonon_core
+{
+MaterialSystem::MaterialSystem()
+    : m_pMaterialBuffer{ std::make_unique<kogayonon_rendering::GPUBuffer>() }
+    , m_pResidency{ std::make_unique<TextureResidency>() }
+{
+  m_materials.emplace_back( GPUMaterial{} );
+}
+
+MaterialSystem::~MaterialSystem() = default;
+
+void MaterialSystem::registerMesh( kogayonon_resources::Mesh* pMesh )
+{
+  if ( !pMesh || contains( pMesh ) )
+    return;
+
+  auto& textures = pMesh->getTextures();
+  auto textureAt = [&]( int32_t index ) -> kogayonon_resources::Texture* {
+    if ( index < 0 || index >= static_cast<int32_t>( textures.size() ) )
+      return nullptr;
+    return textures.at( index );
+  };
+
+  // meshes without materials point every submesh at the default one
+  const auto& materials = pMesh->getMaterials();
+  if ( materials.empty() )
+  {
+    m_firstMaterial.emplace( pMesh, 0 );
+    return;
+  }
+
+  m_firstMaterial.emplace( pMesh, static_cast<uint32_t>( m_materials.size() ) );
+  auto& meshTextures = m_meshTextures[pMesh];
+  for ( const auto& material : materials )
+  {
+    GPUMaterial gpuMaterial{ .baseColorFactor = material.baseColorFactor };
+
+    // the texture might already have a layer from another mesh
+    if ( auto pTexture = textureAt( material.baseColorTexture ) )
+    {
+      m_pResidency->track( pTexture );
+      m_textureMaterials[pTexture].emplace_back( static_cast<uint32_t>( m_materials.size() ) );
+      if ( std::ranges::find( meshTextures, pTexture ) == meshTextures.end() )
+        meshTextures.emplace_back( pTexture );
+
+      if ( const auto slot = m_pResidency->getSlot( pTexture ) )
+      {
+        gpuMaterial.page = slot->page;
+        gpuMaterial.layer = slot->layer;
+        gpuMaterial.flags |= 1u;
+      }
+    }
+    m_materials.emplace_back( gpuMaterial );
+  }
+
+  m_dirty = true;
+}
+
+void MaterialSystem::useTextures( kogayonon_resources::Mesh* pMesh, float pixels )
+{
+  const auto it = m_meshTextures.find( pMesh );
+  if ( it == m_meshTextures.end() )
+    return;
+
+  for ( auto pTexture : it->second )
+    m_pResidency->use( pTexture, pixels );
+}
+
+void MaterialSystem::updateResidency()
+{
+  for ( auto pTexture : m_pResidency->update() )
+  {
+    const auto slot = m_pResidency->getSlot( pTexture );
+    for ( auto index : m_textureMaterials.at( pTexture ) )
+    {
+      auto& material = m_materials.at( index );
+      material.page = slot ? slot->page : 0;
+      material.layer = slot ? slot->layer : 0;
+      material.flags = slot ? material.flags | 1u : material.flags & ~1u;
+    }
+    m_dirty = true;
+  }
+}
+
+auto MaterialSystem::contains( kogayonon_resources::Mesh* pMesh ) const -> bool
+{
+  return m_firstMaterial.contains( pMesh );
+}
+
+auto MaterialSystem::getMaterialIndex( kogayonon_resources::Mesh* pMesh,
+                                       const kogayonon_resources::Submesh& submesh ) const -> uint32_t
+{
+  const auto it = m_firstMaterial.find( pMesh );
+  if ( it == m_firstMaterial.end() || it->second == 0 )
+    return 0;
+
+  return it->second + submesh.materialIndex;
+}
+
+void MaterialSystem::bind()
+{
+  if ( m_dirty )
+  {
+    m_pMaterialBuffer->upload( m_materials.data(), m_materials.size() * sizeof( GPUMaterial ) );
+    m_dirty = false;
+  }
+
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, materialBinding, m_pMaterialBuffer->getId() );
+  m_pResidency->bind( firstPageUnit );
+}
+} // namespace kogayonon_core
@@ -0,0 +1,156 @@
+#include "core/systems/picking_bvh.hpp"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <numeric>
+
+using namespace kogayonon_resources;
+
+namespace kogayonon_core
+{
+namespace
+{
+// distance where the ray enters and leaves the box, it misses when it would leave before it enters
+auto intersect( const AABB& box, const glm::vec3& origin, const glm::vec3& inverseDirection ) -> glm::vec2
+{
+  const auto t0 = ( box.min - origin ) * inverseDirection;
+  const auto t1 = ( box.max - origin ) * inverseDirection;
+  const auto entries = glm::min( t0, t1 );
+  const auto exits = glm::max( t0, t1 );
+  return glm::vec2{ std::max( { entries.x, entries.y, entries.z } ), std::min( { exits.x, exits.y, exits.z } ) };
+}
+} // namespace
+
+void PickingBVH::clear()
+{
+  m_bounds.clear();
+  m_entities.clear();
+  m_order.clear();
+  m_nodes.clear();
+}
+
+void PickingBVH::add( const AABB& bounds, entt::entity entity )
+{
+  if ( !bounds.isValid() )
+    return;
+
+  m_bounds.emplace_back( bounds );
+  m_entities.emplace_back( entity );
+}
+
+void PickingBVH::build()
+{
+  m_nodes.clear();
+  m_order.resize( m_bounds.size() );
+  std::iota( m_order.begin(), m_order.end(), 0u );
+  if ( m_bounds.empty() )
+    return;
+
+  m_nodes.emplace_back( PickingNode{ .first = 0, .count = static_cast<uint32_t>( m_bounds.size() ) } );
+  m_pending.assign( 1, 0u );
+
+  while ( !m_pending.empty() )
+  {
+    const auto index = m_pending.back();
+    m_pending.pop_back();
+
+    // copied since adding the children below can move the nodes
+    const auto node = m_nodes[index];
+    AABB bounds;
+    AABB centers;
+    for ( auto i = node.first; i < node.first + node.count; i++ )
+    {
+      bounds.expand( m_bounds[m_order[i]] );
+      centers.expand( m_bounds[m_order[i]].getCenter() );
+    }
+    m_nodes[index].bounds = bounds;
+
+    if ( node.count <= leafSize )
+      continue;
+
+    const auto extent = centers.max - centers.min;
+    const auto axis = extent.x > extent.y ? ( extent.x > extent.z ? 0 : 2 ) : ( extent.y > extent.z ? 1 : 2 );
+
+    // every box sits on the same spot, splitting would never separate them
+    if ( extent[axis] <= 0.0f )
+      continue;
+
+    // the median always leaves both halves with boxes, a midpoint split would not
+    const auto first = m_order.begin() + node.first;
+    const auto middle = node.first + node.count / 2;
+    std::nth_element( first, m_order.begin() + middle, first + node.count, [&]( uint32_t a, uint32_t b ) {
+      return m_bounds[a].getCenter()[axis] < m_bounds[b].getCenter()[axis];
+    } );
+
+    const auto left = static_cast<uint32_t>( m_nodes.size() );
+    m_nodes.emplace_back( PickingNode{ .first = node.first, .count = middle - node.first } );
+    m_nodes.emplace_back( PickingNode{ .first = middle, .count = node.first + node.count - middle } );
+    m_nodes[index].first = left;
+    m_nodes[index].count = 0;
+
+    m_pending.emplace_back( left );
+    m_pending.emplace_back( left + 1 );
+  }
+}
+
+auto PickingBVH::raycast( const glm::vec3& origin, const glm::vec3& direction ) const -> entt::entity
+{
+  if ( m_nodes.empty() )
+    return entt::null;
+
+  const auto inverseDirection = 1.0f / direction;
+  auto closest = FLT_MAX;
+  auto hit = entt::entity{ entt::null };
+
+  // median splits keep the tree about log2 of the box count deep
+  std::array<uint32_t, 64> stack;
+  uint32_t size = 0;
+  stack[size++] = 0;
+
+  while ( size != 0 )
+  {
+    const auto& node = m_nodes[stack[--size]];
+    const auto span = intersect( node.bounds, origin, inverseDirection );
+    if ( span.x > span.y || span.y < 0.0f || span.x > closest )
+      continue;
+
+    if ( node.count == 0 )
+    {
+      stack[size++] = node.first;
+      stack[size++] = node.first + 1;
+      continue;
+    }
+
+    for ( auto i = node.first; i < node.first + node.count; i++ )
+    {
+      const auto box = m_order[i];
+      const auto boxSpan = intersect( m_bounds[box], origin, inverseDirection );
+      if ( boxSpan.x > boxSpan.y || boxSpan.y < 0.0f )
+        continue;
+
+      const auto distance = boxSpan.x >= 0.0f ? boxSpan.x : boxSpan.y;
+      if ( distance < closest )
+      {
+        closest = distance;
+        hit = m_entities[box];
+      }
+    }
+  }
+
+  return hit;
+}
+
+auto PickingBVH::transformBounds( const AABB& bounds, const glm::mat4x3& model ) -> AABB
+{
+  if ( !bounds.isValid() )
+    return AABB{};
+
+  // the extent along every world axis is the sum of the rotated and scaled half sizes
+  const auto center = model * glm::vec4{ bounds.getCenter(), 1.0f };
+  const auto halfSize = ( bounds.max - bounds.min ) * 0.5f;
+  const auto extent =
+    glm::abs( model[0] ) * halfSize.x + glm::abs( model[1] ) * halfSize.y + glm::abs( model[2] ) * halfSize.z;
+
+  return AABB{ .min = center - extent, .max = center + extent };
+}
+} // namespace kogayonon_core
@@ -0,0 +1,265 @@
+#include "core/systems/render_graph.hpp"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+#include "rendering/profiler.hpp"
+#include "rendering/renderer.hpp"
+
+namespace kogayonon_core
+{
+namespace
+{
+auto contains( const std::vector<RenderResource>& resources, RenderResource resource ) -> bool
+{
+  return std::find( resources.begin(), resources.end(), resource ) != resources.end();
+}
+} // namespace
+
+RenderGraph::RenderGraph() = default;
+
+RenderGraph::~RenderGraph()
+{
+  for ( const auto& texture : m_textures )
+    kogayonon_rendering::RenderTargetPool::release( texture.texture );
+}
+
+void RenderGraph::reset()
+{
+  m_passes.clear();
+  m_resources.clear();
+  m_order.clear();
+}
+
+auto RenderGraph::importResource( std::string name, uint32_t texture ) -> RenderResource
+{
+  m_resources.emplace_back( RenderGraphResource{ .name = std::move( name ), .texture = texture } );
+  return static_cast<RenderResource>( m_resources.size() - 1 );
+}
+
+auto RenderGraph::createTexture( std::string name, const kogayonon_rendering::RenderTargetKey& key ) -> RenderResource
+{
+  m_resources.emplace_back( RenderGraphResource{ .name = std::move( name ), .key = key, .transient = true } );
+  return static_cast<RenderResource>( m_resources.size() - 1 );
+}
+
+void RenderGraph::markOutput( RenderResource resource )
+{
+  m_resources.at( resource ).output = true;
+}
+
+void RenderGraph::addPass( std::string name, std::vector<RenderResource> reads, std::vector<RenderResource> writes,
+                           std::function<void()> execute )
+{
+  m_passes.emplace_back( RenderGraphPass{ .name = std::move( name ),
+                                          .reads = std::move( reads ),
+                                          .writes = std::move( writes ),
+                                          .execute = std::move( execute ) } );
+}
+
+void RenderGraph::compile()
+{
+  sortPasses();
+  cullPasses();
+  assignTextures();
+}
+
+void RenderGraph::sortPasses()
+{
+  const auto passCount = static_cast<uint32_t>( m_passes.size() );
+  std::vector<std::vector<uint32_t>> dependents( passCount );
+  std::vector<uint32_t> dependencies( passCount, 0 );
+
+  const auto addEdge = [&]( uint32_t from, uint32_t to ) {
+    dependents[from].emplace_back( to );
+    ++dependencies[to];
+  };
+
+  for ( auto pass = 0u; pass < passCount; pass++ )
+  {
+    for ( const auto resource : m_passes[pass].writes )
+    {
+      // writers of the same resource draw on top of each other in the order they were added
+      for ( auto writer = pass; writer-- > 0; )
+      {
+        if ( contains( m_passes[writer].writes, resource ) )
+        {
+          addEdge( writer, pass );
+          break;
+        }
+      }
+    }
+
+    for ( const auto resource : m_passes[pass].reads )
+    {
+      // a pass reads what the writers added before it produced, when there are none it waits for the later ones
+      auto found = false;
+      for ( auto writer = 0u; writer < pass; writer++ )
+      {
+        if ( contains( m_passes[writer].writes, resource ) )
+        {
+          addEdge( writer, pass );
+          found = true;
+        }
+      }
+
+      for ( auto writer = pass + 1; !found && writer < passCount; writer++ )
+      {
+        if ( contains( m_passes[writer].writes, resource ) )
+          addEdge( writer, pass );
+      }
+    }
+  }
+
+  // always take the ready pass that was added first so the order is stable from frame to frame
+  std::vector<bool> scheduled( passCount, false );
+  m_order.clear();
+  m_order.reserve( passCount );
+  while ( m_order.size() < passCount )
+  {
+    auto next = passCount;
+    for ( auto pass = 0u; pass < passCount; pass++ )
+    {
+      if ( !scheduled[pass] && dependencies[pass] == 0 )
+      {
+        next = pass;
+        break;
+      }
+    }
+
+    if ( next == passCount )
+    {
+      spdlog::warn( "Render graph has a cycle, the passes run in the order they were added" );
+      m_order.resize( passCount );
+      for ( auto pass = 0u; pass < passCount; pass++ )
+        m_order[pass] = pass;
+      return;
+    }
+
+    scheduled[next] = true;
+    m_order.emplace_back( next );
+    for ( const auto dependent : dependents[next] )
+      --dependencies[dependent];
+  }
+}
+
+void RenderGraph::cullPasses()
+{
+  std::vector<bool> needed( m_resources.size(), false );
+  for ( auto resource = 0u; resource < m_resources.size(); resource++ )
+    needed[resource] = m_resources[resource].output;
+
+  // walking back from the outputs, a pass is needed if something after it reads what it writes
+  for ( auto it = m_order.rbegin(); it != m_order.rend(); ++it )
+  {
+    auto& pass = m_passes[*it];
+    pass.culled = std::none_of( pass.writes.begin(), pass.writes.end(), [&]( RenderResource resource ) {
+      return needed[resource];
+    } );
+
+    if ( pass.culled )
+      continue;
+
+    for ( const auto resource : pass.reads )
+      needed[resource] = true;
+  }
+
+  std::erase_if( m_order, [this]( uint32_t pass ) { return m_passes[pass].culled; } );
+}
+
+void RenderGraph::assignTextures()
+{
+  for ( auto& texture : m_textures )
+  {
+    texture.busyUntil = -1;
+    texture.used = false;
+  }
+
+  for ( auto position = 0u; position < m_order.size(); position++ )
+  {
+    const auto& pass = m_passes[m_order[position]];
+    const auto touch = [&]( RenderResource resource ) {
+      auto& graphResource = m_resources[resource];
+      graphResource.firstPass = std::min( graphResource.firstPass, position );
+      graphResource.lastPass = std::max( graphResource.lastPass, position );
+    };
+
+    std::for_each( pass.reads.begin(), pass.reads.end(), touch );
+    std::for_each( pass.writes.begin(), pass.writes.end(), touch );
+  }
+
+  std::vector<uint32_t> transients;
+  for ( auto resource = 0u; resource < m_resources.size(); resource++ )
+  {
+    if ( m_resources[resource].transient && m_resources[resource].firstPass != UINT32_MAX )
+      transients.emplace_back( resource );
+  }
+
+  std::sort( transients.begin(), transients.end(), [this]( uint32_t a, uint32_t b ) {
+    return m_resources[a].firstPass < m_resources[b].firstPass;
+  } );
+
+  // a texture can be handed to another resource once the last pass of the previous one ran
+  for ( const auto resource : transients )
+  {
+    auto& graphResource = m_resources[resource];
+    auto physical = std::find_if( m_textures.begin(), m_textures.end(), [&]( const PhysicalTexture& texture ) {
+      return texture.key == graphResource.key && texture.busyUntil < static_cast<int32_t>( graphResource.firstPass );
+    } );
+
+    if ( physical == m_textures.end() )
+    {
+      physical = m_textures.insert(
+        m_textures.end(),
+        PhysicalTexture{ .key = graphResource.key,
+                         .texture = kogayonon_rendering::RenderTargetPool::acquire( graphResource.key, false ) } );
+    }
+
+    physical->busyUntil = static_cast<int32_t>( graphResource.lastPass );
+    physical->used = true;
+    graphResource.texture = physical->texture;
+  }
+
+  // the pool keeps them for a while in case the pass comes back
+  std::erase_if( m_textures, []( const PhysicalTexture& texture ) {
+    if ( texture.used )
+      return false;
+
+    kogayonon_rendering::RenderTargetPool::release( texture.texture );
+    return true;
+  } );
+}
+
+void RenderGraph::execute()
+{
+  for ( const auto index : m_order )
+  {
+    auto& pass = m_passes[index];
+    kogayonon_rendering::ProfileScope scope{ pass.name, true };
+    pass.execute();
+  }
+
+  auto& timings = kogayonon_rendering::Renderer::getPassTimings();
+  timings.clear();
+  for ( const auto index : m_order )
+  {
+    const auto& name = m_passes[index].name;
+    timings.emplace_back( kogayonon_rendering::PassTiming{
+      .name = name, .milliseconds = kogayonon_rendering::Profiler::getGpuMilliseconds( name ) } );
+  }
+
+  for ( const auto& pass : m_passes )
+  {
+    if ( !pass.culled )
+      continue;
+
+    timings.emplace_back( kogayonon_rendering::PassTiming{
+      .name = pass.name,
+      .milliseconds = kogayonon_rendering::Profiler::getGpuMilliseconds( pass.name ),
+      .culled = true } );
+  }
+}
+
+auto RenderGraph::getTexture( RenderResource resource ) const -> uint32_t
+{
+  return m_resources.at( resource ).texture;
+}
+} // namespace kogayonon_core
@@ -0,0 +1,103 @@
+#include "core/scene/render_list.hpp"
+#include "core/ecs/components/mesh_component.hpp"
+
+namespace kogayonon_core
+{
+void RenderList::connect( entt::registry& registry )
+{
+  registry.on_construct<MeshComponent>().connect<&RenderList::onMeshConstruct>( *this );
+  registry.on_update<MeshComponent>().connect<&RenderList::onMeshUpdate>( *this );
+  registry.on_destroy<MeshComponent>().connect<&RenderList::onMeshDestroy>( *this );
+
+  for ( const auto& [entity, meshComponent] : registry.view<MeshComponent>().each() )
+  {
+    onMeshConstruct( registry, entity );
+  }
+}
+
+void RenderList::disconnect( entt::registry& registry )
+{
+  registry.on_construct<MeshComponent>().disconnect<&RenderList::onMeshConstruct>( *this );
+  registry.on_update<MeshComponent>().disconnect<&RenderList::onMeshUpdate>( *this );
+  registry.on_destroy<MeshComponent>().disconnect<&RenderList::onMeshDestroy>( *this );
+
+  m_meshes.clear();
+  m_refCounts.clear();
+  m_slots.clear();
+  m_entityMeshes.clear();
+}
+
+void RenderList::onMeshConstruct( entt::registry& registry, entt::entity entity )
+{
+  auto pMesh = registry.get<MeshComponent>( entity ).pMesh;
+  m_entityMeshes.insert_or_assign( entity, pMesh );
+  addMesh( pMesh );
+}
+
+void RenderList::onMeshUpdate( entt::registry& registry, entt::entity entity )
+{
+  auto pMesh = registry.get<MeshComponent>( entity ).pMesh;
+  auto& pOldMesh = m_entityMeshes[entity];
+
+  if ( pOldMesh == pMesh )
+    return;
+
+  removeMesh( pOldMesh );
+  addMesh( pMesh );
+  pOldMesh = pMesh;
+}
+
+void RenderList::onMeshDestroy( entt::registry& registry, entt::entity entity )
+{
+  auto it = m_entityMeshes.find( entity );
+  if ( it == m_entityMeshes.end() )
+    return;
+
+  removeMesh( it->second );
+  m_entityMeshes.erase( it );
+}
+
+void RenderList::addMesh( kogayonon_resources::Mesh* pMesh )
+{
+  // entities can have an empty mesh component until the loader thread fills it
+  if ( !pMesh )
+    return;
+
+  if ( auto it = m_slots.find( pMesh ); it != m_slots.end() )
+  {
+    ++m_refCounts.at( it->second );
+    return;
+  }
+
+  m_slots.try_emplace( pMesh, m_meshes.size() );
+  m_meshes.emplace_back( pMesh );
+  m_refCounts.emplace_back( 1 );
+}
+
+void RenderList::removeMesh( kogayonon_resources::Mesh* pMesh )
+{
+  if ( !pMesh )
+    return;
+
+  auto it = m_slots.find( pMesh );
+  if ( it == m_slots.end() )
+    return;
+
+  const auto slot = it->second;
+  if ( --m_refCounts.at( slot ) != 0 )
+    return;
+
+  // swap with the last mesh so the array stays packed
+  const auto last = m_meshes.size() - 1;
+  if ( slot != last )
+  {
+    m_meshes.at( slot ) = m_meshes.at( last );
+    m_refCounts.at( slot ) = m_refCounts.at( last );
+    m_slots.at( m_meshes.at( slot ) ) = slot;
+  }
+
+  m_meshes.pop_back();
+  m_refCounts.pop_back();
+  m_slots.erase( it );
+}
+} // namespace kogayonon_core
@@ -1,5 +1,7 @@
 #include "core/systems/rendering_system.hpp"
+#include <algorithm>
 #include <assert.h>
+#include <cstddef>
 #include <entt/entt.hpp>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -11,6 +13,10 @@
 #include "core/ecs/entity.hpp"
 #include "core/scene/scene.hpp"
 #include "core/scene/scene_manager.hpp"
+#include "rendering/frame_uniformbuffer.hpp"
+#include "rendering/gpu_buffer.hpp"
+#include "rendering/gpu_fence.hpp"
+#include "rendering/mesh_arena.hpp"
 #include "rendering/opengl_framebuffer.hpp"
 #include "rendering/renderer.hpp"
 #include "utilities/math/math.hpp"
@@ -20,26 +26,441 @@ using namespace kogayonon_rendering;
 
 namespace kogayonon_core
 {
+RenderingSystem::RenderingSystem()
+    : m_pMeshArena{ std::make_unique<MeshArena>() }
+    , m_pFrameUniforms{ std::make_unique<FrameUniformbuffer>() }
+    , m_pClusterBuffer{ std::make_unique<GPUBuffer>() }
+    , m_pClusterLightBuffer{ std::make_unique<GPUBuffer>() }
+{
+  m_frameData.pInstanceBuffer = std::make_unique<GPUBuffer>();
+  m_frameData.pCommandBuffer = std::make_unique<GPUBuffer>();
+  m_frameData.pEntityBuffer = std::make_unique<GPUBuffer>();
+  m_frameData.pMaterialBuffer = std::make_unique<GPUBuffer>();
+
+  m_pickingReadback.pBuffer = std::make_unique<GPUBuffer>();
+  m_pickingReadback.pFence = std::make_unique<GPUFence>();
+
+  for ( auto& data : m_passData )
+  {
+    data.pInstanceBuffer = std::make_unique<GPUBuffer>();
+    data.pCommandBuffer = std::make_unique<GPUBuffer>();
+    data.pEntityBuffer = std::make_unique<GPUBuffer>();
+    data.pMaterialBuffer = std::make_unique<GPUBuffer>();
+    data.pFence = std::make_unique<GPUFence>();
+  }
+}
+
+RenderingSystem::~RenderingSystem() = default;
+
+void RenderingSystem::updateFrameConstants( const FrameConstants& constants )
+{
+  m_pFrameUniforms->update( constants );
+  m_pFrameUniforms->bind();
+}
+
+auto RenderingSystem::getFrameConstants() const -> const FrameConstants&
+{
+  return m_pFrameUniforms->getConstants();
+}
+
+void RenderingSystem::prepareFrame( Scene* scene )
+{
+  if ( !scene )
+    return;
+
+  // every path samples materials. Without culling every instance gets drawn so every one of them uses its textures,
+  // the culled paths report what survived the camera. The view is the one of the last frame
+  const auto isCulled = m_cullingEnabled || m_gpuCullingEnabled;
+  for ( auto pMesh : scene->getRenderList().getMeshes() )
+  {
+    const auto pData = scene->getData( pMesh );
+    if ( !pData )
+      continue;
+
+    if ( !m_materialSystem.contains( pMesh ) )
+      m_materialSystem.registerMesh( pMesh );
+
+    if ( !isCulled )
+      useTextures( pMesh, *pData, nullptr, static_cast<uint32_t>( pData->count ) );
+  }
+
+  m_frameMeshes.clear();
+  m_boundsGathered = false;
+
+  if ( !m_indirectEnabled && !m_cullingEnabled && !m_gpuCullingEnabled )
+    return;
+
+  gatherFrameMeshes( scene );
+
+  // the culling pass builds the commands of every pass on its own
+  if ( m_gpuCullingEnabled )
+    return;
+
+  if ( m_cullingEnabled )
+  {
+    gatherBounds( scene );
+    return;
+  }
+
+  m_frameData.drawList.clear();
+  for ( auto pMesh : m_frameMeshes )
+  {
+    const auto& range = m_pMeshArena->getRange( pMesh->getId() );
+    const auto& data = scene->getData( pMesh );
+    m_frameData.drawList.addMesh( pMesh, range.vertexOffset, range.indexOffset, *data, data->count );
+  }
+
+  uploadDrawData( m_frameData );
+}
+
+void RenderingSystem::updateTextures()
+{
+  m_materialSystem.updateResidency();
+}
+
+void RenderingSystem::useTextures( kogayonon_resources::Mesh* pMesh, const InstanceData& data, const uint32_t* pSlots,
+                                   uint32_t count )
+{
+  if ( count == 0 )
+    return;
+
+  // the textures of a mesh are as big as its closest instance shows the whole mesh, no slots means the first count
+  auto pixelsPerUnit = 0.0f;
+  for ( auto i = 0u; i < count; i++ )
+  {
+    const auto& instanceMatrix = data.instances[pSlots ? pSlots[i] : i].instanceMatrix;
+    pixelsPerUnit = std::max( pixelsPerUnit, m_lodSelector.getPixelsPerUnit( *pMesh, instanceMatrix ) );
+  }
+
+  m_materialSystem.useTextures( pMesh, pixelsPerUnit * 2.0f * pMesh->getBoundingSphere().radius );
+}
+
+void RenderingSystem::gatherFrameMeshes( Scene* scene )
+{
+  m_frameMeshes.clear();
+  for ( auto pMesh : scene->getRenderList().getMeshes() )
+  {
+    // not uploaded yet or every instance got removed
+    const auto pData = scene->getData( pMesh );
+    if ( !pData || pData->count == 0 )
+      continue;
+
+    // geometry is only copied once, the arena keeps it until the system dies
+    if ( m_indirectEnabled && !m_pMeshArena->contains( pMesh->getId() ) )
+      m_pMeshArena->addMesh( pMesh->getId(), pMesh->getVertexData(), pMesh->getIndexData() );
+
+    m_frameMeshes.emplace_back( pMesh );
+  }
+}
+
+void RenderingSystem::gatherBounds( Scene* scene )
+{
+  // world bounds are the same for every pass, only the frustum changes
+  m_cullingSystem.clear();
+  m_cullFirst.clear();
+  m_cullCount.clear();
+  for ( auto pMesh : m_frameMeshes )
+  {
+    const auto& data = scene->getData( pMesh );
+    const auto first = m_cullingSystem.addInstances( pMesh->getBoundingSphere(), data->instances, data->count );
+    m_cullFirst.emplace_back( first );
+    m_cullCount.emplace_back( static_cast<uint32_t>( m_cullingSystem.size() ) - first );
+  }
+  m_boundsGathered = true;
+}
+
+void RenderingSystem::cullPass( Scene* scene, const glm::mat4& viewProjection, PassType pass )
+{
+  auto& passData = m_passData.at( static_cast<std::size_t>( pass ) );
+
+  passData.drawList.clear();
+  passData.gpuCounts = false;
+  m_visible.clear();
+
+  appendVisible( scene, Frustum::fromMatrix( viewProjection ), passData, pass == PassType::Geometry );
+  uploadDrawData( passData );
+}
+
+void RenderingSystem::cullCascades( Scene* scene, const ShadowCascades& cascades, glm::uvec4& firstInstance )
+{
+  auto& passData = m_passData.at( static_cast<std::size_t>( PassType::Depth ) );
+
+  passData.drawList.clear();
+  passData.gpuCounts = false;
+  m_visible.clear();
+
+  for ( auto i = 0u; i < cascades.count; i++ )
+  {
+    firstInstance[i] = static_cast<uint32_t>( passData.drawList.getInstances().size() );
+    appendVisible( scene, Frustum::fromMatrix( cascades.viewProjection.at( i ) ), passData );
+  }
+
+  uploadDrawData( passData );
+}
+
+void RenderingSystem::appendVisible( Scene* scene, const Frustum& frustum, PassDrawData& passData,
+                                     bool reportTextures )
+{
+  auto& stats = Renderer::getFrameStats();
+
+  for ( auto i = 0u; i < m_frameMeshes.size(); i++ )
+  {
+    auto pMesh = m_frameMeshes.at( i );
+    const auto& data = scene->getData( pMesh );
+
+    // the counts from prepareFrame, instances added since then show up next frame
+    const auto count = m_cullCount.at( i );
+    const auto firstVisible = static_cast<uint32_t>( m_visible.size() );
+    const auto visibleCount = m_cullingSystem.cull( frustum, m_cullFirst.at( i ), count, m_visible );
+
+    stats.instancesTested += count;
+    stats.instancesVisible += visibleCount;
+
+    if ( reportTextures )
+      useTextures( pMesh, *data, m_visible.data() + firstVisible, visibleCount );
+
+    // meshes drawn with their own vao index from 0, the arena ones from where they got placed
+    uint32_t vertexOffset = 0;
+    uint32_t indexOffset = 0;
+    if ( m_indirectEnabled )
+    {
+      const auto& range = m_pMeshArena->getRange( pMesh->getId() );
+      vertexOffset = range.vertexOffset;
+      indexOffset = range.indexOffset;
+    }
+
+    uint32_t fullIndices = 0;
+    for ( const auto& submesh : pMesh->getSubmeshes() )
+      fullIndices += submesh.indexCount;
+    stats.fullDetailIndices += uint64_t{ fullIndices } * visibleCount;
+
+    if ( !m_lodEnabled || pMesh->getLodCount() <= 1 )
+    {
+      stats.lodIndices += uint64_t{ fullIndices } * visibleCount;
+      passData.drawList.addMesh( pMesh, vertexOffset, indexOffset, *data, m_visible, firstVisible, visibleCount );
+      continue;
+    }
+
+    // the shadow passes pick with the camera too, picking again for the same camera keeps the level
+    const auto begin = m_visible.begin() + firstVisible;
+    const auto end = begin + visibleCount;
+    for ( auto it = begin; it != end; ++it )
+      data->lods[*it] = m_lodSelector.select( *pMesh, data->instances[*it].instanceMatrix, data->lods[*it] );
+
+    // a range of commands per level, the instances of a level have to be next to each other
+    std::sort( begin, end, [&data]( uint32_t lhs, uint32_t rhs ) {
+      return data->lods[lhs] < data->lods[rhs];
+    } );
+
+    for ( auto first = begin; first != end; )
+    {
+      const auto lod = data->lods[*first];
+      const auto last = std::find_if( first, end, [&data, lod]( uint32_t slot ) {
+        return data->lods[slot] != lod;
+      } );
+
+      const auto levelCount = static_cast<uint32_t>( last - first );
+      for ( const auto& submesh : pMesh->getSubmeshes() )
+        stats.lodIndices += uint64_t{ submesh.getLod( lod ).indexCount } * levelCount;
+
+      passData.drawList.addMesh( pMesh,
+                                 vertexOffset,
+                                 indexOffset,
+                                 *data,
+                                 m_visible,
+                                 static_cast<uint32_t>( first - m_visible.begin() ),
+                                 levelCount,
+                                 lod );
+      first = last;
+    }
+  }
+}
+
+auto RenderingSystem::getDrawData( PassType pass ) -> PassDrawData&
+{
+  if ( m_cullingEnabled || m_gpuCullingEnabled )
+    return m_passData.at( static_cast<std::size_t>( pass ) );
+
+  return m_frameData;
+}
+
+void RenderingSystem::uploadDrawData( PassDrawData& data )
+{
+  const auto& instances = data.drawList.getInstances();
+  const auto& entities = data.drawList.getEntities();
+  const auto& commands = data.drawList.getCommands();
+
+  data.pInstanceBuffer->upload( instances.data(), instances.size() * sizeof( GPUInstance ) );
+  data.pEntityBuffer->upload( entities.data(), entities.size() * sizeof( entt::entity ) );
+
+  // the commands are only read by glMultiDrawElementsIndirect
+  if ( m_indirectEnabled )
+    data.pCommandBuffer->upload( commands.data(), commands.size() * sizeof( DrawElementsIndirectCommand ) );
+
+  uploadDrawMaterials( data );
+}
+
+void RenderingSystem::uploadDrawMaterials( PassDrawData& data )
+{
+  m_drawMaterials.clear();
+  for ( const auto& range : data.drawList.getMeshRanges() )
+  {
+    // commands of a mesh follow the order of its submeshes
+    for ( const auto& submesh : range.pMesh->getSubmeshes() )
+      m_drawMaterials.emplace_back( m_materialSystem.getMaterialIndex( range.pMesh, submesh ) );
+  }
+
+  data.pMaterialBuffer->upload( m_drawMaterials.data(), m_drawMaterials.size() * sizeof( uint32_t ) );
+}
+
+auto RenderingSystem::readbackVisible( PassDrawData& data ) -> bool
+{
+  const auto& commands = data.drawList.getCommands();
+  if ( !data.pFence->isSignaled() || commands.empty() )
+    return false;
+
+  m_readback.resize( commands.size() );
+  glGetNamedBufferSubData( data.pCommandBuffer->getId(),
+                           0,
+                           commands.size() * sizeof( DrawElementsIndirectCommand ),
+                           m_readback.data() );
+
+  // every command of a mesh has the same count so the first one is enough
+  data.gpuVisible = 0;
+  for ( const auto& range : data.drawList.getMeshRanges() )
+  {
+    if ( range.commandCount != 0 )
+      data.gpuVisible += m_readback.at( range.firstCommand ).instanceCount;
+  }
+
+  data.pFence->destroy();
+  return true;
+}
+
+void RenderingSystem::renderCullingPass( FrameContext& frame, CullingPassContext& pass )
+{
+  if ( !m_gpuCullingEnabled || !frame.scene )
+    return;
+
+  auto scene = frame.scene;
+  auto shader = pass.shader;
+  auto& passData = m_passData.at( static_cast<std::size_t>( pass.target ) );
+  auto& stats = Renderer::getFrameStats();
+
+  // counts from the last time this pass ran, the stats lag a frame behind but we never wait on the gpu
+  const auto isGeometry = pass.target == PassType::Geometry;
+  if ( readbackVisible( passData ) && isGeometry )
+  {
+    m_gpuVisibleMeshes.clear();
+    for ( const auto& range : passData.drawList.getMeshRanges() )
+    {
+      if ( range.commandCount != 0 && m_readback.at( range.firstCommand ).instanceCount != 0 )
+        m_gpuVisibleMeshes.emplace( range.pMesh );
+    }
+  }
+
+  // which of the instances survived stays on the gpu, a mesh with any visible one reports all of them
+  if ( isGeometry )
+  {
+    for ( auto pMesh : m_frameMeshes )
+    {
+      const auto& data = scene->getData( pMesh );
+      if ( m_gpuVisibleMeshes.contains( pMesh ) )
+        useTextures( pMesh, *data, nullptr, static_cast<uint32_t>( data->count ) );
+    }
+  }
+
+  // every mesh gets room for all of its instances, the shader packs the visible ones at the start of the range
+  passData.drawList.clear();
+  passData.gpuCounts = true;
+  uint32_t instanceCount = 0;
+  for ( auto pMesh : m_frameMeshes )
+  {
+    uint32_t vertexOffset = 0;
+    uint32_t indexOffset = 0;
+    if ( m_indirectEnabled )
+    {
+      const auto& range = m_pMeshArena->getRange( pMesh->getId() );
+      vertexOffset = range.vertexOffset;
+      indexOffset = range.indexOffset;
+    }
+
+    passData.drawList.addMeshCommands( pMesh, vertexOffset, indexOffset, instanceCount );
+    instanceCount += static_cast<uint32_t>( scene->getData( pMesh )->count );
+  }
+
+  stats.instancesTested += instanceCount;
+  stats.instancesVisible += passData.gpuVisible;
+
+  if ( passData.drawList.empty() )
+    return;
+
+  // only the commands go up, the instances never leave the gpu
+  const auto& commands = passData.drawList.getCommands();
+  passData.pCommandBuffer->upload( commands.data(), commands.size() * sizeof( DrawElementsIndirectCommand ) );
+  passData.pInstanceBuffer->reserve( instanceCount * sizeof( GPUInstance ) );
+  passData.pEntityBuffer->reserve( instanceCount * sizeof( entt::entity ) );
+  uploadDrawMaterials( passData );
+
+  Renderer::useProgram( shader->getShaderId() );
+  shader->setMat4( "viewProjection", *frame.projection * *frame.view );
+  shader->setUint( "instanceStride", sizeof( GPUInstance ) / sizeof( uint32_t ) );
+  shader->setUint( "matrixOffset", offsetof( GPUInstance, instanceMatrix ) / sizeof( uint32_t ) );
+
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 6, passData.pInstanceBuffer->getId() );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 7, passData.pCommandBuffer->getId() );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, instanceEntityBinding, passData.pEntityBuffer->getId() );
+
+  for ( const auto& range : passData.drawList.getMeshRanges() )
+  {
+    const auto& data = scene->getData( range.pMesh );
+    const auto count = static_cast<uint32_t>( data->count );
+    if ( range.commandCount == 0 || count == 0 )
+      continue;
+
+    const auto& sphere = range.pMesh->getBoundingSphere();
+    shader->setVec4( "sphere", glm::vec4{ sphere.center, sphere.radius } );
+    shader->setUint( "instanceCount", count );
+    shader->setUint( "baseInstance", commands.at( range.firstCommand ).baseInstance );
+    shader->setUint( "firstCommand", range.firstCommand );
+    shader->setUint( "commandCount", range.commandCount );
+
+    glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 5, data->instanceBuffer );
+    glBindBufferBase( GL_SHADER_STORAGE_BUFFER, cullEntityBinding, data->entityBuffer );
+    glDispatchCompute( ( count + 63 ) / 64, 1, 1 );
+  }
+
+  // the draws read the commands and the instances, the readback reads the commands
+  glMemoryBarrier( GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT );
+  passData.pFence->insert();
+
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 5, 0 );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 6, 0 );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, 7, 0 );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, instanceEntityBinding, 0 );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, cullEntityBinding, 0 );
+}
+
 void RenderingSystem::renderOutliningPass( FrameContext& frame, OutliningPassContext& pass )
 {
   Renderer::enableDepth();
   beginOutliningPass( frame.canvas );
   Renderer::disableColorMask();
-  glStencilFunc( GL_ALWAYS, 1, 0xFF );
-  glStencilMask( 0xFF );
+  Renderer::setStencilFunc( GL_ALWAYS, 1, 0xFF );
+  Renderer::setStencilMask( 0xFF );
 
   // normal render
-  renderOutlinedEntity( frame.scene, frame.view, frame.projection, pass.normalShader, pass.depthMap );
+  renderOutlinedEntity( frame.scene, pass.normalShader, pass.depthMap );
 
   Renderer::enableColorMask();
-  glStencilFunc( GL_NOTEQUAL, 1, 0xFF );
-  glStencilMask( 0x00 );
+  Renderer::setStencilFunc( GL_NOTEQUAL, 1, 0xFF );
+  Renderer::setStencilMask( 0x00 );
 
   Renderer::disableDepth();
-  renderOutlinedEntity( frame.scene, frame.view, frame.projection, pass.outlineShader, pass.depthMap );
+  renderOutlinedEntity( frame.scene, pass.outlineShader, pass.depthMap );
 
-  glStencilMask( 0xFF );
-  glStencilFunc( GL_ALWAYS, 1, 0xFF );
+  Renderer::setStencilMask( 0xFF );
+  Renderer::setStencilFunc( GL_ALWAYS, 1, 0xFF );
 
   endOutliningPass( frame.canvas );
 }
@@ -47,37 +468,138 @@ void RenderingSystem::renderOutliningPass( FrameContext& frame, OutliningPassCon
 void RenderingSystem::renderDepthPass( FrameContext& frame, DepthPassContext& pass )
 {
   beginDepthPass( frame.canvas );
-  render( frame.scene, frame.view, frame.projection, pass.shader );
+
+  if ( pass.cascades && pass.cascades->count > 1 && pass.cascadeShader )
+    renderCascades( frame.scene, pass );
+  else
+    render( frame.scene, frame.view, frame.projection, pass.shader, PassType::Depth );
+
   endDepthPass( frame.canvas );
 }
 
+void RenderingSystem::renderCascades( Scene* scene, DepthPassContext& pass )
+{
+  // cascades always cull on the cpu, without a culling path enabled nothing was gathered for them yet
+  if ( !m_boundsGathered )
+  {
+    if ( m_frameMeshes.empty() )
+      gatherFrameMeshes( scene );
+    gatherBounds( scene );
+  }
+
+  glm::uvec4 firstInstance{ 0u };
+  cullCascades( scene, *pass.cascades, firstInstance );
+
+  auto shader = pass.cascadeShader;
+  begin( shader );
+  shader->setUvec4( "u_CascadeFirstInstance", firstInstance );
+
+  auto& passData = m_passData.at( static_cast<std::size_t>( PassType::Depth ) );
+  if ( m_indirectEnabled )
+    drawIndirect( passData, false );
+  else
+    drawCulled( scene, passData, nullptr );
+}
+
 void RenderingSystem::renderGeometryPass( FrameContext& frame, GeometryPassContext& pass )
 {
+  buildLightClusters( frame.scene, *frame.view, *frame.projection );
+
+  // the shader turns gl_FragCoord into a tile so it needs the size of the target
+  pass.shader->setUvec4( "u_ClusterGrid",
+                         glm::uvec4{ LightClusters::gridX, LightClusters::gridY, LightClusters::gridZ, 0u } );
+  pass.shader->setVec4( "u_ClusterParams",
+                        glm::vec4{ m_lightClusters.getSliceScale(),
+                                   m_lightClusters.getSliceBias(),
+                                   1.0f / static_cast<float>( std::max( frame.canvas.w, 1 ) ),
+                                   1.0f / static_cast<float>( std::max( frame.canvas.h, 1 ) ) } );
+
   beginGeometryPass( frame.canvas );
 
-  renderWithDepth( frame.scene, frame.view, frame.projection, pass.lightVP, pass.shader, pass.depthMap );
+  renderWithDepth( frame.scene, frame.view, frame.projection, pass.shader, pass.depthMap );
 
   endGeometryPass( frame.canvas );
 }
 
-auto RenderingSystem::renderPickingPass( FrameContext& frame, PickingPassContext& pass ) -> int
+void RenderingSystem::renderPickingPass( FrameContext& frame, PickingPassContext& pass )
 {
+  if ( frame.canvas.w <= 0 || frame.canvas.h <= 0 )
+    return;
+
   auto framebuffer = frame.canvas.framebuffer;
+  auto& readback = m_pickingReadback;
+
+  // the square is clamped to the canvas, the cursor keeps its place inside it
+  const auto flippedY = frame.canvas.h - pass.y - 1;
+  readback.w = std::min( pickingRegionSize, frame.canvas.w );
+  readback.h = std::min( pickingRegionSize, frame.canvas.h );
+  readback.x = std::clamp( pass.x - pickingRegionSize / 2, 0, frame.canvas.w - readback.w );
+  readback.y = std::clamp( flippedY - pickingRegionSize / 2, 0, frame.canvas.h - readback.h );
+  readback.cursorX = pass.x - readback.x;
+  readback.cursorY = flippedY - readback.y;
+  readback.frames = 0;
+
   beginPickingPass( frame.canvas );
 
-  render( frame.scene, frame.view, frame.projection, pass.shader );
+  render( frame.scene, frame.view, frame.projection, pass.shader, PassType::Picking );
 
-  auto result = framebuffer->readPixel( 0, pass.x, pass.y );
+  // a click that comes in before the last one resolved simply replaces it
+  readback.pBuffer->reserve( sizeof( int ) * readback.w * readback.h );
+  framebuffer->readPixels( 0, readback.x, readback.y, readback.w, readback.h, readback.pBuffer->getId() );
+  readback.pFence->insert();
 
   endPickingPass( frame.canvas );
+}
+
+auto RenderingSystem::pollPicking( int& result ) -> PickingStatus
+{
+  auto& readback = m_pickingReadback;
+  if ( !readback.pFence->isPending() )
+    return PickingStatus::Idle;
+
+  if ( !readback.pFence->isSignaled() )
+  {
+    if ( ++readback.frames < maxPickingFrames )
+      return PickingStatus::Pending;
+
+    readback.pFence->destroy();
+    return PickingStatus::Expired;
+  }
+
+  readback.pFence->destroy();
 
-  return result;
+  // only the pixel under the cursor counts, the background stays -1
+  const auto offset = static_cast<GLintptr>( ( readback.cursorY * readback.w + readback.cursorX ) * sizeof( int ) );
+  glGetNamedBufferSubData( readback.pBuffer->getId(), offset, sizeof( int ), &result );
+
+  return PickingStatus::Resolved;
 }
 
-void RenderingSystem::renderOutlinedEntity(
-  Scene* scene, glm::mat4* viewMatrix, glm::mat4* projection, kogayonon_utilities::Shader* shader, uint32_t* depthMap )
+auto RenderingSystem::pickClosest( Scene* scene, const glm::vec3& origin, const glm::vec3& direction ) -> entt::entity
 {
-  shader->bind();
+  // picks only happen on clicks so the tree is simply rebuilt every time
+  m_pickingBVH.clear();
+  for ( auto pMesh : scene->getRenderList().getMeshes() )
+  {
+    const auto pData = pMesh ? scene->getData( pMesh ) : nullptr;
+    if ( !pData )
+      continue;
+
+    const auto count = std::min( static_cast<std::size_t>( pData->count ), pData->instances.size() );
+    for ( auto i = 0u; i < count; i++ )
+    {
+      m_pickingBVH.add( PickingBVH::transformBounds( pMesh->getBounds(), pData->instances[i].instanceMatrix ),
+                        pData->entities[i] );
+    }
+  }
+
+  m_pickingBVH.build();
+  return m_pickingBVH.raycast( origin, direction );
+}
+
+void RenderingSystem::renderOutlinedEntity( Scene* scene, kogayonon_utilities::Shader* shader, uint32_t* depthMap )
+{
+  Renderer::useProgram( shader->getShaderId() );
   const auto& view = scene->getEnttRegistry().view<OutlineComponent>();
   entt::entity ent{ entt::null };
   for ( const auto& [entity, outlineComp] : view.each() )
@@ -93,62 +615,67 @@ void RenderingSystem::renderOutlinedEntity(
   auto& index = entity.getComponent<IndexComponent>().index;
 
   auto data = scene->getData( mesh );
-  shader->setMat4( "view", *viewMatrix );
-  shader->setMat4( "projection", *projection );
-  shader->setMat4( "instanceMatrix", data->instances.at( index ).instanceMatrix );
-  glBindVertexArray( mesh->getVao() );
+  shader->setMat4( "instanceMatrix", glm::mat4{ data->instances.at( index ).instanceMatrix } );
+  Renderer::bindVertexArray( mesh->getVao() );
 
   for ( const auto& sm : mesh->getSubmeshes() )
   {
     glDrawElementsBaseVertex(
       GL_TRIANGLES, sm.indexCount, GL_UNSIGNED_INT, (void*)( sm.indexOffset * sizeof( uint32_t ) ), sm.vertexOffest );
+    ++Renderer::getFrameStats().drawCalls;
   }
-
-  glBindVertexArray( 0 );
-  shader->unbind();
 }
 
 void RenderingSystem::render( Scene* scene,
                               glm::mat4* viewMatrix,
                               glm::mat4* projection,
-                              kogayonon_utilities::Shader* shader )
+                              kogayonon_utilities::Shader* shader,
+                              PassType pass )
 {
+  if ( m_cullingEnabled && !m_gpuCullingEnabled )
+    cullPass( scene, *projection * *viewMatrix, pass );
+
   begin( shader );
 
   scene->bindLightBuffers();
 
-  std::vector<kogayonon_resources::Mesh*> orderedMeshes;
-  makeMeshesUnique( scene, orderedMeshes );
+  if ( m_indirectEnabled )
+  {
+    drawIndirect( getDrawData( pass ), false );
+  }
+  else if ( m_cullingEnabled || m_gpuCullingEnabled )
+  {
+    drawCulled( scene, getDrawData( pass ), nullptr );
+  }
+  else
+  {
+    drawMeshes( scene, scene->getRenderList().getMeshes() );
+  }
 
-  shader->setMat4( "projection", *projection );
-  shader->setMat4( "view", *viewMatrix );
-  drawMeshes( scene, orderedMeshes );
   scene->unbindLightBuffers();
-  end( shader );
 }
 
 void RenderingSystem::drawMeshesWithDepth( Scene* scene,
                                            const std::vector<kogayonon_resources::Mesh*>& orderedMeshes,
-                                           const uint32_t* depthMap )
+                                           const uint32_t* depthMap,
+                                           kogayonon_utilities::Shader* shader )
 {
+  Renderer::bindTextureUnit( 4, *depthMap );
+
   for ( auto& mesh : orderedMeshes )
   {
     if ( !mesh )
       continue;
 
-    glBindVertexArray( mesh->getVao() );
-    const auto& textures = mesh->getTextures();
-    for ( int i = 0; i < textures.size(); i++ )
-    {
-      // bind the texture we need (this is bad)
-      glBindTextureUnit( 3, textures.at( i )->getTextureId() );
-    }
-    glBindTextureUnit( 4, *depthMap );
+    Renderer::bindVertexArray( mesh->getVao() );
 
     auto instanceData = scene->getData( mesh );
     auto& submeshes = mesh->getSubmeshes();
     for ( int i = 0; i < submeshes.size() && instanceData != nullptr; i++ )
     {
+      // a uniform per submesh instead of a texture bind, the textures all live in the material pages
+      shader->setInt( "u_MaterialIndex",
+                      static_cast<int>( m_materialSystem.getMaterialIndex( mesh, submeshes.at( i ) ) ) );
 
       glDrawElementsInstancedBaseVertex( GL_TRIANGLES,
                                          submeshes.at( i ).indexCount,
@@ -156,9 +683,8 @@ void RenderingSystem::drawMeshesWithDepth( Scene* scene,
                                          (void*)( submeshes.at( i ).indexOffset * sizeof( uint32_t ) ),
                                          instanceData->count,
                                          submeshes.at( i ).vertexOffest );
+      ++Renderer::getFrameStats().drawCalls;
     }
-    glBindVertexArray( 0 );
-    glBindTextureUnit( 1, 0 );
   }
 }
 
@@ -169,64 +695,181 @@ void RenderingSystem::drawMeshes( Scene* scene, const std::vector<kogayonon_reso
     if ( !mesh )
       continue;
 
-    glBindVertexArray( mesh->getVao() );
-    const auto& textures = mesh->getTextures();
-    for ( int i = 0; i < textures.size(); i++ )
-    {
-      // bind the texture we need (this is bad)
-      glBindTextureUnit( 3, textures.at( i )->getTextureId() );
-    }
+    Renderer::bindVertexArray( mesh->getVao() );
 
     auto instanceData = scene->getData( mesh );
+    if ( instanceData )
+      glBindBufferBase( GL_SHADER_STORAGE_BUFFER, instanceEntityBinding, instanceData->entityBuffer );
+
     auto& submeshes = mesh->getSubmeshes();
     for ( int i = 0; i < submeshes.size() && instanceData != nullptr; i++ )
     {
-
       glDrawElementsInstancedBaseVertex( GL_TRIANGLES,
                                          submeshes.at( i ).indexCount,
                                          GL_UNSIGNED_INT,
                                          (void*)( submeshes.at( i ).indexOffset * sizeof( uint32_t ) ),
                                          instanceData->count,
                                          submeshes.at( i ).vertexOffest );
+      ++Renderer::getFrameStats().drawCalls;
+    }
+  }
+}
+
+void RenderingSystem::drawIndirect( PassDrawData& data, bool useMaterials )
+{
+  const auto& drawList = data.drawList;
+  if ( drawList.empty() )
+    return;
+
+  auto& stats = Renderer::getFrameStats();
+  const auto& commands = drawList.getCommands();
+
+  // every pass can have its own instance buffer so we point binding 1 at the right one before drawing
+  const auto vao = m_pMeshArena->getVao();
+  if ( !m_arenaInstanceLayout )
+  {
+    Scene::bindInstanceBuffer( vao, data.pInstanceBuffer->getId() );
+    m_arenaInstanceLayout = true;
+  }
+  else
+  {
+    glVertexArrayVertexBuffer( vao, 1, data.pInstanceBuffer->getId(), 0, sizeof( GPUInstance ) );
+  }
+
+  Renderer::bindVertexArray( vao );
+  glBindBuffer( GL_DRAW_INDIRECT_BUFFER, data.pCommandBuffer->getId() );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, instanceEntityBinding, data.pEntityBuffer->getId() );
+
+  // gl_DrawID picks the material of every command so the whole list is one draw even with different textures
+  if ( useMaterials )
+    glBindBufferBase( GL_SHADER_STORAGE_BUFFER, MaterialSystem::drawMaterialBinding, data.pMaterialBuffer->getId() );
+
+  glMultiDrawElementsIndirect( GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>( commands.size() ), 0 );
+  ++stats.drawCalls;
+  stats.indirectCommands += static_cast<uint32_t>( commands.size() );
+
+  glBindBuffer( GL_DRAW_INDIRECT_BUFFER, 0 );
+}
+
+void RenderingSystem::drawCulled( Scene* scene, PassDrawData& data, kogayonon_utilities::Shader* materialShader )
+{
+  const auto& drawList = data.drawList;
+  const auto& commands = drawList.getCommands();
+  auto& stats = Renderer::getFrameStats();
+
+  // single draws always have gl_DrawID 0 so the offset alone points at the material of the command
+  if ( materialShader )
+    glBindBufferBase( GL_SHADER_STORAGE_BUFFER, MaterialSystem::drawMaterialBinding, data.pMaterialBuffer->getId() );
+
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, instanceEntityBinding, data.pEntityBuffer->getId() );
+
+  for ( const auto& range : drawList.getMeshRanges() )
+  {
+    auto pMesh = range.pMesh;
+    const auto vao = pMesh->getVao();
+
+    // the visible instances live in the pass buffer, baseInstance points at the ones of this mesh
+    glVertexArrayVertexBuffer( vao, 1, data.pInstanceBuffer->getId(), 0, sizeof( GPUInstance ) );
+    Renderer::bindVertexArray( vao );
+
+    if ( data.gpuCounts )
+    {
+      // the instance counts were written by the culling pass, the gpu reads them straight from the buffer
+      glBindBuffer( GL_DRAW_INDIRECT_BUFFER, data.pCommandBuffer->getId() );
+      for ( auto i = range.firstCommand; i < range.firstCommand + range.commandCount; i++ )
+      {
+        if ( materialShader )
+          materialShader->setUint( "u_DrawOffset", i );
+
+        glDrawElementsIndirect(
+          GL_TRIANGLES, GL_UNSIGNED_INT, (void*)( i * sizeof( DrawElementsIndirectCommand ) ) );
+        ++stats.drawCalls;
+      }
+      glBindBuffer( GL_DRAW_INDIRECT_BUFFER, 0 );
+    }
+    else
+    {
+      for ( auto i = range.firstCommand; i < range.firstCommand + range.commandCount; i++ )
+      {
+        if ( materialShader )
+          materialShader->setUint( "u_DrawOffset", i );
+
+        const auto& command = commands.at( i );
+        glDrawElementsInstancedBaseVertexBaseInstance( GL_TRIANGLES,
+                                                       command.count,
+                                                       GL_UNSIGNED_INT,
+                                                       (void*)( command.firstIndex * sizeof( uint32_t ) ),
+                                                       command.instanceCount,
+                                                       command.baseVertex,
+                                                       command.baseInstance );
+        ++stats.drawCalls;
+      }
     }
-    glBindVertexArray( 0 );
-    glBindTextureUnit( 1, 0 );
+
+    // give the mesh its full instance buffer back for the passes that do not cull
+    glVertexArrayVertexBuffer( vao, 1, scene->getData( pMesh )->instanceBuffer, 0, sizeof( GPUInstance ) );
   }
 }
 
+void RenderingSystem::buildLightClusters( Scene* scene, const glm::mat4& view, const glm::mat4& projection )
+{
+  m_lightClusters.build( scene->getPointLights(), view, projection );
+
+  const auto& clusters = m_lightClusters.getClusters();
+  const auto& indices = m_lightClusters.getLightIndices();
+  m_pClusterBuffer->upload( clusters.data(), clusters.size() * sizeof( LightCluster ) );
+
+  // an empty buffer can not be bound, keep at least one index around
+  m_pClusterLightBuffer->reserve( sizeof( uint32_t ) );
+  m_pClusterLightBuffer->upload( indices.data(), indices.size() * sizeof( uint32_t ) );
+
+  auto& stats = Renderer::getFrameStats();
+  stats.clusteredLights += m_lightClusters.getBinnedLightCount();
+  stats.clusterLightReferences += static_cast<uint32_t>( indices.size() );
+}
+
 void RenderingSystem::renderWithDepth( Scene* scene,
                                        glm::mat4* viewMatrix,
                                        glm::mat4* projection,
-                                       glm::mat4* lightSpaceMatrix,
                                        kogayonon_utilities::Shader* shader,
                                        uint32_t* depthMap )
 {
+  if ( m_cullingEnabled && !m_gpuCullingEnabled )
+    cullPass( scene, *projection * *viewMatrix, PassType::Geometry );
+
   begin( shader );
 
   scene->bindLightBuffers();
 
-  std::vector<kogayonon_resources::Mesh*> orderedMeshes;
-  makeMeshesUnique( scene, orderedMeshes );
-
-  shader->setMat4( "projection", *projection );
-  shader->setMat4( "view", *viewMatrix );
-  shader->setMat4( "lightVP", *lightSpaceMatrix );
+  // -1 makes the shader look the material up in the per command buffer, the legacy path overrides it per submesh
+  m_materialSystem.bind();
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, LightClusters::clusterBinding, m_pClusterBuffer->getId() );
+  glBindBufferBase( GL_SHADER_STORAGE_BUFFER, LightClusters::lightIndexBinding, m_pClusterLightBuffer->getId() );
+  shader->setInt( "u_MaterialIndex", -1 );
+  shader->setUint( "u_DrawOffset", 0 );
 
-  drawMeshesWithDepth( scene, orderedMeshes, depthMap );
+  if ( m_indirectEnabled )
+  {
+    Renderer::bindTextureUnit( 4, *depthMap );
+    drawIndirect( getDrawData( PassType::Geometry ), true );
+  }
+  else if ( m_cullingEnabled || m_gpuCullingEnabled )
+  {
+    Renderer::bindTextureUnit( 4, *depthMap );
+    drawCulled( scene, getDrawData( PassType::Geometry ), shader );
+  }
+  else
+  {
+    drawMeshesWithDepth( scene, scene->getRenderList().getMeshes(), depthMap, shader );
+  }
 
   scene->unbindLightBuffers();
-  end( shader );
 }
 
 void RenderingSystem::begin( kogayonon_utilities::Shader* shader ) const
 {
-  glUseProgram( 0 );
-  shader->bind();
-}
-
-void RenderingSystem::end( kogayonon_utilities::Shader* shader ) const
-{
-  shader->unbind();
+  // the program stays bound after the pass, the next one only switches if it uses a different shader
+  Renderer::useProgram( shader->getShaderId() );
 }
 
 void RenderingSystem::beginOutliningPass( Canvas& canvas ) const
@@ -235,16 +878,16 @@ void RenderingSystem::beginOutliningPass( Canvas& canvas ) const
   framebuffer->resize( canvas.w, canvas.h );
   framebuffer->bind();
 
-  glEnable( GL_STENCIL_TEST );
-  glStencilOp( GL_KEEP, GL_KEEP, GL_REPLACE );
-  glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
+  Renderer::enableStencil();
+  Renderer::setStencilOp( GL_KEEP, GL_KEEP, GL_REPLACE );
+  Renderer::setClearColor( glm::vec4{ 0.0f } );
   glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT );
 }
 
 void RenderingSystem::endOutliningPass( Canvas& canvas ) const
 {
   auto& framebuffer = canvas.framebuffer;
-  glDisable( GL_STENCIL_TEST );
+  Renderer::disableStencil();
   framebuffer->unbind();
 }
 
@@ -255,7 +898,7 @@ void RenderingSystem::beginGeometryPass( Canvas& canvas ) const
   framebuffer->resize( canvas.w, canvas.h );
   framebuffer->bind();
 
-  glClearColor( 0.2f, 0.2f, 0.2f, 0.4f );
+  Renderer::setClearColor( glm::vec4{ 0.2f, 0.2f, 0.2f, 0.4f } );
   glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT );
 }
 
@@ -274,7 +917,7 @@ void RenderingSystem::beginDepthPass( Canvas& canvas ) const
   framebuffer->bind();
 
   Renderer::enableDepth();
-  glCullFace( GL_FRONT );
+  Renderer::setCullFace( GL_FRONT );
   glClear( GL_DEPTH_BUFFER_BIT );
 }
 
@@ -283,7 +926,7 @@ void RenderingSystem::endDepthPass( Canvas& canvas ) const
   auto framebuffer = canvas.framebuffer;
 
   framebuffer->unbind();
-  glCullFace( GL_BACK );
+  Renderer::setCullFace( GL_BACK );
   Renderer::disableDepth();
 }
 
@@ -294,34 +937,22 @@ void RenderingSystem::beginPickingPass( Canvas& canvas ) const
   framebuffer->resize( canvas.w, canvas.h );
   framebuffer->bind();
   Renderer::enableDepth();
+
+  // only the square around the cursor gets cleared and shaded, glClearTexImage would ignore the scissor
+  const auto& readback = m_pickingReadback;
+  Renderer::enableScissor();
+  Renderer::setScissor( readback.x, readback.y, readback.w, readback.h );
   glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT );
-  framebuffer->clearColorAttachment( 0, -1 );
+
+  const int background = -1;
+  glClearNamedFramebufferiv( framebuffer->getId(), GL_COLOR, 0, &background );
 }
 
 void RenderingSystem::endPickingPass( Canvas& canvas ) const
 {
   auto framebuffer = canvas.framebuffer;
   framebuffer->unbind();
+  Renderer::disableScissor();
   Renderer::disableDepth();
 }
-
-void RenderingSystem::makeMeshesUnique( Scene* scene, std::vector<kogayonon_resources::Mesh*>& orderedMeshes )
-{
-  const auto& view = scene->getEnttRegistry().view<TransformComponent, MeshComponent, IndexComponent>();
-
-  std::unordered_set<kogayonon_resources::Mesh*> uniqueMeshes;
-
-  // we do this because what is different between an instance of a mesh and another is just the
-  // instance matrix ( model matrix so to say ) and we iterate through each available loaded mesh
-  // once and draw EVERY instance with different transforms and so on but using the same loaded model
-  view.each( [&]( const auto entity, auto& transformComp, auto& meshComp, auto& indexComp ) {
-    if ( !meshComp.loaded && !meshComp.pMesh )
-      return;
-
-    if ( uniqueMeshes.insert( meshComp.pMesh ).second )
-    {
-      orderedMeshes.emplace_back( meshComp.pMesh );
-    }
-  } );
-}
 } // namespace kogayonon_core
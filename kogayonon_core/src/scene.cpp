@@ -1,5 +1,6 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include "core/scene/scene.hpp"
+#include <algorithm>
 #include <glad/glad.h>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
@@ -13,12 +14,20 @@
 #include "core/ecs/main_registry.hpp"
 #include "core/ecs/registry.hpp"
 #include "physics/nvidia_physx.hpp"
+#include "rendering/renderer.hpp"
 #include "resources/light_types.hpp"
 #include "resources/pointlight.hpp"
 #include "utilities/asset_manager/asset_manager.hpp"
+#include "utilities/cpu_profiler/cpu_profiler.hpp"
 #include "utilities/math/math.hpp"
 using namespace kogayonon_utilities;
 
+namespace
+{
+// clean instances between two dirty ones that still get uploaded with them instead of starting a new upload
+constexpr uint32_t instanceMergeGap = 8;
+} // namespace
+
 namespace kogayonon_core
 {
 Scene::Scene( const std::string& name )
@@ -29,6 +38,12 @@ Scene::Scene( const std::string& name )
 {
   m_lightUBO.initialize( 3 );
   m_lightSSBO.initialize();
+  m_renderList.connect( m_pRegistry->getRegistry() );
+}
+
+Scene::~Scene()
+{
+  m_renderList.disconnect( m_pRegistry->getRegistry() );
 }
 
 auto Scene::getRegistry() -> Registry*
@@ -62,31 +77,32 @@ void Scene::removeEntity( entt::entity ent )
   {
     const auto& pLightComponent = entity.getComponent<PointLightComponent>();
     const auto toErase = pLightComponent.pointLightIndex;
-    m_lightSSBO.removeLight( kogayonon_resources::LightType::Point, toErase );
+    const auto moved = m_lightSSBO.removeLight( kogayonon_resources::LightType::Point, toErase );
     m_lightUBO.decrementLightCount( kogayonon_resources::LightType::Point );
 
+    // the last light took the removed slot, only its owner has to follow
     for ( const auto& [entity, pLightComponent_] : m_pRegistry->getRegistry().view<PointLightComponent>().each() )
     {
-      if ( pLightComponent_.pointLightIndex > toErase )
-        --pLightComponent_.pointLightIndex;
+      if ( pLightComponent_.pointLightIndex == moved )
+        pLightComponent_.pointLightIndex = toErase;
     }
-    updateLightBuffers();
+    m_lightUBO.update();
   }
 
   if ( entity.hasComponent<DirectionalLightComponent>() )
   {
     const auto& pDirectionalLightComponent = entity.getComponent<DirectionalLightComponent>();
     const auto toErase = pDirectionalLightComponent.directionalLightIndex;
-    m_lightSSBO.removeLight( kogayonon_resources::LightType::Directional, toErase );
+    const auto moved = m_lightSSBO.removeLight( kogayonon_resources::LightType::Directional, toErase );
     m_lightUBO.decrementLightCount( kogayonon_resources::LightType::Directional );
 
     for ( const auto& [entity, pDirectionalLightComponent_] :
           m_pRegistry->getRegistry().view<DirectionalLightComponent>().each() )
     {
-      if ( pDirectionalLightComponent_.directionalLightIndex > toErase )
-        --pDirectionalLightComponent_.directionalLightIndex;
+      if ( pDirectionalLightComponent_.directionalLightIndex == static_cast<int>( moved ) )
+        pDirectionalLightComponent_.directionalLightIndex = toErase;
     }
-    updateLightBuffers();
+    m_lightUBO.update();
   }
 
   // then destroy the entity
@@ -119,20 +135,14 @@ bool Scene::addInstanceData( entt::entity entityId )
       // we create a new instance matrix
       const auto& transform = entity.getComponent<TransformComponent>();
 
-      // increment the count
-      ++instanceData->count;
-
-      // insert the gpu instance in the vector
-      instanceData->instances.emplace_back( GPUInstance{
-        .entityId = static_cast<int>( entityId ),
-        .instanceMatrix = math::computeTransform( transform.translation, transform.rotation, transform.scale ),
-      } );
+      // insert the gpu instance in the vector, this also bumps the count
+      const auto index = instanceData->addInstance(
+        entityId,
+        GPUInstance{ .instanceMatrix = glm::mat4x3{
+                       math::computeTransform( transform.translation, transform.rotation, transform.scale ) } } );
 
-      // get the index of the instance matrix
-      uint32_t size = instanceData->instances.size();
-
-      // add the index component and assing the index to size-1 (last added element)
-      entity.addComponent<IndexComponent>( IndexComponent{ .index = size - 1 } );
+      // the index component is the way back from the entity to its slot
+      entity.addComponent<IndexComponent>( IndexComponent{ .index = index } );
 
       // we found the model in the instance map so the geometry is also already uploaded to the gpu and we use the
       // instance matrix for per model translation/ rotation/ scale
@@ -143,16 +153,13 @@ bool Scene::addInstanceData( entt::entity entityId )
   {
     auto pMesh = pMeshComponent->pMesh;
     const auto& transform = entity.getComponent<TransformComponent>();
-    auto instanceData = std::make_unique<InstanceData>(
-      InstanceData{ .instances = { GPUInstance{ .entityId = static_cast<int>( entityId ),
-                                                .instanceMatrix = math::computeTransform(
-                                                  transform.translation, transform.rotation, transform.scale ) } },
-                    .count = 1,
-                    .pMesh = pMesh } );
+    auto instanceData = std::make_unique<InstanceData>( InstanceData{ .count = 0, .pMesh = pMesh } );
+    const auto index = instanceData->addInstance(
+      entityId,
+      GPUInstance{ .instanceMatrix = glm::mat4x3{
+                     math::computeTransform( transform.translation, transform.rotation, transform.scale ) } } );
 
-    // first we get the index of the instance matrix
-    uint32_t size = instanceData->instances.size();
-    entity.addComponent<kogayonon_core::IndexComponent>( IndexComponent{ .index = size - 1 } );
+    entity.addComponent<kogayonon_core::IndexComponent>( IndexComponent{ .index = index } );
 
     m_instances.try_emplace( pMesh, std::move( instanceData ) );
     // we did not find the model in the instance map so we must also upload geometry to the GPU
@@ -162,7 +169,6 @@ bool Scene::addInstanceData( entt::entity entityId )
 
 void Scene::addMeshToEntity( entt::entity entity, kogayonon_resources::Mesh* pMesh )
 {
-  std::lock_guard lock{ m_registryMutex };
   m_registryModified = true;
   Entity ent{ m_pRegistry.get(), entity };
   ent.setType( EntityType::Object );
@@ -173,6 +179,12 @@ void Scene::addMeshToEntity( entt::entity entity, kogayonon_resources::Mesh* pMe
     ent.addComponent<TransformComponent>();
 }
 
+void Scene::queueMeshForEntity( entt::entity entity, kogayonon_resources::Mesh* pMesh )
+{
+  std::lock_guard lock{ m_pendingMutex };
+  m_pendingMeshes.emplace_back( entity, pMesh );
+}
+
 void Scene::removeInstanceData( entt::entity ent )
 {
   // upon deletion we must remove that specific instance
@@ -186,35 +198,22 @@ void Scene::removeInstanceData( entt::entity ent )
   if ( !pMesh )
     return;
 
-  if ( m_instances.contains( pMesh ) )
+  // meshes that were never prepared for rendering have no slot yet
+  const auto pIndexComponent = entity.tryGetComponent<IndexComponent>();
+  if ( m_instances.contains( pMesh ) && pIndexComponent )
   {
     const auto& instance = m_instances.at( pMesh );
+    const auto slot = pIndexComponent->index;
 
-    --instance->count;
-
-    const auto& indexComponent = entity.getComponent<IndexComponent>();
-
-    // get the index component and then erase that specific instance matrix
-    auto toErase = indexComponent.index;
-    instance->instances.erase( instance->instances.begin() + toErase );
-
-    // now we need to update all the index components that are to the right of the deleted index
-    for ( const auto& [entity, indexComp, meshComp] :
-          m_pRegistry->getRegistry().view<IndexComponent, MeshComponent>().each() )
-    {
-      Entity ent{ m_pRegistry.get(), entity };
+    // the last instance fills the hole, its owner is the only index that changes
+    const auto moved = instance->removeInstance( slot );
+    if ( moved == entt::null )
+      return;
 
-      // update the index just to those who use the same mesh
-      if ( meshComp.pMesh == pMesh )
-      {
-        // if the index from the iteration is > to the index component we erased from the instances
-        if ( indexComp.index > toErase )
-          --indexComp.index;
-      }
-    }
+    m_pRegistry->getRegistry().get<IndexComponent>( moved ).index = slot;
 
-    // finally set up instances again to update the instance buffer and entityIds buffer
-    setupInstances( instance.get() );
+    // the buffer keeps its size, everything past count is just not drawn anymore
+    markInstanceDirty( instance.get(), slot );
   }
 }
 
@@ -245,9 +244,8 @@ void Scene::addOutline( entt::entity ent )
 
     auto data = getData( meshComp.pMesh );
     auto index = entity.getComponent<IndexComponent>().index;
-    data->instances.at( index ).selected = 1;
+    data->selected.at( index ) = 1;
     entity.addComponent<OutlineComponent>();
-    updateInstances( data );
   }
 }
 
@@ -263,9 +261,8 @@ void Scene::removeOutline()
     auto& meshComp = entity.getComponent<MeshComponent>();
     auto data = getData( meshComp.pMesh );
     auto index = entity.getComponent<IndexComponent>().index;
-    data->instances.at( index ).selected = 0;
+    data->selected.at( index ) = 0;
     entity.removeComponent<OutlineComponent>();
-    updateInstances( data );
   } );
 }
 
@@ -277,43 +274,87 @@ auto Scene::getData( kogayonon_resources::Mesh* pModel ) -> InstanceData*
   return m_instances.at( pModel ).get();
 }
 
-void Scene::updateInstances( InstanceData* data )
+void Scene::markInstanceDirty( InstanceData* data, uint32_t index )
 {
-  // upload new data
-  glNamedBufferSubData( data->instanceBuffer, 0, sizeof( GPUInstance ) * data->count, data->instances.data() );
+  if ( data->dirtySlots.empty() )
+    m_dirtyInstances.emplace_back( data );
+
+  data->dirtySlots.emplace_back( index );
+}
+
+void Scene::flushInstances()
+{
+  auto& stats = kogayonon_rendering::Renderer::getFrameStats();
+  for ( auto data : m_dirtyInstances )
+  {
+    auto& slots = data->dirtySlots;
+    std::sort( slots.begin(), slots.end() );
+    slots.erase( std::unique( slots.begin(), slots.end() ), slots.end() );
+
+    // slots past the end belonged to instances removed after they were marked
+    const auto count = static_cast<uint32_t>( data->instances.size() );
+    slots.erase( std::lower_bound( slots.begin(), slots.end(), count ), slots.end() );
+
+    // not on the gpu yet, setupInstances uploads everything anyway
+    if ( data->instanceBuffer == 0 )
+      slots.clear();
+
+    for ( std::size_t i = 0; i < slots.size(); )
+    {
+      const auto first = slots.at( i );
+      auto last = first;
+      while ( ++i < slots.size() && slots.at( i ) - last <= instanceMergeGap )
+        last = slots.at( i );
+
+      const auto size = sizeof( GPUInstance ) * ( last - first + 1 );
+      glNamedBufferSubData( data->instanceBuffer, sizeof( GPUInstance ) * first, size, &data->instances.at( first ) );
+
+      // a removal moves the owner along with the matrix
+      const auto entitySize = sizeof( entt::entity ) * ( last - first + 1 );
+      glNamedBufferSubData(
+        data->entityBuffer, sizeof( entt::entity ) * first, entitySize, &data->entities.at( first ) );
+      stats.instanceUploadBytes += static_cast<uint32_t>( size + entitySize );
+    }
+
+    slots.clear();
+  }
+
+  m_dirtyInstances.clear();
 }
 
 void Scene::setupInstances( InstanceData* data )
 {
   if ( data->instanceBuffer == 0 )
+  {
     glCreateBuffers( 1, &data->instanceBuffer );
+    glCreateBuffers( 1, &data->entityBuffer );
+  }
 
   glNamedBufferData(
     data->instanceBuffer, sizeof( GPUInstance ) * data->count, data->instances.data(), GL_DYNAMIC_DRAW );
+  glNamedBufferData(
+    data->entityBuffer, sizeof( entt::entity ) * data->count, data->entities.data(), GL_DYNAMIC_DRAW );
 
-  const auto& vao = data->pMesh->getVao();
+  bindInstanceBuffer( data->pMesh->getVao(), data->instanceBuffer );
+}
 
-  glVertexArrayVertexBuffer( vao, 1, data->instanceBuffer, 0, sizeof( GPUInstance ) );
+void Scene::bindInstanceBuffer( uint32_t vao, uint32_t instanceBuffer )
+{
+  glVertexArrayVertexBuffer( vao, 1, instanceBuffer, 0, sizeof( GPUInstance ) );
 
-  glEnableVertexArrayAttrib( vao, 3 );
-  glEnableVertexArrayAttrib( vao, 4 );
   glEnableVertexArrayAttrib( vao, 5 );
   glEnableVertexArrayAttrib( vao, 6 );
   glEnableVertexArrayAttrib( vao, 7 );
   glEnableVertexArrayAttrib( vao, 8 );
 
-  glVertexArrayAttribIFormat( vao, 3, 1, GL_UNSIGNED_INT, offsetof( GPUInstance, selected ) );
-  glVertexArrayAttribIFormat( vao, 4, 1, GL_INT, offsetof( GPUInstance, entityId ) );
-
   std::size_t matrixOffset = offsetof( GPUInstance, instanceMatrix );
 
+  // a mat4x3 attribute, 4 columns of 3 floats
   for ( auto i = 0u; i < 4; i++ )
   {
-    glVertexArrayAttribFormat( vao, 5 + i, 4, GL_FLOAT, GL_FALSE, matrixOffset + i * sizeof( glm::vec4 ) );
+    glVertexArrayAttribFormat( vao, 5 + i, 3, GL_FLOAT, GL_FALSE, matrixOffset + i * sizeof( glm::vec3 ) );
   }
 
-  glVertexArrayAttribBinding( vao, 3, 1 );
-  glVertexArrayAttribBinding( vao, 4, 1 );
   glVertexArrayAttribBinding( vao, 5, 1 );
   glVertexArrayAttribBinding( vao, 6, 1 );
   glVertexArrayAttribBinding( vao, 7, 1 );
@@ -351,12 +392,12 @@ void Scene::updateRigidbodyEntities()
 
     // update the instance matrix
     auto& instanceMatrix = instanceData->instances.at( indexComponent.index ).instanceMatrix;
-    instanceMatrix = model;
+    instanceMatrix = glm::mat4x3{ model };
     // rotation is using euler angles, yaw pitch roll (glm::vec3)
     transformComponent.rotation = glm::eulerAngles( rotation );
 
-    // finally update the instances
-    updateInstances( instanceData );
+    // every body sharing the mesh goes up in the same flush before rendering
+    markInstanceDirty( instanceData, indexComponent.index );
   } );
 }
 
@@ -367,13 +408,34 @@ auto Scene::getLightCount( const kogayonon_resources::LightType& type ) -> uint3
 
 void Scene::prepareForRendering()
 {
+  KOGAYONON_PROFILE_ZONE( "Scene::prepareForRendering" );
+
+  // the lock is only held for the swap, the components and the render list change on this thread
+  std::vector<std::pair<entt::entity, kogayonon_resources::Mesh*>> pendingMeshes;
+  {
+    std::lock_guard lock{ m_pendingMutex };
+    pendingMeshes.swap( m_pendingMeshes );
+  }
+
+  for ( const auto& [entity, pMesh] : pendingMeshes )
+  {
+    if ( m_pRegistry->getRegistry().valid( entity ) )
+      addMeshToEntity( entity, pMesh );
+  }
+
+  // whatever moved since the last frame
+  flushInstances();
+
+  // lights edited since the last frame, usually nothing
+  m_lightSSBO.update();
+
   // skip this function if we did not add a new entity or something
   if ( !m_registryModified )
     return;
 
   m_registryModified = false;
 
-  updateLightBuffers();
+  m_lightUBO.update();
 
   auto& assetManager = AssetManager::getInstance();
 
@@ -396,18 +458,7 @@ void Scene::prepareForRendering()
 
       setupInstances( getData( meshComponent.pMesh ) );
 
-      // check textures
-      for ( auto& texture : meshComponent.pMesh->getTextures() )
-      {
-
-        // if either one of them is true then continue to the next one
-        if ( !texture || texture->getLoaded() )
-          continue;
-
-        texture = assetManager.addTexture( texture->getName() );
-        texture->setLoaded( true );
-      }
-
+      // the textures are streamed in by the residency of the material system once the mesh shows up on screen
       meshComponent.loaded = true;
     }
   }
@@ -495,6 +546,11 @@ auto Scene::getPointLight( uint32_t index ) -> kogayonon_resources::PointLight&
   return m_lightSSBO.getPointLights().at( index );
 }
 
+auto Scene::getPointLights() -> const std::vector<kogayonon_resources::PointLight>&
+{
+  return m_lightSSBO.getPointLights();
+}
+
 auto Scene::getDirectionalLight( uint32_t index ) -> kogayonon_resources::DirectionalLight&
 {
   assert( index >= 0 && "index must not be negative" );
@@ -507,4 +563,9 @@ void Scene::updateLightBuffers()
   m_lightUBO.update();
 }
 
+void Scene::markLightDirty( const kogayonon_resources::LightType& type, uint32_t index )
+{
+  m_lightSSBO.markDirty( type, index );
+}
+
 } // namespace kogayonon_core
\ No newline at end of file
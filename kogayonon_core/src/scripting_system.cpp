@@ -15,6 +15,7 @@
 #include "core/ecs/main_registry.hpp"
 #include "core/ecs/registry.hpp"
 #include "core/event/event_dispatcher.hpp"
+#include "utilities/cpu_profiler/cpu_profiler.hpp"
 #include "utilities/time_tracker/time_tracker.hpp"
 #include "window/window.hpp"
 
@@ -83,6 +84,7 @@ bool ScriptingSystem::isInit() const
 
 void ScriptingSystem::loadMainScript( const std::string& path )
 {
+  KOGAYONON_PROFILE_ZONE( "ScriptingSystem::loadMainScript" );
   m_luaState.safe_script_file( path );
 }
 
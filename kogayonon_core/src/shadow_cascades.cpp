@@ -0,0 +1,89 @@
+#include "core/systems/shadow_cascades.hpp"
+#include <algorithm>
+#include <cmath>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+namespace kogayonon_core
+{
+auto computeShadowCascades( const glm::mat4& view, const glm::mat4& projection, const glm::vec3& lightDirection,
+                            const ShadowCascadeSettings& settings ) -> ShadowCascades
+{
+  ShadowCascades cascades{ .count = std::clamp( settings.count, 1u, maxShadowCascades ) };
+
+  // glm::perspective stores -(f + n) / (f - n) and -2fn / (f - n), both solved for near and far
+  const auto a = projection[2][2];
+  const auto b = projection[3][2];
+  const auto nearPlane = b / ( a - 1.0f );
+  const auto cameraFar = b / ( a + 1.0f );
+  const auto farPlane = std::clamp( settings.distance, nearPlane, cameraFar );
+
+  // near corners first, the far corner of the same edge is 4 after it
+  std::array<glm::vec3, 8> corners;
+  const auto inverseViewProjection = glm::inverse( projection * view );
+  auto index = 0u;
+  for ( const auto z : { -1.0f, 1.0f } )
+  {
+    for ( const auto y : { -1.0f, 1.0f } )
+    {
+      for ( const auto x : { -1.0f, 1.0f } )
+      {
+        const auto corner = inverseViewProjection * glm::vec4{ x, y, z, 1.0f };
+        corners[index++] = glm::vec3{ corner } / corner.w;
+      }
+    }
+  }
+
+  const auto up = std::abs( lightDirection.y ) > 0.99f ? glm::vec3{ 0.0f, 0.0f, 1.0f } : glm::vec3{ 0.0f, 1.0f, 0.0f };
+  const auto halfResolution = static_cast<float>( settings.resolution ) * 0.5f;
+
+  auto previousSplit = nearPlane;
+  for ( auto i = 0u; i < cascades.count; i++ )
+  {
+    // blend of the uniform and the logarithmic split, the log one alone leaves the far cascades huge
+    const auto p = static_cast<float>( i + 1 ) / static_cast<float>( cascades.count );
+    const auto logSplit = nearPlane * std::pow( farPlane / nearPlane, p );
+    const auto uniformSplit = nearPlane + ( farPlane - nearPlane ) * p;
+    const auto split = settings.splitLambda * logSplit + ( 1.0f - settings.splitLambda ) * uniformSplit;
+
+    // view depth is linear along the corner edges so the slice is a lerp between the near and far corners
+    const auto start = ( previousSplit - nearPlane ) / ( cameraFar - nearPlane );
+    const auto end = ( split - nearPlane ) / ( cameraFar - nearPlane );
+
+    std::array<glm::vec3, 8> slice;
+    glm::vec3 center{ 0.0f };
+    for ( auto j = 0u; j < 4; j++ )
+    {
+      const auto edge = corners[j + 4] - corners[j];
+      slice[j] = corners[j] + edge * start;
+      slice[j + 4] = corners[j] + edge * end;
+      center += slice[j] + slice[j + 4];
+    }
+    center /= 8.0f;
+
+    float radius = 0.0f;
+    for ( const auto& corner : slice )
+      radius = std::max( radius, glm::length( corner - center ) );
+
+    // float noise in the corners would change the texel size a tiny bit every frame
+    radius = std::ceil( radius * 16.0f ) / 16.0f;
+
+    // the near plane is pulled back so casters between the light and the slice still land in the map
+    const auto lightView = glm::lookAt( center - lightDirection * ( radius + settings.casterDistance ), center, up );
+    auto lightProjection =
+      glm::ortho( -radius, radius, -radius, radius, 0.0f, 2.0f * radius + settings.casterDistance );
+
+    // shift the projection so the world origin sits on a texel, the cascade then only moves in whole texels
+    auto origin = lightProjection * lightView * glm::vec4{ 0.0f, 0.0f, 0.0f, 1.0f };
+    origin *= halfResolution;
+    lightProjection[3][0] += ( std::round( origin.x ) - origin.x ) / halfResolution;
+    lightProjection[3][1] += ( std::round( origin.y ) - origin.y ) / halfResolution;
+
+    cascades.viewProjection[i] = lightProjection * lightView;
+    cascades.splits[i] = split;
+    previousSplit = split;
+  }
+
+  return cascades;
+}
+} // namespace kogayonon_core
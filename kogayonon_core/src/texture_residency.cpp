@@ -0,0 +1,377 @@
+#include "core/systems/texture_residency.hpp"
+#include <algorithm>
+#include <glad/glad.h>
+#include "core/ecs/main_registry.hpp"
+#include "rendering/renderer.hpp"
+#include "resources/texture.hpp"
+#include "utilities/asset_manager/asset_manager.hpp"
+#include "utilities/cpu_profiler/cpu_profiler.hpp"
+
+using kogayonon_rendering::Renderer;
+using kogayonon_rendering::TexturePageMove;
+using kogayonon_rendering::TexturePages;
+using kogayonon_rendering::TexturePageSlot;
+using kogayonon_utilities::AssetManager;
+
+namespace kogayonon_core
+{
+namespace
+{
+inline auto getResidentSize( const std::optional<TexturePageSlot>& slot ) -> uint32_t
+{
+  return slot ? TexturePages::pageSizes.at( slot->page % TexturePages::sizeCount ) : 0;
+}
+} // namespace
+
+TextureResidency::TextureResidency()
+    : m_pPages{ std::make_unique<TexturePages>() }
+{
+}
+
+TextureResidency::~TextureResidency()
+{
+  // the user counts of the textures are left alone, the asset manager may be gone already when the app closes.
+  // The second call gets the views the first one only marked stale
+  releasePreviews();
+  releasePreviews();
+}
+
+void TextureResidency::track( kogayonon_resources::Texture* pTexture )
+{
+  if ( pTexture && m_entries.try_emplace( pTexture ).second )
+    pTexture->addUser();
+}
+
+void TextureResidency::use( kogayonon_resources::Texture* pTexture, float pixels )
+{
+  const auto it = m_entries.find( pTexture );
+  if ( it == m_entries.end() )
+    return;
+
+  // anything under the smallest page still gets the smallest page
+  auto& entry = it->second;
+  const auto size = TexturePages::pageSizes.at( TexturePages::getSizeIndex( static_cast<uint32_t>( pixels ) ) );
+  entry.requiredSize = entry.lastUsedFrame == m_frame ? std::max( entry.requiredSize, size ) : size;
+  entry.lastUsedFrame = m_frame;
+}
+
+auto TextureResidency::update() -> const std::vector<kogayonon_resources::Texture*>&
+{
+  KOGAYONON_PROFILE_ZONE( "TextureResidency::update" );
+
+  m_changed.clear();
+  releasePreviews();
+  const auto placeholder = AssetManager::getInstance().getTextureStreamer().getPlaceholder();
+  for ( auto& [pTexture, entry] : m_entries )
+  {
+    // the streamer marks a texture loaded once it is complete, a file it could not read keeps the placeholder
+    if ( entry.failed || !pTexture->getLoaded() || ( entry.slot && entry.streamSize == 0 ) )
+      continue;
+
+    if ( pTexture->getTextureId() == 0 || pTexture->getTextureId() == placeholder )
+    {
+      if ( entry.streamSize != 0 )
+        m_streaming--;
+      entry.streamSize = 0;
+      entry.failed = true;
+      continue;
+    }
+
+    page( pTexture, entry );
+  }
+
+  relievePressure();
+  requestSizes();
+
+  auto& stats = Renderer::getFrameStats();
+  stats.textureResidentBytes = m_pPages->getAllocatedBytes();
+  stats.textureBudgetBytes = m_budget;
+
+  m_frame++;
+  return m_changed;
+}
+
+auto TextureResidency::getSlot( kogayonon_resources::Texture* pTexture ) const -> std::optional<TexturePageSlot>
+{
+  const auto it = m_entries.find( pTexture );
+  return it == m_entries.end() ? std::nullopt : it->second.slot;
+}
+
+auto TextureResidency::getPreview( kogayonon_resources::Texture* pTexture ) -> uint32_t
+{
+  const auto slot = getSlot( pTexture );
+  if ( !slot )
+    return 0;
+
+  auto& view = m_previews[pTexture];
+  if ( view == 0 )
+    view = m_pPages->createView( *slot );
+  return view;
+}
+
+void TextureResidency::releasePreviews()
+{
+  // windows drawn before the update of a frame still use the views of the last one, those go a frame later
+  for ( auto view : m_stalePreviews )
+    glDeleteTextures( 1, &view );
+  m_stalePreviews.clear();
+
+  for ( const auto& [pTexture, view] : m_previews )
+    m_stalePreviews.emplace_back( view );
+  m_previews.clear();
+}
+
+void TextureResidency::bind( uint32_t firstUnit ) const
+{
+  m_pPages->bind( firstUnit );
+}
+
+auto TextureResidency::getResidentCount() const -> std::size_t
+{
+  return static_cast<std::size_t>(
+    std::ranges::count_if( m_entries, []( const auto& pair ) { return pair.second.slot.has_value(); } ) );
+}
+
+void TextureResidency::page( kogayonon_resources::Texture* pTexture, Entry& entry )
+{
+  // a texture loaded before it was tracked comes in at the size it was used at
+  const auto size = entry.streamSize != 0 ? entry.streamSize : std::max( entry.requiredSize, 1u );
+  if ( entry.streamSize != 0 )
+    m_streaming--;
+  entry.streamSize = 0;
+
+  const auto id = pTexture->getTextureId();
+  const auto slot = m_pPages->addTexture( id, size );
+
+  // the layer is all we keep, the texture gets requested again when it has to grow
+  Renderer::releaseTexture( id );
+  AssetManager::getInstance().getTextureStreamer().release( pTexture );
+
+  if ( !slot )
+  {
+    entry.failed = true;
+    return;
+  }
+
+  if ( entry.slot )
+    m_pPages->free( *entry.slot );
+
+  entry.raw = slot->page < TexturePages::sizeCount;
+  setSlot( pTexture, entry, slot );
+  Renderer::getFrameStats().texturesStreamedIn++;
+}
+
+void TextureResidency::relievePressure()
+{
+  // the pages get trimmed once the victims are picked, so the layers they would keep is what counts
+  const auto reserved = getReservedBytes();
+  auto isOver = [this, reserved]() { return m_pPages->getCompactBytes() + reserved > m_budget; };
+  if ( !isOver() )
+  {
+    // pages that emptied out on their own give the memory back without any pressure
+    followMoves( m_pPages->trim( m_pPages->getAllocatedBytes() + reserved > m_budget ) );
+    return;
+  }
+
+  // textures with a request in flight keep their layer until the bigger one arrives
+  std::vector<std::pair<kogayonon_resources::Texture*, Entry*>> victims;
+  for ( auto& [pTexture, entry] : m_entries )
+  {
+    if ( entry.slot && entry.streamSize == 0 )
+      victims.emplace_back( pTexture, &entry );
+  }
+
+  // least recently used first, the biggest layers first among the ones used just as long ago
+  std::ranges::sort( victims, []( const auto& lhs, const auto& rhs ) {
+    if ( lhs.second->lastUsedFrame != rhs.second->lastUsedFrame )
+      return lhs.second->lastUsedFrame < rhs.second->lastUsedFrame;
+    return getResidentSize( lhs.second->slot ) > getResidentSize( rhs.second->slot );
+  } );
+
+  auto& stats = Renderer::getFrameStats();
+  auto evict = [&]( kogayonon_resources::Texture* pTexture, Entry& entry ) {
+    m_pPages->free( *entry.slot );
+    setSlot( pTexture, entry, std::nullopt );
+    stats.texturesStreamedOut++;
+  };
+
+  // a smaller page that is full would have to grow, that is more memory right when there is none
+  auto canShrink = [this]( const Entry& entry, uint32_t sizeIndex ) {
+    return m_pPages->getGrowBytes( entry.slot->page / TexturePages::sizeCount * TexturePages::sizeCount +
+                                   sizeIndex ) == 0;
+  };
+  auto shrinkTo = [&]( kogayonon_resources::Texture* pTexture, Entry& entry, uint32_t sizeIndex ) {
+    setSlot( pTexture, entry, m_pPages->shrink( *entry.slot, sizeIndex ) );
+    stats.texturesStreamedOut++;
+  };
+
+  // textures nobody drew this frame go down a mip at a time and leave the pages at the smallest size
+  for ( auto& [pTexture, pEntry] : victims )
+  {
+    if ( pEntry->lastUsedFrame == m_frame || !isOver() )
+      break;
+
+    while ( isOver() && pEntry->slot )
+    {
+      const auto sizeIndex = pEntry->slot->page % TexturePages::sizeCount;
+      if ( sizeIndex == 0 || !canShrink( *pEntry, sizeIndex - 1 ) )
+        evict( pTexture, *pEntry );
+      else
+        shrinkTo( pTexture, *pEntry, sizeIndex - 1 );
+    }
+  }
+
+  // then whatever is bigger than the screen needs
+  for ( auto& [pTexture, pEntry] : victims )
+  {
+    if ( !isOver() )
+      break;
+
+    if ( !pEntry->slot || pEntry->lastUsedFrame != m_frame )
+      continue;
+
+    const auto wanted = TexturePages::getSizeIndex( pEntry->requiredSize );
+    if ( wanted < pEntry->slot->page % TexturePages::sizeCount && canShrink( *pEntry, wanted ) )
+      shrinkTo( pTexture, *pEntry, wanted );
+  }
+
+  // everything on screen is at its size, the biggest layers give up a mip until it fits or all are at the bottom
+  while ( isOver() )
+  {
+    std::pair<kogayonon_resources::Texture*, Entry*> largest{ nullptr, nullptr };
+    for ( const auto& victim : victims )
+    {
+      const auto& slot = victim.second->slot;
+      if ( !slot || slot->page % TexturePages::sizeCount == 0 ||
+           !canShrink( *victim.second, slot->page % TexturePages::sizeCount - 1 ) )
+        continue;
+
+      if ( !largest.second || getResidentSize( slot ) > getResidentSize( largest.second->slot ) )
+        largest = victim;
+    }
+
+    if ( !largest.second )
+      break;
+
+    shrinkTo( largest.first, *largest.second, largest.second->slot->page % TexturePages::sizeCount - 1 );
+  }
+
+  followMoves( m_pPages->trim( true ) );
+}
+
+void TextureResidency::requestSizes()
+{
+  if ( m_streaming >= maxStreamsInFlight )
+    return;
+
+  std::vector<std::pair<kogayonon_resources::Texture*, Entry*>> wanted;
+  for ( auto& [pTexture, entry] : m_entries )
+  {
+    if ( entry.failed || entry.streamSize != 0 || entry.lastUsedFrame != m_frame )
+      continue;
+
+    if ( entry.requiredSize > getResidentSize( entry.slot ) )
+      wanted.emplace_back( pTexture, &entry );
+  }
+
+  // textures showing nothing go first, then the ones furthest from what they need
+  std::ranges::sort( wanted, []( const auto& lhs, const auto& rhs ) {
+    const auto lhsSize = getResidentSize( lhs.second->slot );
+    const auto rhsSize = getResidentSize( rhs.second->slot );
+    if ( lhsSize != rhsSize )
+      return lhsSize < rhsSize;
+    return lhs.second->requiredSize > rhs.second->requiredSize;
+  } );
+
+  auto& streamer = AssetManager::getInstance().getTextureStreamer();
+  const auto& pTaskManager = MainRegistry::getInstance().getTaskManager();
+  auto reserved = getReservedBytes();
+  for ( auto& [pTexture, pEntry] : wanted )
+  {
+    if ( m_streaming >= maxStreamsInFlight )
+      break;
+
+    // the old layer stays until the new one is paged, both have to fit together with the texture the streamer
+    // loads it into and the page growing for it. A smaller step is better than nothing
+    const auto resident = getResidentSize( pEntry->slot );
+    auto isTooBig = [&]( uint32_t size ) {
+      return m_pPages->getAllocatedBytes() + reserved + getStreamBytes( pTexture, *pEntry, size ) +
+               m_pPages->getGrowBytes( getStreamPage( *pEntry, size ) ) >
+             m_budget;
+    };
+    auto size = pEntry->requiredSize;
+    while ( size > resident && size >= TexturePages::pageSizes.front() && isTooBig( size ) )
+      size /= 2;
+
+    if ( size <= resident || size < TexturePages::pageSizes.front() )
+      continue;
+
+    pEntry->streamSize = size;
+    reserved += getStreamBytes( pTexture, *pEntry, size );
+    m_streaming++;
+    streamer.request( pTexture, *pTaskManager, kogayonon_utilities::TextureUsage::Color, static_cast<int>( size ) );
+  }
+}
+
+auto TextureResidency::getStreamPage( const Entry& entry, uint32_t size ) const -> uint32_t
+{
+  const auto compressed = AssetManager::getInstance().getTextureStreamer().isCompressionEnabled() && !entry.raw;
+  const auto sizeIndex = TexturePages::getSizeIndex( size );
+  return compressed ? TexturePages::sizeCount + sizeIndex : sizeIndex;
+}
+
+auto TextureResidency::getStreamBytes( const kogayonon_resources::Texture* pTexture, const Entry& entry,
+                                       uint32_t size ) const -> std::size_t
+{
+  const auto pageIndex = getStreamPage( entry, size );
+  const auto layerBytes = TexturePages::getLayerBytes( pageIndex );
+
+  // cooked files leave out the mips above the size, the temporary texture is as big as the layer
+  if ( pageIndex >= TexturePages::sizeCount )
+    return layerBytes * 2;
+
+  // raw files always come in whole as RGBA8 with mips, until one arrived the biggest page is the guess
+  const auto width = static_cast<std::size_t>( pTexture->getWidth() );
+  const auto height = static_cast<std::size_t>( pTexture->getHeight() );
+  const auto largest = static_cast<std::size_t>( TexturePages::pageSizes.back() );
+  const auto sourceBytes = width != 0 && height != 0 ? width * height * 4 * 4 / 3 : largest * largest * 4 * 4 / 3;
+  return layerBytes + sourceBytes;
+}
+
+auto TextureResidency::getReservedBytes() const -> std::size_t
+{
+  std::size_t bytes = 0;
+  for ( const auto& [pTexture, entry] : m_entries )
+  {
+    if ( entry.streamSize != 0 )
+      bytes += getStreamBytes( pTexture, entry, entry.streamSize );
+  }
+  return bytes;
+}
+
+void TextureResidency::followMoves( const std::vector<TexturePageMove>& moves )
+{
+  if ( moves.empty() )
+    return;
+
+  for ( auto& [pTexture, entry] : m_entries )
+  {
+    if ( !entry.slot )
+      continue;
+
+    const auto move = std::ranges::find_if( moves, [&slot = *entry.slot]( const TexturePageMove& candidate ) {
+      return candidate.from.page == slot.page && candidate.from.layer == slot.layer;
+    } );
+    if ( move != moves.end() )
+      setSlot( pTexture, entry, move->to );
+  }
+}
+
+void TextureResidency::setSlot( kogayonon_resources::Texture* pTexture, Entry& entry,
+                                std::optional<TexturePageSlot> slot )
+{
+  entry.slot = slot;
+  if ( std::ranges::find( m_changed, pTexture ) == m_changed.end() )
+    m_changed.emplace_back( pTexture );
+}
+} // namespace kogayonon_core
@@ -16,6 +16,7 @@ struct TextureComponent;
 struct MeshComponent;
 struct TransformComponent;
 class Entity;
+class TextureResidency;
 } // namespace kogayonon_core
 
 namespace kogayonon_gui
@@ -30,6 +31,14 @@ public:
 
   void onEntitySelect( const kogayonon_core::SelectEntityEvent& e );
 
+  /**
+   * @brief Material textures only live in the texture pages, their previews are made from there
+   */
+  inline void setTextureResidency( kogayonon_core::TextureResidency* pResidency )
+  {
+    m_pTextureResidency = pResidency;
+  }
+
 private:
   void drawEnttProperties( std::shared_ptr<kogayonon_core::Scene> scene );
   void drawTextureContextMenu( std::vector<kogayonon_resources::Texture*>& textures, int index ) const;
@@ -50,5 +59,6 @@ private:
 
 private:
   entt::entity m_selectedEntity;
+  kogayonon_core::TextureResidency* m_pTextureResidency{ nullptr };
 };
 } // namespace kogayonon_gui
\ No newline at end of file
@@ -12,5 +12,9 @@ public:
   void draw() override;
 
 private:
+  /**
+   * @brief Frame time history and the percentiles of every profiled scope, plus the chrome trace export
+   */
+  void drawProfiler();
 };
 } // namespace kogayonon_gui
\ No newline at end of file
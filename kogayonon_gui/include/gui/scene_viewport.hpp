@@ -20,6 +20,7 @@ namespace kogayonon_core
 
 class Scene;
 class RenderingSystem;
+class TextureResidency;
 
 class SelectEntityEvent;
 class KeyPressedEvent;
@@ -73,6 +74,17 @@ public:
   void drawToolbar();
   void drawPickingScene();
 
+  /**
+   * @brief Selects the entity of a pick that was queued on an earlier click once the readback is in, or picks on the
+   * cpu if the readback took too long
+   */
+  void resolvePicking();
+
+  /**
+   * @brief The residency of the material textures this viewport draws with
+   */
+  auto getTextureResidency() -> kogayonon_core::TextureResidency&;
+
   // Events
   void onSelectedEntity( const kogayonon_core::SelectEntityEvent& e );
   void onMouseMoved( const kogayonon_core::MouseMovedEvent& e );
@@ -80,6 +92,9 @@ public:
   void onKeyPressed( const kogayonon_core::KeyPressedEvent& e );
   void onMouseScrolled( const kogayonon_core::MouseScrolledEvent& e );
 
+private:
+  void selectPickedEntity( entt::entity ent );
+
 private:
   entt::entity m_selectedEntity;
   unsigned int m_playTextureId;
@@ -103,6 +118,11 @@ private:
   std::unique_ptr<kogayonon_rendering::Camera> m_pCamera;
   GizmoMode m_gizmoMode;
   bool m_gizmoEnabled{ false };
+  bool m_openRenderModePopup{ false };
+
+  // ray of the last click in world space
+  glm::vec3 m_pickOrigin{ 0.0f };
+  glm::vec3 m_pickDirection{ 0.0f, 0.0f, -1.0f };
 
   RenderMode m_renderMode{ RenderMode::GeometryAndLights };
 };
@@ -20,6 +20,7 @@
 #include "core/event/scene_events.hpp"
 #include "core/scene/scene.hpp"
 #include "core/scene/scene_manager.hpp"
+#include "core/systems/texture_residency.hpp"
 #include "imgui_utils/imgui_utils.h"
 #include "physics/nvidia_physx.hpp"
 #include "utilities/asset_manager/asset_manager.hpp"
@@ -352,16 +353,34 @@ void EntityPropertiesWindow::drawMeshComponent( Entity& ent )
     }
   }
 
+  // the texture itself only holds the placeholder, what got loaded lives in a layer of the pages
   for ( const auto& uniqueTex : uniqueTextures )
   {
-    ImGui::Image( (ImTextureID)uniqueTex->getTextureId(), ImVec2{ 50.0f, 50.0f } );
+    if ( !m_pTextureResidency || !m_pTextureResidency->contains( uniqueTex ) )
+    {
+      ImGui::TextDisabled( "%s is not a base color, it is not loaded", uniqueTex->getName().c_str() );
+      continue;
+    }
+
+    const auto preview = m_pTextureResidency->getPreview( uniqueTex );
+    if ( preview == 0 )
+    {
+      ImGui::TextDisabled( "%s is not resident yet", uniqueTex->getName().c_str() );
+      continue;
+    }
+
+    const auto slot = m_pTextureResidency->getSlot( uniqueTex );
+    const auto residentSize =
+      kogayonon_rendering::TexturePages::pageSizes.at( slot->page % kogayonon_rendering::TexturePages::sizeCount );
+
+    ImGui::Image( (ImTextureID)preview, ImVec2{ 50.0f, 50.0f } );
     if ( ImGui::IsItemHovered() )
     {
       // should show here what submeshes uses this texture
       ImGui::BeginTooltip();
-      ImGui::Image( (ImTextureID)uniqueTex->getTextureId(), ImVec2{ 250.0f, 250.0f } );
+      ImGui::Image( (ImTextureID)preview, ImVec2{ 250.0f, 250.0f } );
       ImGui::Text( "%s", uniqueTex->getName().c_str() );
-      ImGui::Text( "%d/%d", uniqueTex->getWidth(), uniqueTex->getHeight() );
+      ImGui::Text( "%d/%d, resident at %u", uniqueTex->getWidth(), uniqueTex->getHeight(), residentSize );
       ImGui::EndTooltip();
     }
   }
@@ -408,12 +427,11 @@ void EntityPropertiesWindow::manageModelPayload( const ImGuiPayload* payload )
     }
     else
     {
+      // the worker only imports, the scene attaches the mesh on the render thread
       pTaskManager->enqueue( [entTemp, p, pScene]() {
         auto& assetManager = AssetManager::getInstance();
-        Entity ent{ pScene->getRegistry(), entTemp };
-
         const auto model = assetManager.addMesh( p.filename().string(), p.string() );
-        pScene->addMeshToEntity( entTemp, model );
+        pScene->queueMeshForEntity( entTemp, model );
       } );
     }
   }
@@ -525,13 +543,14 @@ void EntityPropertiesWindow::drawTransformComponent( Entity& ent ) const
       const auto data = scene->getData( modelComponent->pMesh );
 
       // update the matrix in the instance matrices vector
-      ImGuizmo::RecomposeMatrixFromComponents(
-        glm::value_ptr( translation ),
-        glm::value_ptr( rotation ),
-        glm::value_ptr( scale ),
-        glm::value_ptr( data->instances.at( indexComponent.index ).instanceMatrix ) );
-
-      scene->updateInstances( data );
+      glm::mat4 instanceMatrix{ 1.0f };
+      ImGuizmo::RecomposeMatrixFromComponents( glm::value_ptr( translation ),
+                                               glm::value_ptr( rotation ),
+                                               glm::value_ptr( scale ),
+                                               glm::value_ptr( instanceMatrix ) );
+      data->instances.at( indexComponent.index ).instanceMatrix = glm::mat4x3{ instanceMatrix };
+
+      scene->markInstanceDirty( data, indexComponent.index );
     }
   }
 }
@@ -704,12 +723,9 @@ void EntityPropertiesWindow::drawPointLightComponent( kogayonon_core::Entity& en
 
     ImGui::EndTable();
 
+    // only this light goes up on the next frame
     if ( changed )
-    {
-      auto scene = SceneManager::getCurrentScene().lock();
-      // update the ubo and ssbo if needed
-      scene->updateLightBuffers();
-    }
+      scene->markLightDirty( kogayonon_resources::LightType::Point, pPointLightComponent.pointLightIndex );
   }
 }
 
@@ -797,14 +813,38 @@ void EntityPropertiesWindow::drawDirectionalLightComponent( kogayonon_core::Enti
     changed |=
       ImGui::DragFloat( "##PositionFactor", &pDirectionalLightComponent->positionFactor, 0.1f, 0.1f, 2000.0f, "%.2f" );
 
-    ImGui::EndTable();
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
 
-    if ( changed )
+    ImGui::Text( "Cascades" );
+    ImGui::TableNextColumn();
+    changed |= ImGui::SliderInt( "##CascadeCount", &pDirectionalLightComponent->cascadeCount, 1, 4 );
+
+    // the split and the distance only matter once the shadow is split
+    if ( pDirectionalLightComponent->cascadeCount > 1 )
     {
-      auto scene = SceneManager::getCurrentScene().lock();
-      // update the ubo and ssbo if needed
-      scene->updateLightBuffers();
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+
+      ImGui::Text( "Split lambda" );
+      ImGui::TableNextColumn();
+      changed |= ImGui::SliderFloat(
+        "##CascadeSplitLambda", &pDirectionalLightComponent->cascadeSplitLambda, 0.0f, 1.0f, "%.2f" );
+
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+
+      ImGui::Text( "Distance" );
+      ImGui::TableNextColumn();
+      changed |= ImGui::DragFloat(
+        "##CascadeDistance", &pDirectionalLightComponent->cascadeDistance, 0.5f, 1.0f, 2000.0f, "%.2f" );
     }
+
+    ImGui::EndTable();
+
+    if ( changed )
+      scene->markLightDirty( kogayonon_resources::LightType::Directional,
+                             pDirectionalLightComponent->directionalLightIndex );
   }
 }
 } // namespace kogayonon_gui
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include "core/event/app_event.hpp"
 #include "core/event/event_dispatcher.hpp"
 #include "gui/debug_window.hpp"
+#include "rendering/profiler.hpp"
 #include "utilities/asset_manager/asset_manager.hpp"
 #include "utilities/configurator/configurator.hpp"
 
@@ -181,7 +182,10 @@ void ImGuiManager::begin()
 void ImGuiManager::end()
 {
   ImGui::Render();
-  ImGui_ImplOpenGL3_RenderDrawData( ImGui::GetDrawData() );
+  {
+    kogayonon_rendering::ProfileScope scope{ "imgui", true };
+    ImGui_ImplOpenGL3_RenderDrawData( ImGui::GetDrawData() );
+  }
 
   if ( m_io->ConfigFlags & ImGuiConfigFlags_ViewportsEnable )
   {
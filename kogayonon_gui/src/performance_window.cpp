@@ -1,11 +1,28 @@
 #include "gui/performance_window.hpp"
-#include <chrono>
-#include "core/ecs/main_registry.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <filesystem>
 #include "imgui_utils/imgui_utils.h"
-#include "utilities/time_tracker/time_tracker.hpp"
+#include "rendering/profiler.hpp"
+#include "rendering/render_target_pool.hpp"
+#include "rendering/renderer.hpp"
+#include "utilities/asset_manager/asset_manager.hpp"
 
 namespace kogayonon_gui
 {
+namespace
+{
+auto findFrameHistory() -> const kogayonon_rendering::ProfileHistory*
+{
+  const auto& histories = kogayonon_rendering::Profiler::getHistories();
+  const auto frame = std::find_if( histories.begin(), histories.end(), []( const auto& history ) {
+    return !history.isGpu() && history.getName() == "frame";
+  } );
+
+  return frame != histories.end() ? &*frame : nullptr;
+}
+} // namespace
+
 // could also get more stats into this window like draw calls and so on
 PerformanceWindow::PerformanceWindow( std::string name )
     : ImGuiWindow( std::move( name ) )
@@ -19,26 +36,128 @@ void PerformanceWindow::draw()
   if ( !begin() )
     return;
 
-  static std::chrono::high_resolution_clock::time_point initial = std::chrono::high_resolution_clock::now();
+  // the median of the history moves slow enough to be read, no need to only refresh it once a second
+  const auto pFrame = findFrameHistory();
+  const auto frameTimeMilli = pFrame ? pFrame->getPercentile( 0.5f ) : 0.0f;
+
+  ImGui::Text( "FPS: %d", frameTimeMilli > 0.0f ? static_cast<int>( 1000.0f / frameTimeMilli ) : 0 );
+  ImGui::Text( "Frame time %.3f ms", frameTimeMilli );
+
+  // the viewport is drawn after this window so we show what the last frame did
+  const auto& frameStats = kogayonon_rendering::Renderer::getLastFrameStats();
+  ImGui::Separator();
+  ImGui::Text( "Draw calls %u", frameStats.drawCalls );
+  ImGui::Text( "Indirect commands %u", frameStats.indirectCommands );
+  ImGui::Text( "Visible instances %u / %u", frameStats.instancesVisible, frameStats.instancesTested );
+  ImGui::Text( "LOD indices %llu / %llu full detail",
+               static_cast<unsigned long long>( frameStats.lodIndices ),
+               static_cast<unsigned long long>( frameStats.fullDetailIndices ) );
+  ImGui::Text( "State calls issued %u elided %u", frameStats.stateCallsIssued, frameStats.stateCallsElided );
+  ImGui::Text( "Clustered lights %u in %u cluster entries", frameStats.clusteredLights,
+               frameStats.clusterLightReferences );
+  ImGui::Text( "Light buffers %u bytes, uploaded %u bytes", frameStats.lightBufferBytes, frameStats.lightUploadBytes );
+  ImGui::Text( "Instances uploaded %u bytes", frameStats.instanceUploadBytes );
+
+  const auto& textureStreamer = kogayonon_utilities::AssetManager::getInstance().getTextureStreamer();
+  ImGui::Text( "Textures streaming %zu, uploaded %zu bytes",
+               textureStreamer.getPendingCount(),
+               textureStreamer.getUploadedBytes() );
+
+  // what sits in the pages plus the textures the streamer did not hand over yet
+  const auto& textureStats = textureStreamer.getLoadStats();
+  const auto textureBytes = textureStats.vramBytes + frameStats.textureResidentBytes;
+  ImGui::Text( "Textures %zu (%zu compressed), %.1f MB of VRAM, %.1f MB as RGBA8, loaded in %.1f ms",
+               textureStats.textures,
+               textureStats.compressed,
+               static_cast<double>( textureBytes ) / ( 1 << 20 ),
+               static_cast<double>( textureStats.rgba8Bytes ) / ( 1 << 20 ),
+               textureStats.loadMilliseconds );
+  ImGui::Text( "Texture pages %.1f / %.1f MB, paged in %u, shrunk or evicted %u",
+               static_cast<double>( frameStats.textureResidentBytes ) / ( 1 << 20 ),
+               static_cast<double>( frameStats.textureBudgetBytes ) / ( 1 << 20 ),
+               frameStats.texturesStreamedIn,
+               frameStats.texturesStreamedOut );
+  ImGui::Text( "Render targets %zu, %zu bytes, %u allocated last frame",
+               kogayonon_rendering::RenderTargetPool::getTargets().size(),
+               kogayonon_rendering::RenderTargetPool::getAllocatedBytes(),
+               frameStats.renderTargetAllocations );
+
+  drawProfiler();
+
+  ImGui::End();
+}
+
+void PerformanceWindow::drawProfiler()
+{
+  ImGui::Separator();
+  const auto pFrame = findFrameHistory();
 
-  auto passed = std::chrono::high_resolution_clock::now();
-  ImGui::Text( "FPS:" );
-  ImGui::SameLine();
-  const auto& pTimeTracker = kogayonon_core::MainRegistry::getInstance().getTimeTracker();
-  static int fps = static_cast<int>( 1.0f / pTimeTracker->getDuration( "deltaTime" ).count() );
-  static double frameTimeMilli =
-    std::chrono::duration<double, std::milli>( pTimeTracker->getDuration( "deltaTime" ) ).count();
+  auto frameMedian = 0.0f;
+  if ( pFrame )
+  {
+    frameMedian = pFrame->getPercentile( 0.5f );
+    ImGui::PlotLines( "##frameHistory",
+                      pFrame->getSamples().data(),
+                      static_cast<int>( pFrame->getCount() ),
+                      static_cast<int>( pFrame->getOffset() ),
+                      "frame ms",
+                      0.0f,
+                      FLT_MAX,
+                      ImVec2{ ImGui::GetContentRegionAvail().x, 60.0f } );
+  }
 
-  if ( std::chrono::duration<double>( passed - initial ).count() > 1.0f )
+  // every bar is the median of the scope against the median frame, the gpu scopes are a few frames behind
+  if ( ImGui::BeginTable( "##profilerScopes", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp ) )
   {
-    initial = std::chrono::high_resolution_clock::now();
-    fps = static_cast<int>( 1.0f / pTimeTracker->getDuration( "deltaTime" ).count() );
-    frameTimeMilli = std::chrono::duration<double, std::milli>( pTimeTracker->getDuration( "deltaTime" ) ).count();
+    ImGui::TableSetupColumn( "Scope" );
+    ImGui::TableSetupColumn( "Last" );
+    ImGui::TableSetupColumn( "p50" );
+    ImGui::TableSetupColumn( "p95" );
+    ImGui::TableSetupColumn( "p99" );
+    ImGui::TableSetupColumn( "Share" );
+    ImGui::TableHeadersRow();
+
+    for ( const auto& history : kogayonon_rendering::Profiler::getHistories() )
+    {
+      const auto median = history.getPercentile( 0.5f );
+
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text( "%s %s", history.isGpu() ? "gpu" : "cpu", history.getName().c_str() );
+      ImGui::TableNextColumn();
+      ImGui::Text( "%.3f", history.getLatest() );
+      ImGui::TableNextColumn();
+      ImGui::Text( "%.3f", median );
+      ImGui::TableNextColumn();
+      ImGui::Text( "%.3f", history.getPercentile( 0.95f ) );
+      ImGui::TableNextColumn();
+      ImGui::Text( "%.3f", history.getPercentile( 0.99f ) );
+      ImGui::TableNextColumn();
+      const auto share = frameMedian > 0.0f ? std::min( median / frameMedian, 1.0f ) : 0.0f;
+      ImGui::ProgressBar( share, ImVec2{ -FLT_MIN, 0.0f } );
+    }
+
+    ImGui::EndTable();
   }
 
-  ImGui::Text( "%d", fps );
-  ImGui::Text( "Frame time %.3f ms", frameTimeMilli );
+  for ( const auto& timing : kogayonon_rendering::Renderer::getPassTimings() )
+  {
+    if ( timing.culled )
+      ImGui::TextDisabled( "%s culled", timing.name.c_str() );
+  }
 
-  ImGui::End();
+  static std::string exportStatus;
+  if ( ImGui::Button( "Export trace" ) )
+  {
+    const auto path = ( std::filesystem::current_path() / "kogayonon_trace.json" ).string();
+    exportStatus =
+      kogayonon_rendering::Profiler::exportChromeTrace( path ) ? "Saved " + path : "Could not write " + path;
+  }
+
+  if ( !exportStatus.empty() )
+  {
+    ImGui::SameLine();
+    ImGui::TextUnformatted( exportStatus.c_str() );
+  }
 }
 } // namespace kogayonon_gui
\ No newline at end of file
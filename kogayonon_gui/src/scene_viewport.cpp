@@ -21,8 +21,10 @@
 #include "core/scene/scene.hpp"
 #include "core/scene/scene_manager.hpp"
 #include "core/systems/rendering_system.hpp"
+#include "core/systems/texture_residency.hpp"
 #include "physics/nvidia_physx.hpp"
 #include "rendering/camera/camera.hpp"
+#include "rendering/frame_uniformbuffer.hpp"
 #include "utilities/asset_manager/asset_manager.hpp"
 #include "utilities/shader/shader_manager.hpp"
 #include "utilities/time_tracker/time_tracker.hpp"
@@ -78,23 +80,31 @@ SceneViewportWindow::SceneViewportWindow( SDL_Window* mainWindow, std::string na
     , m_gizmoMode{ GizmoMode::TRANSLATE }
 {
   // buffer where we draw everything, geometry, lights
-  FramebufferSpec spec{
-    { FramebufferAttachment{ .textureFormat = GL_RGBA8, .type = FramebufferAttachmentType::Color },
-      FramebufferAttachment{ .textureFormat = GL_DEPTH_COMPONENT24, .type = FramebufferAttachmentType::Depth } } };
+  // the depth attachments of the geometry and the picking buffer are only needed during their pass, they share one
+  // texture when both have the same size
+  FramebufferSpec spec{ { FramebufferAttachment{ .textureFormat = GL_RGBA8, .type = FramebufferAttachmentType::Color },
+                          FramebufferAttachment{ .textureFormat = GL_DEPTH_COMPONENT24,
+                                                 .type = FramebufferAttachmentType::Depth,
+                                                 .transient = true } } };
 
   // entity picking in the viewport
   FramebufferSpec pickingSpec{
     { FramebufferAttachment{ .textureFormat = GL_RED_INTEGER, .type = FramebufferAttachmentType::Color },
-      FramebufferAttachment{ .textureFormat = GL_DEPTH_COMPONENT24, .type = FramebufferAttachmentType::Depth } } };
+      FramebufferAttachment{
+        .textureFormat = GL_DEPTH_COMPONENT24, .type = FramebufferAttachmentType::Depth, .transient = true } } };
 
   // this is for shadow map and all depth related stuff, also used in outline pass
   FramebufferSpec depthSpec{
     { FramebufferAttachment{ .textureFormat = GL_DEPTH_COMPONENT24, .type = FramebufferAttachmentType::Depth } } };
 
+  // the shadow map is an array with a layer per cascade, a single layer until the light asks for cascades
+  depthSpec.layers = 1;
+
   // outline of the entity selected
   FramebufferSpec outlineSpec{
     { FramebufferAttachment{ .textureFormat = GL_RGBA8, .type = FramebufferAttachmentType::Color },
-      FramebufferAttachment{ .textureFormat = GL_DEPTH24_STENCIL8, .type = FramebufferAttachmentType::Depth } } };
+      FramebufferAttachment{
+        .textureFormat = GL_DEPTH24_STENCIL8, .type = FramebufferAttachmentType::Depth, .transient = true } } };
 
   m_frameBuffer = OpenGLFramebuffer{ spec };
   m_pickingFrameBuffer = OpenGLFramebuffer{ pickingSpec };
@@ -167,17 +177,28 @@ void SceneViewportWindow::drawScene()
   if ( !scene )
     return;
 
+  // a click from an earlier frame might have its entity ready by now
+  resolvePicking();
+
   // prepare model entities for rendering if they were not loaded
   scene->prepareForRendering();
 
+  // textures the last frame drew, picking can prepare a frame as well but this runs once per frame
+  m_pRenderingSystem->updateTextures();
+
+  // builds the indirect commands once, every pass below draws from them
+  m_pRenderingSystem->prepareFrame( scene.get() );
+
   const auto& pShaderManager = MainRegistry::getInstance().getShaderManager();
   auto proj = m_pCamera->getProjectionMatrix( { m_props->width, m_props->height } );
   auto& view = m_pCamera->getViewMatrix();
   auto& depthShader = pShaderManager->getShader( "depth" );
+  auto& depthCascadeShader = pShaderManager->getShader( "depthCascades" );
   auto& depthDebugShader = pShaderManager->getShader( "depthDebug" );
   auto& geometryShader = pShaderManager->getShader( "3d" );
   auto& outliningShader = pShaderManager->getShader( "outlining" );
   auto& normalShader = pShaderManager->getShader( "3d_normal" );
+  auto& cullingShader = pShaderManager->getShader( "cull" );
 
   if ( scene->getLightCount( kogayonon_resources::LightType::Directional ) != 0 )
   {
@@ -210,47 +231,119 @@ void SceneViewportWindow::drawScene()
 
     auto lightSpaceMatrix = lightProjection * lightView;
 
-    Canvas canvas{ .framebuffer = &m_depthBuffer,
-                   .w = static_cast<int>( m_props->width ),
-                   .h = static_cast<int>( m_props->height ) };
-
-    FrameContext frameContext{
-      .canvas = canvas, .scene = scene.get(), .view = &lightView, .projection = &lightProjection };
-
-    DepthPassContext depthPass{ .shader = &depthShader };
-
-    m_pRenderingSystem->renderDepthPass( frameContext, depthPass );
+    // a single cascade keeps the fixed ortho box around the origin, more than one follow the camera frustum
+    ShadowCascades cascades{ .count = 1 };
+    cascades.viewProjection.at( 0 ) = lightSpaceMatrix;
+    cascades.splits.at( 0 ) = directionalLightComponent.farPlane;
+    if ( directionalLightComponent.cascadeCount > 1 )
+    {
+      cascades = computeShadowCascades(
+        view,
+        proj,
+        lightDir,
+        ShadowCascadeSettings{ .count = static_cast<uint32_t>( directionalLightComponent.cascadeCount ),
+                               .splitLambda = directionalLightComponent.cascadeSplitLambda,
+                               .distance = directionalLightComponent.cascadeDistance,
+                               .casterDistance = directionalLightComponent.positionFactor } );
+      lightSpaceMatrix = cascades.viewProjection.at( 0 );
+    }
 
-    auto depthMap = m_depthBuffer.getDepthAttachmentId();
-    GeometryPassContext geometryPass{
-      .shader = &geometryShader,
-      .depthMap = &depthMap,
-      .lightVP = &lightSpaceMatrix,
+    kogayonon_rendering::FrameConstants constants{
+      .view = view,
+      .projection = proj,
+      .lightVP = lightSpaceMatrix,
+      .viewPosition = glm::vec4{ m_pCamera->getPosition(), 1.0f },
+      .cascadeCount = cascades.count,
     };
+    for ( auto i = 0u; i < cascades.count; i++ )
+    {
+      constants.cascadeViewProjection.at( i ) = cascades.viewProjection.at( i );
+      constants.cascadeSplits[i] = cascades.splits.at( i );
+    }
 
-    frameContext.canvas.framebuffer = &m_frameBuffer;
-    frameContext.projection = &proj;
-    frameContext.view = &view;
-
-    m_pRenderingSystem->renderGeometryPass( frameContext, geometryPass );
+    // every pass reads the camera and the light from here, the depth pass renders with lightVP
+    m_pRenderingSystem->updateFrameConstants( constants );
+    m_pRenderingSystem->getLodSelector().setView(
+      m_pCamera->getPosition(), proj, static_cast<float>( m_props->height ) );
+
+    // every cascade is a square layer of a fixed size, the single map too since the shader samples the whole texture
+    // and a map that followed the viewport would reallocate on every resize
+    m_depthBuffer.setLayers( cascades.count );
+    FrameContext depthFrame{ .canvas = Canvas{ .framebuffer = &m_depthBuffer,
+                                               .w = static_cast<int>( shadowCascadeResolution ),
+                                               .h = static_cast<int>( shadowCascadeResolution ) },
+                             .scene = scene.get(),
+                             .view = &lightView,
+                             .projection = &lightProjection };
+
+    FrameContext sceneFrame{ .canvas = Canvas{ .framebuffer = &m_frameBuffer,
+                                               .w = static_cast<int>( m_props->width ),
+                                               .h = static_cast<int>( m_props->height ) },
+                             .scene = scene.get(),
+                             .view = &view,
+                             .projection = &proj };
+
+    uint32_t depthMap = 0;
+
+    auto& graph = m_pRenderingSystem->getRenderGraph();
+    graph.reset();
+
+    // the culling passes write the draw lists of their target pass, they do nothing unless gpu culling is enabled
+    const auto depthDraws = graph.importResource( "depth draws" );
+    const auto geometryDraws = graph.importResource( "geometry draws" );
+    const auto shadowMap = graph.importResource( "shadow map" );
+    const auto sceneColor = graph.importResource( "scene color" );
+    const auto outline = graph.importResource( "outline" );
+    graph.markOutput( sceneColor );
+
+    graph.addPass( "depth culling", {}, { depthDraws }, [&]() {
+      // the cascades always cull on the cpu
+      if ( cascades.count != 1 )
+        return;
+
+      CullingPassContext cullingPass{ .shader = &cullingShader, .target = PassType::Depth };
+      m_pRenderingSystem->renderCullingPass( depthFrame, cullingPass );
+    } );
+
+    graph.addPass( "depth", { depthDraws }, { shadowMap }, [&]() {
+      DepthPassContext depthPass{ .shader = &depthShader, .cascadeShader = &depthCascadeShader, .cascades = &cascades };
+      m_pRenderingSystem->renderDepthPass( depthFrame, depthPass );
+
+      // the pass resizes the framebuffer so the attachment is only known after it
+      depthMap = m_depthBuffer.getDepthAttachmentId();
+    } );
+
+    graph.addPass( "geometry culling", {}, { geometryDraws }, [&]() {
+      CullingPassContext cullingPass{ .shader = &cullingShader, .target = PassType::Geometry };
+      m_pRenderingSystem->renderCullingPass( sceneFrame, cullingPass );
+    } );
+
+    graph.addPass( "geometry", { geometryDraws, shadowMap }, { sceneColor }, [&]() {
+      GeometryPassContext geometryPass{ .shader = &geometryShader, .depthMap = &depthMap };
+      m_pRenderingSystem->renderGeometryPass( sceneFrame, geometryPass );
+    } );
+
+    // culled by the graph unless the selected entity is outlined
+    graph.addPass( "outline", { shadowMap }, { outline }, [&]() {
+      FrameContext outlineFrame = sceneFrame;
+      outlineFrame.canvas.framebuffer = &m_stencilBuffer;
+
+      OutliningPassContext outlinePass{
+        .normalShader = &normalShader, .outlineShader = &outliningShader, .depthMap = &depthMap };
+      m_pRenderingSystem->renderOutliningPass( outlineFrame, outlinePass );
+    } );
 
     if ( m_selectedEntity != entt::null )
     {
       Entity entity{ scene->getRegistry(), m_selectedEntity };
       if ( entity.hasComponent<MeshComponent>() && entity.hasComponent<OutlineComponent>() )
-      {
-        frameContext.canvas.framebuffer = &m_stencilBuffer;
-
-        OutliningPassContext outlinePass{
-          .normalShader = &normalShader, .outlineShader = &outliningShader, .depthMap = &depthMap };
-
-        m_pRenderingSystem->renderOutliningPass( frameContext, outlinePass );
-      }
+        graph.markOutput( outline );
       else
-      {
         scene->addOutline( m_selectedEntity );
-      }
     }
+
+    graph.compile();
+    graph.execute();
   }
 }
 
@@ -262,8 +355,6 @@ void SceneViewportWindow::drawPickingScene()
   if ( m_selectedEntity != entt::null && m_gizmoEnabled )
     return;
 
-  const auto& pEventDispatcher = MainRegistry::getInstance().getEventDispatcher();
-
   const auto& io = ImGui::GetIO();
   auto [mx, my] = ImGui::GetMousePos();
 
@@ -275,6 +366,7 @@ void SceneViewportWindow::drawPickingScene()
 
   const auto& pShaderManager = MainRegistry::getInstance().getShaderManager();
   auto& shader = pShaderManager->getShader( "picking" );
+  auto& cullingShader = pShaderManager->getShader( "cull" );
 
   const auto& scene = SceneManager::getCurrentScene().lock().get();
 
@@ -288,19 +380,77 @@ void SceneViewportWindow::drawPickingScene()
                              .projection =
                                &m_pCamera->getProjectionMatrix( glm::vec2{ m_props->width, m_props->height } ) };
 
+  // kept for the cpu fallback, the readback resolves a frame later and the camera may have moved by then
+  const auto inverseViewProjection = glm::inverse( *frameContext.projection * *frameContext.view );
+  const auto ndc = glm::vec2{ mx / m_props->width * 2.0f - 1.0f, 1.0f - my / m_props->height * 2.0f };
+  const auto nearPoint = inverseViewProjection * glm::vec4{ ndc, -1.0f, 1.0f };
+  const auto farPoint = inverseViewProjection * glm::vec4{ ndc, 1.0f, 1.0f };
+  m_pickOrigin = glm::vec3{ nearPoint } / nearPoint.w;
+  m_pickDirection = glm::normalize( glm::vec3{ farPoint } / farPoint.w - m_pickOrigin );
+
+  if ( !m_pRenderingSystem->isGpuPickingEnabled() )
+  {
+    selectPickedEntity( m_pRenderingSystem->pickClosest( scene, m_pickOrigin, m_pickDirection ) );
+    return;
+  }
+
   PickingPassContext pickingPass{ .shader = &shader, .x = static_cast<int>( mx ), .y = static_cast<int>( my ) };
 
-  auto result = m_pRenderingSystem->renderPickingPass( frameContext, pickingPass );
+  // picking happens while polling events so the instances and the camera might have changed since the last frame,
+  // the moved instances have to reach the gpu before the pass reads their matrices
+  scene->prepareForRendering();
+  m_pRenderingSystem->prepareFrame( scene );
+
+  auto constants = m_pRenderingSystem->getFrameConstants();
+  constants.view = *frameContext.view;
+  constants.projection = *frameContext.projection;
+  constants.viewPosition = glm::vec4{ m_pCamera->getPosition(), 1.0f };
+  m_pRenderingSystem->updateFrameConstants( constants );
+
+  CullingPassContext cullingPass{ .shader = &cullingShader, .target = PassType::Picking };
+  m_pRenderingSystem->renderCullingPass( frameContext, cullingPass );
+
+  m_pRenderingSystem->renderPickingPass( frameContext, pickingPass );
+}
 
-  auto ent = static_cast<entt::entity>( result );
-  if ( scene->getRegistry()->isValid( ent ) )
+auto SceneViewportWindow::getTextureResidency() -> TextureResidency&
+{
+  return m_pRenderingSystem->getMaterialSystem().getResidency();
+}
+
+void SceneViewportWindow::resolvePicking()
+{
+  int result = -1;
+  switch ( m_pRenderingSystem->pollPicking( result ) )
   {
-    scene->addOutline( ent );
-    m_selectedEntity = ent;
-    pEventDispatcher->dispatchEvent( SelectEntityEvent{ ent, SelectEntityEventSource::ViewportWindow } );
+  case PickingStatus::Resolved:
+    selectPickedEntity( static_cast<entt::entity>( result ) );
+    break;
+  case PickingStatus::Expired:
+    selectPickedEntity(
+      m_pRenderingSystem->pickClosest( SceneManager::getCurrentScene().lock().get(), m_pickOrigin, m_pickDirection ) );
+    break;
+  default:
+    break;
   }
 }
 
+void SceneViewportWindow::selectPickedEntity( entt::entity ent )
+{
+  const auto& scene = SceneManager::getCurrentScene().lock();
+  if ( !scene || !scene->getRegistry()->isValid( ent ) )
+    return;
+
+  // the gizmo could have been grabbed while the pick was in flight
+  if ( m_selectedEntity != entt::null && m_gizmoEnabled )
+    return;
+
+  const auto& pEventDispatcher = MainRegistry::getInstance().getEventDispatcher();
+  scene->addOutline( ent );
+  m_selectedEntity = ent;
+  pEventDispatcher->dispatchEvent( SelectEntityEvent{ ent, SelectEntityEventSource::ViewportWindow } );
+}
+
 void SceneViewportWindow::onKeyPressed( const KeyPressedEvent& e )
 {
   // change gizmo mode if we press SHIFT + S R T and once selected SHIFT + X Y Z for axis
@@ -404,22 +554,25 @@ void SceneViewportWindow::draw()
 
   drawScene();
 
+  // the textures can be larger than the viewport, only the corner the passes drew into is shown
+  const auto frameScale = m_frameBuffer.getContentScale();
   ImGui::GetWindowDrawList()->AddImage( m_frameBuffer.getColorAttachmentId( 0 ),
                                         win_pos,
                                         ImVec2{ win_pos.x + contentSize.x, win_pos.y + contentSize.y },
-                                        ImVec2{ 0, 1 },
-                                        ImVec2{ 1, 0 } );
+                                        ImVec2{ 0, frameScale.y },
+                                        ImVec2{ frameScale.x, 0 } );
 
   if ( m_selectedEntity != entt::null && scene->getRegistry()->hasComponent<MeshComponent>( m_selectedEntity ) )
   {
     const auto& meshComp = scene->getRegistry()->getComponent<MeshComponent>( m_selectedEntity );
     if ( meshComp.loaded && meshComp.pMesh != nullptr )
     {
+      const auto outlineScale = m_stencilBuffer.getContentScale();
       ImGui::GetWindowDrawList()->AddImage( m_stencilBuffer.getColorAttachmentId( 0 ),
                                             win_pos,
                                             ImVec2{ win_pos.x + contentSize.x, win_pos.y + contentSize.y },
-                                            ImVec2{ 0, 1 },
-                                            ImVec2{ 1, 0 } );
+                                            ImVec2{ 0, outlineScale.y },
+                                            ImVec2{ outlineScale.x, 0 } );
     }
   }
 
@@ -436,7 +589,10 @@ void SceneViewportWindow::draw()
       const auto& instanceData = scene->getData( modelComponent->pMesh );
       const auto& indexComponet = entity.tryGetComponent<IndexComponent>();
       const auto& transform = entity.tryGetComponent<TransformComponent>();
-      auto& instanceMatrix = instanceData->instances.at( indexComponet->index ).instanceMatrix;
+      auto& instance = instanceData->instances.at( indexComponet->index );
+
+      // the instance only keeps 3 rows, the gizmo wants a full matrix
+      glm::mat4 instanceMatrix{ instance.instanceMatrix };
 
       ImGuizmo::Enable( ( m_props->hovered && m_props->focused ) || ImGuizmo::IsUsingAny() );
 
@@ -448,6 +604,8 @@ void SceneViewportWindow::draw()
 
       if ( ImGuizmo::IsUsing() )
       {
+        instance.instanceMatrix = glm::mat4x3{ instanceMatrix };
+
         glm::vec3 translation, rotation, scale;
         ImGuizmo::DecomposeMatrixToComponents( glm::value_ptr( instanceMatrix ),
                                                glm::value_ptr( translation ),
@@ -457,7 +615,7 @@ void SceneViewportWindow::draw()
         transform->translation = translation;
         transform->rotation = rotation;
         transform->scale = scale;
-        scene->updateInstances( instanceData );
+        scene->markInstanceDirty( instanceData, indexComponet->index );
 
         auto quat = glm::quat{ glm::radians( transform->rotation ) };
 
@@ -489,6 +647,12 @@ void SceneViewportWindow::draw()
   static auto padding = ImVec2{ 10.0f, 10.0f };
   ImGui::PushStyleVar( ImGuiStyleVar_WindowPadding, padding );
 
+  if ( m_openRenderModePopup )
+  {
+    ImGui::OpenPopup( "Render mode" );
+    m_openRenderModePopup = false;
+  }
+
   if ( ImGui::BeginPopupModal( "Render mode", &open, ImGuiWindowFlags_AlwaysAutoResize ) )
   {
     ImGui::Text( "You can change the render modes here, this is a work in progress though" );
@@ -514,6 +678,45 @@ void SceneViewportWindow::draw()
       open = false;
     }
 
+    ImGui::Separator();
+
+    bool indirect = m_pRenderingSystem->isIndirectEnabled();
+    if ( ImGui::Checkbox( "Indirect draw", &indirect ) )
+      m_pRenderingSystem->setIndirectEnabled( indirect );
+
+    bool culling = m_pRenderingSystem->isCullingEnabled();
+    if ( ImGui::Checkbox( "Frustum culling", &culling ) )
+      m_pRenderingSystem->setCullingEnabled( culling );
+
+    bool gpuCulling = m_pRenderingSystem->isGpuCullingEnabled();
+    if ( ImGui::Checkbox( "GPU culling", &gpuCulling ) )
+      m_pRenderingSystem->setGpuCullingEnabled( gpuCulling );
+
+    bool lod = m_pRenderingSystem->isLodEnabled();
+    if ( ImGui::Checkbox( "Level of detail", &lod ) )
+      m_pRenderingSystem->setLodEnabled( lod );
+
+    auto& lodSelector = m_pRenderingSystem->getLodSelector();
+    float pixelError = lodSelector.getPixelError();
+    if ( ImGui::SliderFloat( "LOD pixel error", &pixelError, 0.25f, 8.0f ) )
+      lodSelector.setPixelError( pixelError );
+
+    bool gpuPicking = m_pRenderingSystem->isGpuPickingEnabled();
+    if ( ImGui::Checkbox( "GPU picking", &gpuPicking ) )
+      m_pRenderingSystem->setGpuPickingEnabled( gpuPicking );
+
+    // only textures requested afterwards notice
+    auto& textureStreamer = AssetManager::getInstance().getTextureStreamer();
+    bool compressedTextures = textureStreamer.isCompressionEnabled();
+    if ( ImGui::Checkbox( "Compressed textures", &compressedTextures ) )
+      textureStreamer.setCompressionEnabled( compressedTextures );
+
+    // lowering it shrinks the pages over the next frames
+    auto& residency = m_pRenderingSystem->getMaterialSystem().getResidency();
+    int budgetMegabytes = static_cast<int>( residency.getBudget() >> 20 );
+    if ( ImGui::SliderInt( "Texture budget MB", &budgetMegabytes, 16, 2048 ) )
+      residency.setBudget( static_cast<std::size_t>( budgetMegabytes ) << 20 );
+
     ImGui::EndPopup();
   }
   ImGui::PopStyleVar();
@@ -550,6 +753,8 @@ void SceneViewportWindow::drawToolbar()
     ImGui::SetCursorPos( ImVec2{ 5.0f, 2.5f } );
     if ( ImGui::ImageButton( "#RenderMode", renderModeIcon, toolbarButtonSize ) )
     {
+      // the popup lives in the viewport window, opening it from the toolbar child would use another id stack
+      m_openRenderModePopup = true;
     }
     ImGui::SameLine();
 
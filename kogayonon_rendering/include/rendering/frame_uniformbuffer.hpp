@@ -0,0 +1,64 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "rendering/uniformbuffer.hpp"
+
+namespace kogayonon_rendering
+{
+/**
+ * @brief std140 layout of the FrameConstants block, every member is 16 byte aligned so it matches as is
+ */
+struct FrameConstants
+{
+  glm::mat4 view{ 1.0f };
+  glm::mat4 projection{ 1.0f };
+  glm::mat4 lightVP{ 1.0f };
+
+  // camera position, w is unused, saves every vertex from inverting the view matrix
+  glm::vec4 viewPosition{ 0.0f };
+
+  // lightVP is the first cascade, the rest are only written when the light splits its shadow
+  std::array<glm::mat4, 4> cascadeViewProjection{};
+
+  // view space depth where every cascade ends
+  glm::vec4 cascadeSplits{ 0.0f };
+  uint32_t cascadeCount{ 1 };
+  uint32_t pad[3]{};
+};
+
+/**
+ * @brief Camera and light matrices shared by every shader, written once per frame instead of once per shader per pass
+ */
+class FrameUniformbuffer : public Uniformbuffer
+{
+public:
+  static constexpr uint32_t binding = 4;
+
+  FrameUniformbuffer() = default;
+  ~FrameUniformbuffer() = default;
+
+  void initialize( uint32_t bindingIndex ) override;
+  void destroy() override;
+  void bind() override;
+  void unbind() override;
+
+  /**
+   * @brief Uploads the constants if they differ from the ones already on the gpu
+   * @return True if anything was uploaded
+   */
+  auto update( const FrameConstants& constants ) -> bool;
+
+  inline auto getConstants() const -> const FrameConstants&
+  {
+    return m_constants;
+  }
+
+private:
+  uint32_t m_ubo{ 0 };
+  uint32_t m_bindingIndex{ binding };
+  bool m_uploaded{ false };
+
+  FrameConstants m_constants{};
+};
+} // namespace kogayonon_rendering
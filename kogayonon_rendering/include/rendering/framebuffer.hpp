@@ -18,6 +18,9 @@ struct FramebufferAttachment
   uint32_t id{ 0 };
   uint32_t textureFormat;
   FramebufferAttachmentType type;
+
+  // cleared at the start of every pass and never read afterwards, framebuffers of the same size share the texture
+  bool transient{ false };
 };
 
 struct FramebufferSpec
@@ -43,6 +46,14 @@ struct FramebufferSpec
 
   uint32_t width;
   uint32_t height;
+
+  // size of the textures, width and height rounded up to the size class of the render target pool
+  uint32_t storageWidth{ 0 };
+  uint32_t storageHeight{ 0 };
+
+  // 0 keeps plain 2d textures, otherwise the depth attachments are texture arrays attached as a whole so a geometry
+  // shader picks the layer it draws into
+  uint32_t layers{ 0 };
   std::vector<FramebufferAttachment> colorAttachments;
   std::vector<FramebufferAttachment> depthAttachments;
 };
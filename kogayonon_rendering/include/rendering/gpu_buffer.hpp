@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace kogayonon_rendering
+{
+/**
+ * @brief A buffer that keeps its storage between uploads and only reallocates when the data no longer fits, the
+ * capacity doubles every time it has to grow
+ */
+class GPUBuffer
+{
+public:
+  GPUBuffer() = default;
+  ~GPUBuffer();
+
+  GPUBuffer( const GPUBuffer& ) = delete;
+  GPUBuffer& operator=( const GPUBuffer& ) = delete;
+
+  /**
+   * @brief Makes sure the buffer can hold at least size bytes, the content is kept when growing
+   * @param size Size in bytes
+   * @return True if the buffer was recreated, anything that references the old id must be rebound
+   */
+  bool reserve( std::size_t size );
+
+  /**
+   * @brief Uploads size bytes at the start of the buffer, grows the buffer if needed
+   * @param data Pointer to the data
+   * @param size Size in bytes
+   * @return True if the buffer was recreated
+   */
+  bool upload( const void* data, std::size_t size );
+
+  /**
+   * @brief Uploads size bytes at offset, the range must already fit inside the buffer
+   */
+  void uploadRange( const void* data, std::size_t offset, std::size_t size ) const;
+
+  void destroy();
+
+  inline auto getId() const -> uint32_t
+  {
+    return m_id;
+  }
+
+  inline auto getCapacity() const -> std::size_t
+  {
+    return m_capacity;
+  }
+
+private:
+  uint32_t m_id{ 0 };
+  std::size_t m_capacity{ 0 };
+};
+} // namespace kogayonon_rendering
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <glad/glad.h>
+
+namespace kogayonon_rendering
+{
+/**
+ * @brief Wraps a GLsync so we can ask if the gpu is done with the commands issued before it without stalling
+ */
+class GPUFence
+{
+public:
+  GPUFence() = default;
+  ~GPUFence();
+
+  GPUFence( const GPUFence& ) = delete;
+  GPUFence& operator=( const GPUFence& ) = delete;
+
+  /**
+   * @brief Replaces the current fence with a new one placed after every command issued so far
+   */
+  void insert();
+
+  /**
+   * @brief Polls the fence without waiting, a fence that was never inserted counts as not signaled
+   */
+  auto isSignaled() const -> bool;
+
+  /**
+   * @brief Blocks until the fence is signaled or the timeout passes
+   * @param timeout Timeout in nanoseconds
+   * @return True if the fence got signaled
+   */
+  auto wait( uint64_t timeout ) const -> bool;
+
+  void destroy();
+
+  inline auto isPending() const -> bool
+  {
+    return m_sync != nullptr;
+  }
+
+private:
+  GLsync m_sync{ nullptr };
+};
+} // namespace kogayonon_rendering
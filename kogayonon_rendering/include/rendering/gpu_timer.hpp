@@ -0,0 +1,62 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <glad/glad.h>
+
+namespace kogayonon_rendering
+{
+/**
+ * @brief Measures the gpu time between begin and end with a pair of GL_TIMESTAMP queries. A few pairs take turns so
+ * the result of a frame is read a couple of frames later once it is available and we never wait on the gpu for it.
+ * Timestamps unlike GL_TIME_ELAPSED can overlap, a timer may run inside another one
+ */
+class GPUTimer
+{
+public:
+  // pairs in flight before the oldest one gets reused even if its result never got read
+  static constexpr uint32_t queryCount = 4;
+
+  GPUTimer() = default;
+  ~GPUTimer();
+
+  GPUTimer( const GPUTimer& ) = delete;
+  GPUTimer& operator=( const GPUTimer& ) = delete;
+
+  void begin();
+  void end();
+
+  /**
+   * @brief Reads every pair whose result is available without waiting
+   * @return True if a newer measurement came in
+   */
+  auto poll() -> bool;
+
+  void destroy();
+
+  /**
+   * @brief The latest measurement that came back from the gpu
+   */
+  inline auto getMilliseconds() const -> double
+  {
+    return m_milliseconds;
+  }
+
+  /**
+   * @brief When the latest measurement started, in nanoseconds of the gpu clock
+   */
+  inline auto getStartNanoseconds() const -> uint64_t
+  {
+    return m_start;
+  }
+
+private:
+  // begin and end timestamp of every pair next to each other
+  std::array<uint32_t, queryCount * 2> m_queries{};
+  std::array<bool, queryCount> m_pending{};
+
+  // pair the next begin uses, also the oldest one that can still be pending
+  uint32_t m_current{ 0 };
+  uint64_t m_start{ 0 };
+  double m_milliseconds{ 0.0 };
+};
+} // namespace kogayonon_rendering
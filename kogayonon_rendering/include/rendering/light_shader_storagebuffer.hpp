@@ -1,10 +1,12 @@
 #pragma once
+#include <array>
 #include <cinttypes>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <variant>
 #include <vector>
+#include "rendering/gpu_buffer.hpp"
 #include "resources/directional_light.hpp"
 #include "resources/light_types.hpp"
 #include "resources/pointlight.hpp"
@@ -24,13 +26,21 @@ enum class SSBOType
 	Spot = 2
 };
 
+/**
+ * @brief Keeps the lights of every type in a buffer that only grows, edits mark the lights they touched and update
+ * uploads just that range instead of the whole array
+ */
 class LightShaderStoragebuffer : public IShaderStorageBuffer
 {
   public:
 	struct SSBO
 	{
-		uint32_t id{ 0 };
+		GPUBuffer buffer;
 		uint32_t bindingIndex{ 0 };
+
+		// lights changed since the last upload, nothing to do while begin == end
+		uint32_t dirtyBegin{ 0 };
+		uint32_t dirtyEnd{ 0 };
 	};
 
 	LightShaderStoragebuffer() = default;
@@ -41,22 +51,48 @@ class LightShaderStoragebuffer : public IShaderStorageBuffer
 	void bind() override;
 
 	void initialize() override;
-	void initStorageBuffer( const kogayonon_resources::LightType& type, SSBO& ssbo );
 	void destroy( uint32_t index ) override;
 	void destroy() override;
+
+	/**
+	 * @brief Uploads the dirty range of one buffer, 0 point, 1 directional, 2 spot
+	 */
 	void update( uint32_t index ) override;
 
 	void update() override;
 
+	/**
+	 * @brief Marks a light that was edited through its reference so the next update uploads it
+	 */
+	void markDirty( const kogayonon_resources::LightType& type, uint32_t index );
+
 	auto addLight( const kogayonon_resources::LightType& type ) -> uint32_t;
-	void removeLight( const kogayonon_resources::LightType& type, uint32_t index );
+
+	/**
+	 * @brief Moves the last light of the type into the removed slot so only that one light has to be uploaded again
+	 * @return The index the moved light had before, whoever pointed at it has to point at index now. Equal to index
+	 * when the removed light was the last one
+	 */
+	auto removeLight( const kogayonon_resources::LightType& type, uint32_t index ) -> uint32_t;
 
 	auto getPointLights() -> point_lights&;
 	auto getDirectionalLights() -> directional_lights&;
 	auto getSpotLights() -> spot_lights&;
 
+	/**
+	 * @brief Bytes the three buffers hold on the gpu
+	 */
+	auto getGPUMemory() const -> std::size_t;
+
+  private:
+	auto getSSBO( const kogayonon_resources::LightType& type ) -> SSBO&;
+
+	template <typename T>
+	void upload( SSBO& ssbo, const std::vector<T>& lights );
+
   private:
-	std::vector<SSBO> m_ssbos;
+	// 0 point, 1 directional, 2 spot, same as SSBOType
+	std::array<SSBO, 3> m_ssbos;
 
 	point_lights m_pointLights;
 	directional_lights m_directionalLights;
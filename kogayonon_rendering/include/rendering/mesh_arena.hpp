@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "rendering/gpu_buffer.hpp"
+
+namespace kogayonon_resources
+{
+struct Vertex;
+} // namespace kogayonon_resources
+
+namespace kogayonon_rendering
+{
+/**
+ * @brief Where a mesh lives inside the shared arena buffers, offsets are in elements not bytes
+ */
+struct MeshArenaRange
+{
+  uint32_t vertexOffset{ 0 };
+  uint32_t vertexCount{ 0 };
+  uint32_t indexOffset{ 0 };
+  uint32_t indexCount{ 0 };
+};
+
+/**
+ * @brief Shared vertex and index buffers for every mesh in the scene so all of them can be drawn with the same vao,
+ * which is what lets us issue a single glMultiDrawElementsIndirect per pass
+ */
+class MeshArena
+{
+public:
+  MeshArena() = default;
+  ~MeshArena();
+
+  MeshArena( const MeshArena& ) = delete;
+  MeshArena& operator=( const MeshArena& ) = delete;
+
+  /**
+   * @brief Appends the geometry of a mesh to the arena, meshes are never removed so the ranges stay valid
+   * @param key Whatever identifies the mesh, we use Mesh::getId since an address can belong to another mesh later
+   * @param vertices Mesh vertices
+   * @param indices Mesh indices
+   * @return The range the mesh got inside the arena
+   */
+  auto addMesh( uint64_t key, std::span<const kogayonon_resources::Vertex> vertices,
+                std::span<const uint32_t> indices ) -> MeshArenaRange;
+
+  auto contains( uint64_t key ) const -> bool;
+  auto getRange( uint64_t key ) const -> const MeshArenaRange&;
+
+  /**
+   * @brief The vao that has the arena vertex buffer on binding 0 and the arena index buffer as element buffer
+   */
+  auto getVao() -> uint32_t;
+
+  void destroy();
+
+private:
+  void setupVao();
+
+private:
+  uint32_t m_vao{ 0 };
+  GPUBuffer m_vertexBuffer;
+  GPUBuffer m_indexBuffer;
+  uint32_t m_vertexCount{ 0 };
+  uint32_t m_indexCount{ 0 };
+  std::unordered_map<uint64_t, MeshArenaRange> m_ranges;
+};
+} // namespace kogayonon_rendering
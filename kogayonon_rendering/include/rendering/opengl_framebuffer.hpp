@@ -1,4 +1,5 @@
 #pragma once
+#include <glm/glm.hpp>
 #include <memory>
 #include "rendering/framebuffer.hpp"
 
@@ -17,12 +18,19 @@ public:
   void destroy();
 
   /**
-   * @brief Resize the framebuffer, this destroys and reinitializes the buffer
+   * @brief Resize the framebuffer, the textures are only swapped for other ones from the pool when the size leaves
+   * their size class
    * @param w -width
    * @param h -height
    */
   void resize( uint32_t w, uint32_t h ) override;
 
+  /**
+   * @brief Changes how many layers the depth texture arrays have, reinitializes the buffer like resize
+   * @param layers Layer count, 0 goes back to plain 2d textures
+   */
+  void setLayers( uint32_t layers );
+
   void checkFramebuffer() const;
 
   const FramebufferSpec& getSpecification() override;
@@ -34,6 +42,19 @@ public:
    */
   auto getColorAttachmentId( uint32_t index = 0 ) const -> uint32_t override;
 
+  /**
+   * @brief How much of the textures the passes draw into, the corner to sample when showing an attachment
+   */
+  inline auto getContentScale() const -> glm::vec2
+  {
+    if ( m_specification.storageWidth == 0 || m_specification.storageHeight == 0 )
+      return glm::vec2{ 1.0f };
+
+    return glm::vec2{ static_cast<float>( m_specification.width ) / static_cast<float>( m_specification.storageWidth ),
+                      static_cast<float>( m_specification.height ) /
+                        static_cast<float>( m_specification.storageHeight ) };
+  }
+
   /**
    * @brief Get the depth attachment id
    * @return
@@ -56,13 +77,27 @@ public:
    */
   auto readPixel( uint32_t attachmentIndex, int x, int y ) const -> int;
 
+  /**
+   * @brief Copies a rectangle of an integer attachment into a pixel pack buffer, the call returns right away and the
+   * pixels can be read from the buffer once the gpu is done with the copy
+   * @param attachmentIndex The attachment index which we use to retrieve a framebuffer texture to read from
+   * @param x Left edge, framebuffer coordinates with the origin at the bottom
+   * @param y Bottom edge
+   * @param w Width of the rectangle
+   * @param h Height of the rectangle
+   * @param packBuffer Buffer that receives w * h ints row by row starting at the bottom
+   */
+  void readPixels( uint32_t attachmentIndex, int x, int y, int w, int h, uint32_t packBuffer ) const;
+
   void attachRenderbuffer();
 
   auto getId() -> uint32_t&;
 
 private:
-  void attachColorTexture( uint32_t& id, uint32_t w, uint32_t h, GLenum format, uint32_t& fbo, int index );
-  void attachDepthTexture( uint32_t& id, uint32_t w, uint32_t h, GLenum format, GLenum attachmentType, uint32_t& fbo );
+  void attachColorTexture( FramebufferAttachment& attachment, uint32_t w, uint32_t h, GLenum format, uint32_t& fbo,
+                           int index );
+  void attachDepthTexture( FramebufferAttachment& attachment, uint32_t w, uint32_t h, GLenum format,
+                           GLenum attachmentType, uint32_t& fbo );
 
 private:
   uint32_t m_fbo{ 0 };
@@ -0,0 +1,202 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "rendering/gpu_timer.hpp"
+
+namespace kogayonon_utilities
+{
+struct ProfileZone;
+} // namespace kogayonon_utilities
+
+namespace kogayonon_rendering
+{
+/**
+ * @brief A finished scope on the timeline of the trace, times are in microseconds since the profiler started. The name
+ * belongs to a zone or a gpu timer and outlives the event
+ */
+struct ProfileEvent
+{
+  const char* name{ nullptr };
+  double start{ 0.0 };
+  double duration{ 0.0 };
+  bool gpu{ false };
+
+  // index of the thread that recorded it, the gpu events are all on thread 0
+  uint32_t thread{ 0 };
+};
+
+/**
+ * @brief Last historySize frames of a scope, cpu scopes that ran more than once in a frame are summed
+ */
+class ProfileHistory
+{
+public:
+  static constexpr uint32_t historySize = 240;
+
+  ProfileHistory( std::string name, bool gpu );
+
+  void push( float milliseconds );
+
+  /**
+   * @brief Value below which the given fraction of the samples are, 0.5 is the median
+   */
+  auto getPercentile( float fraction ) const -> float;
+
+  auto getLatest() const -> float;
+
+  inline auto getName() const -> const std::string&
+  {
+    return m_name;
+  }
+
+  inline auto isGpu() const -> bool
+  {
+    return m_gpu;
+  }
+
+  /**
+   * @brief Ring of samples, the oldest one is at getOffset once the ring is full
+   */
+  inline auto getSamples() const -> const std::array<float, historySize>&
+  {
+    return m_samples;
+  }
+
+  inline auto getOffset() const -> uint32_t
+  {
+    return m_count < historySize ? 0 : m_head;
+  }
+
+  inline auto getCount() const -> uint32_t
+  {
+    return m_count;
+  }
+
+private:
+  std::string m_name;
+  bool m_gpu{ false };
+  std::array<float, historySize> m_samples{};
+  uint32_t m_head{ 0 };
+  uint32_t m_count{ 0 };
+};
+
+/**
+ * @brief Keeps a rolling history of every profiled scope and the last maxTraceEvents scopes for a chrome trace. The
+ * cpu side is fed by the zones of every thread (KOGAYONON_PROFILE_ZONE) that get drained once per frame, gpu scopes
+ * are timestamp queries. The gpu results come back a few frames late, they are put on the cpu timeline with the offset
+ * between both clocks measured every frame. Only the render thread may call it
+ */
+class Profiler
+{
+public:
+  // the oldest trace events are overwritten past this
+  static constexpr uint32_t maxTraceEvents = 1u << 16;
+
+  /**
+   * @brief Call at the very start of the frame, ends the last frame and measures the offset between the gpu and the
+   * cpu clock
+   */
+  static void beginFrame();
+
+  /**
+   * @brief Call once everything was submitted, drains the zones of every thread, polls the gpu scopes and pushes the
+   * frame into the histories
+   */
+  static void endFrame();
+
+  /**
+   * @brief A zone for a name that is only known at runtime like a render graph pass, the name is interned once
+   */
+  static void beginCpuScope( const std::string& name );
+  static void endCpuScope();
+
+  /**
+   * @brief Gpu scopes can nest but have to end in the reverse order they began
+   */
+  static void beginGpuScope( const std::string& name );
+  static void endGpuScope();
+
+  /**
+   * @brief Latest gpu time of a scope, 0 if it never came back
+   */
+  static auto getGpuMilliseconds( const std::string& name ) -> double;
+
+  static inline auto getHistories() -> const std::vector<ProfileHistory>&
+  {
+    return m_histories;
+  }
+
+  /**
+   * @brief Writes the trace events in the chrome trace format, open it with chrome://tracing or perfetto
+   * @return False if the file could not be written
+   */
+  static auto exportChromeTrace( const std::string& path ) -> bool;
+
+  /**
+   * @brief Deletes the gpu timer queries, call it while the gl context is still alive
+   */
+  static void shutdown();
+
+private:
+  Profiler() = delete;
+  ~Profiler() = delete;
+
+  static auto getHistory( const char* name, bool gpu ) -> uint32_t;
+  static void addEvent( const ProfileEvent& event );
+
+  /**
+   * @brief Steady clock nanoseconds to microseconds since the profiler started
+   */
+  static auto toMicroseconds( uint64_t nanoseconds ) -> double;
+
+  struct CpuScope
+  {
+    const kogayonon_utilities::ProfileZone* zone;
+    uint64_t start;
+  };
+
+  // time a cpu history got this frame summed over every zone and thread with its name
+  struct ZoneTotal
+  {
+    double milliseconds{ 0.0 };
+    bool touched{ false };
+  };
+
+  static inline uint64_t m_epoch{ 0 };
+
+  // gpu clock minus steady clock in nanoseconds
+  static inline int64_t m_gpuOffset{ 0 };
+  static inline uint64_t m_frameStart{ 0 };
+
+  static inline std::vector<CpuScope> m_cpuScopes{};
+  static inline std::unordered_map<const kogayonon_utilities::ProfileZone*, uint32_t> m_zoneHistories{};
+
+  static inline std::vector<GPUTimer*> m_gpuScopes{};
+  static inline std::unordered_map<std::string, std::unique_ptr<GPUTimer>> m_gpuTimers{};
+
+  static inline std::vector<ProfileHistory> m_histories{};
+  static inline std::vector<ZoneTotal> m_totals{};
+  static inline std::vector<ProfileEvent> m_events{};
+  static inline uint32_t m_nextEvent{ 0 };
+};
+
+/**
+ * @brief Times the scope it lives in on the cpu, and on the gpu too if asked to
+ */
+class ProfileScope
+{
+public:
+  explicit ProfileScope( const std::string& name, bool gpu = false );
+  ~ProfileScope();
+
+  ProfileScope( const ProfileScope& ) = delete;
+  ProfileScope& operator=( const ProfileScope& ) = delete;
+
+private:
+  bool m_gpu;
+};
+} // namespace kogayonon_rendering
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kogayonon_rendering
+{
+/**
+ * @brief What a render target texture is matched by, width and height are already rounded to a size class
+ */
+struct RenderTargetKey
+{
+  uint32_t format{ 0 };
+  uint32_t width{ 0 };
+  uint32_t height{ 0 };
+
+  // 0 for a plain 2d texture, otherwise a 2d array with this many layers
+  uint32_t layers{ 0 };
+  uint32_t samples{ 1 };
+
+  bool operator==( const RenderTargetKey& other ) const = default;
+};
+
+struct RenderTarget
+{
+  RenderTargetKey key;
+  uint32_t texture{ 0 };
+
+  // framebuffers attached to it right now, only transient targets ever have more than one
+  uint32_t users{ 0 };
+  bool transient{ false };
+
+  // frame the last user let go of it
+  uint64_t releasedFrame{ 0 };
+};
+
+/**
+ * @brief Owns the textures the framebuffers render into. Sizes are rounded up to size classes so resizing the
+ * viewport a few pixels keeps the same storage, released textures are only handed out again a couple of frames later
+ * and deleted once nobody asked for them in a while. Transient attachments, the ones that are cleared at the start of
+ * a pass and never read after it, are shared by every framebuffer that wants the same key
+ */
+class RenderTargetPool
+{
+public:
+  // frames a released texture waits before another framebuffer can get it
+  static constexpr uint64_t reuseDelay = 2;
+
+  // frames a free texture is kept around before it gets deleted
+  static constexpr uint64_t purgeDelay = 120;
+
+  // sizes grow in steps of at least this many pixels
+  static constexpr uint32_t minSizeStep = 64;
+
+  /**
+   * @brief A texture for the key, the size of the key is rounded first
+   * @param key Format, size, layers and samples of the texture
+   * @param transient Shares the texture with the other transient users of the same key
+   * @return Texture id, the storage is at least key.width x key.height
+   */
+  static auto acquire( RenderTargetKey key, bool transient ) -> uint32_t;
+
+  /**
+   * @brief Gives a texture back, it stays alive until the purge so it can be reused
+   */
+  static void release( uint32_t texture );
+
+  /**
+   * @brief Call once per frame, deletes the textures that were free for longer than purgeDelay frames
+   */
+  static void endFrame();
+
+  /**
+   * @brief Deletes every texture nobody uses right now no matter how long it was free
+   */
+  static void purge();
+
+  /**
+   * @brief Rounds a size up to its size class, there are eight classes between two powers of two so at most an
+   * eighth of the storage is wasted
+   */
+  static auto roundSize( uint32_t size ) -> uint32_t;
+
+  /**
+   * @brief Video memory of every texture the pool owns, used or not
+   */
+  static auto getAllocatedBytes() -> std::size_t;
+
+  static inline auto getTargets() -> const std::vector<RenderTarget>&
+  {
+    return m_targets;
+  }
+
+private:
+  RenderTargetPool() = delete;
+  ~RenderTargetPool() = delete;
+
+  static auto create( const RenderTargetKey& key, bool transient ) -> RenderTarget&;
+  static void destroy( RenderTarget& target );
+
+  static inline std::vector<RenderTarget> m_targets{};
+  static inline uint64_t m_frame{ 0 };
+};
+} // namespace kogayonon_rendering
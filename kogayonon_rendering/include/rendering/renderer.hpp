@@ -1,10 +1,107 @@
 #pragma once
+#include <array>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
 namespace kogayonon_rendering
 {
+/**
+ * @brief Counters gathered while a frame is recorded, the performance window shows the ones of the last frame
+ */
+struct FrameStats
+{
+  // every glDraw* call we issue, a glMultiDrawElementsIndirect counts as one
+  uint32_t drawCalls{ 0 };
+
+  // the commands packed inside the indirect draws
+  uint32_t indirectCommands{ 0 };
+
+  // instances tested against a frustum and how many of them survived, summed over every pass
+  uint32_t instancesTested{ 0 };
+  uint32_t instancesVisible{ 0 };
+
+  // indices the culled instances drew at their level of detail and what they would have drawn at full detail
+  uint64_t lodIndices{ 0 };
+  uint64_t fullDetailIndices{ 0 };
+
+  // state changes that reached gl and the ones the renderer skipped because the state was already set
+  uint32_t stateCallsIssued{ 0 };
+  uint32_t stateCallsElided{ 0 };
+
+  // point lights that touch the view frustum and how many cluster entries they were written into
+  uint32_t clusteredLights{ 0 };
+  uint32_t clusterLightReferences{ 0 };
+
+  // what the light buffers hold on the gpu and the bytes of light data sent this frame
+  uint32_t lightBufferBytes{ 0 };
+  uint32_t lightUploadBytes{ 0 };
+
+  // instance data sent by the per frame flush of the scene
+  uint32_t instanceUploadBytes{ 0 };
+
+  // render target textures the pool had to create, stays at 0 while resizing inside a size class
+  uint32_t renderTargetAllocations{ 0 };
+
+  // what the material texture pages hold against what they may hold
+  uint64_t textureResidentBytes{ 0 };
+  uint64_t textureBudgetBytes{ 0 };
+
+  // layers paged in from the streamer and layers that lost their biggest mip or left the pages
+  uint32_t texturesStreamedIn{ 0 };
+  uint32_t texturesStreamedOut{ 0 };
+};
+
+/**
+ * @brief Gpu time of a render graph pass, a few frames old since the timer queries are never waited on
+ */
+struct PassTiming
+{
+  std::string name;
+  double milliseconds{ 0.0 };
+
+  // the graph skipped it this frame, milliseconds is the last time it ran
+  bool culled{ false };
+};
+
+/**
+ * @brief What the renderer believes the gl state is, an empty optional means we do not know and the next call is
+ * always issued
+ */
+struct RenderState
+{
+  static constexpr uint32_t maxTextureUnits = 16;
+
+  std::optional<uint32_t> program;
+  std::optional<uint32_t> vertexArray;
+  std::optional<uint32_t> framebuffer;
+  std::array<std::optional<uint32_t>, maxTextureUnits> textureUnits;
+
+  std::optional<bool> depthTest;
+  std::optional<bool> stencilTest;
+  std::optional<bool> cullFace;
+  std::optional<bool> blend;
+  std::optional<bool> scissorTest;
+  std::optional<bool> colorMask;
+
+  std::optional<uint32_t> depthFunc;
+  std::optional<uint32_t> cullFaceMode;
+  std::optional<std::array<uint32_t, 2>> blendFunc;
+  std::optional<std::array<uint32_t, 3>> stencilFunc;
+  std::optional<std::array<uint32_t, 3>> stencilOp;
+  std::optional<uint32_t> stencilMask;
+  std::optional<glm::vec4> clearColor;
+  std::optional<std::array<int, 4>> viewport;
+  std::optional<std::array<int, 4>> scissor;
+};
+
+/**
+ * @brief Every gl state change of the passes goes through here, the last value is shadowed so calls that would not
+ * change anything never reach the driver and nothing is queried back with glGet/glIsEnabled
+ */
 class Renderer
 {
 public:
@@ -14,10 +111,72 @@ public:
   static void enableDepth();
   static void enableStencil();
   static void enableColorMask();
+  static void enableCullFace();
+  static void enableBlend();
+  static void enableScissor();
 
   static void disableDepth();
   static void disableStencil();
   static void disableColorMask();
+  static void disableCullFace();
+  static void disableBlend();
+  static void disableScissor();
+
+  static void useProgram( uint32_t program );
+  static void bindVertexArray( uint32_t vertexArray );
+  static void bindFramebuffer( uint32_t framebuffer );
+
+  /**
+   * @brief Units past RenderState::maxTextureUnits are not tracked and always issued
+   */
+  static void bindTextureUnit( uint32_t unit, uint32_t texture );
+
+  static void setDepthFunc( uint32_t func );
+  static void setCullFace( uint32_t face );
+  static void setBlendFunc( uint32_t source, uint32_t destination );
+  static void setStencilFunc( uint32_t func, int ref, uint32_t mask );
+  static void setStencilOp( uint32_t stencilFail, uint32_t depthFail, uint32_t depthPass );
+  static void setStencilMask( uint32_t mask );
+  static void setClearColor( const glm::vec4& color );
+  static void setViewport( int x, int y, int width, int height );
+  static void setScissor( int x, int y, int width, int height );
+
+  /**
+   * @brief Call before deleting a gl object, gl unbinds deleted objects and the id can be handed out again so the
+   * cache has to forget it
+   */
+  static void releaseTexture( uint32_t texture );
+  static void releaseVertexArray( uint32_t vertexArray );
+  static void releaseFramebuffer( uint32_t framebuffer );
+
+  /**
+   * @brief Forget everything, needed after code we do not own (imgui) changed the state behind our back
+   */
+  static void invalidateState();
+
+  /**
+   * @brief Stats of the frame that is currently being recorded, passes add their draw calls in here
+   */
+  static auto getFrameStats() -> FrameStats&;
+
+  /**
+   * @brief Stats of the last finished frame
+   */
+  static auto getLastFrameStats() -> const FrameStats&;
+
+  /**
+   * @brief Call once at the end of the frame, the current stats become the last frame stats and get reset.
+   * The shadowed state is invalidated too since imgui renders outside of the renderer
+   */
+  static void endFrame();
+
+  /**
+   * @brief Timings of the passes the render graph executed last, in execution order with the culled passes at the end
+   */
+  static inline auto getPassTimings() -> std::vector<PassTiming>&
+  {
+    return m_passTimings;
+  }
 
 private:
   // copy is not allowed
@@ -30,5 +189,16 @@ private:
   // we don't need any instances
   Renderer() = delete;
   ~Renderer() = delete;
+
+  /**
+   * @brief Runs apply and stores value if it differs from the cached one, counts the call as issued or elided
+   */
+  template <typename T, typename Apply>
+  static void setState( std::optional<T>& cached, const T& value, Apply&& apply );
+
+  static inline FrameStats m_frameStats{};
+  static inline FrameStats m_lastFrameStats{};
+  static inline RenderState m_state{};
+  static inline std::vector<PassTiming> m_passTimings{};
 };
-} // namespace kogayonon_rendering
\ No newline at end of file
+} // namespace kogayonon_rendering
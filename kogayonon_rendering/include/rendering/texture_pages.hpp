@@ -0,0 +1,154 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace kogayonon_rendering
+{
+/**
+ * @brief Where a texture ended up, page is the size class and layer the slice inside its array texture
+ */
+struct TexturePageSlot
+{
+  uint32_t page{ 0 };
+  uint32_t layer{ 0 };
+};
+
+/**
+ * @brief A layer that trim moved to another index of the same page
+ */
+struct TexturePageMove
+{
+  TexturePageSlot from;
+  TexturePageSlot to;
+};
+
+/**
+ * @brief Copies textures into GL_TEXTURE_2D_ARRAY pages so a single set of samplers covers every material. Pages are
+ * grouped by size, a texture is scaled into the smallest page that is at least as big as its largest side. Raw
+ * textures are stored as RGBA8, cooked BC7 textures already come in a page size and keep their blocks in BC7 pages.
+ * Freed layers are handed out again before a page grows, whoever adds a texture keeps track of its slot
+ */
+class TexturePages
+{
+public:
+  static constexpr uint32_t sizeCount = 4;
+  static constexpr std::array<uint32_t, sizeCount> pageSizes{ 256, 512, 1024, 2048 };
+
+  // the RGBA8 pages first, then the BC7 ones
+  static constexpr uint32_t pageCount = sizeCount * 2;
+
+  // arrays never hold less than this many layers, trimmed ones are rounded up to it
+  static constexpr uint32_t layerBlock = 4;
+
+  TexturePages() = default;
+  ~TexturePages();
+
+  TexturePages( const TexturePages& ) = delete;
+  TexturePages& operator=( const TexturePages& ) = delete;
+
+  /**
+   * @brief Copies a loaded GL_TEXTURE_2D into a free layer
+   * @param textureId Id of the source texture
+   * @param maxSize The page is never bigger than this, compressed textures skip their biggest mips to get there
+   * @return The slot the texture got, nothing for compressed textures that fit no page since those can not be scaled
+   */
+  auto addTexture( uint32_t textureId, uint32_t maxSize = pageSizes.back() ) -> std::optional<TexturePageSlot>;
+
+  /**
+   * @brief Moves a layer into a smaller page of the same format by copying the mips that still fit, the old layer is
+   * freed. A full smaller page grows, see getGrowBytes
+   * @param sizeIndex Index into pageSizes, smaller than the one of the slot
+   * @return The new slot
+   */
+  auto shrink( const TexturePageSlot& slot, uint32_t sizeIndex ) -> TexturePageSlot;
+
+  /**
+   * @brief Gives the layer back, the next texture of that page reuses it
+   */
+  void free( const TexturePageSlot& slot );
+
+  /**
+   * @brief Recreates pages with free layers at the size their used layers need, the used layers get packed to the
+   * front. The old array lives until the copy is done
+   * @param tight Trims every page with a free block of layers, otherwise only pages that are at most half used
+   * @return The layers that moved, whoever tracks the slots has to follow them
+   */
+  auto trim( bool tight ) -> std::vector<TexturePageMove>;
+
+  /**
+   * @brief A GL_TEXTURE_2D view of a single layer with all of its mips, for showing it outside the shaders. It keeps
+   * the array it was made from alive, delete it before the page changes
+   */
+  auto createView( const TexturePageSlot& slot ) const -> uint32_t;
+
+  /**
+   * @brief Binds page i to unit firstUnit + i, pages without layers get nothing bound
+   */
+  void bind( uint32_t firstUnit ) const;
+
+  void destroy();
+
+  /**
+   * @brief Index into pageSizes of the smallest page at least as big as size, the biggest one for anything larger
+   */
+  static auto getSizeIndex( uint32_t size ) -> uint32_t;
+
+  /**
+   * @brief Gpu memory of a single layer with all of its mips
+   */
+  static auto getLayerBytes( uint32_t pageIndex ) -> std::size_t;
+
+  /**
+   * @brief Layers that hold a texture
+   */
+  auto getUsedBytes() const -> std::size_t;
+
+  /**
+   * @brief Every layer the arrays were created with, used or not
+   */
+  auto getAllocatedBytes() const -> std::size_t;
+
+  /**
+   * @brief What the arrays would take after a tight trim
+   */
+  auto getCompactBytes() const -> std::size_t;
+
+  /**
+   * @brief Bytes of the array a page would be recreated as if one more layer went in, 0 when it has room. Both
+   * arrays are alive while the layers are copied over
+   */
+  auto getGrowBytes( uint32_t pageIndex ) const -> std::size_t;
+
+private:
+  struct Page
+  {
+    uint32_t id{ 0 };
+    uint32_t layerCount{ 0 };
+    uint32_t layerCapacity{ 0 };
+    std::vector<uint32_t> freeLayers;
+  };
+
+  auto allocate( uint32_t pageIndex ) -> TexturePageSlot;
+
+  /**
+   * @brief An empty array for a page with room for capacity layers and all of their mips
+   */
+  static auto createArray( uint32_t pageIndex, uint32_t capacity ) -> uint32_t;
+
+  static inline auto getUsedLayers( const Page& page ) -> uint32_t
+  {
+    return page.layerCount - static_cast<uint32_t>( page.freeLayers.size() );
+  }
+
+  /**
+   * @brief Makes room for one more layer, the array is recreated with double the layers and the old ones get copied
+   */
+  void grow( uint32_t pageIndex );
+
+private:
+  std::array<Page, pageCount> m_pages{};
+};
+} // namespace kogayonon_rendering
@@ -0,0 +1,49 @@
+#include "rendering/frame_uniformbuffer.hpp"
+#include <cstring>
+#include <glad/glad.h>
+
+namespace kogayonon_rendering
+{
+void FrameUniformbuffer::initialize( uint32_t bindingIndex )
+{
+  m_bindingIndex = bindingIndex;
+  glCreateBuffers( 1, &m_ubo );
+  glNamedBufferStorage( m_ubo, sizeof( FrameConstants ), &m_constants, GL_DYNAMIC_STORAGE_BIT );
+  bind();
+}
+
+void FrameUniformbuffer::destroy()
+{
+  if ( m_ubo )
+  {
+    glDeleteBuffers( 1, &m_ubo );
+    m_ubo = 0;
+  }
+  m_uploaded = false;
+}
+
+void FrameUniformbuffer::bind()
+{
+  glBindBufferBase( GL_UNIFORM_BUFFER, m_bindingIndex, m_ubo );
+}
+
+void FrameUniformbuffer::unbind()
+{
+  glBindBufferBase( GL_UNIFORM_BUFFER, m_bindingIndex, 0 );
+}
+
+auto FrameUniformbuffer::update( const FrameConstants& constants ) -> bool
+{
+  if ( m_ubo == 0 )
+    initialize( m_bindingIndex );
+
+  // picking and the viewport both update the constants, most of the time nothing moved in between
+  if ( m_uploaded && std::memcmp( &m_constants, &constants, sizeof( FrameConstants ) ) == 0 )
+    return false;
+
+  m_constants = constants;
+  glNamedBufferSubData( m_ubo, 0, sizeof( FrameConstants ), &m_constants );
+  m_uploaded = true;
+  return true;
+}
+} // namespace kogayonon_rendering
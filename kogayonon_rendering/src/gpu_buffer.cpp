@@ -0,0 +1,65 @@
+#include "rendering/gpu_buffer.hpp"
+#include <algorithm>
+#include <glad/glad.h>
+
+namespace kogayonon_rendering
+{
+GPUBuffer::~GPUBuffer()
+{
+  destroy();
+}
+
+bool GPUBuffer::reserve( std::size_t size )
+{
+  if ( size <= m_capacity && m_id != 0 )
+    return false;
+
+  // start from something small so a couple of appends don't reallocate every time
+  auto capacity = std::max<std::size_t>( m_capacity, 256 );
+  while ( capacity < size )
+    capacity *= 2;
+
+  uint32_t id = 0;
+  glCreateBuffers( 1, &id );
+  glNamedBufferStorage( id, capacity, nullptr, GL_DYNAMIC_STORAGE_BIT );
+
+  // keep what was already uploaded
+  if ( m_id != 0 )
+  {
+    glCopyNamedBufferSubData( m_id, id, 0, 0, m_capacity );
+    glDeleteBuffers( 1, &m_id );
+  }
+
+  m_id = id;
+  m_capacity = capacity;
+  return true;
+}
+
+bool GPUBuffer::upload( const void* data, std::size_t size )
+{
+  auto recreated = reserve( size );
+
+  if ( size != 0 )
+    glNamedBufferSubData( m_id, 0, size, data );
+
+  return recreated;
+}
+
+void GPUBuffer::uploadRange( const void* data, std::size_t offset, std::size_t size ) const
+{
+  if ( size == 0 || m_id == 0 )
+    return;
+
+  glNamedBufferSubData( m_id, offset, size, data );
+}
+
+void GPUBuffer::destroy()
+{
+  if ( m_id != 0 )
+  {
+    glDeleteBuffers( 1, &m_id );
+    m_id = 0;
+  }
+  m_capacity = 0;
+}
+} // namespace kogayonon_rendering
@@ -0,0 +1,43 @@
+#include "rendering/gpu_fence.hpp"
+
+namespace kogayonon_rendering
+{
+GPUFence::~GPUFence()
+{
+  destroy();
+}
+
+void GPUFence::insert()
+{
+  destroy();
+  m_sync = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+}
+
+auto GPUFence::isSignaled() const -> bool
+{
+  if ( !m_sync )
+    return false;
+
+  GLint status = GL_UNSIGNALED;
+  glGetSynciv( m_sync, GL_SYNC_STATUS, sizeof( status ), nullptr, &status );
+  return status == GL_SIGNALED;
+}
+
+auto GPUFence::wait( uint64_t timeout ) const -> bool
+{
+  if ( !m_sync )
+    return false;
+
+  const auto result = glClientWaitSync( m_sync, GL_SYNC_FLUSH_COMMANDS_BIT, timeout );
+  return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+void GPUFence::destroy()
+{
+  if ( m_sync )
+  {
+    glDeleteSync( m_sync );
+    m_sync = nullptr;
+  }
+}
+} // namespace kogayonon_rendering
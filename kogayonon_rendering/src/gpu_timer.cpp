@@ -0,0 +1,65 @@
+#include "rendering/gpu_timer.hpp"
+
+namespace kogayonon_rendering
+{
+GPUTimer::~GPUTimer()
+{
+  destroy();
+}
+
+void GPUTimer::begin()
+{
+  if ( m_queries[0] == 0 )
+    glCreateQueries( GL_TIMESTAMP, static_cast<GLsizei>( m_queries.size() ), m_queries.data() );
+
+  // reusing a pair drops its result, only happens when the gpu is more than queryCount frames behind
+  glQueryCounter( m_queries[m_current * 2], GL_TIMESTAMP );
+}
+
+void GPUTimer::end()
+{
+  glQueryCounter( m_queries[m_current * 2 + 1], GL_TIMESTAMP );
+  m_pending[m_current] = true;
+  m_current = ( m_current + 1 ) % queryCount;
+}
+
+auto GPUTimer::poll() -> bool
+{
+  auto updated = false;
+
+  // oldest first so the newest available result is the one that stays
+  for ( auto i = 0u; i < queryCount; i++ )
+  {
+    const auto index = ( m_current + i ) % queryCount;
+    if ( !m_pending[index] )
+      continue;
+
+    // the end timestamp is written last, once it is there both are
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv( m_queries[index * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available );
+    if ( available == GL_FALSE )
+      continue;
+
+    GLuint64 start = 0;
+    GLuint64 end = 0;
+    glGetQueryObjectui64v( m_queries[index * 2], GL_QUERY_RESULT, &start );
+    glGetQueryObjectui64v( m_queries[index * 2 + 1], GL_QUERY_RESULT, &end );
+    m_start = start;
+    m_milliseconds = static_cast<double>( end - start ) / 1e6;
+    m_pending[index] = false;
+    updated = true;
+  }
+
+  return updated;
+}
+
+void GPUTimer::destroy()
+{
+  if ( m_queries[0] == 0 )
+    return;
+
+  glDeleteQueries( static_cast<GLsizei>( m_queries.size() ), m_queries.data() );
+  m_queries.fill( 0 );
+  m_pending.fill( false );
+}
+} // namespace kogayonon_rendering
@@ -1,21 +1,39 @@
 #include "rendering/light_shader_storagebuffer.hpp"
+#include <algorithm>
+#include <cassert>
 #include <glad/glad.h>
 #include <spdlog/spdlog.h>
+#include "rendering/renderer.hpp"
 
 namespace kogayonon_rendering
 {
+namespace
+{
+// the last light takes the place of the removed one, returns where it came from
+template <typename T>
+auto swapRemove( std::vector<T>& lights, uint32_t index ) -> uint32_t
+{
+	const auto last = static_cast<uint32_t>( lights.size() - 1 );
+	if ( index != last )
+		lights.at( index ) = lights.at( last );
+
+	lights.pop_back();
+	return last;
+}
+} // namespace
+
 void LightShaderStoragebuffer::bind( uint32_t index )
 {
-	glBindBuffer( GL_SHADER_STORAGE_BUFFER, m_ssbos.at( index ).id );
+	const auto& ssbo = m_ssbos.at( index );
+	glBindBufferBase( GL_SHADER_STORAGE_BUFFER, ssbo.bindingIndex, ssbo.buffer.getId() );
 }
 
 void LightShaderStoragebuffer::bind()
 {
 	for ( short i = 0; i < 3; i++ )
 	{
-		const auto& ssbo = m_ssbos.at( i );
-		if ( ssbo.id != 0 )
-			glBindBuffer( GL_SHADER_STORAGE_BUFFER, ssbo.id );
+		if ( m_ssbos.at( i ).buffer.getId() != 0 )
+			bind( i );
 	}
 }
 
@@ -27,74 +45,15 @@ void LightShaderStoragebuffer::unbind()
 void LightShaderStoragebuffer::initialize()
 {
 	// 0       1       2
-	//  point spot directional
+	//  point directional spot
 	for ( uint32_t i = 0; i < 3; i++ )
-	{
-		m_ssbos.push_back( SSBO{ .id = 0, .bindingIndex = i } );
-	}
+		m_ssbos.at( i ).bindingIndex = i;
 
-	auto& pointLightSSBO = m_ssbos.at( 0 );
-	auto& directionalLightSSBO = m_ssbos.at( 1 );
-	auto& spotLightSSBO = m_ssbos.at( 2 );
-
-	initStorageBuffer( kogayonon_resources::LightType::Point, pointLightSSBO );
-	initStorageBuffer( kogayonon_resources::LightType::Directional, directionalLightSSBO );
-	initStorageBuffer( kogayonon_resources::LightType::Spot, spotLightSSBO );
-}
-
-void LightShaderStoragebuffer::initStorageBuffer( const kogayonon_resources::LightType& type, SSBO& ssbo )
-{
-	switch ( type )
-	{
-	case kogayonon_resources::LightType::Point: {
-		glCreateBuffers( 1, &ssbo.id );
-		if ( !m_pointLights.empty() )
-		{
-			glNamedBufferData( ssbo.id,
-							   sizeof( kogayonon_resources::PointLight ) * m_pointLights.size(),
-							   m_pointLights.data(),
-							   GL_DYNAMIC_DRAW );
-		}
-		else
-		{
-			glNamedBufferData( ssbo.id, sizeof( kogayonon_resources::PointLight ), nullptr, GL_DYNAMIC_DRAW );
-		}
-		glBindBufferBase( GL_SHADER_STORAGE_BUFFER, ssbo.bindingIndex, ssbo.id );
-		break;
-	}
-	case kogayonon_resources::LightType::Directional: {
-		glCreateBuffers( 1, &ssbo.id );
-		if ( !m_directionalLights.empty() )
-		{
-			glNamedBufferData( ssbo.id,
-							   sizeof( kogayonon_resources::DirectionalLight ) * m_directionalLights.size(),
-							   m_directionalLights.data(),
-							   GL_DYNAMIC_DRAW );
-		}
-		else
-		{
-			glNamedBufferData( ssbo.id, sizeof( kogayonon_resources::DirectionalLight ), nullptr, GL_DYNAMIC_DRAW );
-		}
-		glBindBufferBase( GL_SHADER_STORAGE_BUFFER, ssbo.bindingIndex, ssbo.id );
-		break;
-	}
-	case kogayonon_resources::LightType::Spot: {
-		glCreateBuffers( 1, &ssbo.id );
-		if ( !m_spotLights.empty() )
-		{
-			glNamedBufferData( ssbo.id,
-							   sizeof( kogayonon_resources::SpotLight ) * m_spotLights.size(),
-							   m_spotLights.data(),
-							   GL_DYNAMIC_DRAW );
-		}
-		else
-		{
-			glNamedBufferData( ssbo.id, sizeof( kogayonon_resources::SpotLight ), nullptr, GL_DYNAMIC_DRAW );
-		}
-		glBindBufferBase( GL_SHADER_STORAGE_BUFFER, ssbo.bindingIndex, ssbo.id );
-		break;
-	}
-	}
+	// an empty buffer can not be bound, every type starts with room for a few lights
+	m_ssbos.at( 0 ).buffer.reserve( sizeof( kogayonon_resources::PointLight ) );
+	m_ssbos.at( 1 ).buffer.reserve( sizeof( kogayonon_resources::DirectionalLight ) );
+	m_ssbos.at( 2 ).buffer.reserve( sizeof( kogayonon_resources::SpotLight ) );
+	bind();
 }
 
 void LightShaderStoragebuffer::destroy()
@@ -107,12 +66,7 @@ void LightShaderStoragebuffer::destroy()
 
 void LightShaderStoragebuffer::destroy( uint32_t index )
 {
-	auto& ssbo = m_ssbos.at( index );
-	if ( ssbo.id != 0 )
-	{
-		glDeleteBuffers( 1, &ssbo.id );
-		ssbo.id = 0;
-	}
+	m_ssbos.at( index ).buffer.destroy();
 }
 
 void LightShaderStoragebuffer::update()
@@ -121,6 +75,8 @@ void LightShaderStoragebuffer::update()
 	{
 		update( i );
 	}
+
+	Renderer::getFrameStats().lightBufferBytes = static_cast<uint32_t>( getGPUMemory() );
 }
 
 void LightShaderStoragebuffer::update( uint32_t index )
@@ -130,89 +86,123 @@ void LightShaderStoragebuffer::update( uint32_t index )
 	switch ( index )
 	{
 	case 0: {
-		initStorageBuffer( kogayonon_resources::LightType::Point, ssbo );
-		bind( 0 );
-
-		if ( !m_pointLights.empty() )
-			glNamedBufferData( ssbo.id,
-							   sizeof( kogayonon_resources::PointLight ) * m_pointLights.size(),
-							   m_pointLights.data(),
-							   GL_DYNAMIC_DRAW );
-
-		glBindBufferBase( GL_SHADER_STORAGE_BUFFER, ssbo.bindingIndex, ssbo.id );
-		unbind();
+		upload( ssbo, m_pointLights );
 		break;
 	}
 	case 1: {
-		initStorageBuffer( kogayonon_resources::LightType::Directional, ssbo );
-		bind( 1 );
-
-		if ( !m_directionalLights.empty() )
-			glNamedBufferData( ssbo.id,
-							   sizeof( kogayonon_resources::DirectionalLight ) * m_directionalLights.size(),
-							   m_directionalLights.data(),
-							   GL_DYNAMIC_DRAW );
-
-		glBindBufferBase( GL_SHADER_STORAGE_BUFFER, ssbo.bindingIndex, ssbo.id );
-		unbind();
+		upload( ssbo, m_directionalLights );
 		break;
 	}
 	case 2: {
-		initStorageBuffer( kogayonon_resources::LightType::Spot, ssbo );
-		bind( 2 );
+		upload( ssbo, m_spotLights );
+		break;
+	}
+	}
+}
 
-		if ( !m_spotLights.empty() )
-			glNamedBufferData( ssbo.id,
-							   sizeof( kogayonon_resources::SpotLight ) * m_spotLights.size(),
-							   m_spotLights.data(),
-							   GL_DYNAMIC_DRAW );
+template <typename T>
+void LightShaderStoragebuffer::upload( SSBO& ssbo, const std::vector<T>& lights )
+{
+	// removing the last lights can leave the range past the end
+	const auto end = std::min<std::size_t>( ssbo.dirtyEnd, lights.size() );
+	const auto begin = ssbo.dirtyBegin;
+	ssbo.dirtyBegin = 0;
+	ssbo.dirtyEnd = 0;
+
+	if ( begin >= end )
+		return;
+
+	// growing copies the old content over, so the lights that were already there stay valid
+	if ( ssbo.buffer.reserve( lights.size() * sizeof( T ) ) )
+		glBindBufferBase( GL_SHADER_STORAGE_BUFFER, ssbo.bindingIndex, ssbo.buffer.getId() );
+
+	const auto bytes = ( end - begin ) * sizeof( T );
+	ssbo.buffer.uploadRange( lights.data() + begin, begin * sizeof( T ), bytes );
+	Renderer::getFrameStats().lightUploadBytes += static_cast<uint32_t>( bytes );
+}
 
-		glBindBufferBase( GL_SHADER_STORAGE_BUFFER, ssbo.bindingIndex, ssbo.id );
-		unbind();
-		break;
+void LightShaderStoragebuffer::markDirty( const kogayonon_resources::LightType& type, uint32_t index )
+{
+	auto& ssbo = getSSBO( type );
+	if ( ssbo.dirtyBegin == ssbo.dirtyEnd )
+	{
+		ssbo.dirtyBegin = index;
+		ssbo.dirtyEnd = index + 1;
+		return;
 	}
+
+	ssbo.dirtyBegin = std::min( ssbo.dirtyBegin, index );
+	ssbo.dirtyEnd = std::max( ssbo.dirtyEnd, index + 1 );
+}
+
+auto LightShaderStoragebuffer::getSSBO( const kogayonon_resources::LightType& type ) -> SSBO&
+{
+	switch ( type )
+	{
+	case kogayonon_resources::LightType::Point:
+		return m_ssbos.at( static_cast<uint32_t>( SSBOType::Point ) );
+	case kogayonon_resources::LightType::Directional:
+		return m_ssbos.at( static_cast<uint32_t>( SSBOType::Directional ) );
+	case kogayonon_resources::LightType::Spot:
+	default:
+		return m_ssbos.at( static_cast<uint32_t>( SSBOType::Spot ) );
 	}
 }
 
 auto LightShaderStoragebuffer::addLight( const kogayonon_resources::LightType& type ) -> uint32_t
 {
+	uint32_t index = 0;
 	switch ( type )
 	{
 	case kogayonon_resources::LightType::Point: {
-		auto light = kogayonon_resources::PointLight{};
-		auto index = m_pointLights.size();
-		m_pointLights.emplace_back( light );
-		return index;
+		index = static_cast<uint32_t>( m_pointLights.size() );
+		m_pointLights.emplace_back( kogayonon_resources::PointLight{} );
+		break;
 	}
 	case kogayonon_resources::LightType::Directional: {
-		auto light = kogayonon_resources::DirectionalLight{};
-		auto index = m_directionalLights.size();
-		m_directionalLights.emplace_back( light );
-		return index;
+		index = static_cast<uint32_t>( m_directionalLights.size() );
+		m_directionalLights.emplace_back( kogayonon_resources::DirectionalLight{} );
+		break;
 	}
 	case kogayonon_resources::LightType::Spot: {
+		index = static_cast<uint32_t>( m_spotLights.size() );
+		m_spotLights.emplace_back( kogayonon_resources::SpotLight{} );
 		break;
 	}
 	}
+
+	markDirty( type, index );
+	return index;
 }
 
-void LightShaderStoragebuffer::removeLight( const kogayonon_resources::LightType& type, uint32_t index )
+auto LightShaderStoragebuffer::removeLight( const kogayonon_resources::LightType& type, uint32_t index ) -> uint32_t
 {
+	uint32_t moved = index;
+	std::size_t remaining = 0;
 	switch ( type )
 	{
 	case kogayonon_resources::LightType::Point: {
-		m_pointLights.erase( m_pointLights.begin() + index );
+		moved = swapRemove( m_pointLights, index );
+		remaining = m_pointLights.size();
 		break;
 	}
 	case kogayonon_resources::LightType::Directional: {
-		m_directionalLights.erase( m_directionalLights.begin() + index );
+		moved = swapRemove( m_directionalLights, index );
+		remaining = m_directionalLights.size();
 		break;
 	}
 	case kogayonon_resources::LightType::Spot: {
-		m_spotLights.erase( m_spotLights.begin() + index );
+		moved = swapRemove( m_spotLights, index );
+		remaining = m_spotLights.size();
 		break;
 	}
 	}
+
+	// the buffer keeps its size, the shader only reads up to the light count
+	if ( index < remaining )
+		markDirty( type, index );
+
+	return moved;
 }
 
 auto LightShaderStoragebuffer::getPointLights() -> point_lights&
@@ -230,4 +220,13 @@ auto LightShaderStoragebuffer::getSpotLights() -> spot_lights&
 	return m_spotLights;
 }
 
+auto LightShaderStoragebuffer::getGPUMemory() const -> std::size_t
+{
+	std::size_t bytes = 0;
+	for ( const auto& ssbo : m_ssbos )
+		bytes += ssbo.buffer.getCapacity();
+
+	return bytes;
+}
+
 } // namespace kogayonon_rendering
\ No newline at end of file
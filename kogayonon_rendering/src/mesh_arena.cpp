@@ -0,0 +1,103 @@
+#include "rendering/mesh_arena.hpp"
+#include <assert.h>
+#include <glad/glad.h>
+#include "rendering/renderer.hpp"
+#include "resources/vertex.hpp"
+
+namespace kogayonon_rendering
+{
+MeshArena::~MeshArena()
+{
+  destroy();
+}
+
+auto MeshArena::addMesh( uint64_t key, std::span<const kogayonon_resources::Vertex> vertices,
+                         std::span<const uint32_t> indices ) -> MeshArenaRange
+{
+  if ( auto it = m_ranges.find( key ); it != m_ranges.end() )
+    return it->second;
+
+  if ( m_vao == 0 )
+    glCreateVertexArrays( 1, &m_vao );
+
+  MeshArenaRange range{ .vertexOffset = m_vertexCount,
+                        .vertexCount = static_cast<uint32_t>( vertices.size() ),
+                        .indexOffset = m_indexCount,
+                        .indexCount = static_cast<uint32_t>( indices.size() ) };
+
+  const auto vertexBytes = ( m_vertexCount + range.vertexCount ) * sizeof( kogayonon_resources::Vertex );
+  const auto indexBytes = ( m_indexCount + range.indexCount ) * sizeof( uint32_t );
+
+  // if any of the buffers got recreated the vao points to a dead buffer so we link it again
+  auto recreated = m_vertexBuffer.reserve( vertexBytes );
+  recreated |= m_indexBuffer.reserve( indexBytes );
+  if ( recreated )
+    setupVao();
+
+  m_vertexBuffer.uploadRange( vertices.data(),
+                              range.vertexOffset * sizeof( kogayonon_resources::Vertex ),
+                              range.vertexCount * sizeof( kogayonon_resources::Vertex ) );
+  m_indexBuffer.uploadRange(
+    indices.data(), range.indexOffset * sizeof( uint32_t ), range.indexCount * sizeof( uint32_t ) );
+
+  m_vertexCount += range.vertexCount;
+  m_indexCount += range.indexCount;
+
+  m_ranges.try_emplace( key, range );
+  return range;
+}
+
+auto MeshArena::contains( uint64_t key ) const -> bool
+{
+  return m_ranges.contains( key );
+}
+
+auto MeshArena::getRange( uint64_t key ) const -> const MeshArenaRange&
+{
+  assert( m_ranges.contains( key ) && "mesh is not in the arena" );
+  return m_ranges.at( key );
+}
+
+auto MeshArena::getVao() -> uint32_t
+{
+  if ( m_vao == 0 )
+    glCreateVertexArrays( 1, &m_vao );
+
+  return m_vao;
+}
+
+void MeshArena::setupVao()
+{
+  // same layout as AssetManager::uploadMeshGeometry
+  glVertexArrayVertexBuffer( m_vao, 0, m_vertexBuffer.getId(), 0, sizeof( kogayonon_resources::Vertex ) );
+  glVertexArrayElementBuffer( m_vao, m_indexBuffer.getId() );
+
+  glEnableVertexArrayAttrib( m_vao, 0 );
+  glEnableVertexArrayAttrib( m_vao, 1 );
+  glEnableVertexArrayAttrib( m_vao, 2 );
+
+  glVertexArrayAttribFormat( m_vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof( kogayonon_resources::Vertex, translation ) );
+  glVertexArrayAttribFormat( m_vao, 1, 3, GL_FLOAT, GL_FALSE, offsetof( kogayonon_resources::Vertex, normal ) );
+  glVertexArrayAttribFormat( m_vao, 2, 2, GL_FLOAT, GL_FALSE, offsetof( kogayonon_resources::Vertex, textureCoords ) );
+
+  glVertexArrayAttribBinding( m_vao, 0, 0 );
+  glVertexArrayAttribBinding( m_vao, 1, 0 );
+  glVertexArrayAttribBinding( m_vao, 2, 0 );
+}
+
+void MeshArena::destroy()
+{
+  if ( m_vao != 0 )
+  {
+    Renderer::releaseVertexArray( m_vao );
+    glDeleteVertexArrays( 1, &m_vao );
+    m_vao = 0;
+  }
+
+  m_vertexBuffer.destroy();
+  m_indexBuffer.destroy();
+  m_vertexCount = 0;
+  m_indexCount = 0;
+  m_ranges.clear();
+}
+} // namespace kogayonon_rendering
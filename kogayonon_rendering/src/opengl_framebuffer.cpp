@@ -1,5 +1,7 @@
 #include "rendering/opengl_framebuffer.hpp"
 #include <spdlog/spdlog.h>
+#include "rendering/render_target_pool.hpp"
+#include "rendering/renderer.hpp"
 
 namespace kogayonon_rendering
 {
@@ -48,6 +50,12 @@ void OpenGLFramebuffer::init()
 {
   glCreateFramebuffers( 1, &m_fbo );
 
+  // the textures come from the pool in size classes, the passes only draw into the width x height corner of them
+  m_specification.storageWidth = RenderTargetPool::roundSize( m_specification.width );
+  m_specification.storageHeight = RenderTargetPool::roundSize( m_specification.height );
+  const auto w = m_specification.storageWidth;
+  const auto h = m_specification.storageHeight;
+
   auto count = 0u;
   for ( auto& item : m_specification.colorAttachments )
   {
@@ -55,10 +63,10 @@ void OpenGLFramebuffer::init()
     {
     case GL_RGBA8:
     case GL_RGBA:
-      attachColorTexture( item.id, m_specification.width, m_specification.height, GL_RGBA8, m_fbo, count++ );
+      attachColorTexture( item, w, h, GL_RGBA8, m_fbo, count++ );
       break;
     case GL_RED_INTEGER:
-      attachColorTexture( item.id, m_specification.width, m_specification.height, GL_R32I, m_fbo, count++ );
+      attachColorTexture( item, w, h, GL_R32I, m_fbo, count++ );
       break;
     default:
       spdlog::critical( "Texture format unsupported" );
@@ -71,13 +79,11 @@ void OpenGLFramebuffer::init()
     switch ( item.textureFormat )
     {
     case GL_DEPTH_COMPONENT24:
-      attachDepthTexture( item.id, m_specification.width, m_specification.height, GL_DEPTH_COMPONENT32,
-                          GL_DEPTH_ATTACHMENT, m_fbo );
+      attachDepthTexture( item, w, h, GL_DEPTH_COMPONENT32, GL_DEPTH_ATTACHMENT, m_fbo );
       break;
 
     case GL_DEPTH24_STENCIL8:
-      attachDepthTexture( item.id, m_specification.width, m_specification.height, GL_DEPTH24_STENCIL8,
-                          GL_DEPTH_STENCIL_ATTACHMENT, m_fbo );
+      attachDepthTexture( item, w, h, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL_ATTACHMENT, m_fbo );
       break;
     default:
       spdlog::critical( "Texture format unsupported" );
@@ -102,7 +108,7 @@ void OpenGLFramebuffer::init()
   }
 
   checkFramebuffer();
-  glViewport( 0, 0, m_specification.width, m_specification.height );
+  Renderer::setViewport( 0, 0, m_specification.width, m_specification.height );
 }
 
 void OpenGLFramebuffer::resize( uint32_t w, uint32_t h )
@@ -116,6 +122,22 @@ void OpenGLFramebuffer::resize( uint32_t w, uint32_t h )
   m_specification.width = w;
   m_specification.height = h;
 
+  // still inside the same size class, the textures fit and only the viewport of the passes changes
+  if ( m_fbo && RenderTargetPool::roundSize( w ) == m_specification.storageWidth &&
+       RenderTargetPool::roundSize( h ) == m_specification.storageHeight )
+    return;
+
+  destroy();
+  init();
+}
+
+void OpenGLFramebuffer::setLayers( uint32_t layers )
+{
+  if ( layers == m_specification.layers )
+    return;
+
+  m_specification.layers = layers;
+
   destroy();
   init();
 }
@@ -128,7 +150,7 @@ void OpenGLFramebuffer::destroy()
     {
       if ( m_specification.colorAttachments.at( i ).id )
       {
-        glDeleteTextures( 1, &m_specification.colorAttachments.at( i ).id );
+        RenderTargetPool::release( m_specification.colorAttachments.at( i ).id );
         m_specification.colorAttachments.at( i ).id = 0;
       }
     }
@@ -137,7 +159,7 @@ void OpenGLFramebuffer::destroy()
     {
       if ( m_specification.depthAttachments.at( i ).id )
       {
-        glDeleteTextures( 1, &m_specification.depthAttachments.at( i ).id );
+        RenderTargetPool::release( m_specification.depthAttachments.at( i ).id );
         m_specification.depthAttachments.at( i ).id = 0;
       }
     }
@@ -147,6 +169,7 @@ void OpenGLFramebuffer::destroy()
 
     m_rbo = 0;
 
+    Renderer::releaseFramebuffer( m_fbo );
     glDeleteFramebuffers( 1, &m_fbo );
     m_fbo = 0;
   }
@@ -154,13 +177,13 @@ void OpenGLFramebuffer::destroy()
 
 void OpenGLFramebuffer::bind()
 {
-  glBindFramebuffer( GL_FRAMEBUFFER, m_fbo );
-  glViewport( 0, 0, m_specification.width, m_specification.height );
+  Renderer::bindFramebuffer( m_fbo );
+  Renderer::setViewport( 0, 0, m_specification.width, m_specification.height );
 }
 
 void OpenGLFramebuffer::unbind()
 {
-  glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+  Renderer::bindFramebuffer( 0 );
 }
 
 auto OpenGLFramebuffer::getSpecification() -> const FramebufferSpec&
@@ -187,6 +210,16 @@ auto OpenGLFramebuffer::readPixel( uint32_t attachmentIndex, int x, int y ) cons
   return pixelData;
 }
 
+void OpenGLFramebuffer::readPixels( uint32_t attachmentIndex, int x, int y, int w, int h, uint32_t packBuffer ) const
+{
+  glReadBuffer( GL_COLOR_ATTACHMENT0 + attachmentIndex );
+
+  // with a pack buffer bound the last argument is an offset into it, nothing waits for the gpu here
+  glBindBuffer( GL_PIXEL_PACK_BUFFER, packBuffer );
+  glReadPixels( x, y, w, h, GL_RED_INTEGER, GL_INT, nullptr );
+  glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+}
+
 void OpenGLFramebuffer::attachRenderbuffer()
 {
   glGenRenderbuffers( 1, &m_rbo );
@@ -217,13 +250,14 @@ void OpenGLFramebuffer::clearColorAttachment( uint32_t index, int id ) const
   }
 }
 
-void OpenGLFramebuffer::attachColorTexture( uint32_t& id, uint32_t w, uint32_t h, GLenum format, uint32_t& fbo,
-                                            int index )
+void OpenGLFramebuffer::attachColorTexture( FramebufferAttachment& attachment, uint32_t w, uint32_t h, GLenum format,
+                                            uint32_t& fbo, int index )
 
 {
   assert( w != 0 && h != 0 && "width and height CANNOT be 0" );
-  glCreateTextures( GL_TEXTURE_2D, 1, &id );
-  glTextureStorage2D( id, 1, format, w, h );
+  attachment.id =
+    RenderTargetPool::acquire( RenderTargetKey{ .format = format, .width = w, .height = h }, attachment.transient );
+  const auto id = attachment.id;
 
   glTextureParameteri( id, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
   glTextureParameteri( id, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
@@ -232,21 +266,21 @@ void OpenGLFramebuffer::attachColorTexture( uint32_t& id, uint32_t w, uint32_t h
   glNamedFramebufferTexture( fbo, GL_COLOR_ATTACHMENT0 + index, id, 0 );
 }
 
-void OpenGLFramebuffer::attachDepthTexture( uint32_t& id, uint32_t w, uint32_t h, GLenum format, GLenum attachmentType,
-                                            uint32_t& fbo )
+void OpenGLFramebuffer::attachDepthTexture( FramebufferAttachment& attachment, uint32_t w, uint32_t h, GLenum format,
+                                            GLenum attachmentType, uint32_t& fbo )
 
 {
   assert( w != 0 && h != 0 && "width and height CANNOT be 0" );
-  glCreateTextures( GL_TEXTURE_2D, 1, &id );
-  glBindTexture( GL_TEXTURE_2D, id );
-  glTextureStorage2D( id, 1, format, w, h );
+  attachment.id = RenderTargetPool::acquire(
+    RenderTargetKey{ .format = format, .width = w, .height = h, .layers = m_specification.layers },
+    attachment.transient );
+  const auto id = attachment.id;
   glTextureParameteri( id, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
   glTextureParameteri( id, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
   glTextureParameteri( id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER );
   glTextureParameteri( id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER );
   float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
   glTextureParameterfv( id, GL_TEXTURE_BORDER_COLOR, borderColor );
-  glBindTexture( GL_TEXTURE_2D, 0 );
 
   glNamedFramebufferTexture( fbo, attachmentType, id, 0 );
 }
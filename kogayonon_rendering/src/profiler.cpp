@@ -0,0 +1,241 @@
+#include "rendering/profiler.hpp"
+#include <algorithm>
+#include <fstream>
+#include <glad/glad.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include "utilities/cpu_profiler/cpu_profiler.hpp"
+
+namespace kogayonon_rendering
+{
+using kogayonon_utilities::CpuProfiler;
+using kogayonon_utilities::ZoneSample;
+
+ProfileHistory::ProfileHistory( std::string name, bool gpu )
+    : m_name{ std::move( name ) }
+    , m_gpu{ gpu }
+{
+}
+
+void ProfileHistory::push( float milliseconds )
+{
+  m_samples[m_head] = milliseconds;
+  m_head = ( m_head + 1 ) % historySize;
+  m_count = std::min( m_count + 1, historySize );
+}
+
+auto ProfileHistory::getPercentile( float fraction ) const -> float
+{
+  if ( m_count == 0 )
+    return 0.0f;
+
+  // the ring is filled from the start so the first m_count samples are always the valid ones
+  auto sorted = m_samples;
+  const auto nth = static_cast<uint32_t>( std::clamp( fraction, 0.0f, 1.0f ) * static_cast<float>( m_count - 1 ) );
+  std::nth_element( sorted.begin(), sorted.begin() + nth, sorted.begin() + m_count );
+  return sorted[nth];
+}
+
+auto ProfileHistory::getLatest() const -> float
+{
+  if ( m_count == 0 )
+    return 0.0f;
+
+  return m_samples[( m_head + historySize - 1 ) % historySize];
+}
+
+void Profiler::beginFrame()
+{
+  // the last frame runs until this one starts so the swap is part of it, it is recorded like any other zone so it
+  // also exists in builds without the zone macros
+  static constexpr kogayonon_utilities::ProfileZone frameZone{ "frame", __FILE__, __LINE__ };
+  const auto frameStart = CpuProfiler::now();
+  if ( m_frameStart != 0 )
+    CpuProfiler::record( &frameZone, m_frameStart, frameStart );
+
+  GLint64 gpuNow = 0;
+  glGetInteger64v( GL_TIMESTAMP, &gpuNow );
+  m_frameStart = frameStart;
+  m_gpuOffset = gpuNow - static_cast<int64_t>( m_frameStart );
+
+  if ( m_epoch == 0 )
+    m_epoch = m_frameStart;
+}
+
+void Profiler::endFrame()
+{
+  CpuProfiler::drain( []( const ZoneSample& sample, uint32_t threadIndex ) {
+    const auto start = toMicroseconds( sample.start );
+    const auto duration = static_cast<double>( sample.end - sample.start ) / 1000.0;
+    addEvent(
+      ProfileEvent{ .name = sample.zone->name, .start = start, .duration = duration, .thread = threadIndex + 1 } );
+
+    auto history = m_zoneHistories.find( sample.zone );
+    if ( history == m_zoneHistories.end() )
+      history = m_zoneHistories.emplace( sample.zone, getHistory( sample.zone->name, false ) ).first;
+
+    auto& total = m_totals[history->second];
+    total.milliseconds += duration / 1000.0;
+    total.touched = true;
+  } );
+
+  for ( auto i = 0u; i < m_totals.size(); i++ )
+  {
+    if ( !m_totals[i].touched )
+      continue;
+
+    m_histories[i].push( static_cast<float>( m_totals[i].milliseconds ) );
+    m_totals[i] = ZoneTotal{};
+  }
+
+  // the results are a few frames old, the offset of this frame is close enough to place them
+  for ( const auto& [name, pTimer] : m_gpuTimers )
+  {
+    if ( !pTimer->poll() )
+      continue;
+
+    const auto start = static_cast<int64_t>( pTimer->getStartNanoseconds() ) - m_gpuOffset;
+    addEvent( ProfileEvent{ .name = name.c_str(),
+                            .start = toMicroseconds( static_cast<uint64_t>( start ) ),
+                            .duration = pTimer->getMilliseconds() * 1000.0,
+                            .gpu = true } );
+    m_histories[getHistory( name.c_str(), true )].push( static_cast<float>( pTimer->getMilliseconds() ) );
+  }
+}
+
+void Profiler::beginCpuScope( const std::string& name )
+{
+  m_cpuScopes.emplace_back( CpuScope{ .zone = CpuProfiler::internZone( name ), .start = CpuProfiler::now() } );
+}
+
+void Profiler::endCpuScope()
+{
+  if ( m_cpuScopes.empty() )
+    return;
+
+  const auto& scope = m_cpuScopes.back();
+  CpuProfiler::record( scope.zone, scope.start, CpuProfiler::now() );
+  m_cpuScopes.pop_back();
+}
+
+void Profiler::beginGpuScope( const std::string& name )
+{
+  auto& pTimer = m_gpuTimers[name];
+  if ( !pTimer )
+    pTimer = std::make_unique<GPUTimer>();
+
+  pTimer->begin();
+  m_gpuScopes.emplace_back( pTimer.get() );
+}
+
+void Profiler::endGpuScope()
+{
+  if ( m_gpuScopes.empty() )
+    return;
+
+  m_gpuScopes.back()->end();
+  m_gpuScopes.pop_back();
+}
+
+auto Profiler::getGpuMilliseconds( const std::string& name ) -> double
+{
+  const auto timer = m_gpuTimers.find( name );
+  return timer != m_gpuTimers.end() ? timer->second->getMilliseconds() : 0.0;
+}
+
+void Profiler::shutdown()
+{
+  // the statics outlive the window, their queries would be deleted without a context otherwise
+  m_gpuScopes.clear();
+  m_gpuTimers.clear();
+}
+
+auto Profiler::exportChromeTrace( const std::string& path ) -> bool
+{
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer{ buffer };
+
+  writer.StartObject();
+  writer.Key( "displayTimeUnit" );
+  writer.String( "ms" );
+  writer.Key( "traceEvents" );
+  writer.StartArray();
+
+  // complete events of a single process, the gpu is thread 0 and every cpu thread that recorded a zone follows
+  for ( const auto& event : m_events )
+  {
+    writer.StartObject();
+    writer.Key( "name" );
+    writer.String( event.name );
+    writer.Key( "cat" );
+    writer.String( event.gpu ? "gpu" : "cpu" );
+    writer.Key( "ph" );
+    writer.String( "X" );
+    writer.Key( "ts" );
+    writer.Double( event.start );
+    writer.Key( "dur" );
+    writer.Double( event.duration );
+    writer.Key( "pid" );
+    writer.Int( 0 );
+    writer.Key( "tid" );
+    writer.Uint( event.thread );
+    writer.EndObject();
+  }
+
+  writer.EndArray();
+  writer.EndObject();
+
+  std::ofstream file{ path, std::ios::trunc };
+  if ( !file )
+    return false;
+
+  file.write( buffer.GetString(), static_cast<std::streamsize>( buffer.GetSize() ) );
+  return file.good();
+}
+
+auto Profiler::getHistory( const char* name, bool gpu ) -> uint32_t
+{
+  const auto history = std::find_if( m_histories.begin(), m_histories.end(), [&]( const ProfileHistory& history ) {
+    return history.isGpu() == gpu && history.getName() == name;
+  } );
+
+  if ( history != m_histories.end() )
+    return static_cast<uint32_t>( std::distance( m_histories.begin(), history ) );
+
+  m_histories.emplace_back( name, gpu );
+  m_totals.emplace_back();
+  return static_cast<uint32_t>( m_histories.size() - 1 );
+}
+
+void Profiler::addEvent( const ProfileEvent& event )
+{
+  if ( m_events.size() < maxTraceEvents )
+  {
+    m_events.emplace_back( event );
+    return;
+  }
+
+  m_events[m_nextEvent] = event;
+  m_nextEvent = ( m_nextEvent + 1 ) % maxTraceEvents;
+}
+
+auto Profiler::toMicroseconds( uint64_t nanoseconds ) -> double
+{
+  return static_cast<double>( static_cast<int64_t>( nanoseconds - m_epoch ) ) / 1000.0;
+}
+
+ProfileScope::ProfileScope( const std::string& name, bool gpu )
+    : m_gpu{ gpu }
+{
+  Profiler::beginCpuScope( name );
+  if ( m_gpu )
+    Profiler::beginGpuScope( name );
+}
+
+ProfileScope::~ProfileScope()
+{
+  if ( m_gpu )
+    Profiler::endGpuScope();
+  Profiler::endCpuScope();
+}
+} // namespace kogayonon_rendering
@@ -0,0 +1,157 @@
+#include "rendering/render_target_pool.hpp"
+#include <algorithm>
+#include <bit>
+#include <glad/glad.h>
+#include "rendering/renderer.hpp"
+
+namespace kogayonon_rendering
+{
+namespace
+{
+auto bytesPerPixel( uint32_t format ) -> std::size_t
+{
+  switch ( format )
+  {
+  case GL_RGBA16F:
+  case GL_RGBA16:
+    return 8;
+  case GL_RGBA32F:
+    return 16;
+  case GL_R8:
+    return 1;
+  default:
+    // RGBA8, R32I, DEPTH_COMPONENT32 and DEPTH24_STENCIL8 are all 4
+    return 4;
+  }
+}
+
+auto getTargetBytes( const RenderTargetKey& key ) -> std::size_t
+{
+  return bytesPerPixel( key.format ) * key.width * key.height * std::max( key.layers, 1u ) *
+         std::max( key.samples, 1u );
+}
+} // namespace
+
+auto RenderTargetPool::roundSize( uint32_t size ) -> uint32_t
+{
+  if ( size <= minSizeStep )
+    return minSizeStep;
+
+  const auto step = std::max( minSizeStep, std::bit_floor( size ) / 8 );
+  return ( size + step - 1 ) / step * step;
+}
+
+auto RenderTargetPool::acquire( RenderTargetKey key, bool transient ) -> uint32_t
+{
+  key.width = roundSize( key.width );
+  key.height = roundSize( key.height );
+
+  // transient targets are cleared by every pass that uses them so they can be shared while in use
+  if ( transient )
+  {
+    const auto shared = std::find_if( m_targets.begin(), m_targets.end(), [&]( const RenderTarget& target ) {
+      return target.transient && target.users != 0 && target.key == key;
+    } );
+
+    if ( shared != m_targets.end() )
+    {
+      ++shared->users;
+      return shared->texture;
+    }
+  }
+
+  // a texture released this frame might still be read by commands that were already issued
+  const auto free = std::find_if( m_targets.begin(), m_targets.end(), [&]( const RenderTarget& target ) {
+    return target.users == 0 && target.key == key && m_frame >= target.releasedFrame + reuseDelay;
+  } );
+
+  if ( free != m_targets.end() )
+  {
+    free->users = 1;
+    free->transient = transient;
+    return free->texture;
+  }
+
+  return create( key, transient ).texture;
+}
+
+void RenderTargetPool::release( uint32_t texture )
+{
+  if ( texture == 0 )
+    return;
+
+  const auto target = std::find_if( m_targets.begin(), m_targets.end(), [texture]( const RenderTarget& target ) {
+    return target.texture == texture;
+  } );
+
+  if ( target == m_targets.end() || target->users == 0 )
+    return;
+
+  if ( --target->users == 0 )
+    target->releasedFrame = m_frame;
+}
+
+void RenderTargetPool::endFrame()
+{
+  ++m_frame;
+
+  std::erase_if( m_targets, []( RenderTarget& target ) {
+    if ( target.users != 0 || m_frame < target.releasedFrame + purgeDelay )
+      return false;
+
+    destroy( target );
+    return true;
+  } );
+}
+
+void RenderTargetPool::purge()
+{
+  std::erase_if( m_targets, []( RenderTarget& target ) {
+    if ( target.users != 0 )
+      return false;
+
+    destroy( target );
+    return true;
+  } );
+}
+
+auto RenderTargetPool::getAllocatedBytes() -> std::size_t
+{
+  std::size_t bytes = 0;
+  for ( const auto& target : m_targets )
+    bytes += getTargetBytes( target.key );
+
+  return bytes;
+}
+
+auto RenderTargetPool::create( const RenderTargetKey& key, bool transient ) -> RenderTarget&
+{
+  auto& target = m_targets.emplace_back( RenderTarget{ .key = key, .users = 1, .transient = transient } );
+
+  if ( key.samples > 1 )
+  {
+    glCreateTextures( GL_TEXTURE_2D_MULTISAMPLE, 1, &target.texture );
+    glTextureStorage2DMultisample( target.texture, key.samples, key.format, key.width, key.height, GL_TRUE );
+  }
+  else if ( key.layers > 0 )
+  {
+    glCreateTextures( GL_TEXTURE_2D_ARRAY, 1, &target.texture );
+    glTextureStorage3D( target.texture, 1, key.format, key.width, key.height, key.layers );
+  }
+  else
+  {
+    glCreateTextures( GL_TEXTURE_2D, 1, &target.texture );
+    glTextureStorage2D( target.texture, 1, key.format, key.width, key.height );
+  }
+
+  ++Renderer::getFrameStats().renderTargetAllocations;
+  return target;
+}
+
+void RenderTargetPool::destroy( RenderTarget& target )
+{
+  Renderer::releaseTexture( target.texture );
+  glDeleteTextures( 1, &target.texture );
+  target.texture = 0;
+}
+} // namespace kogayonon_rendering
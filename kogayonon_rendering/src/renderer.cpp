@@ -3,56 +3,216 @@
 
 namespace kogayonon_rendering
 {
+template <typename T, typename Apply>
+void Renderer::setState( std::optional<T>& cached, const T& value, Apply&& apply )
+{
+  if ( cached && *cached == value )
+  {
+    ++m_frameStats.stateCallsElided;
+    return;
+  }
+
+  apply();
+  cached = value;
+  ++m_frameStats.stateCallsIssued;
+}
+
 bool Renderer::isDepthEnabled()
 {
-  return glIsEnabled( GL_DEPTH_TEST );
+  // only ask the driver if we never set it ourselves
+  if ( !m_state.depthTest )
+    m_state.depthTest = glIsEnabled( GL_DEPTH_TEST ) == GL_TRUE;
+
+  return *m_state.depthTest;
 }
 
 bool Renderer::isStencilEnabled()
 {
-  return glIsEnabled( GL_STENCIL_TEST );
+  if ( !m_state.stencilTest )
+    m_state.stencilTest = glIsEnabled( GL_STENCIL_TEST ) == GL_TRUE;
+
+  return *m_state.stencilTest;
 }
 
 void Renderer::enableDepth()
 {
-  if ( isDepthEnabled() )
-    return;
-
-  glEnable( GL_DEPTH_TEST );
+  setState( m_state.depthTest, true, [] { glEnable( GL_DEPTH_TEST ); } );
 }
 
 void Renderer::enableStencil()
 {
-  if ( isStencilEnabled() )
-    return;
+  setState( m_state.stencilTest, true, [] { glEnable( GL_STENCIL_TEST ); } );
+}
 
-  glEnable( GL_STENCIL_TEST );
+void Renderer::enableCullFace()
+{
+  setState( m_state.cullFace, true, [] { glEnable( GL_CULL_FACE ); } );
 }
 
-void Renderer::disableDepth()
+void Renderer::enableBlend()
 {
-  if ( !isDepthEnabled() )
-    return;
+  setState( m_state.blend, true, [] { glEnable( GL_BLEND ); } );
+}
 
-  glDisable( GL_DEPTH_TEST );
+void Renderer::enableScissor()
+{
+  setState( m_state.scissorTest, true, [] { glEnable( GL_SCISSOR_TEST ); } );
+}
+
+void Renderer::disableDepth()
+{
+  setState( m_state.depthTest, false, [] { glDisable( GL_DEPTH_TEST ); } );
 }
 
 void Renderer::disableStencil()
 {
-  if ( !isStencilEnabled() )
-    return;
+  setState( m_state.stencilTest, false, [] { glDisable( GL_STENCIL_TEST ); } );
+}
+
+void Renderer::disableCullFace()
+{
+  setState( m_state.cullFace, false, [] { glDisable( GL_CULL_FACE ); } );
+}
+
+void Renderer::disableBlend()
+{
+  setState( m_state.blend, false, [] { glDisable( GL_BLEND ); } );
+}
 
-  glDisable( GL_STENCIL_TEST );
+void Renderer::disableScissor()
+{
+  setState( m_state.scissorTest, false, [] { glDisable( GL_SCISSOR_TEST ); } );
 }
 
 void Renderer::enableColorMask()
 {
-  glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+  setState( m_state.colorMask, true, [] { glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE ); } );
 }
 
 void Renderer::disableColorMask()
 {
-  glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+  setState( m_state.colorMask, false, [] { glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE ); } );
+}
+
+void Renderer::useProgram( uint32_t program )
+{
+  setState( m_state.program, program, [program] { glUseProgram( program ); } );
+}
+
+void Renderer::bindVertexArray( uint32_t vertexArray )
+{
+  setState( m_state.vertexArray, vertexArray, [vertexArray] { glBindVertexArray( vertexArray ); } );
+}
+
+void Renderer::bindFramebuffer( uint32_t framebuffer )
+{
+  setState( m_state.framebuffer, framebuffer, [framebuffer] { glBindFramebuffer( GL_FRAMEBUFFER, framebuffer ); } );
+}
+
+void Renderer::bindTextureUnit( uint32_t unit, uint32_t texture )
+{
+  if ( unit >= RenderState::maxTextureUnits )
+  {
+    glBindTextureUnit( unit, texture );
+    ++m_frameStats.stateCallsIssued;
+    return;
+  }
+
+  setState( m_state.textureUnits.at( unit ), texture, [unit, texture] { glBindTextureUnit( unit, texture ); } );
+}
+
+void Renderer::setDepthFunc( uint32_t func )
+{
+  setState( m_state.depthFunc, func, [func] { glDepthFunc( func ); } );
+}
+
+void Renderer::setCullFace( uint32_t face )
+{
+  setState( m_state.cullFaceMode, face, [face] { glCullFace( face ); } );
+}
+
+void Renderer::setBlendFunc( uint32_t source, uint32_t destination )
+{
+  setState( m_state.blendFunc, std::array<uint32_t, 2>{ source, destination }, [source, destination] {
+    glBlendFunc( source, destination );
+  } );
+}
+
+void Renderer::setStencilFunc( uint32_t func, int ref, uint32_t mask )
+{
+  setState( m_state.stencilFunc, std::array<uint32_t, 3>{ func, static_cast<uint32_t>( ref ), mask }, [=] {
+    glStencilFunc( func, ref, mask );
+  } );
+}
+
+void Renderer::setStencilOp( uint32_t stencilFail, uint32_t depthFail, uint32_t depthPass )
+{
+  setState( m_state.stencilOp, std::array<uint32_t, 3>{ stencilFail, depthFail, depthPass }, [=] {
+    glStencilOp( stencilFail, depthFail, depthPass );
+  } );
+}
+
+void Renderer::setStencilMask( uint32_t mask )
+{
+  setState( m_state.stencilMask, mask, [mask] { glStencilMask( mask ); } );
+}
+
+void Renderer::setClearColor( const glm::vec4& color )
+{
+  setState( m_state.clearColor, color, [&color] { glClearColor( color.r, color.g, color.b, color.a ); } );
+}
+
+void Renderer::setViewport( int x, int y, int width, int height )
+{
+  setState( m_state.viewport, std::array<int, 4>{ x, y, width, height }, [=] { glViewport( x, y, width, height ); } );
+}
+
+void Renderer::setScissor( int x, int y, int width, int height )
+{
+  setState( m_state.scissor, std::array<int, 4>{ x, y, width, height }, [=] { glScissor( x, y, width, height ); } );
+}
+
+void Renderer::releaseTexture( uint32_t texture )
+{
+  for ( auto& unit : m_state.textureUnits )
+  {
+    if ( unit == texture )
+      unit = 0;
+  }
+}
+
+void Renderer::releaseVertexArray( uint32_t vertexArray )
+{
+  if ( m_state.vertexArray == vertexArray )
+    m_state.vertexArray = 0;
+}
+
+void Renderer::releaseFramebuffer( uint32_t framebuffer )
+{
+  if ( m_state.framebuffer == framebuffer )
+    m_state.framebuffer = 0;
+}
+
+void Renderer::invalidateState()
+{
+  m_state = RenderState{};
+}
+
+auto Renderer::getFrameStats() -> FrameStats&
+{
+  return m_frameStats;
+}
+
+auto Renderer::getLastFrameStats() -> const FrameStats&
+{
+  return m_lastFrameStats;
+}
+
+void Renderer::endFrame()
+{
+  m_lastFrameStats = m_frameStats;
+  m_frameStats = FrameStats{};
+  invalidateState();
 }
 
-} // namespace kogayonon_rendering
\ No newline at end of file
+} // namespace kogayonon_rendering
@@ -0,0 +1,351 @@
+#include "rendering/texture_pages.hpp"
+#include <algorithm>
+#include <bit>
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+#include "rendering/renderer.hpp"
+
+namespace kogayonon_rendering
+{
+TexturePages::~TexturePages()
+{
+  destroy();
+}
+
+namespace
+{
+// copies levels mips of a layer, the source starts at sourceLevel so a bigger texture can fill a smaller page
+void copyLevels( uint32_t source, uint32_t sourceTarget, int sourceLayer, int sourceLevel, uint32_t target,
+                 int targetLayer, int size, int levels )
+{
+  for ( auto level = 0; level < levels; level++ )
+  {
+    const auto levelSize = std::max( size >> level, 1 );
+    glCopyImageSubData( source,
+                        sourceTarget,
+                        sourceLevel + level,
+                        0,
+                        0,
+                        sourceLayer,
+                        target,
+                        GL_TEXTURE_2D_ARRAY,
+                        level,
+                        0,
+                        0,
+                        targetLayer,
+                        levelSize,
+                        levelSize,
+                        1 );
+  }
+}
+// copies every mip of count layers between two arrays of the same page
+void copyLayers( uint32_t source, int sourceLayer, uint32_t target, int targetLayer, int count, int size, int levels )
+{
+  for ( auto level = 0; level < levels; level++ )
+  {
+    const auto levelSize = std::max( size >> level, 1 );
+    glCopyImageSubData( source,
+                        GL_TEXTURE_2D_ARRAY,
+                        level,
+                        0,
+                        0,
+                        sourceLayer,
+                        target,
+                        GL_TEXTURE_2D_ARRAY,
+                        level,
+                        0,
+                        0,
+                        targetLayer,
+                        levelSize,
+                        levelSize,
+                        count );
+  }
+}
+
+auto getCompactCapacity( uint32_t usedLayers ) -> uint32_t
+{
+  return ( usedLayers + TexturePages::layerBlock - 1 ) / TexturePages::layerBlock * TexturePages::layerBlock;
+}
+} // namespace
+
+auto TexturePages::addTexture( uint32_t textureId, uint32_t maxSize ) -> std::optional<TexturePageSlot>
+{
+  // the texture object knows its size even if whoever loaded it did not keep it
+  int width = 0;
+  int height = 0;
+  int format = 0;
+  int compressed = 0;
+  glGetTextureLevelParameteriv( textureId, 0, GL_TEXTURE_WIDTH, &width );
+  glGetTextureLevelParameteriv( textureId, 0, GL_TEXTURE_HEIGHT, &height );
+  glGetTextureLevelParameteriv( textureId, 0, GL_TEXTURE_INTERNAL_FORMAT, &format );
+  glGetTextureLevelParameteriv( textureId, 0, GL_TEXTURE_COMPRESSED, &compressed );
+
+  const auto largest = static_cast<uint32_t>( std::max( { width, height, 1 } ) );
+  const auto sizeIndex = std::min( getSizeIndex( largest ), getSizeIndex( maxSize ) );
+  const auto size = static_cast<int>( pageSizes.at( sizeIndex ) );
+  const auto levels = static_cast<int>( std::bit_width( pageSizes.at( sizeIndex ) ) );
+
+  // blocks can not be blitted, they are copied as they are so one of the mips has to match the page exactly
+  const auto isBc7 = format == GL_COMPRESSED_RGBA_BPTC_UNORM;
+  const auto firstLevel = static_cast<int>( std::bit_width( largest ) ) - levels;
+  if ( compressed != 0 )
+  {
+    int sourceLevels = 0;
+    glGetTextureParameteriv( textureId, GL_TEXTURE_IMMUTABLE_LEVELS, &sourceLevels );
+    if ( !isBc7 || width != height || !std::has_single_bit( largest ) || firstLevel < 0 ||
+         sourceLevels < firstLevel + levels )
+    {
+      spdlog::warn( "Compressed texture {} ({}x{}) does not fit a texture page", textureId, width, height );
+      return std::nullopt;
+    }
+  }
+
+  const auto slot = allocate( isBc7 ? sizeCount + sizeIndex : sizeIndex );
+  const auto& page = m_pages.at( slot.page );
+
+  if ( isBc7 )
+  {
+    // the cook already made every mip
+    copyLevels( textureId, GL_TEXTURE_2D, 0, firstLevel, page.id, static_cast<int>( slot.layer ), size, levels );
+  }
+  else
+  {
+    // a blit does the scaling for us and works no matter how the source was created
+    uint32_t framebuffers[2]{};
+    glCreateFramebuffers( 2, framebuffers );
+    glNamedFramebufferTexture( framebuffers[0], GL_COLOR_ATTACHMENT0, textureId, 0 );
+    glNamedFramebufferTextureLayer( framebuffers[1], GL_COLOR_ATTACHMENT0, page.id, 0, static_cast<int>( slot.layer ) );
+    glBlitNamedFramebuffer(
+      framebuffers[0], framebuffers[1], 0, 0, width, height, 0, 0, size, size, GL_COLOR_BUFFER_BIT, GL_LINEAR );
+    glDeleteFramebuffers( 2, framebuffers );
+
+    // mipmapping the array would filter every layer again, a view of the new layer limits it to that one
+    uint32_t view = 0;
+    glGenTextures( 1, &view );
+    glTextureView( view, GL_TEXTURE_2D, page.id, GL_RGBA8, 0, levels, slot.layer, 1 );
+    glGenerateTextureMipmap( view );
+    glDeleteTextures( 1, &view );
+  }
+
+  return slot;
+}
+
+auto TexturePages::shrink( const TexturePageSlot& slot, uint32_t sizeIndex ) -> TexturePageSlot
+{
+  const auto family = slot.page / sizeCount;
+  const auto oldSizeIndex = slot.page % sizeCount;
+  if ( sizeIndex >= oldSizeIndex )
+    return slot;
+
+  const auto result = allocate( family * sizeCount + sizeIndex );
+
+  // the mips below the new top level are already there, nothing has to be filtered again
+  const auto size = static_cast<int>( pageSizes.at( sizeIndex ) );
+  const auto levels = static_cast<int>( std::bit_width( pageSizes.at( sizeIndex ) ) );
+  copyLevels( m_pages.at( slot.page ).id,
+              GL_TEXTURE_2D_ARRAY,
+              static_cast<int>( slot.layer ),
+              static_cast<int>( oldSizeIndex - sizeIndex ),
+              m_pages.at( result.page ).id,
+              static_cast<int>( result.layer ),
+              size,
+              levels );
+
+  free( slot );
+  return result;
+}
+
+void TexturePages::free( const TexturePageSlot& slot )
+{
+  m_pages.at( slot.page ).freeLayers.emplace_back( slot.layer );
+}
+
+auto TexturePages::trim( bool tight ) -> std::vector<TexturePageMove>
+{
+  std::vector<TexturePageMove> moves;
+  for ( auto i = 0u; i < pageCount; i++ )
+  {
+    auto& page = m_pages.at( i );
+    const auto used = getUsedLayers( page );
+    const auto capacity = getCompactCapacity( used );
+    if ( capacity >= page.layerCapacity || ( !tight && capacity * 2 > page.layerCapacity ) )
+      continue;
+
+    uint32_t id = 0;
+    if ( capacity != 0 )
+    {
+      const auto size = static_cast<int>( pageSizes.at( i % sizeCount ) );
+      const auto levels = static_cast<int>( std::bit_width( pageSizes.at( i % sizeCount ) ) );
+      id = createArray( i, capacity );
+
+      std::vector<bool> isFree( page.layerCount, false );
+      for ( const auto layer : page.freeLayers )
+        isFree.at( layer ) = true;
+
+      auto next = 0u;
+      for ( auto layer = 0u; layer < page.layerCount; layer++ )
+      {
+        if ( isFree.at( layer ) )
+          continue;
+
+        copyLayers( page.id, static_cast<int>( layer ), id, static_cast<int>( next ), 1, size, levels );
+        if ( layer != next )
+          moves.emplace_back(
+            TexturePageMove{ .from = { .page = i, .layer = layer }, .to = { .page = i, .layer = next } } );
+        next++;
+      }
+    }
+
+    Renderer::releaseTexture( page.id );
+    glDeleteTextures( 1, &page.id );
+
+    page.id = id;
+    page.layerCount = used;
+    page.layerCapacity = capacity;
+    page.freeLayers.clear();
+  }
+  return moves;
+}
+
+auto TexturePages::createView( const TexturePageSlot& slot ) const -> uint32_t
+{
+  const auto& page = m_pages.at( slot.page );
+  const auto levels = std::bit_width( pageSizes.at( slot.page % sizeCount ) );
+  const auto format = slot.page < sizeCount ? GL_RGBA8 : GL_COMPRESSED_RGBA_BPTC_UNORM;
+
+  // views need a name that was never bound, glCreateTextures would give it a target already
+  uint32_t view = 0;
+  glGenTextures( 1, &view );
+  glTextureView( view, GL_TEXTURE_2D, page.id, format, 0, levels, slot.layer, 1 );
+  return view;
+}
+
+void TexturePages::bind( uint32_t firstUnit ) const
+{
+  for ( auto i = 0u; i < pageCount; i++ )
+  {
+    if ( m_pages.at( i ).id != 0 )
+      Renderer::bindTextureUnit( firstUnit + i, m_pages.at( i ).id );
+  }
+}
+
+auto TexturePages::getSizeIndex( uint32_t size ) -> uint32_t
+{
+  for ( auto i = 0u; i < sizeCount; i++ )
+  {
+    if ( pageSizes.at( i ) >= size )
+      return i;
+  }
+  return sizeCount - 1;
+}
+
+auto TexturePages::getLayerBytes( uint32_t pageIndex ) -> std::size_t
+{
+  // a full mip chain adds a third, BC7 is a byte per texel and RGBA8 four
+  const auto size = static_cast<std::size_t>( pageSizes.at( pageIndex % sizeCount ) );
+  const auto texelBytes = pageIndex < sizeCount ? std::size_t{ 4 } : std::size_t{ 1 };
+  return size * size * texelBytes * 4 / 3;
+}
+
+auto TexturePages::getUsedBytes() const -> std::size_t
+{
+  std::size_t bytes = 0;
+  for ( auto i = 0u; i < pageCount; i++ )
+  {
+    const auto& page = m_pages.at( i );
+    bytes += ( page.layerCount - page.freeLayers.size() ) * getLayerBytes( i );
+  }
+  return bytes;
+}
+
+auto TexturePages::getAllocatedBytes() const -> std::size_t
+{
+  std::size_t bytes = 0;
+  for ( auto i = 0u; i < pageCount; i++ )
+    bytes += m_pages.at( i ).layerCapacity * getLayerBytes( i );
+  return bytes;
+}
+
+auto TexturePages::getCompactBytes() const -> std::size_t
+{
+  std::size_t bytes = 0;
+  for ( auto i = 0u; i < pageCount; i++ )
+    bytes += getCompactCapacity( getUsedLayers( m_pages.at( i ) ) ) * getLayerBytes( i );
+  return bytes;
+}
+
+auto TexturePages::getGrowBytes( uint32_t pageIndex ) const -> std::size_t
+{
+  const auto& page = m_pages.at( pageIndex );
+  if ( !page.freeLayers.empty() || page.layerCount < page.layerCapacity )
+    return 0;
+
+  return std::max( page.layerCapacity * 2, layerBlock ) * getLayerBytes( pageIndex );
+}
+
+auto TexturePages::allocate( uint32_t pageIndex ) -> TexturePageSlot
+{
+  auto& page = m_pages.at( pageIndex );
+  if ( !page.freeLayers.empty() )
+  {
+    const auto layer = page.freeLayers.back();
+    page.freeLayers.pop_back();
+    return TexturePageSlot{ .page = pageIndex, .layer = layer };
+  }
+
+  if ( page.layerCount == page.layerCapacity )
+    grow( pageIndex );
+
+  return TexturePageSlot{ .page = pageIndex, .layer = page.layerCount++ };
+}
+
+void TexturePages::grow( uint32_t pageIndex )
+{
+  auto& page = m_pages.at( pageIndex );
+  const auto size = static_cast<int>( pageSizes.at( pageIndex % sizeCount ) );
+  const auto levels = static_cast<int>( std::bit_width( pageSizes.at( pageIndex % sizeCount ) ) );
+  const auto capacity = std::max( page.layerCapacity * 2, layerBlock );
+  const auto id = createArray( pageIndex, capacity );
+
+  // every mip of the layers we already have
+  if ( page.id != 0 )
+  {
+    if ( page.layerCount != 0 )
+      copyLayers( page.id, 0, id, 0, static_cast<int>( page.layerCount ), size, levels );
+    Renderer::releaseTexture( page.id );
+    glDeleteTextures( 1, &page.id );
+  }
+
+  page.id = id;
+  page.layerCapacity = capacity;
+}
+
+auto TexturePages::createArray( uint32_t pageIndex, uint32_t capacity ) -> uint32_t
+{
+  const auto size = static_cast<int>( pageSizes.at( pageIndex % sizeCount ) );
+  const auto levels = static_cast<int>( std::bit_width( pageSizes.at( pageIndex % sizeCount ) ) );
+  const auto format = pageIndex < sizeCount ? GL_RGBA8 : GL_COMPRESSED_RGBA_BPTC_UNORM;
+
+  uint32_t id = 0;
+  glCreateTextures( GL_TEXTURE_2D_ARRAY, 1, &id );
+  glTextureStorage3D( id, levels, format, size, size, static_cast<int>( capacity ) );
+  glTextureParameteri( id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+  glTextureParameteri( id, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+  glTextureParameteri( id, GL_TEXTURE_WRAP_S, GL_REPEAT );
+  glTextureParameteri( id, GL_TEXTURE_WRAP_T, GL_REPEAT );
+  return id;
+}
+
+void TexturePages::destroy()
+{
+  for ( auto& page : m_pages )
+  {
+    if ( page.id != 0 )
+    {
+      Renderer::releaseTexture( page.id );
+      glDeleteTextures( 1, &page.id );
+    }
+    page = Page{};
+  }
+}
+} // namespace kogayonon_rendering
@@ -0,0 +1,67 @@
+#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace kogayonon_resources
+{
+struct AABB
+{
+  glm::vec3 min{ FLT_MAX };
+  glm::vec3 max{ -FLT_MAX };
+
+  inline auto isValid() const -> bool
+  {
+    return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+  }
+
+  inline auto getCenter() const -> glm::vec3
+  {
+    return ( min + max ) * 0.5f;
+  }
+
+  inline void expand( const glm::vec3& point )
+  {
+    min = glm::min( min, point );
+    max = glm::max( max, point );
+  }
+
+  inline void expand( const AABB& other )
+  {
+    if ( !other.isValid() )
+      return;
+
+    min = glm::min( min, other.min );
+    max = glm::max( max, other.max );
+  }
+};
+
+struct BoundingSphere
+{
+  glm::vec3 center{ 0.0f };
+  float radius{ 0.0f };
+};
+
+/**
+ * @brief Sphere centered on the box that encloses every point, tighter than the sphere around the box corners
+ * @param box Bounds of the points
+ * @param points The points the box was built from
+ */
+inline auto computeBoundingSphere( const AABB& box, const std::vector<glm::vec3>& points ) -> BoundingSphere
+{
+  if ( !box.isValid() )
+    return BoundingSphere{};
+
+  BoundingSphere sphere{ .center = box.getCenter() };
+  float radiusSquared = 0.0f;
+  for ( const auto& point : points )
+  {
+    const auto delta = point - sphere.center;
+    radiusSquared = std::max( radiusSquared, glm::dot( delta, delta ) );
+  }
+  sphere.radius = std::sqrt( radiusSquared );
+  return sphere;
+}
+} // namespace kogayonon_resources
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include <glm/glm.hpp>
+
+namespace kogayonon_resources
+{
+/**
+ * @brief Material of a glTF primitive, the textures are indices into the texture vector of the mesh since those
+ * pointers get swapped once the textures are loaded on the main thread
+ */
+struct Material
+{
+  int32_t baseColorTexture{ -1 };
+  int32_t normalTexture{ -1 };
+  glm::vec4 baseColorFactor{ 1.0f };
+};
+} // namespace kogayonon_resources
@@ -1,17 +1,60 @@
 #pragma once
+#include <algorithm>
+#include <array>
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
+#include "resources/bounds.hpp"
+#include "resources/material.hpp"
 #include "resources/texture.hpp"
 #include "resources/vertex.hpp"
 
 namespace kogayonon_resources
 {
+// the full index list plus up to three simplified ones
+static constexpr uint32_t maxMeshLods = 4;
+
+/**
+ * @brief Index range of a simplified level, it indexes the same vertices as the full submesh
+ */
+struct SubmeshLod
+{
+  uint32_t indexOffset{ 0 };
+  uint32_t indexCount{ 0 };
+
+  // how far the simplified surface is from the full one, in mesh space units
+  float error{ 0.0f };
+};
+
 struct Submesh
 {
   uint32_t vertexOffest{ 0 };
   uint32_t indexOffset{ 0 };
   uint32_t indexCount{ 0 };
+
+  // object space bounds, computed when the mesh is imported
+  AABB bounds;
+  BoundingSphere sphere;
+
+  // index into the materials of the mesh
+  uint32_t materialIndex{ 0 };
+
+  // levels 1 and up, level 0 is the range above
+  std::array<SubmeshLod, maxMeshLods - 1> lods{};
+  uint32_t lodCount{ 1 };
+
+  /**
+   * @brief Index range of a level, asking for a level the submesh does not have gives its coarsest one
+   */
+  inline auto getLod( uint32_t level ) const -> SubmeshLod
+  {
+    level = std::min( level, lodCount - 1 );
+    if ( level == 0 )
+      return SubmeshLod{ .indexOffset = indexOffset, .indexCount = indexCount };
+
+    return lods[level - 1];
+  }
 };
 
 class Mesh
@@ -32,16 +75,71 @@ public:
   explicit Mesh( const std::string& path, const std::vector<Vertex>&& vertices, const std::vector<uint32_t>&& indices,
                  const std::vector<Submesh>&& submeshes );
 
+  /**
+   * @brief A mesh whose geometry lives in memory it does not own, a cooked file mapping for example
+   * @param pStorage Keeps the memory alive for as long as the mesh is
+   */
+  explicit Mesh( const std::string& path, std::shared_ptr<const void> pStorage, std::span<const Vertex> vertices,
+                 std::span<const uint32_t> indices, std::vector<Texture*>&& textures,
+                 std::vector<Submesh>&& submeshes );
+
+  /**
+   * @brief Owned geometry, empty when the mesh reads it from external storage, upload from getVertexData instead
+   */
   auto getVertices() -> std::vector<Vertex>&;
   auto getIndices() -> std::vector<uint32_t>&;
+
+  /**
+   * @brief The geometry wherever it lives
+   */
+  auto getVertexData() const -> std::span<const Vertex>;
+  auto getIndexData() const -> std::span<const uint32_t>;
   auto getTextures() -> std::vector<Texture*>&;
   auto getSubmeshes() -> std::vector<Submesh>&;
+  auto getMaterials() -> std::vector<Material>&;
+
+  void setMaterials( std::vector<Material>&& materials );
 
   auto getPath() -> std::string&
   {
     return m_path;
   }
 
+  /**
+   * @brief Never handed out twice while the program runs, unlike the address of a mesh that got freed
+   */
+  inline auto getId() const -> uint64_t
+  {
+    return m_id;
+  }
+
+  /**
+   * @brief Object space bounds of the whole mesh
+   */
+  auto getBounds() const -> const AABB&;
+  auto getBoundingSphere() const -> const BoundingSphere&;
+
+  /**
+   * @brief Merges the bounds and the lod errors of every submesh into the mesh, call after the submeshes are filled
+   */
+  void computeBounds();
+
+  /**
+   * @brief Levels the submesh with the most of them has
+   */
+  inline auto getLodCount() const -> uint32_t
+  {
+    return m_lodCount;
+  }
+
+  /**
+   * @brief Largest error any submesh has at a level, in mesh space units
+   */
+  inline auto getLodError( uint32_t level ) const -> float
+  {
+    return m_lodErrors[std::min( level, m_lodCount - 1 )];
+  }
+
   auto getVao() -> uint32_t&;
   auto getVbo() -> uint32_t&;
   auto getEbo() -> uint32_t&;
@@ -51,11 +149,27 @@ private:
   std::vector<Vertex> m_vertices;
   std::vector<uint32_t> m_indices;
   std::vector<Submesh> m_submeshes;
+  std::vector<Material> m_materials;
+
+  // set when the geometry is not in the vectors above
+  std::shared_ptr<const void> m_pStorage;
+  std::span<const Vertex> m_vertexData;
+  std::span<const uint32_t> m_indexData;
+
+  AABB m_bounds;
+  BoundingSphere m_sphere;
+
+  std::array<float, maxMeshLods> m_lodErrors{};
+  uint32_t m_lodCount{ 1 };
 
   uint32_t m_vao;
   uint32_t m_vbo;
   uint32_t m_ebo;
 
   std::string m_path;
+
+  uint64_t m_id{ makeId() };
+
+  static auto makeId() -> uint64_t;
 };
 } // namespace kogayonon_resources
\ No newline at end of file
@@ -25,6 +25,14 @@ public:
   void setLoaded( bool value );
   void setTextureId( unsigned int id );
 
+  /**
+   * @brief Systems that keep a raw pointer to the texture past a frame count themselves in, the asset manager does
+   * not delete it while any are left
+   */
+  void addUser();
+  void removeUser();
+  int getUserCount() const;
+
 private:
   uint32_t m_id{ 0 };
   std::string m_path;
@@ -33,5 +41,6 @@ private:
   int m_height{ 0 };
   int m_numComponents{ 0 };
   bool m_loaded{ false };
+  int m_users{ 0 };
 };
 } // namespace kogayonon_resources
\ No newline at end of file
@@ -1,8 +1,15 @@
 #include "resources/mesh.hpp"
+#include <atomic>
 #include "resources/vertex.hpp"
 
 namespace kogayonon_resources
 {
+auto Mesh::makeId() -> uint64_t
+{
+  // meshes get imported on the workers
+  static std::atomic<uint64_t> next{ 1 };
+  return next.fetch_add( 1, std::memory_order_relaxed );
+}
 
 Mesh::Mesh( const std::string& path, const std::vector<Vertex>&& vertices, const std::vector<uint32_t>&& indices,
             const std::vector<Texture*>&& textures, const std::vector<Submesh>&& submeshes )
@@ -29,6 +36,20 @@ Mesh::Mesh( const std::string& path, const std::vector<Vertex>&& vertices, const
 {
 }
 
+Mesh::Mesh( const std::string& path, std::shared_ptr<const void> pStorage, std::span<const Vertex> vertices,
+            std::span<const uint32_t> indices, std::vector<Texture*>&& textures, std::vector<Submesh>&& submeshes )
+    : m_path{ path }
+    , m_textures{ std::move( textures ) }
+    , m_submeshes{ std::move( submeshes ) }
+    , m_pStorage{ std::move( pStorage ) }
+    , m_vertexData{ vertices }
+    , m_indexData{ indices }
+    , m_vao{ 0 }
+    , m_vbo{ 0 }
+    , m_ebo{ 0 }
+{
+}
+
 auto Mesh::getVertices() -> std::vector<Vertex>&
 {
   return m_vertices;
@@ -39,6 +60,22 @@ auto Mesh::getIndices() -> std::vector<uint32_t>&
   return m_indices;
 }
 
+auto Mesh::getVertexData() const -> std::span<const Vertex>
+{
+  if ( m_pStorage )
+    return m_vertexData;
+
+  return m_vertices;
+}
+
+auto Mesh::getIndexData() const -> std::span<const uint32_t>
+{
+  if ( m_pStorage )
+    return m_indexData;
+
+  return m_indices;
+}
+
 auto Mesh::getTextures() -> std::vector<Texture*>&
 {
   return m_textures;
@@ -64,4 +101,55 @@ auto Mesh::getSubmeshes() -> std::vector<Submesh>&
   return m_submeshes;
 }
 
+auto Mesh::getMaterials() -> std::vector<Material>&
+{
+  return m_materials;
+}
+
+void Mesh::setMaterials( std::vector<Material>&& materials )
+{
+  m_materials = std::move( materials );
+}
+
+auto Mesh::getBounds() const -> const AABB&
+{
+  return m_bounds;
+}
+
+auto Mesh::getBoundingSphere() const -> const BoundingSphere&
+{
+  return m_sphere;
+}
+
+void Mesh::computeBounds()
+{
+  m_lodErrors.fill( 0.0f );
+  m_lodCount = 1;
+  for ( const auto& submesh : m_submeshes )
+  {
+    m_lodCount = std::max( m_lodCount, submesh.lodCount );
+    for ( uint32_t level = 1; level < maxMeshLods; level++ )
+      m_lodErrors[level] = std::max( m_lodErrors[level], submesh.getLod( level ).error );
+  }
+
+  m_bounds = AABB{};
+  for ( const auto& submesh : m_submeshes )
+    m_bounds.expand( submesh.bounds );
+
+  if ( !m_bounds.isValid() )
+  {
+    m_sphere = BoundingSphere{};
+    return;
+  }
+
+  // the mesh sphere must contain every submesh sphere
+  m_sphere.center = m_bounds.getCenter();
+  m_sphere.radius = 0.0f;
+  for ( const auto& submesh : m_submeshes )
+  {
+    const auto distance = glm::length( submesh.sphere.center - m_sphere.center ) + submesh.sphere.radius;
+    m_sphere.radius = std::max( m_sphere.radius, distance );
+  }
+}
+
 } // namespace kogayonon_resources
\ No newline at end of file
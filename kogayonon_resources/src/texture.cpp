@@ -86,4 +86,19 @@ void Texture::setLoaded( bool value )
   m_loaded = value;
 }
 
+void Texture::addUser()
+{
+  m_users++;
+}
+
+void Texture::removeUser()
+{
+  m_users--;
+}
+
+int Texture::getUserCount() const
+{
+  return m_users;
+}
+
 } // namespace kogayonon_resources
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <filesystem>
+#include <future>
 #include <glm/glm.hpp>
 #include <mutex>
 #include <string>
@@ -7,10 +8,12 @@
 #include <unordered_map>
 #include "resources/mesh.hpp"
 #include "resources/texture.hpp"
+#include "utilities/texture_streamer/texture_streamer.hpp"
 
 struct cgltf_primitive;
 struct cgltf_accessor;
 struct cgltf_material;
+struct cgltf_texture_view;
 
 namespace kogayonon_utilities
 {
@@ -47,16 +50,42 @@ public:
   /**
    * @brief Deletes a texture from the loaded map, even though we index with texture name which is not actual filename,
    * we will loop through the map with an iterator it and look if the path == it->second->getPath() since we store the
-   * path in the texture object
+   * path in the texture object. The gl texture goes with it, textures a loaded mesh still uses, the streamer is loading
+   * or another system holds are left alone
    * @param path Path of the texture file
    */
   void removeTexture( const std::string& path );
 
   auto getTextureById( uint32_t id ) -> std::weak_ptr<kogayonon_resources::Texture>;
 
+  /**
+   * @brief Decodes the mesh textures on the workers and uploads them over a few frames, addTexture stays synchronous
+   * for the editor icons
+   */
+  inline auto getTextureStreamer() -> TextureStreamer&
+  {
+    return m_textureStreamer;
+  }
+
   // meshes
-  auto addMesh( const std::string& meshName, const std::string& meshPath ) -> kogayonon_resources::Mesh*;
+  /**
+   * @brief Loads a mesh once and keeps it, safe to call from several threads. Different files import side by side,
+   * a thread asking for a file another one is importing waits for that import instead of starting its own
+   * @param pTaskManager Decodes the primitives of a glTF in parallel when given
+   */
+  auto addMesh( const std::string& meshName, const std::string& meshPath, TaskManager* pTaskManager = nullptr )
+    -> kogayonon_resources::Mesh*;
   auto addMesh( const std::string& meshName ) -> kogayonon_resources::Mesh*;
+
+  /**
+   * @brief Loads a mesh without keeping it in the asset manager, addMesh calls it without holding the asset lock
+   * @param meshPath Path of the glTF
+   * @param useCooked Loads the .kmesh next to the glTF when it is up to date and cooks it when it is not, otherwise the
+   * glTF is always parsed and nothing is written
+   * @param pTaskManager Workers the primitives get decoded on, nullptr decodes them one after the other
+   */
+  auto importMesh( const std::string& meshPath, bool useCooked, TaskManager* pTaskManager = nullptr )
+    -> std::shared_ptr<kogayonon_resources::Mesh>;
   auto getMesh( const std::string& meshPath ) -> kogayonon_resources::Mesh*;
 
   /**
@@ -78,17 +107,77 @@ private:
   AssetManager( AssetManager&& ) = delete;
   AssetManager& operator=( AssetManager&& ) = delete;
 
+  /**
+   * @brief A primitive on its own, its offsets count from the start of its own vertices and indices. The indices of
+   * its levels of detail come after the full ones
+   */
+  struct DecodedPrimitive
+  {
+    std::vector<kogayonon_resources::Vertex> vertices;
+    std::vector<uint32_t> indices;
+    kogayonon_resources::Submesh submesh;
+  };
+
+  /**
+   * @brief Parses a glTF with cgltf, transforms every primitive into mesh space and generates its levels of detail.
+   * Materials are resolved while walking the nodes, the primitives are decoded on the workers and merged in order
+   */
+  auto parseMesh( const std::string& meshPath, TaskManager* pTaskManager )
+    -> std::shared_ptr<kogayonon_resources::Mesh>;
+
+  /**
+   * @brief Reads the attributes and indices of a primitive and simplifies it, only reads the glTF so it can run on any
+   * thread
+   */
+  auto decodePrimitive( cgltf_primitive& primitive, const glm::mat4& transform, uint32_t materialIndex ) const
+    -> DecodedPrimitive;
+
   void parseVertices( cgltf_primitive& primitive, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals,
                       std::vector<glm::vec2>& tex_coords, const glm::mat4& transformation ) const;
 
   void parseIndices( cgltf_accessor* accessor, std::vector<uint32_t>& indices ) const;
 
-  void parseTextures( const cgltf_material* material, std::vector<kogayonon_resources::Texture*>& textures );
+  /**
+   * @brief Simplifies a primitive into the coarser levels of its submesh, their indices go after the mesh indices
+   * @param positions Mesh space positions of the primitive
+   * @param localIndices Full index list of the primitive
+   * @param indices Indices of the mesh we are building
+   * @param submesh Submesh of the primitive, its lods get filled
+   */
+  void generateLods( const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& localIndices,
+                     std::vector<uint32_t>& indices, kogayonon_resources::Submesh& submesh ) const;
+
+  /**
+   * @brief Turns a glTF material into a mesh material, the textures it uses are appended to the mesh textures once
+   * @param material The glTF material
+   * @param textures Textures of the mesh we are building
+   */
+  auto parseMaterial( const cgltf_material* material, std::vector<kogayonon_resources::Texture*>& textures )
+    -> kogayonon_resources::Material;
+
+  /**
+   * @brief Finds or creates the texture of a texture view and returns its index inside textures, -1 if there is none
+   */
+  auto parseTexture( const cgltf_texture_view& view, std::vector<kogayonon_resources::Texture*>& textures )
+    -> int32_t;
+
+  /**
+   * @brief Finds or creates the texture at a path and returns its index inside textures, the pixels load later. Takes
+   * the asset lock since imports of other meshes add textures at the same time
+   */
+  auto addMeshTexture( const std::filesystem::path& texturePath, std::vector<kogayonon_resources::Texture*>& textures )
+    -> int32_t;
 
   std::thread m_watchThread{};
+  // guards the maps below, readers too since workers insert while the editor looks things up
   std::mutex m_assetMutex{};
 
   std::unordered_map<std::string, std::shared_ptr<kogayonon_resources::Texture>> m_loadedTextures;
   std::unordered_map<std::string, std::shared_ptr<kogayonon_resources::Mesh>> m_loadedMeshes;
+
+  // imports that started but did not land in m_loadedMeshes yet, whoever asks for the same path waits on them
+  std::unordered_map<std::string, std::shared_future<std::shared_ptr<kogayonon_resources::Mesh>>> m_meshesInFlight;
+
+  TextureStreamer m_textureStreamer;
 };
 } // namespace kogayonon_utilities
\ No newline at end of file
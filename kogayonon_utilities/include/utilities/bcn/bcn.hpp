@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kogayonon_utilities
+{
+/**
+ * @brief Block compressed formats the cook writes, every block covers 4x4 texels
+ */
+enum class BlockFormat : uint8_t
+{
+  // two channels as two BC4 blocks, for normal maps
+  BC5,
+
+  // rgba at 8 bits per texel, only mode 6 is written
+  BC7
+};
+
+inline constexpr auto getBlockBytes( [[maybe_unused]] BlockFormat format ) -> std::size_t
+{
+  // both formats happen to use 128 bit blocks, BC1 and BC4 would be 64
+  return 16;
+}
+
+/**
+ * @brief Bytes of one mip level, levels smaller than a block still take a whole block
+ */
+inline constexpr auto getCompressedSize( BlockFormat format, int width, int height ) -> std::size_t
+{
+  const auto blocksX = static_cast<std::size_t>( ( width + 3 ) / 4 );
+  const auto blocksY = static_cast<std::size_t>( ( height + 3 ) / 4 );
+  return blocksX * blocksY * getBlockBytes( format );
+}
+
+/**
+ * @brief Encodes one block
+ * @param format What to encode to
+ * @param pTexels 16 rgba texels, row by row
+ * @param pOut getBlockBytes( format ) bytes
+ */
+void encodeBlock( BlockFormat format, const uint8_t* pTexels, uint8_t* pOut );
+
+/**
+ * @brief Encodes a whole rgba8 image, edge blocks repeat the last row and column
+ * @param pPixels width * height * 4 bytes
+ * @param out Gets getCompressedSize( format, width, height ) bytes appended
+ */
+void compressImage( BlockFormat format, const uint8_t* pPixels, int width, int height, std::vector<uint8_t>& out );
+} // namespace kogayonon_utilities
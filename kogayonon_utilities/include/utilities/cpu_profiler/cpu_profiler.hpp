@@ -0,0 +1,189 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace kogayonon_utilities
+{
+/**
+ * @brief Where a zone is in the code, every KOGAYONON_PROFILE_ZONE owns a static one so its address is the id of the
+ * zone and nothing has to be hashed or copied when it runs
+ */
+struct ProfileZone
+{
+  const char* name;
+  const char* file;
+  uint32_t line;
+};
+
+struct ZoneSample
+{
+  const ProfileZone* zone;
+
+  // steady clock nanoseconds
+  uint64_t start;
+  uint64_t end;
+};
+
+/**
+ * @brief Samples of one thread, only that thread writes and only the thread that drains reads so neither side locks.
+ * When the reader falls more than capacity samples behind the oldest ones are lost
+ */
+class ZoneRing
+{
+public:
+  static constexpr uint32_t capacity = 1u << 14;
+
+  explicit ZoneRing( uint32_t threadIndex );
+
+  inline void push( const ZoneSample& sample ) noexcept
+  {
+    const auto write = m_write.load( std::memory_order_relaxed );
+    m_samples[write & ( capacity - 1 )] = sample;
+    m_write.store( write + 1, std::memory_order_release );
+  }
+
+  /**
+   * @brief Hands every sample written since the last drain to func, oldest first
+   */
+  template <typename Func>
+  void drain( Func&& func )
+  {
+    const auto write = m_write.load( std::memory_order_acquire );
+    if ( write - m_read > capacity )
+    {
+      m_dropped += write - m_read - capacity;
+      m_read = write - capacity;
+    }
+
+    for ( ; m_read < write; m_read++ )
+    {
+      const auto sample = m_samples[m_read & ( capacity - 1 )];
+
+      // the writer lapped us while we copied it, the sample might be torn
+      if ( m_write.load( std::memory_order_acquire ) - m_read > capacity )
+      {
+        ++m_dropped;
+        continue;
+      }
+
+      func( sample, m_threadIndex );
+    }
+  }
+
+  inline auto getDropped() const -> uint64_t
+  {
+    return m_dropped;
+  }
+
+private:
+  std::array<ZoneSample, capacity> m_samples{};
+  std::atomic<uint64_t> m_write{ 0 };
+
+  // reader side only
+  uint64_t m_read{ 0 };
+  uint64_t m_dropped{ 0 };
+  uint32_t m_threadIndex;
+};
+
+/**
+ * @brief Collects the zones of every thread. A thread allocates its ring the first time it records a zone, after that
+ * recording is two clock reads and a store into the ring
+ */
+class CpuProfiler
+{
+public:
+  static inline auto now() noexcept -> uint64_t
+  {
+    return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() )
+        .count() );
+  }
+
+  static void record( const ProfileZone* zone, uint64_t start, uint64_t end ) noexcept;
+
+  /**
+   * @brief Zone for a name only known at runtime, the first call for a name allocates and later ones only look it up
+   */
+  static auto internZone( std::string_view name ) -> const ProfileZone*;
+
+  /**
+   * @brief Hands the new samples of every thread to func( sample, threadIndex ), only one thread may drain
+   */
+  template <typename Func>
+  static void drain( Func&& func )
+  {
+    std::lock_guard lock{ m_ringMutex };
+    for ( auto& pRing : m_rings )
+      pRing->drain( func );
+  }
+
+private:
+  CpuProfiler() = delete;
+  ~CpuProfiler() = delete;
+
+  static auto getThreadRing() -> ZoneRing&;
+
+  // only taken when a thread records its first zone, when draining and when interning
+  static inline std::mutex m_ringMutex{};
+  static inline std::vector<std::unique_ptr<ZoneRing>> m_rings{};
+
+  struct InternedZone
+  {
+    std::string name;
+    ProfileZone zone;
+  };
+
+  static inline std::mutex m_zoneMutex{};
+  static inline std::vector<std::unique_ptr<InternedZone>> m_internedZones{};
+  static inline std::unordered_map<std::string_view, const ProfileZone*> m_zoneLookup{};
+};
+
+/**
+ * @brief Records the zone from its construction to its destruction
+ */
+class ZoneScope
+{
+public:
+  explicit ZoneScope( const ProfileZone* zone ) noexcept
+      : m_zone{ zone }
+      , m_start{ CpuProfiler::now() }
+  {
+  }
+
+  ~ZoneScope()
+  {
+    CpuProfiler::record( m_zone, m_start, CpuProfiler::now() );
+  }
+
+  ZoneScope( const ZoneScope& ) = delete;
+  ZoneScope& operator=( const ZoneScope& ) = delete;
+
+private:
+  const ProfileZone* m_zone;
+  uint64_t m_start;
+};
+} // namespace kogayonon_utilities
+
+#define KOGAYONON_PROFILE_CONCAT_( a, b ) a##b
+#define KOGAYONON_PROFILE_CONCAT( a, b ) KOGAYONON_PROFILE_CONCAT_( a, b )
+
+// zones only exist in debug builds or when KOGAYONON_PROFILING is enabled, otherwise they compile to nothing
+#ifdef KOGAYONON_PROFILING
+#define KOGAYONON_PROFILE_ZONE( name )                                                                                 \
+  static constexpr kogayonon_utilities::ProfileZone KOGAYONON_PROFILE_CONCAT( kogayonon_zone_, __LINE__ ){             \
+    name, __FILE__, __LINE__ };                                                                                        \
+  const kogayonon_utilities::ZoneScope KOGAYONON_PROFILE_CONCAT( kogayonon_zone_scope_, __LINE__ )                     \
+  {                                                                                                                    \
+    &KOGAYONON_PROFILE_CONCAT( kogayonon_zone_, __LINE__ )                                                             \
+  }
+#else
+#define KOGAYONON_PROFILE_ZONE( name ) ( (void)0 )
+#endif
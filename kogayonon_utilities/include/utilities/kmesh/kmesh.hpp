@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include "resources/material.hpp"
+#include "resources/mesh.hpp"
+#include "resources/vertex.hpp"
+#include "utilities/mapped_file/mapped_file.hpp"
+
+namespace kogayonon_utilities
+{
+// "KMSH" read as a little endian uint32
+static constexpr uint32_t kmeshMagic = 0x48534d4b;
+
+// bump it whenever the layout or what the importer bakes into the file changes, older files get cooked again
+static constexpr uint32_t kmeshVersion = 1;
+
+/**
+ * @brief Start of a .kmesh file. Vertices, indices, submeshes and materials are stored the way they sit in memory so
+ * loading them is pointing into the mapping, the strides catch a file written by a build with different structs
+ */
+struct KMeshHeader
+{
+  uint32_t magic{ kmeshMagic };
+  uint32_t version{ kmeshVersion };
+
+  // hash of the glTF the file was cooked from
+  uint64_t sourceHash{ 0 };
+
+  uint32_t vertexStride{ sizeof( kogayonon_resources::Vertex ) };
+  uint32_t submeshStride{ sizeof( kogayonon_resources::Submesh ) };
+  uint32_t materialStride{ sizeof( kogayonon_resources::Material ) };
+
+  uint32_t vertexCount{ 0 };
+  uint32_t indexCount{ 0 };
+  uint32_t submeshCount{ 0 };
+  uint32_t materialCount{ 0 };
+  uint32_t textureCount{ 0 };
+
+  // byte offsets from the start of the file, every section starts 16 byte aligned
+  uint64_t vertexOffset{ 0 };
+  uint64_t indexOffset{ 0 };
+  uint64_t submeshOffset{ 0 };
+  uint64_t materialOffset{ 0 };
+  uint64_t textureOffset{ 0 };
+  uint64_t fileSize{ 0 };
+};
+
+/**
+ * @brief A cooked mesh as it comes out of the file, the vertices and indices point into the mapping so it has to stay
+ * alive for as long as they are used
+ */
+struct CookedMesh
+{
+  std::shared_ptr<MappedFile> pFile;
+  std::span<const kogayonon_resources::Vertex> vertices;
+  std::span<const uint32_t> indices;
+  std::vector<kogayonon_resources::Submesh> submeshes;
+  std::vector<kogayonon_resources::Material> materials;
+
+  // paths relative to the resources folder, in the order the materials index them
+  std::vector<std::string> textures;
+};
+
+/**
+ * @brief Where the cooked file of a glTF lives, right next to it
+ */
+auto getCookedMeshPath( const std::filesystem::path& source ) -> std::filesystem::path;
+
+/**
+ * @brief Hash of the glTF file contents. External buffers only add their size and write time so checking the cache does
+ * not read the whole geometry
+ */
+auto hashMeshSource( const std::filesystem::path& source ) -> uint64_t;
+
+/**
+ * @brief Maps a cooked file and checks it against the source
+ * @param path The .kmesh file
+ * @param sourceHash What hashMeshSource gives for the glTF now
+ * @param mesh Output, only valid when it returns true
+ * @return False if the file is missing, stale, from another version or broken
+ */
+auto readCookedMesh( const std::filesystem::path& path, uint64_t sourceHash, CookedMesh& mesh ) -> bool;
+
+/**
+ * @brief Writes a cooked file, it goes to a temporary file first and gets renamed so a crash never leaves half a file
+ * @param textures Texture paths relative to the resources folder
+ */
+auto writeCookedMesh( const std::filesystem::path& path, uint64_t sourceHash,
+                      std::span<const kogayonon_resources::Vertex> vertices, std::span<const uint32_t> indices,
+                      const std::vector<kogayonon_resources::Submesh>& submeshes,
+                      const std::vector<kogayonon_resources::Material>& materials,
+                      const std::vector<std::string>& textures ) -> bool;
+} // namespace kogayonon_utilities
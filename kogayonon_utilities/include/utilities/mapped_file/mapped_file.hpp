@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace kogayonon_utilities
+{
+/**
+ * @brief Read only view of a whole file mapped into memory, the pages are only read from disk once something touches
+ * them and the os can drop them again under memory pressure
+ */
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile( const MappedFile& ) = delete;
+  MappedFile& operator=( const MappedFile& ) = delete;
+
+  /**
+   * @brief Maps the file, an empty file fails since there is nothing to map
+   * @return False if the file could not be opened or mapped
+   */
+  auto open( const std::filesystem::path& path ) -> bool;
+  void close();
+
+  inline auto getData() const -> const uint8_t*
+  {
+    return m_pData;
+  }
+
+  inline auto getSize() const -> std::size_t
+  {
+    return m_size;
+  }
+
+private:
+  const uint8_t* m_pData{ nullptr };
+  std::size_t m_size{ 0 };
+
+#ifdef _WIN32
+  void* m_file{ nullptr };
+  void* m_mapping{ nullptr };
+#endif
+};
+} // namespace kogayonon_utilities
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace kogayonon_utilities
+{
+struct SimplifiedIndices
+{
+  std::vector<uint32_t> indices;
+
+  // root mean square distance the collapses moved the surface by, in position units
+  float error{ 0.0f };
+};
+
+/**
+ * @brief Quadric error edge collapse over a triangle list. A vertex only ever collapses onto one of its neighbours so
+ * no vertex is moved or added and every level can index the vertex buffer of the mesh. Vertices on a border, uv and
+ * normal seams included since the importer splits vertices there, never move so the level does not tear
+ * @param positions Position of every vertex the indices point to
+ * @param indices Triangle list
+ * @param targetIndexCount Collapsing stops once the list is this short
+ * @param maxError Collapsing stops before a collapse that would move the surface by more than this
+ */
+auto simplifyMesh( const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices,
+                   std::size_t targetIndexCount, float maxError ) -> SimplifiedIndices;
+} // namespace kogayonon_utilities
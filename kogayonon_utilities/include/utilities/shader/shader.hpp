@@ -2,7 +2,11 @@
 
 #include <filesystem>
 #include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
 #include <string>
+#include <unordered_set>
+#include <vector>
+#include "utilities/shader/uniform_table.hpp"
 
 namespace kogayonon_utilities
 {
@@ -10,7 +14,9 @@ enum class ShaderType
 {
   NONE = 0,
   VERTEX = 1,
-  FRAGMENT = 2
+  FRAGMENT = 2,
+  COMPUTE = 3,
+  GEOMETRY = 4
 };
 
 struct shader_source
@@ -19,6 +25,10 @@ struct shader_source
   std::string fragmentSource;
   std::filesystem::path vertexPath;
   std::filesystem::path fragmentPath;
+  std::string computeSource;
+  std::filesystem::path computePath;
+  std::string geometrySource;
+  std::filesystem::path geometryPath;
 };
 
 class Shader
@@ -27,34 +37,110 @@ public:
   Shader() = default;
 
   shader_source parseShaderFile( const std::string& vertexPath, const std::string& fragmentPath );
+  shader_source parseComputeFile( const std::string& computePath );
 
-  void bind() const;
-  void unbind() const;
-
-  void setInt( const char* uniform, int value ) const;
-  void setMat4( const char* uniform, const glm::mat4& mat );
-  void setBool( const char* uniform, bool value ) const;
+  void setInt( UniformName uniform, int value ) const;
+  void setMat4( UniformName uniform, const glm::mat4& mat );
+  void setBool( UniformName uniform, bool value ) const;
+  void setUint( UniformName uniform, uint32_t value ) const;
+  void setVec4( UniformName uniform, const glm::vec4& vec ) const;
+  void setUvec4( UniformName uniform, const glm::uvec4& vec ) const;
 
   void initializeShaderSource( const std::string& vertexPath, const std::string& fragmentPath );
+
+  /**
+   * @brief Same as above with a geometry stage between the vertex and the fragment shader
+   */
+  void initializeShaderSource( const std::string& vertexPath, const std::string& geometryPath,
+                               const std::string& fragmentPath );
+
+  /**
+   * @brief Turns this shader into a compute program, the vertex and fragment paths stay empty
+   * @param computePath Path to the compute shader file
+   */
+  void initializeComputeSource( const std::string& computePath );
   void destroy() const;
 
   void markForCompilation();
   bool isCompiled() const;
 
-  void initializeProgram();
+  /**
+   * @brief Starts building the program, straight from the binary cache when it has an entry for these sources. With
+   * KHR_parallel_shader_compile the driver compiles in the background and this returns right away
+   * @param cacheDirectory Where the program binaries are kept, empty disables the cache
+   */
+  void beginCompilation( const std::filesystem::path& cacheDirectory );
+
+  /**
+   * @brief Non blocking, true once the program started by beginCompilation is done. Without parallel compile support
+   * this is always true and finishCompilation blocks instead
+   */
+  auto isReady() const -> bool;
+
+  /**
+   * @brief Checks the link status, swaps the new program in and writes its binary to the cache. Blocks if the driver
+   * is not done yet, a program that fails to link keeps the previous one
+   */
+  void finishCompilation();
+
+  auto isPending() const -> bool;
+  auto isFromCache() const -> bool;
+
+  static auto supportsParallelCompile() -> bool;
+  static auto supportsProgramBinaries() -> bool;
 
   auto getVertexShaderPath() -> std::string;
   auto getFragmentShaderPath() -> std::string;
+  auto getComputeShaderPath() -> std::string;
+  auto getGeometryShaderPath() -> std::string;
+
+  auto isCompute() const -> bool;
 
   auto getShaderId() const -> uint32_t;
 
+  /**
+   * @brief Location of an active uniform from the table built after linking, -1 if the program does not use it.
+   * A missing uniform is only reported the first time
+   */
+  auto getUniformLocation( UniformName uniform ) const -> int;
+
+  /**
+   * @brief Whether the program has an active uniform or shader storage block with this name
+   */
+  auto hasBlock( const char* block ) const -> bool;
+
 private:
-  auto compileShader( uint32_t shaderType, std::string& sourceData ) -> uint32_t;
-  auto createShader() -> uint32_t;
+  void readGeometryFile( const std::filesystem::path& geometryPath );
+  auto compileStage( uint32_t shaderType, const std::string& source ) -> uint32_t;
+  void logStageErrors( uint32_t stage ) const;
+
+  /**
+   * @brief Hash of every source and the driver strings, names the cache file
+   */
+  auto getSourceHash() const -> uint64_t;
+  auto loadBinary() -> bool;
+  void saveBinary() const;
+
+  /**
+   * @brief Reads every active uniform and block of the linked program into the lookup tables
+   */
+  void reflect();
 
 private:
   uint32_t m_programId = 0;
   bool m_isCompiled{ false };
+  bool m_sourceChanged{ false };
   shader_source m_shaderSource;
+
+  // the program being built, it replaces m_programId once it links
+  uint32_t m_pendingProgram{ 0 };
+  std::vector<uint32_t> m_pendingStages;
+  bool m_pending{ false };
+  bool m_fromCache{ false };
+  std::filesystem::path m_cacheFile;
+
+  UniformTable m_uniforms;
+  std::unordered_set<uint64_t> m_blocks;
+  mutable std::unordered_set<uint64_t> m_reportedMissing;
 };
 } // namespace kogayonon_utilities
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include <filesystem>
 #include <unordered_map>
 #include "utilities/shader/shader.hpp"
 
@@ -14,19 +15,57 @@ public:
 
   auto getShaderId( const std::string& shaderName ) -> uint32_t;
   void pushShader( const std::string& vertexShader, const std::string& fragmentShader, const std::string& shaderName );
+
+  /**
+   * @brief Pushes a program with a geometry stage
+   */
+  void pushShader( const std::string& vertexShader, const std::string& geometryShader,
+                   const std::string& fragmentShader, const std::string& shaderName );
+  void pushComputeShader( const std::string& computeShader, const std::string& shaderName );
   auto getShader( const std::string& shaderName ) -> Shader&;
-  void bindShader( const std::string& shaderName );
-  void unbindShader( const std::string& shaderName );
   void removeShader( const std::string& shaderName );
 
   /**
-   * @brief Loops through all the shaders and check for the m_isCompiled flag, if false it parses the vertex and
-   * fragment files again and then compiles and links them
+   * @brief Loops through all the shaders and check for the m_isCompiled flag, if false it compiles and links them.
+   * Blocks until they are done but every program is started before the first one is waited on
    */
   void compileMarkedShaders();
 
   /**
-   * @brief Marks a shader for recompilation if either vertex or fragment shader path is == to the one in the param list
+   * @brief Starts every shader that is not compiled yet without waiting, so the driver can compile them while we
+   * load other things. Files are only read again for shaders marked for recompilation
+   */
+  void beginCompilation();
+
+  /**
+   * @brief Non blocking, finishes the shaders the driver is done with and returns true once none are left
+   */
+  auto isReady() -> bool;
+
+  /**
+   * @brief Blocks until every started shader is finished
+   */
+  void finishCompilation();
+
+  /**
+   * @brief Where the program binaries are cached, an empty path disables the cache
+   */
+  inline void setProgramCacheDirectory( const std::filesystem::path& directory )
+  {
+    m_programCacheDirectory = directory;
+  }
+
+  /**
+   * @brief How many of the programs finished so far came from the binary cache
+   */
+  inline auto getProgramCacheHits() const -> uint32_t
+  {
+    return m_programCacheHits;
+  }
+
+  /**
+   * @brief Marks a shader for recompilation if either vertex, geometry, fragment or compute shader path is == to the
+   * one in the param list
    * @param filePath Path to the file we are looking for
    */
   void markForRecompilation( const std::string& filePath );
@@ -35,5 +74,7 @@ private:
   // this mutex is not needed atm, might add if shaders take too much time to compile
   // std::mutex m_mutex;
   std::unordered_map<std::string, Shader> m_shaders;
+  std::filesystem::path m_programCacheDirectory{ "cache/shaders" };
+  uint32_t m_programCacheHits{ 0 };
 };
 } // namespace kogayonon_utilities
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace kogayonon_utilities
+{
+/**
+ * @brief 64 bit FNV-1a, pass the previous result as hash to keep folding more text into it
+ */
+constexpr auto hashString( std::string_view text, uint64_t hash = 14695981039346656037ull ) -> uint64_t
+{
+  for ( const auto c : text )
+  {
+    hash ^= static_cast<uint8_t>( c );
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+/**
+ * @brief Wide enough that two uniform names of the same program never collide in practice
+ */
+constexpr auto hashUniformName( std::string_view name ) -> uint64_t
+{
+  return hashString( name );
+}
+
+/**
+ * @brief A uniform name hashed at compile time, setters take it so a lookup never touches the string
+ */
+class UniformName
+{
+public:
+  consteval UniformName( const char* name )
+      : m_name{ name }
+      , m_hash{ hashUniformName( name ) }
+  {
+  }
+
+  inline auto getName() const -> const char*
+  {
+    return m_name;
+  }
+
+  inline auto getHash() const -> uint64_t
+  {
+    return m_hash;
+  }
+
+private:
+  const char* m_name;
+  uint64_t m_hash;
+};
+
+/**
+ * @brief Name hash to location of every active uniform of a program, filled once after linking so setting a uniform
+ * never asks the driver for a location. Programs have a handful of uniforms so a flat array beats a hash map here
+ */
+class UniformTable
+{
+public:
+  UniformTable() = default;
+  ~UniformTable() = default;
+
+  inline void clear()
+  {
+    m_locations.clear();
+  }
+
+  inline void add( std::string_view name, int location )
+  {
+    m_locations.emplace_back( hashUniformName( name ), location );
+  }
+
+  /**
+   * @brief -1 if the program has no active uniform with this name
+   */
+  inline auto find( uint64_t hash ) const -> int
+  {
+    for ( const auto& [key, location] : m_locations )
+    {
+      if ( key == hash )
+        return location;
+    }
+    return -1;
+  }
+
+  inline auto find( const UniformName& name ) const -> int
+  {
+    return find( name.getHash() );
+  }
+
+  inline auto size() const -> std::size_t
+  {
+    return m_locations.size();
+  }
+
+private:
+  std::vector<std::pair<uint64_t, int>> m_locations;
+};
+} // namespace kogayonon_utilities
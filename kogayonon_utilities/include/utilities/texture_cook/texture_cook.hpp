@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+#include "utilities/bcn/bcn.hpp"
+#include "utilities/mapped_file/mapped_file.hpp"
+
+namespace kogayonon_utilities
+{
+// bump it whenever the encoder or the resampling changes, older files get cooked again
+static constexpr uint32_t textureCookVersion = 1;
+
+// cooked textures are square powers of two inside these, the same sizes the material texture pages use
+static constexpr int minCookedSize = 256;
+static constexpr int maxCookedSize = 2048;
+
+/**
+ * @brief What a texture is sampled as, it decides the block format
+ */
+enum class TextureUsage : uint8_t
+{
+  Color,
+  Normal
+};
+
+struct CookedLevel
+{
+  // from the start of CookedTexture::data
+  std::size_t offset{ 0 };
+  std::size_t size{ 0 };
+  int width{ 0 };
+  int height{ 0 };
+};
+
+/**
+ * @brief Every mip of a block compressed texture, either freshly cooked or pointing into a mapped .ktx2 file
+ */
+struct CookedTexture
+{
+  BlockFormat format{ BlockFormat::BC7 };
+  int width{ 0 };
+  int height{ 0 };
+
+  // level 0 is the biggest
+  std::vector<CookedLevel> levels;
+  std::span<const uint8_t> data;
+
+  // whichever of these owns data
+  std::shared_ptr<MappedFile> pFile;
+  std::vector<uint8_t> storage;
+};
+
+inline auto getBlockFormat( TextureUsage usage ) -> BlockFormat
+{
+  return usage == TextureUsage::Normal ? BlockFormat::BC5 : BlockFormat::BC7;
+}
+
+/**
+ * @brief Where the cooked file of a texture lives, right next to it
+ */
+auto getCookedTexturePath( const std::filesystem::path& source ) -> std::filesystem::path;
+
+/**
+ * @brief Hash of the image file together with the usage and the cook version
+ */
+auto hashTextureSource( const std::filesystem::path& source, TextureUsage usage ) -> uint64_t;
+
+/**
+ * @brief Resamples decoded rgba8 pixels to the cooked size, builds the mip chain and compresses every level
+ * @param pPixels width * height * 4 bytes
+ */
+auto cookTexture( const uint8_t* pPixels, int width, int height, TextureUsage usage ) -> CookedTexture;
+
+/**
+ * @brief Maps a .ktx2 file and checks it against the source
+ * @param sourceHash What hashTextureSource gives for the image now
+ * @param texture Output, only valid when it returns true
+ * @return False if the file is missing, stale, in a format we do not cook or broken
+ */
+auto readCookedTexture( const std::filesystem::path& path, uint64_t sourceHash, CookedTexture& texture ) -> bool;
+
+/**
+ * @brief Writes a .ktx2 file through a temporary file, the source hash goes into the key value data
+ */
+auto writeCookedTexture( const std::filesystem::path& path, uint64_t sourceHash, const CookedTexture& texture )
+  -> bool;
+} // namespace kogayonon_utilities
@@ -0,0 +1,229 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "utilities/texture_cook/texture_cook.hpp"
+
+namespace kogayonon_resources
+{
+class Texture;
+} // namespace kogayonon_resources
+
+namespace kogayonon_utilities
+{
+class TaskManager;
+
+/**
+ * @brief What a worker made of a file, either raw pixels freed with SOIL once the upload is done or the mips of the
+ * cooked texture. Neither means the file could not be read
+ */
+struct DecodedTexture
+{
+  kogayonon_resources::Texture* pTexture{ nullptr };
+  int width{ 0 };
+  int height{ 0 };
+  std::unique_ptr<unsigned char[], void ( * )( unsigned char* )> pixels{ nullptr, nullptr };
+  CookedTexture cooked;
+
+  // gl texture the rows go into and how far along it is, cooked textures count rows of blocks per level
+  uint32_t texture{ 0 };
+  uint32_t uploadedLevel{ 0 };
+  int uploadedRows{ 0 };
+};
+
+/**
+ * @brief Totals of the textures loaded since the last reset, the app resets them when a project loads. A texture
+ * streamed again at another size is counted once with its latest load
+ */
+struct TextureLoadStats
+{
+  std::size_t textures{ 0 };
+  std::size_t compressed{ 0 };
+
+  // gl textures the streamer still owns, the ones copied into texture pages and released are not in here
+  std::size_t vramBytes{ 0 };
+
+  // what the latest load of the same textures would take as RGBA8 with mips
+  std::size_t rgba8Bytes{ 0 };
+
+  // from the first request until nothing was pending anymore, summed over every such stretch
+  double loadMilliseconds{ 0.0 };
+};
+
+/**
+ * @brief Loads textures without stalling the render thread. Workers of the task manager decode the files, the render
+ * thread copies the pixels into a persistently mapped pixel buffer ring and uploads at most a byte budget per frame, so
+ * a big texture can take a few frames. Until a texture is resident it shows a small checker placeholder and stays
+ * unloaded, the material system keeps drawing its meshes with the default material in the meantime.
+ * With compression on the workers load the cooked .ktx2 next to the file instead, cooking it first when it is missing
+ * or stale, and the blocks are uploaded as they are with every mip. A texture that can not be cooked goes the raw way
+ */
+class TextureStreamer
+{
+public:
+  // frames the ring is split into, a segment is only written again once the gpu read it
+  static constexpr uint32_t ringSegments = 3;
+
+  // bytes uploaded per frame unless the caller asks for something else
+  static constexpr std::size_t defaultFrameBudget = 8ull << 20;
+
+  // a segment must hold at least one row of the widest texture gl allows us
+  static constexpr std::size_t minSegmentBytes = 16384 * 4;
+
+  TextureStreamer() = default;
+  ~TextureStreamer();
+
+  TextureStreamer( const TextureStreamer& ) = delete;
+  TextureStreamer& operator=( const TextureStreamer& ) = delete;
+
+  /**
+   * @brief Queues the decode of a texture on the task manager, textures that are loaded or already queued are skipped.
+   * Call it on the render thread, the texture gets the placeholder id right away
+   * @param pTexture The texture to fill, its path is the file that gets decoded
+   * @param taskManager Workers that decode
+   * @param usage Decides the block format when the texture gets cooked
+   * @param maxSize Cooked textures leave out the mips bigger than this, raw ones always come in whole
+   */
+  void request( kogayonon_resources::Texture* pTexture, TaskManager& taskManager,
+                TextureUsage usage = TextureUsage::Color, int maxSize = maxCookedSize );
+
+  /**
+   * @brief Deletes the gl texture of a loaded texture and puts the placeholder back, it can be requested again later.
+   * Textures that are still pending are left alone. The renderer may still think the id is bound, tell it first
+   */
+  void release( kogayonon_resources::Texture* pTexture );
+
+  /**
+   * @brief Drops the texture from the load stats, call it before the texture is destroyed so its address is not
+   * mistaken for the one of a later texture
+   */
+  void forget( kogayonon_resources::Texture* pTexture );
+
+  /**
+   * @brief Uploads what the workers decoded, call it once per frame on the render thread
+   * @param byteBudget Pixel bytes copied this frame at most
+   */
+  void update( std::size_t byteBudget = defaultFrameBudget );
+
+  /**
+   * @brief Deletes the ring and the placeholder, needs the gl context
+   */
+  void destroy();
+
+  /**
+   * @brief A worker or the upload ring still writes into the texture
+   */
+  inline auto isPending( kogayonon_resources::Texture* pTexture ) const -> bool
+  {
+    return m_pending.contains( pTexture );
+  }
+
+  /**
+   * @brief Textures requested that are not resident yet
+   */
+  inline auto getPendingCount() const -> std::size_t
+  {
+    return m_pending.size();
+  }
+
+  /**
+   * @brief Pixel bytes the last update sent
+   */
+  inline auto getUploadedBytes() const -> std::size_t
+  {
+    return m_uploadedBytes;
+  }
+
+  inline auto getPlaceholder() const -> uint32_t
+  {
+    return m_placeholder;
+  }
+
+  /**
+   * @brief Textures requested from now on are loaded from cooked files, off uploads the decoded pixels as RGBA8
+   */
+  inline void setCompressionEnabled( bool enabled )
+  {
+    m_compressionEnabled = enabled;
+  }
+
+  inline auto isCompressionEnabled() const -> bool
+  {
+    return m_compressionEnabled;
+  }
+
+  inline auto getLoadStats() const -> const TextureLoadStats&
+  {
+    return m_stats;
+  }
+
+  inline void resetLoadStats()
+  {
+    m_stats = TextureLoadStats{};
+    m_loaded.clear();
+  }
+
+private:
+  void createPlaceholder();
+  void createRing( std::size_t segmentBytes );
+  void createTexture( DecodedTexture& upload ) const;
+
+  /**
+   * @brief Copies the next rows of blocks of a cooked texture into the ring and uploads them
+   * @return Bytes used, the texture is complete once uploadedLevel reaches its level count
+   */
+  auto uploadCooked( DecodedTexture& upload, std::size_t offset, std::size_t budget ) -> std::size_t;
+
+  void finish( DecodedTexture& upload );
+
+private:
+  // what the latest load of a texture added to the stats
+  struct LoadedTexture
+  {
+    std::size_t vramBytes{ 0 };
+    std::size_t rgba8Bytes{ 0 };
+    bool compressed{ false };
+  };
+
+  /**
+   * @brief Swaps what a texture adds to the stats for its latest load
+   */
+  void account( kogayonon_resources::Texture* pTexture, const LoadedTexture& loaded );
+
+private:
+  struct Segment
+  {
+    // sync object of the uploads that read the segment
+    void* fence{ nullptr };
+  };
+
+  uint32_t m_placeholder{ 0 };
+  bool m_compressionEnabled{ true };
+
+  uint32_t m_ring{ 0 };
+  unsigned char* m_pMapped{ nullptr };
+  std::size_t m_segmentBytes{ 0 };
+  std::array<Segment, ringSegments> m_segments{};
+  uint32_t m_segmentIndex{ 0 };
+  std::size_t m_uploadedBytes{ 0 };
+
+  // only touched by the render thread
+  std::unordered_set<kogayonon_resources::Texture*> m_pending;
+  std::deque<DecodedTexture> m_uploads;
+  TextureLoadStats m_stats;
+  std::unordered_map<kogayonon_resources::Texture*, LoadedTexture> m_loaded;
+  std::chrono::steady_clock::time_point m_loadStart;
+
+  // filled by the workers
+  std::mutex m_decodedMutex;
+  std::vector<DecodedTexture> m_decoded;
+};
+} // namespace kogayonon_utilities
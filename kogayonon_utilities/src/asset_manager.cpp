@@ -1,16 +1,84 @@
 #include "utilities/asset_manager/asset_manager.hpp"
 #include <cgltf.h>
 #include <SOIL2/SOIL2.h>
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
 #include <glad/glad.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <spdlog/spdlog.h>
 
 #include "resources/texture.hpp"
 #include "resources/vertex.hpp"
+#include "utilities/cpu_profiler/cpu_profiler.hpp"
+#include "utilities/kmesh/kmesh.hpp"
+#include "utilities/mesh_simplifier/mesh_simplifier.hpp"
+#include "utilities/task_manager/task_manager.hpp"
 
 namespace kogayonon_utilities
 {
+namespace
+{
+// runs body for every index on the workers, the calling thread takes indices too so it never waits for a job that did
+// not start. That matters since addMesh itself usually runs on a worker. The first exception of body is thrown on the
+// calling thread once every index is done
+void parallelFor( TaskManager* pTaskManager, std::size_t count, const std::function<void( std::size_t )>& body )
+{
+  if ( !pTaskManager || count < 2 )
+  {
+    for ( std::size_t i = 0; i < count; i++ )
+      body( i );
+    return;
+  }
+
+  struct Work
+  {
+    std::atomic<std::size_t> next{ 0 };
+    std::atomic<std::size_t> done{ 0 };
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::exception_ptr error;
+  };
+
+  // helpers that start after every index got taken return right away, they never touch body then
+  auto pWork = std::make_shared<Work>();
+  auto run = [pWork, count, &body]() {
+    for ( auto i = pWork->next.fetch_add( 1 ); i < count; i = pWork->next.fetch_add( 1 ) )
+    {
+      // a throwing index still has to count as done or the caller waits forever
+      try
+      {
+        body( i );
+      }
+      catch ( ... )
+      {
+        std::lock_guard lock{ pWork->mutex };
+        if ( !pWork->error )
+          pWork->error = std::current_exception();
+      }
+
+      if ( pWork->done.fetch_add( 1 ) + 1 == count )
+      {
+        std::lock_guard lock{ pWork->mutex };
+        pWork->finished.notify_all();
+      }
+    }
+  };
+
+  const auto helpers = std::min<std::size_t>( count - 1, std::max( std::thread::hardware_concurrency(), 1u ) );
+  for ( std::size_t i = 0; i < helpers; i++ )
+    pTaskManager->enqueue( run );
+
+  run();
+
+  std::unique_lock lock{ pWork->mutex };
+  pWork->finished.wait( lock, [&pWork, count]() { return pWork->done.load() == count; } );
+  if ( pWork->error )
+    std::rethrow_exception( pWork->error );
+}
+} // namespace
 
 AssetManager::AssetManager()
 {
@@ -24,15 +92,18 @@ AssetManager::~AssetManager()
 std::weak_ptr<kogayonon_resources::Texture> AssetManager::addTextureWithoutParams( const std::string& textureName,
                                                                                    const std::string& texturePath )
 {
-  if ( m_loadedTextures.contains( texturePath ) )
   {
-    if ( m_loadedTextures.at( texturePath )->getLoaded() == true )
+    std::lock_guard lock{ m_assetMutex };
+    if ( m_loadedTextures.contains( texturePath ) )
     {
-      return m_loadedTextures.at( texturePath );
-    }
-    else
-    {
-      spdlog::info( "We have the texture in the map but it is not yet loaded in OpenGl" );
+      if ( m_loadedTextures.at( texturePath )->getLoaded() == true )
+      {
+        return m_loadedTextures.at( texturePath );
+      }
+      else
+      {
+        spdlog::info( "We have the texture in the map but it is not yet loaded in OpenGl" );
+      }
     }
   }
 
@@ -54,6 +125,7 @@ std::weak_ptr<kogayonon_resources::Texture> AssetManager::addTextureWithoutParam
                                                              0  // channels unknown
   );
 
+  std::lock_guard lock{ m_assetMutex };
   m_loadedTextures.try_emplace( texturePath, tex );
   return m_loadedTextures.at( texturePath );
 }
@@ -78,15 +150,18 @@ kogayonon_resources::Texture* AssetManager::addTexture( const std::string& textu
 
 kogayonon_resources::Texture* AssetManager::addTexture( const std::string& textureName, const std::string& texturePath )
 {
-  if ( m_loadedTextures.contains( texturePath ) )
   {
-    if ( m_loadedTextures.at( texturePath )->getLoaded() )
+    std::lock_guard lock{ m_assetMutex };
+    if ( m_loadedTextures.contains( texturePath ) )
     {
-      return m_loadedTextures.at( texturePath ).get();
-    }
-    else
-    {
-      spdlog::info( "We have the texture in the map but it is not yet loaded in OpenGl" );
+      if ( m_loadedTextures.at( texturePath )->getLoaded() )
+      {
+        return m_loadedTextures.at( texturePath ).get();
+      }
+      else
+      {
+        spdlog::info( "We have the texture in the map but it is not yet loaded in OpenGl" );
+      }
     }
   }
 
@@ -107,24 +182,125 @@ kogayonon_resources::Texture* AssetManager::addTexture( const std::string& textu
   SOIL_free_image_data( data );
 
   auto tex = std::make_shared<kogayonon_resources::Texture>( id, texturePath, textureName, w, h, channels );
+  std::lock_guard lock{ m_assetMutex };
   m_loadedTextures.try_emplace( texturePath, tex );
   spdlog::info( "Loaded texture {}", textureName, texturePath );
 
   return m_loadedTextures.at( texturePath ).get();
 }
 
-kogayonon_resources::Mesh* AssetManager::addMesh( const std::string& meshName, const std::string& meshPath )
+kogayonon_resources::Mesh* AssetManager::addMesh( const std::string& meshName, const std::string& meshPath,
+                                                  TaskManager* pTaskManager )
 {
-  std::lock_guard lock{ m_assetMutex };
+  KOGAYONON_PROFILE_ZONE( "AssetManager::addMesh" );
 
-  if ( m_loadedMeshes.contains( meshPath ) )
+  // the lock only covers the maps, the import itself runs next to the imports of other files
+  std::promise<std::shared_ptr<kogayonon_resources::Mesh>> promise;
+  std::shared_future<std::shared_ptr<kogayonon_resources::Mesh>> inFlight;
   {
-    spdlog::info( "Mesh already loaded {} ", meshName );
-    return m_loadedMeshes.at( meshPath ).get();
+    std::lock_guard lock{ m_assetMutex };
+    if ( m_loadedMeshes.contains( meshPath ) )
+    {
+      spdlog::info( "Mesh already loaded {} ", meshName );
+      return m_loadedMeshes.at( meshPath ).get();
+    }
+
+    if ( auto it = m_meshesInFlight.find( meshPath ); it != m_meshesInFlight.end() )
+      inFlight = it->second;
+    else
+      m_meshesInFlight.emplace( meshPath, promise.get_future().share() );
+  }
+
+  if ( inFlight.valid() )
+  {
+    KOGAYONON_PROFILE_ZONE( "AssetManager::addMesh wait" );
+    return inFlight.get().get();
   }
 
   assert( std::filesystem::exists( meshPath ) && "mesh file does not exist" );
 
+  // whoever waits on the import gets the exception too, and the path can be imported again later
+  std::shared_ptr<kogayonon_resources::Mesh> mesh_;
+  try
+  {
+    mesh_ = importMesh( meshPath, true, pTaskManager );
+  }
+  catch ( ... )
+  {
+    {
+      std::lock_guard lock{ m_assetMutex };
+      m_meshesInFlight.erase( meshPath );
+    }
+    promise.set_exception( std::current_exception() );
+    throw;
+  }
+
+  {
+    std::lock_guard lock{ m_assetMutex };
+    if ( mesh_ )
+      m_loadedMeshes.try_emplace( meshPath, mesh_ );
+    m_meshesInFlight.erase( meshPath );
+  }
+  promise.set_value( mesh_ );
+
+  if ( mesh_ )
+    spdlog::info( "Loaded mesh {} ", meshName );
+  return mesh_.get();
+}
+
+auto AssetManager::importMesh( const std::string& meshPath, bool useCooked, TaskManager* pTaskManager )
+  -> std::shared_ptr<kogayonon_resources::Mesh>
+{
+  if ( !useCooked )
+    return parseMesh( meshPath, pTaskManager );
+
+  const auto sourceHash = hashMeshSource( meshPath );
+  const auto cookedPath = getCookedMeshPath( meshPath );
+  const auto resourcesPath = std::filesystem::absolute( "resources" );
+
+  CookedMesh cooked;
+  if ( readCookedMesh( cookedPath, sourceHash, cooked ) )
+  {
+    std::vector<kogayonon_resources::Texture*> textures;
+    for ( const auto& texture : cooked.textures )
+      addMeshTexture( resourcesPath / texture, textures );
+
+    // the mapping stays alive through the mesh, the buffers get filled straight from it
+    auto mesh = std::make_shared<kogayonon_resources::Mesh>( meshPath,
+                                                             cooked.pFile,
+                                                             cooked.vertices,
+                                                             cooked.indices,
+                                                             std::move( textures ),
+                                                             std::move( cooked.submeshes ) );
+    mesh->setMaterials( std::move( cooked.materials ) );
+    mesh->computeBounds();
+    return mesh;
+  }
+
+  auto mesh = parseMesh( meshPath, pTaskManager );
+  if ( !mesh )
+    return mesh;
+
+  std::vector<std::string> textures;
+  for ( const auto pTexture : mesh->getTextures() )
+    textures.emplace_back( std::filesystem::relative( pTexture->getPath(), resourcesPath ).generic_string() );
+
+  if ( writeCookedMesh( cookedPath,
+                        sourceHash,
+                        mesh->getVertexData(),
+                        mesh->getIndexData(),
+                        mesh->getSubmeshes(),
+                        mesh->getMaterials(),
+                        textures ) )
+    spdlog::info( "Cooked mesh {} ", cookedPath.string() );
+
+  return mesh;
+}
+
+auto AssetManager::parseMesh( const std::string& meshPath, TaskManager* pTaskManager )
+  -> std::shared_ptr<kogayonon_resources::Mesh>
+{
+  KOGAYONON_PROFILE_ZONE( "AssetManager::parseMesh" );
   cgltf_options options{};
   cgltf_data* data = nullptr;
 
@@ -150,10 +326,18 @@ kogayonon_resources::Mesh* AssetManager::addMesh( const std::string& meshName, c
     return {};
   }
 
-  std::vector<kogayonon_resources::Submesh> submeshes;
-  std::vector<kogayonon_resources::Vertex> vertices;
-  std::vector<uint32_t> indices;
+  // materials and textures are shared between primitives, they get resolved here in node order
+  struct PendingPrimitive
+  {
+    cgltf_primitive* pPrimitive{ nullptr };
+    glm::mat4 transform{ 1.0f };
+    uint32_t materialIndex{ 0 };
+  };
+
+  std::vector<PendingPrimitive> pending;
   std::vector<kogayonon_resources::Texture*> textures;
+  std::vector<kogayonon_resources::Material> materials;
+  std::unordered_map<const cgltf_material*, uint32_t> materialIndices;
 
   for ( size_t i = 0; i < data->nodes_count; ++i )
   {
@@ -179,50 +363,153 @@ kogayonon_resources::Mesh* AssetManager::addMesh( const std::string& meshName, c
     {
       cgltf_primitive& primitive = mesh.primitives[j];
 
-      std::vector<glm::vec3> localPositions;
-      std::vector<glm::vec3> localNormals;
-      std::vector<glm::vec2> localTextureCoords;
-      std::vector<uint32_t> localIndices;
-      std::vector<kogayonon_resources::Vertex> localVertices;
-
-      parseVertices( primitive, localPositions, localNormals, localTextureCoords, transform );
-
-      if ( primitive.indices )
-        parseIndices( primitive.indices, localIndices );
-
+      // primitives that share a glTF material share the mesh material too
+      uint32_t materialIndex = 0;
       if ( primitive.material )
-        parseTextures( primitive.material, textures );
-
-      for ( size_t x = 0; x < localPositions.size(); ++x )
       {
-        kogayonon_resources::Vertex v{ .translation = localPositions[x],
-                                       .normal = ( x < localNormals.size() ) ? localNormals[x] : glm::vec3{ 0.0f },
-                                       .textureCoords = ( x < localTextureCoords.size() ) ? localTextureCoords[x]
-                                                                                          : glm::vec2{ 0.0f } };
-        localVertices.emplace_back( v );
+        if ( auto it = materialIndices.find( primitive.material ); it != materialIndices.end() )
+        {
+          materialIndex = it->second;
+        }
+        else
+        {
+          materialIndex = static_cast<uint32_t>( materials.size() );
+          materials.emplace_back( parseMaterial( primitive.material, textures ) );
+          materialIndices.emplace( primitive.material, materialIndex );
+        }
       }
 
-      uint32_t vertexOffset = static_cast<uint32_t>( vertices.size() );
-      uint32_t indexOffset = static_cast<uint32_t>( indices.size() );
+      pending.emplace_back(
+        PendingPrimitive{ .pPrimitive = &primitive, .transform = transform, .materialIndex = materialIndex } );
+    }
+  }
 
-      vertices.insert( vertices.end(), localVertices.begin(), localVertices.end() );
-      indices.insert( indices.end(), localIndices.begin(), localIndices.end() );
+  // the simplifier dominates, every primitive is simplified on its own
+  std::vector<DecodedPrimitive> decoded( pending.size() );
+  parallelFor( pTaskManager, pending.size(), [&]( std::size_t i ) {
+    decoded[i] = decodePrimitive( *pending[i].pPrimitive, pending[i].transform, pending[i].materialIndex );
+  } );
 
-      submeshes.emplace_back(
-        kogayonon_resources::Submesh{ .vertexOffest = static_cast<uint32_t>( vertexOffset ),
-                                      .indexOffset = static_cast<uint32_t>( indexOffset ),
-                                      .indexCount = static_cast<uint32_t>( localIndices.size() ) } );
-    }
+  std::size_t vertexCount = 0;
+  std::size_t indexCount = 0;
+  for ( const auto& primitive : decoded )
+  {
+    vertexCount += primitive.vertices.size();
+    indexCount += primitive.indices.size();
   }
 
-  auto mesh_ = std::make_shared<kogayonon_resources::Mesh>( meshPath, std::move( vertices ), std::move( indices ),
-                                                            std::move( textures ), std::move( submeshes ) );
-  m_loadedMeshes.try_emplace( meshPath, mesh_ );
+  std::vector<kogayonon_resources::Submesh> submeshes;
+  std::vector<kogayonon_resources::Vertex> vertices;
+  std::vector<uint32_t> indices;
+  submeshes.reserve( decoded.size() );
+  vertices.reserve( vertexCount );
+  indices.reserve( indexCount );
+
+  // the index values stay local to their primitive, only the offsets move
+  for ( auto& primitive : decoded )
+  {
+    auto& submesh = submeshes.emplace_back( primitive.submesh );
+    submesh.vertexOffest = static_cast<uint32_t>( vertices.size() );
+    submesh.indexOffset += static_cast<uint32_t>( indices.size() );
+    for ( auto level = 0u; level + 1 < submesh.lodCount; level++ )
+      submesh.lods[level].indexOffset += static_cast<uint32_t>( indices.size() );
+
+    vertices.insert( vertices.end(), primitive.vertices.begin(), primitive.vertices.end() );
+    indices.insert( indices.end(), primitive.indices.begin(), primitive.indices.end() );
+  }
+
+  auto mesh = std::make_shared<kogayonon_resources::Mesh>( meshPath, std::move( vertices ), std::move( indices ),
+                                                           std::move( textures ), std::move( submeshes ) );
+  mesh->setMaterials( std::move( materials ) );
+  mesh->computeBounds();
 
   cgltf_free( data );
+  return mesh;
+}
+
+auto AssetManager::decodePrimitive( cgltf_primitive& primitive, const glm::mat4& transform,
+                                    uint32_t materialIndex ) const -> DecodedPrimitive
+{
+  KOGAYONON_PROFILE_ZONE( "AssetManager::decodePrimitive" );
+
+  std::vector<glm::vec3> localPositions;
+  std::vector<glm::vec3> localNormals;
+  std::vector<glm::vec2> localTextureCoords;
+  std::vector<uint32_t> localIndices;
+  DecodedPrimitive decoded;
+
+  parseVertices( primitive, localPositions, localNormals, localTextureCoords, transform );
 
-  spdlog::info( "Loaded mesh {} ", meshName );
-  return getMesh( meshPath );
+  if ( primitive.indices )
+    parseIndices( primitive.indices, localIndices );
+
+  decoded.vertices.reserve( localPositions.size() );
+  for ( size_t x = 0; x < localPositions.size(); ++x )
+  {
+    kogayonon_resources::Vertex v{ .translation = localPositions[x],
+                                   .normal = ( x < localNormals.size() ) ? localNormals[x] : glm::vec3{ 0.0f },
+                                   .textureCoords =
+                                     ( x < localTextureCoords.size() ) ? localTextureCoords[x] : glm::vec2{ 0.0f } };
+    decoded.vertices.emplace_back( v );
+  }
+
+  // positions are already in mesh space since the node transform got applied in parseVertices
+  kogayonon_resources::AABB bounds;
+  for ( const auto& position : localPositions )
+    bounds.expand( position );
+  const auto sphere = kogayonon_resources::computeBoundingSphere( bounds, localPositions );
+
+  decoded.submesh = kogayonon_resources::Submesh{ .vertexOffest = 0,
+                                                  .indexOffset = 0,
+                                                  .indexCount = static_cast<uint32_t>( localIndices.size() ),
+                                                  .bounds = bounds,
+                                                  .sphere = sphere,
+                                                  .materialIndex = materialIndex };
+
+  // the levels go right after the full indices of the primitive
+  decoded.indices = localIndices;
+  generateLods( localPositions, localIndices, decoded.indices, decoded.submesh );
+  return decoded;
+}
+
+void AssetManager::generateLods( const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& localIndices,
+                                 std::vector<uint32_t>& indices, kogayonon_resources::Submesh& submesh ) const
+{
+  KOGAYONON_PROFILE_ZONE( "AssetManager::generateLods" );
+
+  // share of the full triangles every level keeps and how far it may move the surface, relative to the submesh size
+  static constexpr std::array<float, kogayonon_resources::maxMeshLods - 1> ratios{ 0.5f, 0.25f, 0.125f };
+  static constexpr std::array<float, kogayonon_resources::maxMeshLods - 1> maxErrors{ 0.01f, 0.03f, 0.08f };
+
+  // tiny primitives are not worth it
+  static constexpr std::size_t minIndexCount = 3 * 64;
+
+  if ( localIndices.size() < minIndexCount )
+    return;
+
+  // every level starts from the previous one so the errors add up
+  auto previous = localIndices;
+  float error = 0.0f;
+
+  for ( std::size_t level = 0; level < ratios.size(); level++ )
+  {
+    const auto target = static_cast<std::size_t>( localIndices.size() * ratios[level] ) / 3 * 3;
+    auto simplified = simplifyMesh( positions, previous, target, submesh.sphere.radius * maxErrors[level] - error );
+
+    // stop once the simplifier gets stuck on borders or the error limit, a level that barely shrinks is not worth it
+    if ( simplified.indices.empty() || simplified.indices.size() > previous.size() * 4 / 5 )
+      break;
+
+    error += simplified.error;
+    submesh.lods[level] =
+      kogayonon_resources::SubmeshLod{ .indexOffset = static_cast<uint32_t>( indices.size() ),
+                                       .indexCount = static_cast<uint32_t>( simplified.indices.size() ),
+                                       .error = error };
+    ++submesh.lodCount;
+
+    indices.insert( indices.end(), simplified.indices.begin(), simplified.indices.end() );
+    previous = std::move( simplified.indices );
+  }
 }
 
 auto AssetManager::addMesh( const std::string& meshName ) -> kogayonon_resources::Mesh*
@@ -236,8 +523,9 @@ void AssetManager::uploadMeshGeometry( kogayonon_resources::Mesh* mesh ) const
   auto& vbo = mesh->getVbo();
   auto& ebo = mesh->getEbo();
 
-  auto& vertices = mesh->getVertices();
-  auto& indices = mesh->getIndices();
+  // straight from the mapping for cooked meshes
+  const auto vertices = mesh->getVertexData();
+  const auto indices = mesh->getIndexData();
 
   // prepare the buffers to tell OpenGL how to interpret our data
   glCreateVertexArrays( 1, &vao );
@@ -247,12 +535,12 @@ void AssetManager::uploadMeshGeometry( kogayonon_resources::Mesh* mesh ) const
   glCreateBuffers( 1, &vbo );
   assert( vbo != 0 && "vbo cannot be 0" );
 
-  glNamedBufferData( vbo, vertices.size() * sizeof( kogayonon_resources::Vertex ), vertices.data(), GL_DYNAMIC_DRAW );
+  glNamedBufferData( vbo, vertices.size_bytes(), vertices.data(), GL_DYNAMIC_DRAW );
 
   // upload indices to element buffer
   glCreateBuffers( 1, &ebo );
   assert( ebo != 0 && "ebo cannot be 0" );
-  glNamedBufferData( ebo, indices.size() * sizeof( unsigned int ), indices.data(), GL_DYNAMIC_DRAW );
+  glNamedBufferData( ebo, indices.size_bytes(), indices.data(), GL_DYNAMIC_DRAW );
 
   // link vao to vbo (vbo will be binded by this call)
   glVertexArrayVertexBuffer( vao, 0, vbo, 0, sizeof( kogayonon_resources::Vertex ) );
@@ -290,34 +578,65 @@ auto AssetManager::getTexture( const std::string& textureName, const std::string
   -> std::weak_ptr<kogayonon_resources::Texture>
 {
   std::filesystem::path p{ folder + textureName };
+  std::lock_guard lock{ m_assetMutex };
   return m_loadedTextures.at( p.string() );
 }
 
 void AssetManager::removeTexture( const std::string& path )
 {
-  for ( auto it = m_loadedTextures.begin(); it != m_loadedTextures.end(); ++it )
+  // held for the whole check, a worker could hand the texture to a new mesh in between
+  std::lock_guard lock{ m_assetMutex };
+  const auto it = std::ranges::find_if( m_loadedTextures, [&path]( const auto& pair ) {
+    return pair.second->getPath() == path;
+  } );
+  if ( it == m_loadedTextures.end() )
+  {
+    spdlog::info( "file was not loaded so we did not delete anything" );
+    return;
+  }
+
+  // materials hold raw pointers to their textures, the residency of the renderer and the streamer too
+  auto pTexture = it->second.get();
+  if ( m_textureStreamer.isPending( pTexture ) || pTexture->getUserCount() != 0 )
+  {
+    spdlog::warn( "{} is still loading or the renderer keeps it, not deleting it", path );
+    return;
+  }
+  for ( const auto& [meshPath, pMesh] : m_loadedMeshes )
   {
-    if ( it->second->getPath() == path.data() )
+    if ( std::ranges::find( pMesh->getTextures(), pTexture ) != pMesh->getTextures().end() )
     {
-      spdlog::info( "deleted {} ", path );
+      spdlog::warn( "{} is still used by {}, not deleting it", path, meshPath );
       return;
     }
   }
-  spdlog::info( "file was not loaded so we did not delete anything" );
+
+  // the placeholder belongs to the streamer
+  auto id = pTexture->getTextureId();
+  if ( id != 0 && id != m_textureStreamer.getPlaceholder() )
+    glDeleteTextures( 1, &id );
+
+  m_textureStreamer.forget( pTexture );
+  m_loadedTextures.erase( it );
+  spdlog::info( "deleted {} ", path );
 }
 
 auto AssetManager::getTextureById( uint32_t id ) -> std::weak_ptr<kogayonon_resources::Texture>
 {
-  for ( const auto& [texturePath, texture] : m_loadedTextures )
   {
-    if ( texture->getTextureId() == id )
-      return texture;
+    std::lock_guard lock{ m_assetMutex };
+    for ( const auto& [texturePath, texture] : m_loadedTextures )
+    {
+      if ( texture->getTextureId() == id )
+        return texture;
+    }
   }
   return getTexture( "default" );
 }
 
 auto AssetManager::getMesh( const std::string& meshPath ) -> kogayonon_resources::Mesh*
 {
+  std::lock_guard lock{ m_assetMutex };
   if ( !m_loadedMeshes.contains( meshPath ) )
     return nullptr;
 
@@ -390,56 +709,57 @@ void AssetManager::parseIndices( cgltf_accessor* accessor, std::vector<uint32_t>
   }
 }
 
-void AssetManager::parseTextures( const cgltf_material* material, std::vector<kogayonon_resources::Texture*>& textures )
+auto AssetManager::parseMaterial( const cgltf_material* material, std::vector<kogayonon_resources::Texture*>& textures )
+  -> kogayonon_resources::Material
 {
+  kogayonon_resources::Material result;
   if ( !material )
-    return;
+    return result;
 
-  if ( material->normal_texture.texture && material->normal_texture.texture->image )
-  {
-    std::string uri = material->normal_texture.texture->image->uri;
-    std::filesystem::path texturePath = std::filesystem::absolute( "resources" ) / uri;
-    std::string textureName = texturePath.filename().string();
+  result.normalTexture = parseTexture( material->normal_texture, textures );
 
-    std::shared_ptr<kogayonon_resources::Texture> texture;
+  if ( material->has_pbr_metallic_roughness )
+  {
+    const auto& pbr = material->pbr_metallic_roughness;
+    result.baseColorTexture = parseTexture( pbr.base_color_texture, textures );
+    result.baseColorFactor = glm::make_vec4( pbr.base_color_factor );
+  }
 
-    if ( m_loadedTextures.contains( texturePath.string() ) )
-    {
-      texture = m_loadedTextures.at( texturePath.string() );
-    }
-    else
-    {
-      texture = std::make_shared<kogayonon_resources::Texture>( texturePath.string(), textureName );
+  return result;
+}
 
-      if ( !m_loadedTextures.contains( texturePath.string() ) )
-        m_loadedTextures.emplace( texturePath.string(), texture );
-    }
+auto AssetManager::parseTexture( const cgltf_texture_view& view,
+                                 std::vector<kogayonon_resources::Texture*>& textures ) -> int32_t
+{
+  if ( !view.texture || !view.texture->image || !view.texture->image->uri )
+    return -1;
 
-    textures.push_back( texture.get() );
-  }
+  return addMeshTexture( std::filesystem::absolute( "resources" ) / view.texture->image->uri, textures );
+}
 
-  if ( material->has_pbr_metallic_roughness && material->pbr_metallic_roughness.base_color_texture.texture &&
-       material->pbr_metallic_roughness.base_color_texture.texture->image )
-  {
-    std::string uri = material->pbr_metallic_roughness.base_color_texture.texture->image->uri;
-    std::filesystem::path texturePath = std::filesystem::absolute( "resources" ) / uri;
-    std::string textureName = texturePath.filename().string();
+auto AssetManager::addMeshTexture( const std::filesystem::path& texturePath,
+                                   std::vector<kogayonon_resources::Texture*>& textures ) -> int32_t
+{
+  std::string textureName = texturePath.filename().string();
 
-    std::shared_ptr<kogayonon_resources::Texture> texture;
+  std::shared_ptr<kogayonon_resources::Texture> texture;
+  std::lock_guard lock{ m_assetMutex };
 
-    if ( m_loadedTextures.contains( texturePath.string() ) )
-    {
-      texture = m_loadedTextures.at( texturePath.string() );
-    }
-    else
-    {
-      texture = std::make_shared<kogayonon_resources::Texture>( texturePath.string(), textureName );
+  if ( m_loadedTextures.contains( texturePath.string() ) )
+  {
+    texture = m_loadedTextures.at( texturePath.string() );
+  }
+  else
+  {
+    texture = std::make_shared<kogayonon_resources::Texture>( texturePath.string(), textureName );
+    m_loadedTextures.emplace( texturePath.string(), texture );
+  }
 
-      if ( !m_loadedTextures.contains( texturePath.string() ) )
-        m_loadedTextures.emplace( texturePath.string(), texture );
-    }
+  // primitives often share textures, the mesh only keeps one entry per texture
+  if ( auto it = std::find( textures.begin(), textures.end(), texture.get() ); it != textures.end() )
+    return static_cast<int32_t>( std::distance( textures.begin(), it ) );
 
-    textures.push_back( texture.get() );
-  }
+  textures.push_back( texture.get() );
+  return static_cast<int32_t>( textures.size() - 1 );
 }
 } // namespace kogayonon_utilities
\ No newline at end of file
@@ -0,0 +1,321 @@
+#include "utilities/bcn/bcn.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace kogayonon_utilities
+{
+namespace
+{
+// interpolation weights of the 4 bit bc7 indices, out of 64
+constexpr std::array<int, 16> bc7Weights{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct BitWriter
+{
+  uint8_t* pOut{ nullptr };
+  uint32_t bit{ 0 };
+
+  void write( uint32_t value, uint32_t count )
+  {
+    for ( auto i = 0u; i < count; i++, bit++ )
+    {
+      if ( ( value >> i ) & 1u )
+        pOut[bit >> 3] |= static_cast<uint8_t>( 1u << ( bit & 7u ) );
+    }
+  }
+};
+
+// one channel into 8 bytes, the two endpoints are the extremes so every value lands on one of 8 steps between them
+void encodeBc4( const uint8_t* pTexels, uint32_t channel, uint8_t* pOut )
+{
+  uint8_t low = 255;
+  uint8_t high = 0;
+  for ( auto i = 0u; i < 16; i++ )
+  {
+    low = std::min( low, pTexels[i * 4 + channel] );
+    high = std::max( high, pTexels[i * 4 + channel] );
+  }
+
+  std::memset( pOut, 0, 8 );
+  pOut[0] = high;
+  pOut[1] = low;
+  if ( high == low )
+    return;
+
+  // high > low picks the 8 value palette
+  std::array<int, 8> palette{ high, low };
+  for ( auto i = 2; i < 8; i++ )
+    palette[i] = ( ( 8 - i ) * high + ( i - 1 ) * low ) / 7;
+
+  BitWriter writer{ .pOut = pOut + 2 };
+  for ( auto i = 0u; i < 16; i++ )
+  {
+    const int value = pTexels[i * 4 + channel];
+    uint32_t best = 0;
+    for ( auto j = 1u; j < 8; j++ )
+    {
+      if ( std::abs( palette[j] - value ) < std::abs( palette[best] - value ) )
+        best = j;
+    }
+    writer.write( best, 3 );
+  }
+}
+
+struct Bc7Endpoints
+{
+  // 7 bits per channel, the p bit is the shared lowest bit of the 8 bit value
+  std::array<std::array<int, 4>, 2> colors{};
+  std::array<int, 2> pBits{};
+
+  auto expand( uint32_t endpoint, uint32_t channel ) const -> int
+  {
+    return ( colors[endpoint][channel] << 1 ) | pBits[endpoint];
+  }
+};
+
+// the p bit is shared by all channels so both choices get tried
+void quantizeEndpoint( const std::array<float, 4>& color, Bc7Endpoints& endpoints, uint32_t endpoint )
+{
+  auto bestError = std::numeric_limits<float>::max();
+  for ( auto p = 0; p < 2; p++ )
+  {
+    std::array<int, 4> quantized{};
+    auto error = 0.0f;
+    for ( auto c = 0u; c < 4; c++ )
+    {
+      const auto value = std::clamp( color[c], 0.0f, 255.0f );
+      const auto rounded = static_cast<int>( std::lround( ( value - static_cast<float>( p ) ) * 0.5f ) );
+      quantized[c] = std::clamp( rounded, 0, 127 );
+      const auto difference = value - static_cast<float>( ( quantized[c] << 1 ) | p );
+      error += difference * difference;
+    }
+
+    if ( error < bestError )
+    {
+      bestError = error;
+      endpoints.colors[endpoint] = quantized;
+      endpoints.pBits[endpoint] = p;
+    }
+  }
+}
+
+// picks the closest palette entry for every texel and returns the summed squared error
+auto assignIndices( const uint8_t* pTexels, const Bc7Endpoints& endpoints, std::array<uint32_t, 16>& indices ) -> int
+{
+  std::array<std::array<int, 4>, 16> palette{};
+  for ( auto i = 0u; i < 16; i++ )
+  {
+    for ( auto c = 0u; c < 4; c++ )
+    {
+      const auto weight = bc7Weights[i];
+      palette[i][c] = ( ( 64 - weight ) * endpoints.expand( 0, c ) + weight * endpoints.expand( 1, c ) + 32 ) >> 6;
+    }
+  }
+
+  auto total = 0;
+  for ( auto t = 0u; t < 16; t++ )
+  {
+    auto bestError = std::numeric_limits<int>::max();
+    for ( auto i = 0u; i < 16; i++ )
+    {
+      auto error = 0;
+      for ( auto c = 0u; c < 4; c++ )
+      {
+        const auto difference = palette[i][c] - pTexels[t * 4 + c];
+        error += difference * difference;
+      }
+
+      if ( error < bestError )
+      {
+        bestError = error;
+        indices[t] = i;
+      }
+    }
+    total += bestError;
+  }
+  return total;
+}
+
+// endpoints that minimize the squared error for fixed indices, false when every texel got the same weight
+auto solveEndpoints( const uint8_t* pTexels, const std::array<uint32_t, 16>& indices,
+                     std::array<std::array<float, 4>, 2>& colors ) -> bool
+{
+  auto aa = 0.0f;
+  auto ab = 0.0f;
+  auto bb = 0.0f;
+  std::array<float, 4> ax{};
+  std::array<float, 4> bx{};
+  for ( auto t = 0u; t < 16; t++ )
+  {
+    const auto b = static_cast<float>( bc7Weights[indices[t]] ) / 64.0f;
+    const auto a = 1.0f - b;
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+    for ( auto c = 0u; c < 4; c++ )
+    {
+      ax[c] += a * pTexels[t * 4 + c];
+      bx[c] += b * pTexels[t * 4 + c];
+    }
+  }
+
+  const auto determinant = aa * bb - ab * ab;
+  if ( std::abs( determinant ) < 1e-6f )
+    return false;
+
+  for ( auto c = 0u; c < 4; c++ )
+  {
+    colors[0][c] = ( bb * ax[c] - ab * bx[c] ) / determinant;
+    colors[1][c] = ( aa * bx[c] - ab * ax[c] ) / determinant;
+  }
+  return true;
+}
+
+// mode 6, a single subset with 7777 endpoints plus p bits and 4 bit indices. The endpoints start at the extremes
+// along the principal axis of the block and get one least squares pass
+void encodeBc7( const uint8_t* pTexels, uint8_t* pOut )
+{
+  std::array<float, 4> mean{};
+  for ( auto t = 0u; t < 16; t++ )
+  {
+    for ( auto c = 0u; c < 4; c++ )
+      mean[c] += pTexels[t * 4 + c] / 16.0f;
+  }
+
+  std::array<std::array<float, 4>, 4> covariance{};
+  for ( auto t = 0u; t < 16; t++ )
+  {
+    for ( auto i = 0u; i < 4; i++ )
+    {
+      for ( auto j = 0u; j < 4; j++ )
+        covariance[i][j] += ( pTexels[t * 4 + i] - mean[i] ) * ( pTexels[t * 4 + j] - mean[j] );
+    }
+  }
+
+  // a few power iterations are plenty for a 4x4 matrix
+  std::array<float, 4> axis{ 1.0f, 1.0f, 1.0f, 1.0f };
+  for ( auto iteration = 0; iteration < 8; iteration++ )
+  {
+    std::array<float, 4> next{};
+    for ( auto i = 0u; i < 4; i++ )
+    {
+      for ( auto j = 0u; j < 4; j++ )
+        next[i] += covariance[i][j] * axis[j];
+    }
+
+    const auto length = std::sqrt( next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3] );
+    if ( length < 1e-6f )
+      break;
+
+    for ( auto c = 0u; c < 4; c++ )
+      axis[c] = next[c] / length;
+  }
+
+  auto low = std::numeric_limits<float>::max();
+  auto high = std::numeric_limits<float>::lowest();
+  for ( auto t = 0u; t < 16; t++ )
+  {
+    auto projection = 0.0f;
+    for ( auto c = 0u; c < 4; c++ )
+      projection += ( pTexels[t * 4 + c] - mean[c] ) * axis[c];
+    low = std::min( low, projection );
+    high = std::max( high, projection );
+  }
+
+  std::array<std::array<float, 4>, 2> colors{};
+  for ( auto c = 0u; c < 4; c++ )
+  {
+    colors[0][c] = mean[c] + axis[c] * low;
+    colors[1][c] = mean[c] + axis[c] * high;
+  }
+
+  Bc7Endpoints endpoints;
+  quantizeEndpoint( colors[0], endpoints, 0 );
+  quantizeEndpoint( colors[1], endpoints, 1 );
+  std::array<uint32_t, 16> indices{};
+  auto error = assignIndices( pTexels, endpoints, indices );
+
+  if ( error != 0 && solveEndpoints( pTexels, indices, colors ) )
+  {
+    Bc7Endpoints refined;
+    quantizeEndpoint( colors[0], refined, 0 );
+    quantizeEndpoint( colors[1], refined, 1 );
+    std::array<uint32_t, 16> refinedIndices{};
+    if ( const auto refinedError = assignIndices( pTexels, refined, refinedIndices ); refinedError < error )
+    {
+      endpoints = refined;
+      indices = refinedIndices;
+      error = refinedError;
+    }
+  }
+
+  // the top bit of the first index is implied zero, swapping the endpoints flips the indices to get there
+  if ( indices[0] & 8u )
+  {
+    std::swap( endpoints.colors[0], endpoints.colors[1] );
+    std::swap( endpoints.pBits[0], endpoints.pBits[1] );
+    for ( auto& index : indices )
+      index = 15u - index;
+  }
+
+  std::memset( pOut, 0, 16 );
+  BitWriter writer{ .pOut = pOut };
+  writer.write( 1u << 6, 7 );
+  for ( auto c = 0u; c < 4; c++ )
+  {
+    writer.write( static_cast<uint32_t>( endpoints.colors[0][c] ), 7 );
+    writer.write( static_cast<uint32_t>( endpoints.colors[1][c] ), 7 );
+  }
+  writer.write( static_cast<uint32_t>( endpoints.pBits[0] ), 1 );
+  writer.write( static_cast<uint32_t>( endpoints.pBits[1] ), 1 );
+
+  writer.write( indices[0], 3 );
+  for ( auto t = 1u; t < 16; t++ )
+    writer.write( indices[t], 4 );
+}
+} // namespace
+
+void encodeBlock( BlockFormat format, const uint8_t* pTexels, uint8_t* pOut )
+{
+  switch ( format )
+  {
+  case BlockFormat::BC5:
+    encodeBc4( pTexels, 0, pOut );
+    encodeBc4( pTexels, 1, pOut + 8 );
+    break;
+  case BlockFormat::BC7:
+    encodeBc7( pTexels, pOut );
+    break;
+  }
+}
+
+void compressImage( BlockFormat format, const uint8_t* pPixels, int width, int height, std::vector<uint8_t>& out )
+{
+  const auto blockBytes = getBlockBytes( format );
+  auto offset = out.size();
+  out.resize( offset + getCompressedSize( format, width, height ) );
+
+  std::array<uint8_t, 64> texels{};
+  for ( auto blockY = 0; blockY < height; blockY += 4 )
+  {
+    for ( auto blockX = 0; blockX < width; blockX += 4 )
+    {
+      for ( auto y = 0; y < 4; y++ )
+      {
+        const auto row = std::min( blockY + y, height - 1 );
+        for ( auto x = 0; x < 4; x++ )
+        {
+          const auto column = std::min( blockX + x, width - 1 );
+          const auto* pTexel = pPixels + ( static_cast<std::size_t>( row ) * width + column ) * 4;
+          std::memcpy( &texels[( y * 4 + x ) * 4], pTexel, 4 );
+        }
+      }
+
+      encodeBlock( format, texels.data(), out.data() + offset );
+      offset += blockBytes;
+    }
+  }
+}
+} // namespace kogayonon_utilities
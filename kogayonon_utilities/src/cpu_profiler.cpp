@@ -0,0 +1,40 @@
+#include "utilities/cpu_profiler/cpu_profiler.hpp"
+
+namespace kogayonon_utilities
+{
+ZoneRing::ZoneRing( uint32_t threadIndex )
+    : m_threadIndex{ threadIndex }
+{
+}
+
+void CpuProfiler::record( const ProfileZone* zone, uint64_t start, uint64_t end ) noexcept
+{
+  getThreadRing().push( ZoneSample{ .zone = zone, .start = start, .end = end } );
+}
+
+auto CpuProfiler::internZone( std::string_view name ) -> const ProfileZone*
+{
+  std::lock_guard lock{ m_zoneMutex };
+  if ( const auto zone = m_zoneLookup.find( name ); zone != m_zoneLookup.end() )
+    return zone->second;
+
+  // the zone points into its own string, both live as long as the program
+  auto& pInterned = m_internedZones.emplace_back( std::make_unique<InternedZone>() );
+  pInterned->name = name;
+  pInterned->zone = ProfileZone{ .name = pInterned->name.c_str(), .file = "", .line = 0 };
+  m_zoneLookup.emplace( pInterned->name, &pInterned->zone );
+  return &pInterned->zone;
+}
+
+auto CpuProfiler::getThreadRing() -> ZoneRing&
+{
+  thread_local ZoneRing* pRing = nullptr;
+  if ( pRing )
+    return *pRing;
+
+  // rings are never freed, a thread that exits leaves its last samples to be drained
+  std::lock_guard lock{ m_ringMutex };
+  pRing = m_rings.emplace_back( std::make_unique<ZoneRing>( static_cast<uint32_t>( m_rings.size() ) ) ).get();
+  return *pRing;
+}
+} // namespace kogayonon_utilities
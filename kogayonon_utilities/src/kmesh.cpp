@@ -0,0 +1,213 @@
+#include "utilities/kmesh/kmesh.hpp"
+#include <algorithm>
+#include <cgltf.h>
+#include <cstring>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <type_traits>
+#include "utilities/shader/uniform_table.hpp"
+
+namespace kogayonon_utilities
+{
+namespace
+{
+static_assert( std::is_trivially_copyable_v<kogayonon_resources::Vertex> );
+static_assert( std::is_trivially_copyable_v<kogayonon_resources::Submesh> );
+static_assert( std::is_trivially_copyable_v<kogayonon_resources::Material> );
+
+constexpr uint64_t sectionAlignment = 16;
+
+inline auto alignSection( uint64_t offset ) -> uint64_t
+{
+  return ( offset + sectionAlignment - 1 ) / sectionAlignment * sectionAlignment;
+}
+
+inline auto hashValue( uint64_t value, uint64_t hash ) -> uint64_t
+{
+  return hashString( std::string_view{ reinterpret_cast<const char*>( &value ), sizeof( value ) }, hash );
+}
+
+inline auto fitsInFile( uint64_t offset, uint64_t count, uint64_t stride, uint64_t fileSize ) -> bool
+{
+  return offset <= fileSize && count <= ( fileSize - offset ) / std::max<uint64_t>( stride, 1 );
+}
+} // namespace
+
+auto getCookedMeshPath( const std::filesystem::path& source ) -> std::filesystem::path
+{
+  auto path = source;
+  path.replace_extension( ".kmesh" );
+  return path;
+}
+
+auto hashMeshSource( const std::filesystem::path& source ) -> uint64_t
+{
+  std::ifstream file{ source, std::ios::binary };
+  if ( !file )
+    return 0;
+
+  const std::string contents{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+  auto hash = hashString( contents );
+
+  // only the json is parsed, the buffers are not loaded
+  cgltf_options options{};
+  cgltf_data* data = nullptr;
+  if ( cgltf_parse( &options, contents.data(), contents.size(), &data ) != cgltf_result_success )
+    return hash;
+
+  for ( size_t i = 0; i < data->buffers_count; i++ )
+  {
+    const auto* uri = data->buffers[i].uri;
+    if ( !uri || std::strncmp( uri, "data:", 5 ) == 0 )
+      continue;
+
+    std::error_code error;
+    const auto bufferPath = source.parent_path() / uri;
+    const auto size = std::filesystem::file_size( bufferPath, error );
+    const auto time = std::filesystem::last_write_time( bufferPath, error );
+    hash = hashValue( error ? 0 : size, hash );
+    hash = hashValue( error ? 0 : static_cast<uint64_t>( time.time_since_epoch().count() ), hash );
+  }
+
+  cgltf_free( data );
+  return hash;
+}
+
+auto readCookedMesh( const std::filesystem::path& path, uint64_t sourceHash, CookedMesh& mesh ) -> bool
+{
+  auto pFile = std::make_shared<MappedFile>();
+  if ( !pFile->open( path ) || pFile->getSize() < sizeof( KMeshHeader ) )
+    return false;
+
+  KMeshHeader header;
+  std::memcpy( &header, pFile->getData(), sizeof( header ) );
+
+  const KMeshHeader expected{};
+  if ( header.magic != kmeshMagic || header.version != kmeshVersion || header.sourceHash != sourceHash ||
+       header.vertexStride != expected.vertexStride || header.submeshStride != expected.submeshStride ||
+       header.materialStride != expected.materialStride )
+    return false;
+
+  const auto size = static_cast<uint64_t>( pFile->getSize() );
+  if ( header.fileSize != size ||
+       !fitsInFile( header.vertexOffset, header.vertexCount, sizeof( kogayonon_resources::Vertex ), size ) ||
+       !fitsInFile( header.indexOffset, header.indexCount, sizeof( uint32_t ), size ) ||
+       !fitsInFile( header.submeshOffset, header.submeshCount, sizeof( kogayonon_resources::Submesh ), size ) ||
+       !fitsInFile( header.materialOffset, header.materialCount, sizeof( kogayonon_resources::Material ), size ) ||
+       header.textureOffset > size )
+  {
+    spdlog::warn( "Cooked mesh {} is broken, cooking it again", path.string() );
+    return false;
+  }
+
+  const auto* data = pFile->getData();
+  mesh.vertices = std::span{ reinterpret_cast<const kogayonon_resources::Vertex*>( data + header.vertexOffset ),
+                             header.vertexCount };
+  mesh.indices = std::span{ reinterpret_cast<const uint32_t*>( data + header.indexOffset ), header.indexCount };
+
+  // the tables are tiny, copying them lets the mesh own and edit them
+  mesh.submeshes.resize( header.submeshCount );
+  std::memcpy( mesh.submeshes.data(), data + header.submeshOffset, header.submeshCount * header.submeshStride );
+  mesh.materials.resize( header.materialCount );
+  std::memcpy( mesh.materials.data(), data + header.materialOffset, header.materialCount * header.materialStride );
+
+  // every texture is its length followed by the characters
+  mesh.textures.clear();
+  auto offset = header.textureOffset;
+  for ( auto i = 0u; i < header.textureCount; i++ )
+  {
+    uint32_t length = 0;
+    if ( !fitsInFile( offset, 1, sizeof( length ), size ) )
+      return false;
+
+    std::memcpy( &length, data + offset, sizeof( length ) );
+    offset += sizeof( length );
+    if ( !fitsInFile( offset, length, 1, size ) )
+      return false;
+
+    mesh.textures.emplace_back( reinterpret_cast<const char*>( data + offset ), length );
+    offset += length;
+  }
+
+  mesh.pFile = std::move( pFile );
+  return true;
+}
+
+auto writeCookedMesh( const std::filesystem::path& path, uint64_t sourceHash,
+                      std::span<const kogayonon_resources::Vertex> vertices, std::span<const uint32_t> indices,
+                      const std::vector<kogayonon_resources::Submesh>& submeshes,
+                      const std::vector<kogayonon_resources::Material>& materials,
+                      const std::vector<std::string>& textures ) -> bool
+{
+  KMeshHeader header{ .sourceHash = sourceHash,
+                      .vertexCount = static_cast<uint32_t>( vertices.size() ),
+                      .indexCount = static_cast<uint32_t>( indices.size() ),
+                      .submeshCount = static_cast<uint32_t>( submeshes.size() ),
+                      .materialCount = static_cast<uint32_t>( materials.size() ),
+                      .textureCount = static_cast<uint32_t>( textures.size() ) };
+
+  header.vertexOffset = alignSection( sizeof( KMeshHeader ) );
+  header.indexOffset = alignSection( header.vertexOffset + vertices.size_bytes() );
+  header.submeshOffset = alignSection( header.indexOffset + indices.size_bytes() );
+  header.materialOffset =
+    alignSection( header.submeshOffset + submeshes.size() * sizeof( kogayonon_resources::Submesh ) );
+  header.textureOffset =
+    alignSection( header.materialOffset + materials.size() * sizeof( kogayonon_resources::Material ) );
+
+  header.fileSize = header.textureOffset;
+  for ( const auto& texture : textures )
+    header.fileSize += sizeof( uint32_t ) + texture.size();
+
+  auto temporaryPath = path;
+  temporaryPath += ".tmp";
+
+  {
+    std::ofstream file{ temporaryPath, std::ios::binary | std::ios::trunc };
+    if ( !file )
+    {
+      spdlog::warn( "Could not write cooked mesh {}", path.string() );
+      return false;
+    }
+
+    const auto writeAt = [&file]( uint64_t offset, const void* data, std::size_t bytes ) {
+      // zero padding up to the section
+      static constexpr char padding[sectionAlignment]{};
+      const auto position = static_cast<uint64_t>( file.tellp() );
+      file.write( padding, static_cast<std::streamsize>( offset - position ) );
+      if ( bytes != 0 )
+        file.write( static_cast<const char*>( data ), static_cast<std::streamsize>( bytes ) );
+    };
+
+    writeAt( 0, &header, sizeof( header ) );
+    writeAt( header.vertexOffset, vertices.data(), vertices.size_bytes() );
+    writeAt( header.indexOffset, indices.data(), indices.size_bytes() );
+    writeAt( header.submeshOffset, submeshes.data(), submeshes.size() * sizeof( kogayonon_resources::Submesh ) );
+    writeAt( header.materialOffset, materials.data(), materials.size() * sizeof( kogayonon_resources::Material ) );
+    writeAt( header.textureOffset, nullptr, 0 );
+
+    for ( const auto& texture : textures )
+    {
+      const auto length = static_cast<uint32_t>( texture.size() );
+      file.write( reinterpret_cast<const char*>( &length ), sizeof( length ) );
+      file.write( texture.data(), length );
+    }
+
+    if ( !file )
+    {
+      spdlog::warn( "Could not write cooked mesh {}", path.string() );
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename( temporaryPath, path, error );
+  if ( error )
+  {
+    spdlog::warn( "Could not replace cooked mesh {}: {}", path.string(), error.message() );
+    std::filesystem::remove( temporaryPath, error );
+    return false;
+  }
+
+  return true;
+}
+} // namespace kogayonon_utilities
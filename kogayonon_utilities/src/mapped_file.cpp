@@ -0,0 +1,111 @@
+#include "utilities/mapped_file/mapped_file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kogayonon_utilities
+{
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+#ifdef _WIN32
+auto MappedFile::open( const std::filesystem::path& path ) -> bool
+{
+  close();
+
+  auto file = CreateFileW(
+    path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+  if ( file == INVALID_HANDLE_VALUE )
+    return false;
+
+  LARGE_INTEGER size{};
+  if ( !GetFileSizeEx( file, &size ) || size.QuadPart == 0 )
+  {
+    CloseHandle( file );
+    return false;
+  }
+
+  auto mapping = CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+  if ( !mapping )
+  {
+    CloseHandle( file );
+    return false;
+  }
+
+  auto data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+  if ( !data )
+  {
+    CloseHandle( mapping );
+    CloseHandle( file );
+    return false;
+  }
+
+  m_file = file;
+  m_mapping = mapping;
+  m_pData = static_cast<const uint8_t*>( data );
+  m_size = static_cast<std::size_t>( size.QuadPart );
+  return true;
+}
+
+void MappedFile::close()
+{
+  if ( m_pData )
+    UnmapViewOfFile( m_pData );
+  if ( m_mapping )
+    CloseHandle( m_mapping );
+  if ( m_file )
+    CloseHandle( m_file );
+
+  m_pData = nullptr;
+  m_mapping = nullptr;
+  m_file = nullptr;
+  m_size = 0;
+}
+#else
+auto MappedFile::open( const std::filesystem::path& path ) -> bool
+{
+  close();
+
+  const auto file = ::open( path.c_str(), O_RDONLY );
+  if ( file < 0 )
+    return false;
+
+  struct stat status{};
+  if ( fstat( file, &status ) != 0 || status.st_size == 0 )
+  {
+    ::close( file );
+    return false;
+  }
+
+  auto data = mmap( nullptr, static_cast<std::size_t>( status.st_size ), PROT_READ, MAP_PRIVATE, file, 0 );
+
+  // the mapping keeps the file alive on its own
+  ::close( file );
+  if ( data == MAP_FAILED )
+    return false;
+
+  m_pData = static_cast<const uint8_t*>( data );
+  m_size = static_cast<std::size_t>( status.st_size );
+  return true;
+}
+
+void MappedFile::close()
+{
+  if ( m_pData )
+    munmap( const_cast<uint8_t*>( m_pData ), m_size );
+
+  m_pData = nullptr;
+  m_size = 0;
+}
+#endif
+} // namespace kogayonon_utilities
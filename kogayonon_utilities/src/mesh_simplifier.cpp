@@ -0,0 +1,253 @@
+#include "utilities/mesh_simplifier/mesh_simplifier.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace kogayonon_utilities
+{
+namespace
+{
+// symmetric 4x4 matrix of the summed plane equations, w is the area they were weighted by
+struct Quadric
+{
+  double a2{ 0.0 }, ab{ 0.0 }, ac{ 0.0 }, ad{ 0.0 };
+  double b2{ 0.0 }, bc{ 0.0 }, bd{ 0.0 };
+  double c2{ 0.0 }, cd{ 0.0 };
+  double d2{ 0.0 };
+  double w{ 0.0 };
+};
+
+struct Collapse
+{
+  uint32_t from;
+  uint32_t to;
+  double cost;
+};
+
+void addPlane( Quadric& q, const glm::dvec3& n, double d, double weight )
+{
+  q.a2 += n.x * n.x * weight;
+  q.ab += n.x * n.y * weight;
+  q.ac += n.x * n.z * weight;
+  q.ad += n.x * d * weight;
+  q.b2 += n.y * n.y * weight;
+  q.bc += n.y * n.z * weight;
+  q.bd += n.y * d * weight;
+  q.c2 += n.z * n.z * weight;
+  q.cd += n.z * d * weight;
+  q.d2 += d * d * weight;
+  q.w += weight;
+}
+
+auto addQuadrics( const Quadric& a, const Quadric& b ) -> Quadric
+{
+  return Quadric{ a.a2 + b.a2, a.ab + b.ab, a.ac + b.ac, a.ad + b.ad, a.b2 + b.b2, a.bc + b.bc,
+                  a.bd + b.bd, a.c2 + b.c2, a.cd + b.cd, a.d2 + b.d2, a.w + b.w };
+}
+
+// mean squared distance of p to the planes of the quadric
+auto evaluate( const Quadric& q, const glm::vec3& point ) -> double
+{
+  const glm::dvec3 p{ point };
+  const auto value = p.x * p.x * q.a2 + p.y * p.y * q.b2 + p.z * p.z * q.c2 +
+                     2.0 * ( p.x * p.y * q.ab + p.x * p.z * q.ac + p.y * p.z * q.bc ) +
+                     2.0 * ( p.x * q.ad + p.y * q.bd + p.z * q.cd ) + q.d2;
+
+  return q.w > 0.0 ? std::max( value, 0.0 ) / q.w : 0.0;
+}
+
+inline auto packEdge( uint32_t a, uint32_t b ) -> uint64_t
+{
+  return a < b ? ( uint64_t{ a } << 32 ) | b : ( uint64_t{ b } << 32 ) | a;
+}
+
+// every edge of the list once per triangle that uses it, sorted so the shared ones are next to each other
+void collectEdges( const std::vector<uint32_t>& indices, std::vector<uint64_t>& edges )
+{
+  edges.clear();
+  edges.reserve( indices.size() );
+  for ( std::size_t i = 0; i + 2 < indices.size(); i += 3 )
+  {
+    edges.emplace_back( packEdge( indices[i], indices[i + 1] ) );
+    edges.emplace_back( packEdge( indices[i + 1], indices[i + 2] ) );
+    edges.emplace_back( packEdge( indices[i + 2], indices[i] ) );
+  }
+  std::sort( edges.begin(), edges.end() );
+}
+} // namespace
+
+auto simplifyMesh( const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices,
+                   std::size_t targetIndexCount, float maxError ) -> SimplifiedIndices
+{
+  SimplifiedIndices result{ .indices = indices };
+  if ( indices.size() <= targetIndexCount )
+    return result;
+
+  const auto vertexCount = positions.size();
+  std::vector<uint64_t> edges;
+
+  // an edge only one triangle uses is a border, its vertices stay where they are
+  std::vector<uint8_t> locked( vertexCount, 0 );
+  collectEdges( indices, edges );
+  for ( std::size_t i = 0; i < edges.size(); )
+  {
+    auto end = i + 1;
+    while ( end < edges.size() && edges[end] == edges[i] )
+      ++end;
+
+    if ( end - i == 1 )
+    {
+      locked[edges[i] >> 32] = 1;
+      locked[edges[i] & 0xffffffffu] = 1;
+    }
+    i = end;
+  }
+
+  std::vector<Quadric> quadrics( vertexCount );
+  for ( std::size_t i = 0; i + 2 < indices.size(); i += 3 )
+  {
+    const glm::dvec3 p0{ positions[indices[i]] };
+    const auto normal = glm::cross( glm::dvec3{ positions[indices[i + 1]] } - p0,
+                                    glm::dvec3{ positions[indices[i + 2]] } - p0 );
+    const auto length = glm::length( normal );
+    if ( length == 0.0 )
+      continue;
+
+    const auto n = normal / length;
+    const auto d = -glm::dot( n, p0 );
+    for ( auto corner = 0; corner < 3; corner++ )
+      addPlane( quadrics[indices[i + corner]], n, d, length * 0.5 );
+  }
+
+  const auto maxCost = static_cast<double>( maxError ) * maxError;
+  double resultCost = 0.0;
+
+  std::vector<uint32_t> remap( vertexCount );
+  std::vector<uint8_t> touched( vertexCount );
+  std::vector<uint32_t> adjacencyOffsets( vertexCount + 1 );
+  std::vector<uint32_t> adjacency;
+  std::vector<Collapse> collapses;
+
+  auto& current = result.indices;
+  while ( current.size() > targetIndexCount )
+  {
+    // triangles around every vertex
+    std::fill( adjacencyOffsets.begin(), adjacencyOffsets.end(), 0u );
+    for ( const auto index : current )
+      ++adjacencyOffsets[index + 1];
+    for ( std::size_t i = 1; i < adjacencyOffsets.size(); i++ )
+      adjacencyOffsets[i] += adjacencyOffsets[i - 1];
+
+    adjacency.resize( current.size() );
+    auto fill = adjacencyOffsets;
+    for ( std::size_t i = 0; i < current.size(); i++ )
+      adjacency[fill[current[i]]++] = static_cast<uint32_t>( i / 3 );
+
+    // cheapest direction of every edge
+    collectEdges( current, edges );
+    edges.erase( std::unique( edges.begin(), edges.end() ), edges.end() );
+
+    collapses.clear();
+    for ( const auto edge : edges )
+    {
+      const auto a = static_cast<uint32_t>( edge >> 32 );
+      const auto b = static_cast<uint32_t>( edge & 0xffffffffu );
+      if ( locked[a] && locked[b] )
+        continue;
+
+      const auto q = addQuadrics( quadrics[a], quadrics[b] );
+      const auto costAB = locked[a] ? std::numeric_limits<double>::max() : evaluate( q, positions[b] );
+      const auto costBA = locked[b] ? std::numeric_limits<double>::max() : evaluate( q, positions[a] );
+
+      const auto collapse = costAB <= costBA ? Collapse{ a, b, costAB } : Collapse{ b, a, costBA };
+      if ( collapse.cost <= maxCost )
+        collapses.emplace_back( collapse );
+    }
+
+    std::sort( collapses.begin(), collapses.end(), []( const Collapse& lhs, const Collapse& rhs ) {
+      return lhs.cost < rhs.cost;
+    } );
+
+    // collapses that share a triangle would read positions the other one already moved, so one per neighbourhood
+    for ( std::size_t i = 0; i < vertexCount; i++ )
+      remap[i] = static_cast<uint32_t>( i );
+    std::fill( touched.begin(), touched.end(), uint8_t{ 0 } );
+
+    const auto trianglesToRemove = ( current.size() - targetIndexCount ) / 3;
+    std::size_t removed = 0;
+    std::size_t applied = 0;
+
+    for ( const auto& collapse : collapses )
+    {
+      if ( removed >= trianglesToRemove )
+        break;
+
+      if ( touched[collapse.from] || touched[collapse.to] )
+        continue;
+
+      // moving a vertex must not turn any of its remaining triangles around
+      auto flips = false;
+      std::size_t degenerate = 0;
+      for ( auto k = adjacencyOffsets[collapse.from]; k < adjacencyOffsets[collapse.from + 1] && !flips; k++ )
+      {
+        const auto* triangle = &current[adjacency[k] * 3];
+        if ( triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to )
+        {
+          ++degenerate;
+          continue;
+        }
+
+        glm::vec3 before[3];
+        glm::vec3 after[3];
+        for ( auto corner = 0; corner < 3; corner++ )
+        {
+          before[corner] = positions[triangle[corner]];
+          after[corner] = triangle[corner] == collapse.from ? positions[collapse.to] : before[corner];
+        }
+
+        const auto normalBefore = glm::cross( before[1] - before[0], before[2] - before[0] );
+        const auto normalAfter = glm::cross( after[1] - after[0], after[2] - after[0] );
+        flips = glm::dot( normalBefore, normalAfter ) <= 0.0f;
+      }
+
+      if ( flips )
+        continue;
+
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to] = addQuadrics( quadrics[collapse.to], quadrics[collapse.from] );
+      resultCost = std::max( resultCost, collapse.cost );
+
+      for ( auto k = adjacencyOffsets[collapse.from]; k < adjacencyOffsets[collapse.from + 1]; k++ )
+      {
+        const auto* triangle = &current[adjacency[k] * 3];
+        touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+      }
+
+      removed += degenerate;
+      ++applied;
+    }
+
+    if ( applied == 0 )
+      break;
+
+    // a collapsed vertex never becomes the target of another one in the same pass so one lookup is enough
+    std::size_t write = 0;
+    for ( std::size_t i = 0; i + 2 < current.size(); i += 3 )
+    {
+      const auto a = remap[current[i]];
+      const auto b = remap[current[i + 1]];
+      const auto c = remap[current[i + 2]];
+      if ( a == b || b == c || c == a )
+        continue;
+
+      current[write++] = a;
+      current[write++] = b;
+      current[write++] = c;
+    }
+    current.resize( write );
+  }
+
+  result.error = static_cast<float>( std::sqrt( resultCost ) );
+  return result;
+}
+} // namespace kogayonon_utilities
@@ -1,32 +1,206 @@
 #include "utilities/shader/shader.hpp"
+#include <algorithm>
 #include <assert.h>
+#include <cstring>
+#include <format>
 #include <fstream>
 #include <glad/glad.h>
 #include <glm/gtc/type_ptr.hpp>
+#include <iterator>
 #include <spdlog/spdlog.h>
+#include <vector>
+
+// glad only has the core profile, the enum is the same for the KHR and ARB versions of the extension
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 namespace kogayonon_utilities
 {
+namespace
+{
+auto hasExtension( const char* name ) -> bool
+{
+  int count = 0;
+  glGetIntegerv( GL_NUM_EXTENSIONS, &count );
+  for ( auto i = 0; i < count; i++ )
+  {
+    if ( std::strcmp( reinterpret_cast<const char*>( glGetStringi( GL_EXTENSIONS, i ) ), name ) == 0 )
+      return true;
+  }
+  return false;
+}
+} // namespace
+
+auto Shader::supportsParallelCompile() -> bool
+{
+  static const bool supported =
+    hasExtension( "GL_KHR_parallel_shader_compile" ) || hasExtension( "GL_ARB_parallel_shader_compile" );
+  return supported;
+}
+
+auto Shader::supportsProgramBinaries() -> bool
+{
+  static const bool supported = [] {
+    int formats = 0;
+    glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &formats );
+    return formats > 0;
+  }();
+  return supported;
+}
 
 void Shader::initializeShaderSource( const std::string& vertexPath, const std::string& fragmentPath )
 {
   m_shaderSource = parseShaderFile( vertexPath, fragmentPath );
 }
 
-void Shader::initializeProgram()
+void Shader::initializeShaderSource( const std::string& vertexPath, const std::string& geometryPath,
+                                     const std::string& fragmentPath )
 {
-  // cache the paths
-  std::string v = m_shaderSource.vertexPath.string();
-  std::string f = m_shaderSource.fragmentPath.string();
+  m_shaderSource = parseShaderFile( vertexPath, fragmentPath );
+  readGeometryFile( geometryPath );
+}
+
+void Shader::initializeComputeSource( const std::string& computePath )
+{
+  m_shaderSource = parseComputeFile( computePath );
+}
+
+void Shader::beginCompilation( const std::filesystem::path& cacheDirectory )
+{
+  // the sources read when the shader was pushed are still good unless a file changed since
+  if ( m_sourceChanged )
+  {
+    if ( isCompute() )
+      m_shaderSource = parseComputeFile( m_shaderSource.computePath.string() );
+    else
+    {
+      const auto geometryPath = m_shaderSource.geometryPath;
+      m_shaderSource = parseShaderFile( m_shaderSource.vertexPath.string(), m_shaderSource.fragmentPath.string() );
+      if ( !geometryPath.empty() )
+        readGeometryFile( geometryPath );
+    }
+
+    m_sourceChanged = false;
+  }
 
-  // reparse the files
-  m_shaderSource = parseShaderFile( v, f );
-  m_programId = createShader();
+  m_fromCache = false;
+  m_cacheFile.clear();
+  if ( !cacheDirectory.empty() && supportsProgramBinaries() )
+    m_cacheFile = cacheDirectory / std::format( "{:016x}.bin", getSourceHash() );
+
+  m_pendingProgram = glCreateProgram();
+  if ( loadBinary() )
+  {
+    m_fromCache = true;
+    m_pending = true;
+    return;
+  }
+
+  if ( isCompute() )
+  {
+    m_pendingStages.emplace_back( compileStage( GL_COMPUTE_SHADER, m_shaderSource.computeSource ) );
+  }
+  else
+  {
+    m_pendingStages.emplace_back( compileStage( GL_VERTEX_SHADER, m_shaderSource.vertexSource ) );
+    if ( !m_shaderSource.geometrySource.empty() )
+      m_pendingStages.emplace_back( compileStage( GL_GEOMETRY_SHADER, m_shaderSource.geometrySource ) );
+    m_pendingStages.emplace_back( compileStage( GL_FRAGMENT_SHADER, m_shaderSource.fragmentSource ) );
+  }
+
+  for ( const auto stage : m_pendingStages )
+    glAttachShader( m_pendingProgram, stage );
+
+  // has to be set before linking or the driver might not keep what glGetProgramBinary needs
+  if ( !m_cacheFile.empty() )
+    glProgramParameteri( m_pendingProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+
+  // with parallel compile this returns right away, nothing below queries a status until finishCompilation
+  glLinkProgram( m_pendingProgram );
+  m_pending = true;
+}
+
+auto Shader::isReady() const -> bool
+{
+  if ( !m_pending )
+    return true;
+
+  if ( !supportsParallelCompile() )
+    return true;
+
+  int done = GL_FALSE;
+  glGetProgramiv( m_pendingProgram, GL_COMPLETION_STATUS_KHR, &done );
+  return done == GL_TRUE;
+}
+
+void Shader::finishCompilation()
+{
+  if ( !m_pending )
+    return;
+
+  m_pending = false;
+
+  int result;
+  glGetProgramiv( m_pendingProgram, GL_LINK_STATUS, &result );
+
+  for ( const auto stage : m_pendingStages )
+  {
+    if ( result == GL_FALSE )
+      logStageErrors( stage );
+
+    glDetachShader( m_pendingProgram, stage );
+    glDeleteShader( stage );
+  }
+  m_pendingStages.clear();
+
+  if ( result == GL_FALSE )
+  {
+    int length;
+    glGetProgramiv( m_pendingProgram, GL_INFO_LOG_LENGTH, &length );
+    std::string message( std::max( length, 1 ), '\0' );
+    glGetProgramInfoLog( m_pendingProgram, length, &length, message.data() );
+
+    spdlog::info( "Failed to link shader program {}", message );
+    glDeleteProgram( m_pendingProgram );
+    m_pendingProgram = 0;
+
+    // a broken edit keeps the last program that worked
+    m_isCompiled = true;
+    return;
+  }
+
+  if ( m_fromCache )
+  {
+    spdlog::info( "Loaded program {} from the binary cache", m_cacheFile.filename().string() );
+  }
+  else
+  {
+    spdlog::info( "Succesfully linked shaders" );
+    saveBinary();
+  }
+
+  if ( m_programId != 0 )
+    glDeleteProgram( m_programId );
+
+  m_programId = m_pendingProgram;
+  m_pendingProgram = 0;
+  reflect();
 
   // mark compiled
   m_isCompiled = true;
 }
 
+auto Shader::isPending() const -> bool
+{
+  return m_pending;
+}
+
+auto Shader::isFromCache() const -> bool
+{
+  return m_fromCache;
+}
+
 bool Shader::isCompiled() const
 {
   return m_isCompiled;
@@ -42,6 +216,21 @@ std::string Shader::getFragmentShaderPath()
   return m_shaderSource.fragmentPath.string();
 }
 
+std::string Shader::getComputeShaderPath()
+{
+  return m_shaderSource.computePath.string();
+}
+
+std::string Shader::getGeometryShaderPath()
+{
+  return m_shaderSource.geometryPath.string();
+}
+
+auto Shader::isCompute() const -> bool
+{
+  return !m_shaderSource.computePath.empty();
+}
+
 shader_source Shader::parseShaderFile( const std::string& vertPath, const std::string& fragPath )
 {
   std::ifstream vertexStream( vertPath );
@@ -85,50 +274,139 @@ shader_source Shader::parseShaderFile( const std::string& vertPath, const std::s
   return source;
 }
 
-void Shader::bind() const
+void Shader::readGeometryFile( const std::filesystem::path& geometryPath )
 {
-  glUseProgram( m_programId );
-}
+  m_shaderSource.geometryPath = geometryPath;
 
-void Shader::unbind() const
-{
-  glUseProgram( 0 );
+  std::ifstream geometryStream( geometryPath );
+  if ( !geometryStream.is_open() )
+  {
+    spdlog::error( "Failed to open shader file {}", geometryPath.string() );
+    return;
+  }
+
+  std::stringstream geometry_ss;
+  geometry_ss << geometryStream.rdbuf();
+  m_shaderSource.geometrySource = geometry_ss.str();
 }
 
-void Shader::setInt( const char* uniform, int value ) const
+shader_source Shader::parseComputeFile( const std::string& computePath )
 {
-  if ( int location = glGetUniformLocation( m_programId, uniform ); location == -1 )
+  std::ifstream computeStream( computePath );
+  if ( !computeStream.is_open() )
   {
-    // Uniform not found, print a warning or error message
-    spdlog::error( "Uniform not found {} ", uniform );
-  }
-  else
-  {
-    glUniform1i( location, value ); // Set the uniform value
+    spdlog::error( "Failed to open shader file {}", computePath );
+    return shader_source{ .computePath = computePath };
   }
+
+  std::stringstream compute_ss;
+  compute_ss << computeStream.rdbuf();
+
+  shader_source source{ .computeSource = compute_ss.str(), .computePath = computePath };
+  return source;
 }
 
-void Shader::setMat4( const char* uniform, const glm::mat4& mat )
+void Shader::setInt( UniformName uniform, int value ) const
 {
-  if ( int location = glGetUniformLocation( m_programId, uniform ); location == -1 )
-  {
-    spdlog::error( "Uniform not found {} ", uniform );
-  }
-  else
-  {
-    glUniformMatrix4fv( location, 1, GL_FALSE, glm::value_ptr( mat ) );
-  }
+  if ( const auto location = getUniformLocation( uniform ); location != -1 )
+    glProgramUniform1i( m_programId, location, value );
+}
+
+void Shader::setMat4( UniformName uniform, const glm::mat4& mat )
+{
+  if ( const auto location = getUniformLocation( uniform ); location != -1 )
+    glProgramUniformMatrix4fv( m_programId, location, 1, GL_FALSE, glm::value_ptr( mat ) );
+}
+
+void Shader::setBool( UniformName uniform, bool value ) const
+{
+  if ( const auto location = getUniformLocation( uniform ); location != -1 )
+    glProgramUniform1i( m_programId, location, value );
+}
+
+void Shader::setUint( UniformName uniform, uint32_t value ) const
+{
+  if ( const auto location = getUniformLocation( uniform ); location != -1 )
+    glProgramUniform1ui( m_programId, location, value );
+}
+
+void Shader::setVec4( UniformName uniform, const glm::vec4& vec ) const
+{
+  if ( const auto location = getUniformLocation( uniform ); location != -1 )
+    glProgramUniform4fv( m_programId, location, 1, glm::value_ptr( vec ) );
+}
+
+void Shader::setUvec4( UniformName uniform, const glm::uvec4& vec ) const
+{
+  if ( const auto location = getUniformLocation( uniform ); location != -1 )
+    glProgramUniform4uiv( m_programId, location, 1, glm::value_ptr( vec ) );
+}
+
+auto Shader::getUniformLocation( UniformName uniform ) const -> int
+{
+  const auto location = m_uniforms.find( uniform );
+  if ( location == -1 && m_reportedMissing.insert( uniform.getHash() ).second )
+    spdlog::error( "Uniform not found {} ", uniform.getName() );
+
+  return location;
 }
 
-void Shader::setBool( const char* uniform, bool value ) const
+auto Shader::hasBlock( const char* block ) const -> bool
 {
-  if ( int location = glGetUniformLocation( m_programId, uniform ); location == -1 )
+  return m_blocks.contains( hashUniformName( block ) );
+}
+
+void Shader::reflect()
+{
+  m_uniforms.clear();
+  m_blocks.clear();
+  m_reportedMissing.clear();
+
+  if ( m_programId == 0 )
+    return;
+
+  std::string name;
+  auto readName = [&]( GLenum interface, int index, int length ) {
+    name.resize( length );
+    glGetProgramResourceName( m_programId, interface, index, length, nullptr, name.data() );
+    // the length we get counts the null terminator
+    name.resize( length > 0 ? length - 1 : 0 );
+  };
+
+  int uniformCount = 0;
+  glGetProgramInterfaceiv( m_programId, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount );
+
+  const GLenum properties[]{ GL_NAME_LENGTH, GL_LOCATION };
+  for ( auto i = 0; i < uniformCount; i++ )
   {
-    spdlog::error( "Uniform not found {} ", uniform );
+    int values[2]{};
+    glGetProgramResourceiv( m_programId, GL_UNIFORM, i, 2, properties, 2, nullptr, values );
+
+    // members of uniform blocks have no location, they are written through the buffer
+    if ( values[1] == -1 )
+      continue;
+
+    readName( GL_UNIFORM, i, values[0] );
+    m_uniforms.add( name, values[1] );
+
+    // arrays are reported as name[0], make the plain name work too
+    if ( name.ends_with( "[0]" ) )
+      m_uniforms.add( std::string_view{ name }.substr( 0, name.size() - 3 ), values[1] );
   }
-  else
+
+  for ( const auto interface : { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK } )
   {
-    glUniform1i( location, value );
+    int blockCount = 0;
+    glGetProgramInterfaceiv( m_programId, interface, GL_ACTIVE_RESOURCES, &blockCount );
+
+    const GLenum nameLength = GL_NAME_LENGTH;
+    for ( auto i = 0; i < blockCount; i++ )
+    {
+      int length = 0;
+      glGetProgramResourceiv( m_programId, interface, i, 1, &nameLength, 1, nullptr, &length );
+      readName( interface, i, length );
+      m_blocks.insert( hashUniformName( name ) );
+    }
   }
 }
 
@@ -137,75 +415,142 @@ auto Shader::getShaderId() const -> uint32_t
   return m_programId;
 }
 
-auto Shader::compileShader( uint32_t shader_type, std::string& source_data ) -> uint32_t
+auto Shader::compileStage( uint32_t shaderType, const std::string& source ) -> uint32_t
 {
-  auto id = glCreateShader( shader_type );
-  const char* m_shaderSource = source_data.c_str();
-  glShaderSource( id, 1, &m_shaderSource, nullptr );
+  auto id = glCreateShader( shaderType );
+  const char* sourceData = source.c_str();
+  glShaderSource( id, 1, &sourceData, nullptr );
   glCompileShader( id );
-  int result;
-  glGetShaderiv( id, GL_COMPILE_STATUS, &result );
-  if ( result == GL_FALSE )
-  {
-    int length;
-    glGetShaderiv( id, GL_INFO_LOG_LENGTH, &length );
-    auto message = (char*)_malloca( length * sizeof( char ) );
-    glGetShaderInfoLog( id, length, &length, message );
-    if ( shader_type == GL_VERTEX_SHADER )
-    {
-      spdlog::info( "Failed to compile vertex shader:{}", message );
-    }
-    else if ( shader_type == GL_FRAGMENT_SHADER )
-    {
-      spdlog::info( "Failed to compile fragment shader:{}", message );
-    }
-    glDeleteShader( id );
-    return 0;
-  }
-  spdlog::info( "Shader compilation is done" );
-  ;
   return id;
 }
 
-void Shader::destroy() const
+void Shader::logStageErrors( uint32_t stage ) const
 {
-  glDeleteProgram( m_programId );
+  int result;
+  glGetShaderiv( stage, GL_COMPILE_STATUS, &result );
+  if ( result == GL_TRUE )
+    return;
+
+  int length;
+  glGetShaderiv( stage, GL_INFO_LOG_LENGTH, &length );
+  std::string message( std::max( length, 1 ), '\0' );
+  glGetShaderInfoLog( stage, length, &length, message.data() );
+
+  int shaderType;
+  glGetShaderiv( stage, GL_SHADER_TYPE, &shaderType );
+  if ( shaderType == GL_VERTEX_SHADER )
+  {
+    spdlog::info( "Failed to compile vertex shader:{}", message );
+  }
+  else if ( shaderType == GL_FRAGMENT_SHADER )
+  {
+    spdlog::info( "Failed to compile fragment shader:{}", message );
+  }
+  else if ( shaderType == GL_COMPUTE_SHADER )
+  {
+    spdlog::info( "Failed to compile compute shader:{}", message );
+  }
+  else if ( shaderType == GL_GEOMETRY_SHADER )
+  {
+    spdlog::info( "Failed to compile geometry shader:{}", message );
+  }
 }
 
-void Shader::markForCompilation()
+auto Shader::getSourceHash() const -> uint64_t
 {
-  m_isCompiled = false;
+  // a driver update invalidates the binaries so the driver strings are part of the key
+  static const std::string driver = std::format( "{}|{}|{}",
+                                                 reinterpret_cast<const char*>( glGetString( GL_VENDOR ) ),
+                                                 reinterpret_cast<const char*>( glGetString( GL_RENDERER ) ),
+                                                 reinterpret_cast<const char*>( glGetString( GL_VERSION ) ) );
+
+  auto hash = hashString( driver );
+  for ( const auto* source : { &m_shaderSource.vertexSource,
+                               &m_shaderSource.geometrySource,
+                               &m_shaderSource.fragmentSource,
+                               &m_shaderSource.computeSource } )
+  {
+    // the separator keeps "ab" + "c" and "a" + "bc" apart
+    hash = hashString( *source, hash );
+    hash = hashString( "|", hash );
+  }
+  return hash;
 }
 
-auto Shader::createShader() -> uint32_t
+auto Shader::loadBinary() -> bool
 {
-  uint32_t program = glCreateProgram();
-  uint32_t vs = compileShader( GL_VERTEX_SHADER, m_shaderSource.vertexSource );
-  uint32_t fs = compileShader( GL_FRAGMENT_SHADER, m_shaderSource.fragmentSource );
+  if ( m_cacheFile.empty() || !std::filesystem::exists( m_cacheFile ) )
+    return false;
+
+  std::ifstream file( m_cacheFile, std::ios::binary );
+  uint32_t format = 0;
+  file.read( reinterpret_cast<char*>( &format ), sizeof( format ) );
+  if ( !file )
+    return false;
+
+  std::vector<char> binary{ std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() };
+  if ( binary.empty() )
+    return false;
 
-  // Attach shaders now
-  glAttachShader( program, vs );
-  glAttachShader( program, fs );
-  glLinkProgram( program );
+  glProgramBinary( m_pendingProgram, format, binary.data(), static_cast<int>( binary.size() ) );
+
+  // the driver is allowed to reject a binary it wrote itself, fall back to compiling
   int result;
-  glGetProgramiv( program, GL_LINK_STATUS, &result );
+  glGetProgramiv( m_pendingProgram, GL_LINK_STATUS, &result );
   if ( result == GL_FALSE )
   {
-    int length;
-    glGetProgramiv( program, GL_INFO_LOG_LENGTH, &length );
-    auto message = (char*)malloc( length * sizeof( char ) );
-    glGetProgramInfoLog( program, length, &length, message );
+    spdlog::warn( "Program binary {} was rejected, compiling from source", m_cacheFile.filename().string() );
+    std::error_code error;
+    std::filesystem::remove( m_cacheFile, error );
+    return false;
+  }
 
-    spdlog::info( "Failed to link shader program {}", message );
-    free( message );
-    glDeleteProgram( program );
-    return 0;
+  return true;
+}
+
+void Shader::saveBinary() const
+{
+  if ( m_cacheFile.empty() )
+    return;
+
+  int length = 0;
+  glGetProgramiv( m_pendingProgram, GL_PROGRAM_BINARY_LENGTH, &length );
+  if ( length <= 0 )
+    return;
+
+  std::vector<char> binary( length );
+  uint32_t format = 0;
+  glGetProgramBinary( m_pendingProgram, length, &length, &format, binary.data() );
+
+  std::error_code error;
+  std::filesystem::create_directories( m_cacheFile.parent_path(), error );
+
+  std::ofstream file( m_cacheFile, std::ios::binary | std::ios::trunc );
+  if ( !file.is_open() )
+  {
+    spdlog::warn( "Could not write program binary {}", m_cacheFile.string() );
+    return;
   }
-  glValidateProgram( program );
-  glDeleteShader( vs );
-  glDeleteShader( fs );
 
-  spdlog::info( "Succesfully linked shaders" );
-  return program;
+  file.write( reinterpret_cast<const char*>( &format ), sizeof( format ) );
+  file.write( binary.data(), length );
 }
+
+void Shader::destroy() const
+{
+  glDeleteProgram( m_programId );
+
+  for ( const auto stage : m_pendingStages )
+    glDeleteShader( stage );
+
+  if ( m_pendingProgram != 0 )
+    glDeleteProgram( m_pendingProgram );
+}
+
+void Shader::markForCompilation()
+{
+  m_isCompiled = false;
+  m_sourceChanged = true;
+}
+
 } // namespace kogayonon_utilities
\ No newline at end of file
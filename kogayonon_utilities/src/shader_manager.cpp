@@ -10,9 +10,14 @@ void ShaderManager::markForRecompilation( const std::string& filePath )
   {
     auto fragment = shaders.second.getFragmentShaderPath();
     auto vertex = shaders.second.getVertexShaderPath();
+    auto compute = shaders.second.getComputeShaderPath();
+    auto geometry = shaders.second.getGeometryShaderPath();
     std::replace( fragment.begin(), fragment.end(), '/', '\\' );
     std::replace( vertex.begin(), vertex.end(), '/', '\\' );
-    if ( fragment == filePath || vertex == filePath )
+    std::replace( compute.begin(), compute.end(), '/', '\\' );
+    std::replace( geometry.begin(), geometry.end(), '/', '\\' );
+    if ( fragment == filePath || vertex == filePath || ( !compute.empty() && compute == filePath ) ||
+         ( !geometry.empty() && geometry == filePath ) )
     {
       shaders.second.markForCompilation();
     }
@@ -33,37 +38,93 @@ void ShaderManager::pushShader( const std::string& vertex_shader, const std::str
   m_shaders.emplace( shader_name, std::move( sh ) );
 }
 
+void ShaderManager::pushShader( const std::string& vertex_shader, const std::string& geometry_shader,
+                                const std::string& fragment_shader, const std::string& shader_name )
+{
+  if ( m_shaders.contains( shader_name ) )
+  {
+    m_shaders.at( shader_name ).destroy();
+    m_shaders.erase( shader_name );
+  }
+
+  Shader sh;
+  sh.initializeShaderSource( vertex_shader, geometry_shader, fragment_shader );
+  m_shaders.emplace( shader_name, std::move( sh ) );
+}
+
+void ShaderManager::pushComputeShader( const std::string& compute_shader, const std::string& shader_name )
+{
+  if ( m_shaders.contains( shader_name ) )
+  {
+    m_shaders.at( shader_name ).destroy();
+    m_shaders.erase( shader_name );
+  }
+
+  Shader sh;
+  sh.initializeComputeSource( compute_shader );
+  m_shaders.emplace( shader_name, std::move( sh ) );
+}
+
 void ShaderManager::compileMarkedShaders()
+{
+  beginCompilation();
+  finishCompilation();
+}
+
+void ShaderManager::beginCompilation()
 {
   for ( auto& shader : m_shaders )
   {
-    if ( shader.second.isCompiled() == false )
-      shader.second.initializeProgram();
+    if ( shader.second.isCompiled() == false && !shader.second.isPending() )
+      shader.second.beginCompilation( m_programCacheDirectory );
   }
 }
 
-auto ShaderManager::getShader( const std::string& shader_name ) -> Shader&
+auto ShaderManager::isReady() -> bool
 {
-  if ( m_shaders.find( shader_name ) == m_shaders.end() )
+  bool ready = true;
+  for ( auto& shader : m_shaders )
   {
-    throw std::runtime_error( "Shader not found" );
+    if ( !shader.second.isPending() )
+      continue;
+
+    if ( shader.second.isReady() )
+    {
+      shader.second.finishCompilation();
+      m_programCacheHits += shader.second.isFromCache();
+    }
+    else
+    {
+      ready = false;
+    }
   }
-  return m_shaders.at( shader_name );
+  return ready;
 }
 
-auto ShaderManager::getShaderId( const std::string& shader_name ) -> uint32_t
+void ShaderManager::finishCompilation()
 {
-  return getShader( shader_name ).getShaderId();
+  for ( auto& shader : m_shaders )
+  {
+    if ( !shader.second.isPending() )
+      continue;
+
+    shader.second.finishCompilation();
+    m_programCacheHits += shader.second.isFromCache();
+  }
 }
 
-void ShaderManager::bindShader( const std::string& shader_name )
+auto ShaderManager::getShader( const std::string& shader_name ) -> Shader&
 {
-  getShader( shader_name ).bind();
+  if ( m_shaders.find( shader_name ) == m_shaders.end() )
+  {
+    throw std::runtime_error( "Shader not found" );
+  }
+  return m_shaders.at( shader_name );
 }
 
-void ShaderManager::unbindShader( const std::string& shader_name )
+auto ShaderManager::getShaderId( const std::string& shader_name ) -> uint32_t
 {
-  getShader( shader_name ).unbind();
+  return getShader( shader_name ).getShaderId();
 }
 
 void ShaderManager::removeShader( const std::string& shaderName )
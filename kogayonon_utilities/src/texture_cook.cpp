@@ -0,0 +1,397 @@
+#include "utilities/texture_cook/texture_cook.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <string_view>
+#include "utilities/shader/uniform_table.hpp"
+
+namespace kogayonon_utilities
+{
+namespace
+{
+// the KTX 20 file identifier
+constexpr std::array<uint8_t, 12> ktx2Identifier{
+  0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a };
+
+// VK_FORMAT_BC5_UNORM_BLOCK and VK_FORMAT_BC7_UNORM_BLOCK
+constexpr uint32_t vkFormatBc5 = 141;
+constexpr uint32_t vkFormatBc7 = 145;
+
+// color models of the khronos data format descriptor
+constexpr uint32_t dfdModelBc5 = 132;
+constexpr uint32_t dfdModelBc7 = 134;
+
+constexpr std::string_view sourceHashKey = "KGYsourceHash";
+constexpr std::string_view writerKey = "KTXwriter";
+constexpr std::string_view writerValue = "kogayonon";
+
+// every level starts 16 byte aligned which satisfies the block size and the 4 byte rule of the spec
+constexpr uint64_t levelAlignment = 16;
+
+struct Ktx2Header
+{
+  std::array<uint8_t, 12> identifier{ ktx2Identifier };
+  uint32_t vkFormat{ 0 };
+  uint32_t typeSize{ 1 };
+  uint32_t pixelWidth{ 0 };
+  uint32_t pixelHeight{ 0 };
+  uint32_t pixelDepth{ 0 };
+  uint32_t layerCount{ 0 };
+  uint32_t faceCount{ 1 };
+  uint32_t levelCount{ 0 };
+  uint32_t supercompressionScheme{ 0 };
+
+  uint32_t dfdByteOffset{ 0 };
+  uint32_t dfdByteLength{ 0 };
+  uint32_t kvdByteOffset{ 0 };
+  uint32_t kvdByteLength{ 0 };
+  uint64_t sgdByteOffset{ 0 };
+  uint64_t sgdByteLength{ 0 };
+};
+static_assert( sizeof( Ktx2Header ) == 80 );
+
+struct Ktx2Level
+{
+  uint64_t byteOffset{ 0 };
+  uint64_t byteLength{ 0 };
+  uint64_t uncompressedByteLength{ 0 };
+};
+
+inline auto alignTo( uint64_t offset, uint64_t alignment ) -> uint64_t
+{
+  return ( offset + alignment - 1 ) / alignment * alignment;
+}
+
+template <typename T>
+void append( std::vector<uint8_t>& bytes, const T& value )
+{
+  const auto* pBytes = reinterpret_cast<const uint8_t*>( &value );
+  bytes.insert( bytes.end(), pBytes, pBytes + sizeof( T ) );
+}
+
+// basic descriptor block, bc5 is a red and a green sample of 64 bits each, bc7 a single 128 bit color sample
+auto makeDataFormatDescriptor( BlockFormat format ) -> std::vector<uint8_t>
+{
+  struct Sample
+  {
+    uint32_t bitOffset;
+    uint32_t bitLength;
+    uint32_t channel;
+  };
+
+  std::vector<Sample> samples;
+  if ( format == BlockFormat::BC5 )
+    samples = { { 0, 64, 0 }, { 64, 64, 1 } };
+  else
+    samples = { { 0, 128, 0 } };
+
+  const auto blockSize = static_cast<uint32_t>( 24 + 16 * samples.size() );
+  std::vector<uint8_t> dfd;
+  append( dfd, static_cast<uint32_t>( 4 + blockSize ) );
+  append( dfd, uint32_t{ 0 } );
+  append( dfd, 2u | ( blockSize << 16 ) );
+
+  // bt709 primaries, linear transfer, straight alpha
+  const auto model = format == BlockFormat::BC5 ? dfdModelBc5 : dfdModelBc7;
+  append( dfd, model | ( 1u << 8 ) | ( 1u << 16 ) );
+
+  // 4x4x1 texel blocks stored minus one, then the bytes of the only plane
+  append( dfd, 3u | ( 3u << 8 ) );
+  append( dfd, static_cast<uint32_t>( getBlockBytes( format ) ) );
+  append( dfd, uint32_t{ 0 } );
+
+  for ( const auto& sample : samples )
+  {
+    append( dfd, sample.bitOffset | ( ( sample.bitLength - 1 ) << 16 ) | ( sample.channel << 24 ) );
+    append( dfd, uint32_t{ 0 } );
+    append( dfd, uint32_t{ 0 } );
+    append( dfd, uint32_t{ 0xffffffff } );
+  }
+  return dfd;
+}
+
+void appendKeyValue( std::vector<uint8_t>& kvd, std::string_view key, const void* pValue, std::size_t size )
+{
+  append( kvd, static_cast<uint32_t>( key.size() + 1 + size ) );
+  kvd.insert( kvd.end(), key.begin(), key.end() );
+  kvd.push_back( 0 );
+
+  const auto* pBytes = static_cast<const uint8_t*>( pValue );
+  kvd.insert( kvd.end(), pBytes, pBytes + size );
+  kvd.resize( alignTo( kvd.size(), 4 ) );
+}
+
+auto findSourceHash( std::span<const uint8_t> kvd, uint64_t& hash ) -> bool
+{
+  std::size_t offset = 0;
+  while ( offset + sizeof( uint32_t ) <= kvd.size() )
+  {
+    uint32_t length = 0;
+    std::memcpy( &length, kvd.data() + offset, sizeof( length ) );
+    offset += sizeof( length );
+    if ( length > kvd.size() - offset )
+      return false;
+
+    const std::string_view entry{ reinterpret_cast<const char*>( kvd.data() + offset ), length };
+    if ( entry.size() == sourceHashKey.size() + 1 + sizeof( hash ) && entry.starts_with( sourceHashKey ) &&
+         entry[sourceHashKey.size()] == '\0' )
+    {
+      std::memcpy( &hash, entry.data() + sourceHashKey.size() + 1, sizeof( hash ) );
+      return true;
+    }
+    offset = alignTo( offset + length, 4 );
+  }
+  return false;
+}
+
+// bilinear between texel centers, only used once per texture while cooking
+auto resample( const uint8_t* pPixels, int width, int height, int size ) -> std::vector<uint8_t>
+{
+  std::vector<uint8_t> result( static_cast<std::size_t>( size ) * size * 4 );
+  const auto scaleX = static_cast<float>( width ) / static_cast<float>( size );
+  const auto scaleY = static_cast<float>( height ) / static_cast<float>( size );
+
+  for ( auto y = 0; y < size; y++ )
+  {
+    const auto sourceY = std::clamp( ( static_cast<float>( y ) + 0.5f ) * scaleY - 0.5f, 0.0f, height - 1.0f );
+    const auto y0 = static_cast<int>( sourceY );
+    const auto y1 = std::min( y0 + 1, height - 1 );
+    const auto fy = sourceY - static_cast<float>( y0 );
+
+    for ( auto x = 0; x < size; x++ )
+    {
+      const auto sourceX = std::clamp( ( static_cast<float>( x ) + 0.5f ) * scaleX - 0.5f, 0.0f, width - 1.0f );
+      const auto x0 = static_cast<int>( sourceX );
+      const auto x1 = std::min( x0 + 1, width - 1 );
+      const auto fx = sourceX - static_cast<float>( x0 );
+
+      const auto texel = [&]( int tx, int ty, int c ) {
+        return static_cast<float>( pPixels[( static_cast<std::size_t>( ty ) * width + tx ) * 4 + c] );
+      };
+
+      for ( auto c = 0; c < 4; c++ )
+      {
+        const auto top = texel( x0, y0, c ) + ( texel( x1, y0, c ) - texel( x0, y0, c ) ) * fx;
+        const auto bottom = texel( x0, y1, c ) + ( texel( x1, y1, c ) - texel( x0, y1, c ) ) * fx;
+        result[( static_cast<std::size_t>( y ) * size + x ) * 4 + c] =
+          static_cast<uint8_t>( top + ( bottom - top ) * fy + 0.5f );
+      }
+    }
+  }
+  return result;
+}
+
+// 2x2 box filter, the cooked sizes are powers of two so nothing is left over
+auto downsample( const std::vector<uint8_t>& pixels, int size ) -> std::vector<uint8_t>
+{
+  const auto half = std::max( size / 2, 1 );
+  std::vector<uint8_t> result( static_cast<std::size_t>( half ) * half * 4 );
+  for ( auto y = 0; y < half; y++ )
+  {
+    for ( auto x = 0; x < half; x++ )
+    {
+      for ( auto c = 0; c < 4; c++ )
+      {
+        const auto at = [&]( int tx, int ty ) {
+          return static_cast<int>( pixels[( static_cast<std::size_t>( ty ) * size + tx ) * 4 + c] );
+        };
+        const auto sum =
+          at( x * 2, y * 2 ) + at( x * 2 + 1, y * 2 ) + at( x * 2, y * 2 + 1 ) + at( x * 2 + 1, y * 2 + 1 );
+        result[( static_cast<std::size_t>( y ) * half + x ) * 4 + c] = static_cast<uint8_t>( ( sum + 2 ) / 4 );
+      }
+    }
+  }
+  return result;
+}
+} // namespace
+
+auto getCookedTexturePath( const std::filesystem::path& source ) -> std::filesystem::path
+{
+  auto path = source;
+  path.replace_extension( ".ktx2" );
+  return path;
+}
+
+auto hashTextureSource( const std::filesystem::path& source, TextureUsage usage ) -> uint64_t
+{
+  std::ifstream file{ source, std::ios::binary };
+  if ( !file )
+    return 0;
+
+  const std::string contents{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+  const std::array<uint32_t, 2> settings{ textureCookVersion, static_cast<uint32_t>( usage ) };
+  return hashString( std::string_view{ reinterpret_cast<const char*>( settings.data() ), sizeof( settings ) },
+                     hashString( contents ) );
+}
+
+auto cookTexture( const uint8_t* pPixels, int width, int height, TextureUsage usage ) -> CookedTexture
+{
+  const auto largest = static_cast<uint32_t>( std::max( { width, height, 1 } ) );
+  const auto size = std::clamp( static_cast<int>( std::bit_ceil( largest ) ), minCookedSize, maxCookedSize );
+
+  CookedTexture texture{ .format = getBlockFormat( usage ), .width = size, .height = size };
+
+  auto level = resample( pPixels, width, height, size );
+  for ( auto levelSize = size;; levelSize /= 2 )
+  {
+    const auto offset = texture.storage.size();
+    compressImage( texture.format, level.data(), levelSize, levelSize, texture.storage );
+    texture.levels.emplace_back( CookedLevel{
+      .offset = offset, .size = texture.storage.size() - offset, .width = levelSize, .height = levelSize } );
+
+    if ( levelSize == 1 )
+      break;
+    level = downsample( level, levelSize );
+  }
+
+  texture.data = texture.storage;
+  return texture;
+}
+
+auto readCookedTexture( const std::filesystem::path& path, uint64_t sourceHash, CookedTexture& texture ) -> bool
+{
+  auto pFile = std::make_shared<MappedFile>();
+  if ( !pFile->open( path ) || pFile->getSize() < sizeof( Ktx2Header ) )
+    return false;
+
+  const auto* data = pFile->getData();
+  const auto size = static_cast<uint64_t>( pFile->getSize() );
+
+  Ktx2Header header;
+  std::memcpy( &header, data, sizeof( header ) );
+  if ( header.identifier != ktx2Identifier )
+    return false;
+
+  if ( header.vkFormat != vkFormatBc5 && header.vkFormat != vkFormatBc7 )
+    return false;
+
+  // a full chain ends at 1x1, more levels than that would shift the size past its bits
+  const auto maxLevels = static_cast<uint32_t>( std::bit_width( std::max( header.pixelWidth, header.pixelHeight ) ) );
+  const auto format = header.vkFormat == vkFormatBc5 ? BlockFormat::BC5 : BlockFormat::BC7;
+  if ( header.supercompressionScheme != 0 || header.pixelDepth != 0 || header.layerCount > 1 ||
+       header.faceCount != 1 || header.levelCount == 0 || header.pixelWidth == 0 || header.pixelHeight == 0 ||
+       header.pixelWidth > static_cast<uint32_t>( maxCookedSize ) ||
+       header.pixelHeight > static_cast<uint32_t>( maxCookedSize ) ||
+       header.levelCount > maxLevels ||
+       sizeof( Ktx2Header ) + header.levelCount * sizeof( Ktx2Level ) > size ||
+       static_cast<uint64_t>( header.kvdByteOffset ) + header.kvdByteLength > size )
+  {
+    spdlog::warn( "Cooked texture {} is broken, cooking it again", path.string() );
+    return false;
+  }
+
+  uint64_t hash = 0;
+  if ( !findSourceHash( std::span{ data + header.kvdByteOffset, header.kvdByteLength }, hash ) || hash != sourceHash )
+    return false;
+
+  texture.format = format;
+  texture.width = static_cast<int>( header.pixelWidth );
+  texture.height = static_cast<int>( header.pixelHeight );
+  texture.levels.clear();
+
+  for ( auto i = 0u; i < header.levelCount; i++ )
+  {
+    Ktx2Level level;
+    std::memcpy( &level, data + sizeof( Ktx2Header ) + i * sizeof( Ktx2Level ), sizeof( level ) );
+
+    const auto width = std::max( texture.width >> i, 1 );
+    const auto height = std::max( texture.height >> i, 1 );
+    if ( level.byteLength != getCompressedSize( format, width, height ) || level.byteOffset > size ||
+         level.byteLength > size - level.byteOffset )
+    {
+      spdlog::warn( "Cooked texture {} is broken, cooking it again", path.string() );
+      return false;
+    }
+
+    texture.levels.emplace_back( CookedLevel{ .offset = static_cast<std::size_t>( level.byteOffset ),
+                                              .size = static_cast<std::size_t>( level.byteLength ),
+                                              .width = width,
+                                              .height = height } );
+  }
+
+  texture.data = std::span{ data, static_cast<std::size_t>( size ) };
+  texture.storage.clear();
+  texture.pFile = std::move( pFile );
+  return true;
+}
+
+auto writeCookedTexture( const std::filesystem::path& path, uint64_t sourceHash, const CookedTexture& texture )
+  -> bool
+{
+  Ktx2Header header{ .vkFormat = texture.format == BlockFormat::BC5 ? vkFormatBc5 : vkFormatBc7,
+                     .pixelWidth = static_cast<uint32_t>( texture.width ),
+                     .pixelHeight = static_cast<uint32_t>( texture.height ),
+                     .levelCount = static_cast<uint32_t>( texture.levels.size() ) };
+
+  const auto dfd = makeDataFormatDescriptor( texture.format );
+
+  // keys sorted by their bytes as the spec wants
+  std::vector<uint8_t> kvd;
+  appendKeyValue( kvd, sourceHashKey, &sourceHash, sizeof( sourceHash ) );
+  appendKeyValue( kvd, writerKey, writerValue.data(), writerValue.size() );
+
+  header.dfdByteOffset = static_cast<uint32_t>( sizeof( Ktx2Header ) + texture.levels.size() * sizeof( Ktx2Level ) );
+  header.dfdByteLength = static_cast<uint32_t>( dfd.size() );
+  header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+  header.kvdByteLength = static_cast<uint32_t>( kvd.size() );
+
+  // the data of the smallest level comes first in the file
+  std::vector<Ktx2Level> levels( texture.levels.size() );
+  auto offset = static_cast<uint64_t>( header.kvdByteOffset ) + header.kvdByteLength;
+  for ( auto i = texture.levels.size(); i-- > 0; )
+  {
+    offset = alignTo( offset, levelAlignment );
+    levels[i] = Ktx2Level{ .byteOffset = offset,
+                           .byteLength = texture.levels[i].size,
+                           .uncompressedByteLength = texture.levels[i].size };
+    offset += texture.levels[i].size;
+  }
+
+  auto temporaryPath = path;
+  temporaryPath += ".tmp";
+
+  {
+    std::ofstream file{ temporaryPath, std::ios::binary | std::ios::trunc };
+    if ( !file )
+    {
+      spdlog::warn( "Could not write cooked texture {}", path.string() );
+      return false;
+    }
+
+    file.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+    file.write( reinterpret_cast<const char*>( levels.data() ),
+                static_cast<std::streamsize>( levels.size() * sizeof( Ktx2Level ) ) );
+    file.write( reinterpret_cast<const char*>( dfd.data() ), static_cast<std::streamsize>( dfd.size() ) );
+    file.write( reinterpret_cast<const char*>( kvd.data() ), static_cast<std::streamsize>( kvd.size() ) );
+
+    for ( auto i = texture.levels.size(); i-- > 0; )
+    {
+      static constexpr char padding[levelAlignment]{};
+      const auto position = static_cast<uint64_t>( file.tellp() );
+      file.write( padding, static_cast<std::streamsize>( levels[i].byteOffset - position ) );
+      file.write( reinterpret_cast<const char*>( texture.data.data() + texture.levels[i].offset ),
+                  static_cast<std::streamsize>( texture.levels[i].size ) );
+    }
+
+    if ( !file )
+    {
+      spdlog::warn( "Could not write cooked texture {}", path.string() );
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename( temporaryPath, path, error );
+  if ( error )
+  {
+    spdlog::warn( "Could not replace cooked texture {}: {}", path.string(), error.message() );
+    std::filesystem::remove( temporaryPath, error );
+    return false;
+  }
+
+  return true;
+}
+} // namespace kogayonon_utilities
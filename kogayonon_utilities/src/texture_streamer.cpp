@@ -0,0 +1,432 @@
+#include "utilities/texture_streamer/texture_streamer.hpp"
+#include <SOIL2/SOIL2.h>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+#include "resources/texture.hpp"
+#include "utilities/cpu_profiler/cpu_profiler.hpp"
+#include "utilities/task_manager/task_manager.hpp"
+
+namespace kogayonon_utilities
+{
+TextureStreamer::~TextureStreamer()
+{
+  // the singleton that owns us dies after the context, the driver frees the objects with it
+  m_uploads.clear();
+}
+
+namespace
+{
+auto getGlFormat( BlockFormat format ) -> GLenum
+{
+  return format == BlockFormat::BC5 ? GL_COMPRESSED_RG_RGTC2 : GL_COMPRESSED_RGBA_BPTC_UNORM;
+}
+
+auto getRgba8Bytes( int width, int height, std::size_t levels ) -> std::size_t
+{
+  std::size_t bytes = 0;
+  for ( auto level = 0u; level < levels; level++ )
+    bytes += static_cast<std::size_t>( std::max( width >> level, 1 ) ) * std::max( height >> level, 1 ) * 4;
+  return bytes;
+}
+
+inline auto isEmpty( const DecodedTexture& decoded ) -> bool
+{
+  return !decoded.pixels && decoded.cooked.levels.empty();
+}
+} // namespace
+
+void TextureStreamer::request( kogayonon_resources::Texture* pTexture, TaskManager& taskManager, TextureUsage usage,
+                               int maxSize )
+{
+  if ( !pTexture || pTexture->getLoaded() || m_pending.contains( pTexture ) )
+    return;
+
+  if ( m_placeholder == 0 )
+    createPlaceholder();
+
+  if ( m_pending.empty() )
+    m_loadStart = std::chrono::steady_clock::now();
+
+  m_pending.emplace( pTexture );
+  pTexture->setTextureId( m_placeholder );
+
+  // textures created from a glTF know where their file is, the others live in the textures folder
+  auto path = pTexture->getPath();
+  if ( path.empty() )
+    path = "resources/textures/" + pTexture->getName();
+
+  taskManager.enqueue( [this, pTexture, path, usage, maxSize, compress = m_compressionEnabled]() {
+    KOGAYONON_PROFILE_ZONE( "TextureStreamer::decode" );
+
+    DecodedTexture decoded{ .pTexture = pTexture, .pixels = { nullptr, SOIL_free_image_data } };
+    const auto cookedPath = getCookedTexturePath( path );
+    const auto sourceHash = compress ? hashTextureSource( path, usage ) : 0;
+    if ( sourceHash == 0 || !readCookedTexture( cookedPath, sourceHash, decoded.cooked ) )
+    {
+      // always four channels so every upload has the same layout
+      int channels = 0;
+      decoded.pixels.reset(
+        SOIL_load_image( path.c_str(), &decoded.width, &decoded.height, &channels, SOIL_LOAD_RGBA ) );
+      if ( !decoded.pixels )
+        spdlog::error( "SOIL could not decode texture {}: {}", path, SOIL_last_result() );
+
+      if ( decoded.pixels && sourceHash != 0 )
+      {
+        KOGAYONON_PROFILE_ZONE( "TextureStreamer::cook" );
+        decoded.cooked = cookTexture( decoded.pixels.get(), decoded.width, decoded.height, usage );
+        writeCookedTexture( cookedPath, sourceHash, decoded.cooked );
+        decoded.pixels.reset();
+      }
+    }
+
+    // the mips we skip stay in the file, a later request for a bigger size maps them again
+    auto& levels = decoded.cooked.levels;
+    while ( levels.size() > 1 && std::max( levels.front().width, levels.front().height ) > maxSize )
+      levels.erase( levels.begin() );
+
+    if ( !levels.empty() )
+    {
+      decoded.cooked.width = levels.front().width;
+      decoded.cooked.height = levels.front().height;
+      decoded.width = decoded.cooked.width;
+      decoded.height = decoded.cooked.height;
+    }
+
+    std::lock_guard lock{ m_decodedMutex };
+    m_decoded.emplace_back( std::move( decoded ) );
+  } );
+}
+
+void TextureStreamer::release( kogayonon_resources::Texture* pTexture )
+{
+  if ( !pTexture || !pTexture->getLoaded() || m_pending.contains( pTexture ) )
+    return;
+
+  auto id = pTexture->getTextureId();
+  if ( id != 0 && id != m_placeholder )
+    glDeleteTextures( 1, &id );
+
+  pTexture->setTextureId( m_placeholder );
+  pTexture->setLoaded( false );
+
+  // still counted as loaded, the memory is gone though
+  if ( const auto it = m_loaded.find( pTexture ); it != m_loaded.end() )
+    account( pTexture, LoadedTexture{ .rgba8Bytes = it->second.rgba8Bytes, .compressed = it->second.compressed } );
+}
+
+void TextureStreamer::forget( kogayonon_resources::Texture* pTexture )
+{
+  const auto it = m_loaded.find( pTexture );
+  if ( it == m_loaded.end() )
+    return;
+
+  account( pTexture, LoadedTexture{} );
+  m_loaded.erase( it );
+  m_stats.textures = m_loaded.size();
+}
+
+void TextureStreamer::account( kogayonon_resources::Texture* pTexture, const LoadedTexture& loaded )
+{
+  auto& previous = m_loaded[pTexture];
+  m_stats.vramBytes = m_stats.vramBytes - previous.vramBytes + loaded.vramBytes;
+  m_stats.rgba8Bytes = m_stats.rgba8Bytes - previous.rgba8Bytes + loaded.rgba8Bytes;
+  m_stats.compressed = m_stats.compressed - ( previous.compressed ? 1 : 0 ) + ( loaded.compressed ? 1 : 0 );
+  previous = loaded;
+  m_stats.textures = m_loaded.size();
+}
+
+void TextureStreamer::update( std::size_t byteBudget )
+{
+  KOGAYONON_PROFILE_ZONE( "TextureStreamer::update" );
+  m_uploadedBytes = 0;
+
+  {
+    std::lock_guard lock{ m_decodedMutex };
+    for ( auto& decoded : m_decoded )
+      m_uploads.emplace_back( std::move( decoded ) );
+    m_decoded.clear();
+  }
+
+  // a file that failed keeps the placeholder for good so its materials can still be registered
+  while ( !m_uploads.empty() && isEmpty( m_uploads.front() ) )
+  {
+    finish( m_uploads.front() );
+    m_uploads.pop_front();
+  }
+
+  if ( m_uploads.empty() )
+    return;
+
+  const auto segmentBytes = std::max( byteBudget, minSegmentBytes );
+  if ( segmentBytes > m_segmentBytes )
+    createRing( segmentBytes );
+
+  // the gpu is still reading what we wrote ringSegments frames ago, try again next frame
+  auto& segment = m_segments.at( m_segmentIndex );
+  if ( segment.fence )
+  {
+    const auto status = glClientWaitSync( static_cast<GLsync>( segment.fence ), 0, 0 );
+    if ( status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED )
+      return;
+
+    glDeleteSync( static_cast<GLsync>( segment.fence ) );
+    segment.fence = nullptr;
+  }
+
+  const auto segmentOffset = static_cast<std::size_t>( m_segmentIndex ) * m_segmentBytes;
+  const auto budget = std::min( byteBudget, m_segmentBytes );
+  std::size_t used = 0;
+
+  glBindBuffer( GL_PIXEL_UNPACK_BUFFER, m_ring );
+  glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+
+  while ( !m_uploads.empty() )
+  {
+    auto& upload = m_uploads.front();
+    if ( isEmpty( upload ) )
+    {
+      finish( upload );
+      m_uploads.pop_front();
+      continue;
+    }
+
+    if ( upload.texture == 0 )
+      createTexture( upload );
+
+    if ( !upload.cooked.levels.empty() )
+    {
+      const auto bytes = uploadCooked( upload, segmentOffset + used, budget - used );
+      used += bytes;
+      if ( upload.uploadedLevel == upload.cooked.levels.size() )
+      {
+        finish( upload );
+        m_uploads.pop_front();
+        continue;
+      }
+
+      // the next row of blocks did not fit
+      break;
+    }
+
+    // whole rows only, the rest of the texture goes in the next frames
+    const auto rowBytes = static_cast<std::size_t>( upload.width ) * 4;
+    const auto rowsLeft = static_cast<std::size_t>( upload.height - upload.uploadedRows );
+    const auto rows = std::min( rowsLeft, ( budget - used ) / rowBytes );
+    if ( rows == 0 )
+      break;
+
+    const auto bytes = rows * rowBytes;
+    std::memcpy(
+      m_pMapped + segmentOffset + used, upload.pixels.get() + upload.uploadedRows * rowBytes, bytes );
+    glTextureSubImage2D( upload.texture,
+                         0,
+                         0,
+                         upload.uploadedRows,
+                         upload.width,
+                         static_cast<int>( rows ),
+                         GL_RGBA,
+                         GL_UNSIGNED_BYTE,
+                         reinterpret_cast<const void*>( segmentOffset + used ) );
+
+    used += bytes;
+    upload.uploadedRows += static_cast<int>( rows );
+
+    if ( upload.uploadedRows == upload.height )
+    {
+      finish( upload );
+      m_uploads.pop_front();
+    }
+  }
+
+  glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+  if ( used != 0 )
+  {
+    segment.fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+    m_segmentIndex = ( m_segmentIndex + 1 ) % ringSegments;
+  }
+  m_uploadedBytes = used;
+}
+
+void TextureStreamer::destroy()
+{
+  for ( auto& segment : m_segments )
+  {
+    if ( segment.fence )
+      glDeleteSync( static_cast<GLsync>( segment.fence ) );
+    segment.fence = nullptr;
+  }
+
+  for ( auto& upload : m_uploads )
+  {
+    if ( upload.texture != 0 )
+      glDeleteTextures( 1, &upload.texture );
+  }
+  m_uploads.clear();
+
+  if ( m_ring != 0 )
+  {
+    glUnmapNamedBuffer( m_ring );
+    glDeleteBuffers( 1, &m_ring );
+  }
+
+  if ( m_placeholder != 0 )
+    glDeleteTextures( 1, &m_placeholder );
+
+  m_ring = 0;
+  m_pMapped = nullptr;
+  m_segmentBytes = 0;
+  m_placeholder = 0;
+}
+
+void TextureStreamer::createPlaceholder()
+{
+  // grey checker, obviously not the real texture but not loud either
+  static constexpr int size = 8;
+  std::array<uint32_t, size * size> pixels{};
+  for ( auto y = 0; y < size; y++ )
+  {
+    for ( auto x = 0; x < size; x++ )
+      pixels[y * size + x] = ( ( x / 4 + y / 4 ) % 2 ) ? 0xff808080u : 0xffb0b0b0u;
+  }
+
+  glCreateTextures( GL_TEXTURE_2D, 1, &m_placeholder );
+  glTextureStorage2D( m_placeholder, 1, GL_RGBA8, size, size );
+  glTextureSubImage2D( m_placeholder, 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data() );
+  glTextureParameteri( m_placeholder, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+  glTextureParameteri( m_placeholder, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+}
+
+void TextureStreamer::createRing( std::size_t segmentBytes )
+{
+  // the old ring can go right away, gl keeps it alive until the uploads that read it are done
+  for ( auto& segment : m_segments )
+  {
+    if ( segment.fence )
+      glDeleteSync( static_cast<GLsync>( segment.fence ) );
+    segment.fence = nullptr;
+  }
+
+  if ( m_ring != 0 )
+  {
+    glUnmapNamedBuffer( m_ring );
+    glDeleteBuffers( 1, &m_ring );
+  }
+
+  m_segmentBytes = segmentBytes;
+  m_segmentIndex = 0;
+
+  const auto flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  const auto size = static_cast<GLsizeiptr>( m_segmentBytes * ringSegments );
+  glCreateBuffers( 1, &m_ring );
+  glNamedBufferStorage( m_ring, size, nullptr, flags );
+  m_pMapped = static_cast<unsigned char*>( glMapNamedBufferRange( m_ring, 0, size, flags ) );
+}
+
+void TextureStreamer::createTexture( DecodedTexture& upload ) const
+{
+  const auto largest = static_cast<uint32_t>( std::max( { upload.width, upload.height, 1 } ) );
+  const auto cooked = !upload.cooked.levels.empty();
+  const auto levels = static_cast<int>( cooked ? upload.cooked.levels.size() : std::bit_width( largest ) );
+  const auto format = cooked ? getGlFormat( upload.cooked.format ) : GL_RGBA8;
+
+  glCreateTextures( GL_TEXTURE_2D, 1, &upload.texture );
+  glTextureStorage2D( upload.texture, levels, format, upload.width, upload.height );
+  glTextureParameteri( upload.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+  glTextureParameteri( upload.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+  glTextureParameteri( upload.texture, GL_TEXTURE_WRAP_S, GL_REPEAT );
+  glTextureParameteri( upload.texture, GL_TEXTURE_WRAP_T, GL_REPEAT );
+}
+
+auto TextureStreamer::uploadCooked( DecodedTexture& upload, std::size_t offset, std::size_t budget ) -> std::size_t
+{
+  const auto format = getGlFormat( upload.cooked.format );
+  const auto blockBytes = getBlockBytes( upload.cooked.format );
+  std::size_t used = 0;
+
+  // whole rows of blocks, the small levels at the end are a single row each
+  while ( upload.uploadedLevel < upload.cooked.levels.size() )
+  {
+    const auto& level = upload.cooked.levels.at( upload.uploadedLevel );
+    const auto rowBytes = static_cast<std::size_t>( ( level.width + 3 ) / 4 ) * blockBytes;
+    const auto rowsLeft = static_cast<std::size_t>( ( level.height + 3 ) / 4 - upload.uploadedRows );
+    const auto rows = std::min( rowsLeft, ( budget - used ) / rowBytes );
+    if ( rows == 0 )
+      break;
+
+    const auto bytes = rows * rowBytes;
+    const auto y = upload.uploadedRows * 4;
+    const auto height = std::min( static_cast<int>( rows ) * 4, level.height - y );
+    const auto* pSource = upload.cooked.data.data() + level.offset + upload.uploadedRows * rowBytes;
+    std::memcpy( m_pMapped + offset + used, pSource, bytes );
+    glCompressedTextureSubImage2D( upload.texture,
+                                   static_cast<int>( upload.uploadedLevel ),
+                                   0,
+                                   y,
+                                   level.width,
+                                   height,
+                                   format,
+                                   static_cast<int>( bytes ),
+                                   reinterpret_cast<const void*>( offset + used ) );
+
+    used += bytes;
+    upload.uploadedRows += static_cast<int>( rows );
+    if ( static_cast<std::size_t>( upload.uploadedRows ) * rowBytes == level.size )
+    {
+      upload.uploadedLevel++;
+      upload.uploadedRows = 0;
+    }
+  }
+
+  return used;
+}
+
+void TextureStreamer::finish( DecodedTexture& upload )
+{
+  auto pTexture = upload.pTexture;
+  if ( upload.texture != 0 )
+  {
+    const auto cooked = !upload.cooked.levels.empty();
+    const auto largest = static_cast<uint32_t>( std::max( { upload.width, upload.height, 1 } ) );
+    const auto levels = cooked ? upload.cooked.levels.size() : static_cast<std::size_t>( std::bit_width( largest ) );
+    const auto rgba8Bytes = getRgba8Bytes( upload.width, upload.height, levels );
+
+    LoadedTexture loaded{ .vramBytes = rgba8Bytes, .rgba8Bytes = rgba8Bytes, .compressed = cooked };
+    if ( cooked )
+    {
+      loaded.vramBytes = 0;
+      for ( const auto& level : upload.cooked.levels )
+        loaded.vramBytes += level.size;
+    }
+    else
+    {
+      glGenerateTextureMipmap( upload.texture );
+    }
+
+    // a texture streamed again at a bigger size replaces what its last load counted
+    account( pTexture, loaded );
+
+    pTexture->setTextureId( upload.texture );
+    pTexture->setWidth( upload.width );
+    pTexture->setHeight( upload.height );
+  }
+
+  pTexture->setLoaded( true );
+  m_pending.erase( pTexture );
+
+  if ( m_pending.empty() )
+  {
+    m_stats.loadMilliseconds +=
+      std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - m_loadStart ).count();
+    spdlog::info( "Textures loaded: {} ({} compressed), {:.1f} MB still unpaged, {:.1f} MB as RGBA8, {:.1f} ms",
+                  m_stats.textures,
+                  m_stats.compressed,
+                  static_cast<double>( m_stats.vramBytes ) / ( 1 << 20 ),
+                  static_cast<double>( m_stats.rgba8Bytes ) / ( 1 << 20 ),
+                  m_stats.loadMilliseconds );
+  }
+}
+} // namespace kogayonon_utilities
@@ -37,6 +37,56 @@ layout(std430, binding = 2) buffer SpotLights{
     SpotLight spotLights[];
 };
 
+// keep in sync with GPUMaterial
+struct Material
+{
+  uint page;
+  uint layer;
+  uint flags; // bit 0 = has a base color texture
+  uint pad;
+  vec4 baseColorFactor;
+};
+
+layout(std430, binding = 8) readonly buffer Materials
+{
+  Material materials[];
+};
+
+// the light matrices live with the camera ones, written once per frame
+layout(std140, binding = 4) uniform FrameConstants
+{
+  mat4 view;
+  mat4 projection;
+  mat4 lightVP;
+  vec4 viewPosition;
+  mat4 cascadeViewProjection[4];
+  vec4 cascadeSplits;
+  uint cascadeCount;
+};
+
+// keep in sync with LightCluster, offset into clusterLights and how many lights follow
+struct LightCluster
+{
+  uint offset;
+  uint count;
+};
+
+layout(std430, binding = 10) readonly buffer LightClusters
+{
+  LightCluster clusters[];
+};
+
+layout(std430, binding = 11) readonly buffer ClusterLights
+{
+  uint clusterLights[];
+};
+
+// xyz = froxels along every axis
+uniform uvec4 u_ClusterGrid;
+
+// x = slice scale, y = slice bias, zw = 1 / size of the target
+uniform vec4 u_ClusterParams;
+
 // ubo for the light count
 layout(std140, binding = 3) uniform LightCounts {
     int u_NumPointLights;
@@ -46,14 +96,17 @@ layout(std140, binding = 3) uniform LightCounts {
 };
 
 in vec2 TexCoord;
-in vec4 ShadowCoord;
+in float ViewDepth;
 in vec3 Normal;
 in vec3 FragPos;
 in vec3 ViewPos;
-flat in uint Selected;
+flat in uint MaterialIndex;
+
+// one layer per cascade, a single layer when the light does not split its shadow
+layout(binding = 4) uniform sampler2DArray u_ShadowMap;
 
-layout(binding = 3) uniform sampler2D u_Texture;
-layout(binding = 4) uniform sampler2D u_ShadowMap;
+// one texture array per page size, 256 512 1024 2048, first the RGBA8 pages then the BC7 ones
+layout(binding = 5) uniform sampler2DArray u_TexturePages[8];
 
 out vec4 FragColor;
 
@@ -81,15 +134,62 @@ float FogCalculation(float distance_, float near, float far)
   return 1.0 - (fogMax - distance_) / (fogMax - fogMin);
 }
 
-float ShadowCalculation(vec4 fragPosLightSpace)
+vec3 BaseColor()
+{
+  Material material = materials[MaterialIndex];
+  if ((material.flags & 1u) == 0u)
+    return material.baseColorFactor.rgb;
+
+  // the page can differ between neighbouring pixels so the derivatives are taken before branching
+  vec3 uv = vec3(TexCoord, float(material.layer));
+  vec2 dx = dFdx(TexCoord);
+  vec2 dy = dFdy(TexCoord);
+
+  vec4 color;
+  switch (material.page)
+  {
+    case 0u: color = textureGrad(u_TexturePages[0], uv, dx, dy); break;
+    case 1u: color = textureGrad(u_TexturePages[1], uv, dx, dy); break;
+    case 2u: color = textureGrad(u_TexturePages[2], uv, dx, dy); break;
+    case 3u: color = textureGrad(u_TexturePages[3], uv, dx, dy); break;
+    case 4u: color = textureGrad(u_TexturePages[4], uv, dx, dy); break;
+    case 5u: color = textureGrad(u_TexturePages[5], uv, dx, dy); break;
+    case 6u: color = textureGrad(u_TexturePages[6], uv, dx, dy); break;
+    default: color = textureGrad(u_TexturePages[7], uv, dx, dy); break;
+  }
+  return color.rgb * material.baseColorFactor.rgb;
+}
+
+uint ClusterIndex()
+{
+  uvec2 tile = uvec2(gl_FragCoord.xy * u_ClusterParams.zw * vec2(u_ClusterGrid.xy));
+  tile = min(tile, u_ClusterGrid.xy - 1u);
+
+  // the slices get deeper exponentially, same as LightClusters::getSlice
+  float slice = floor(log(ViewDepth) * u_ClusterParams.x + u_ClusterParams.y);
+  uint z = uint(clamp(slice, 0.0, float(u_ClusterGrid.z - 1u)));
+  return tile.x + u_ClusterGrid.x * (tile.y + u_ClusterGrid.y * z);
+}
+
+float ShadowCalculation(vec3 fragPos, float viewDepth)
 {
+  // first cascade that reaches past the fragment, past the last split the last cascade still gets a try
+  uint cascade = 0u;
+  while (cascade + 1u < cascadeCount && viewDepth > cascadeSplits[cascade])
+    cascade++;
+
+  vec4 fragPosLightSpace = cascadeViewProjection[cascade] * vec4(fragPos, 1.0);
   vec3 shadowCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
 	shadowCoords = shadowCoords * 0.5 + 0.5;
-	float closestDepth = texture(u_ShadowMap, shadowCoords.xy).r; 
 	float currentDepth = shadowCoords.z;
+
+  // behind the far plane of the light, nothing there could have been drawn into the map
+  if(currentDepth > 1.0)
+    return 0.0;
+
   int sampleRadius = 1;
   float bias = 0.00005;
-  vec2 texelSize = 1.0 / textureSize(u_ShadowMap, 0);
+  vec2 texelSize = 1.0 / vec2(textureSize(u_ShadowMap, 0).xy);
   float shadow = 0.0f;
 
   // create a box around our pixel and filter the shadow
@@ -100,7 +200,7 @@ float ShadowCalculation(vec4 fragPosLightSpace)
 	  for(int x = -sampleRadius; x <= sampleRadius; x++)
 	  {
       vec2 offset = vec2(x, y) * texelSize;
-      float pcfDepth = texture(u_ShadowMap, shadowCoords.xy + offset ).x; 
+      float pcfDepth = texture(u_ShadowMap, vec3(shadowCoords.xy + offset, float(cascade))).x; 
       if(currentDepth > pcfDepth + bias)
         shadow += 0.8f;
 	  }    
@@ -150,18 +250,16 @@ vec3 CalcDirLight(DirectionalLight light, vec3 normal, vec3 viewDir, float shado
 
 void main()
 {
-  // discard if the entity is selected, it goes through a different rendering process
-  // if(Selected==1){discard;}
   vec3 result = vec3(0.0);
-  vec3 objectColor = texture(u_Texture, TexCoord).rgb;
-  float shadow = 1 - ShadowCalculation(ShadowCoord);
-  for (int i = 0; i < u_NumPointLights; ++i)
+  vec3 objectColor = BaseColor();
+  float shadow = 1 - ShadowCalculation(FragPos, ViewDepth);
+  // only the lights binned into this froxel, disabled ones never make it into a cluster
+  LightCluster cluster = clusters[ClusterIndex()];
+  for (uint i = 0u; i < cluster.count; ++i)
   {
-    // if it is not visible just skip this light
-    if(pointLights[i].params.w==0.0f) continue;
-
-    vec3 viewDir = normalize(pointLights[i].translation.xyz - FragPos);
-    result += CalcPointLight(pointLights[i], Normal, FragPos, viewDir, shadow);
+    PointLight light = pointLights[clusterLights[cluster.offset + i]];
+    vec3 viewDir = normalize(light.translation.xyz - FragPos);
+    result += CalcPointLight(light, Normal, FragPos, viewDir, shadow);
   }
 
   for (int i = 0; i < u_NumDirectionalLights; ++i)
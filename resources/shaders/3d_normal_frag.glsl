@@ -37,6 +37,18 @@ layout(std430, binding = 2) buffer SpotLights{
     SpotLight spotLights[];
 };
 
+// the light matrices live with the camera ones, written once per frame
+layout(std140, binding = 4) uniform FrameConstants
+{
+  mat4 view;
+  mat4 projection;
+  mat4 lightVP;
+  vec4 viewPosition;
+  mat4 cascadeViewProjection[4];
+  vec4 cascadeSplits;
+  uint cascadeCount;
+};
+
 // ubo for the light count
 layout(std140, binding = 3) uniform LightCounts {
     int u_NumPointLights;
@@ -46,14 +58,13 @@ layout(std140, binding = 3) uniform LightCounts {
 };
 
 in vec2 TexCoord;
-in vec4 ShadowCoord;
+in float ViewDepth;
 in vec3 Normal;
 in vec3 FragPos;
 in vec3 ViewPos;
-flat in uint Selected;
 
 layout(binding = 3) uniform sampler2D u_Texture;
-layout(binding = 4) uniform sampler2D u_ShadowMap;
+layout(binding = 4) uniform sampler2DArray u_ShadowMap;
 
 out vec4 FragColor;
 
@@ -81,15 +92,25 @@ float FogCalculation(float distance_, float near, float far)
   return 1.0 - (fogMax - distance_) / (fogMax - fogMin);
 }
 
-float ShadowCalculation(vec4 fragPosLightSpace)
+float ShadowCalculation(vec3 fragPos, float viewDepth)
 {
+  // first cascade that reaches past the fragment, past the last split the last cascade still gets a try
+  uint cascade = 0u;
+  while (cascade + 1u < cascadeCount && viewDepth > cascadeSplits[cascade])
+    cascade++;
+
+  vec4 fragPosLightSpace = cascadeViewProjection[cascade] * vec4(fragPos, 1.0);
   vec3 shadowCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
 	shadowCoords = shadowCoords * 0.5 + 0.5;
-	float closestDepth = texture(u_ShadowMap, shadowCoords.xy).r; 
 	float currentDepth = shadowCoords.z;
+
+  // behind the far plane of the light, nothing there could have been drawn into the map
+  if(currentDepth > 1.0)
+    return 0.0;
+
   int sampleRadius = 1;
   float bias = 0.00005;
-  vec2 texelSize = 1.0 / textureSize(u_ShadowMap, 0);
+  vec2 texelSize = 1.0 / vec2(textureSize(u_ShadowMap, 0).xy);
   float shadow = 0.0f;
 
   // create a box around our pixel and filter the shadow
@@ -100,7 +121,7 @@ float ShadowCalculation(vec4 fragPosLightSpace)
 	  for(int x = -sampleRadius; x <= sampleRadius; x++)
 	  {
       vec2 offset = vec2(x, y) * texelSize;
-      float pcfDepth = texture(u_ShadowMap, shadowCoords.xy + offset ).x; 
+      float pcfDepth = texture(u_ShadowMap, vec3(shadowCoords.xy + offset, float(cascade))).x; 
       if(currentDepth > pcfDepth + bias)
         shadow += 0.8f;
 	  }    
@@ -152,7 +173,7 @@ void main()
 {
   vec3 result = vec3(0.0);
   vec3 objectColor = texture(u_Texture, TexCoord).rgb;
-  float shadow = 1 - ShadowCalculation(ShadowCoord);
+  float shadow = 1 - ShadowCalculation(FragPos, ViewDepth);
   for (int i = 0; i < u_NumPointLights; ++i)
   {
     // if it is not visible just skip this light
@@ -3,38 +3,54 @@
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aTexCoord;
-layout(location = 3) in uint aSelected;
-layout(location = 4) in int aEntityId;
 
-layout(location = 5) in mat4 instanceMatrix; // those has 4 rows of vec4s
-// 4 - 2nd row
-// 5 - 3rd row
-// 6 - 4th row
+layout(location = 5) in mat4x3 instanceMatrix; // 4 columns of vec3, locations 5 to 8
 
 
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 lightVP;
+// material of every command, multi draws index it with gl_DrawID
+layout(std430, binding = 9) readonly buffer DrawMaterials
+{
+  uint drawMaterials[];
+};
+
+// per frame constants, written once by the rendering system before the passes
+layout(std140, binding = 4) uniform FrameConstants
+{
+  mat4 view;
+  mat4 projection;
+  mat4 lightVP;
+  vec4 viewPosition;
+  mat4 cascadeViewProjection[4];
+  vec4 cascadeSplits;
+  uint cascadeCount;
+};
+
+// >= 0 when the draw sets its material directly, otherwise it comes from drawMaterials
+uniform int u_MaterialIndex;
+uniform uint u_DrawOffset;
 
 out vec2 TexCoord;
 out vec3 Normal;
 out vec3 FragPos;
-out vec4 ShadowCoord;
+out float ViewDepth;
 out vec3 ViewPos;
-flat out uint Selected;
+flat out uint MaterialIndex;
 
 void main()
 {
-  FragPos = vec3(instanceMatrix * vec4(aPos,1.0f));
-  mat3 normalMatrix = transpose(inverse(mat3(instanceMatrix)));
+  FragPos = instanceMatrix * vec4(aPos,1.0f);
+
+  // for rotation * scale the inverse transpose is every column divided by its squared length, no inverse needed
+  mat3 model = mat3(instanceMatrix);
+  mat3 normalMatrix = mat3(model[0] / dot(model[0], model[0]),
+                           model[1] / dot(model[1], model[1]),
+                           model[2] / dot(model[2], model[2]));
   Normal = normalize(normalMatrix * aNormal);
   TexCoord = aTexCoord;
-  ShadowCoord = lightVP  * vec4(FragPos,1.0f);
-  gl_Position = projection * view * vec4(FragPos,1.0f);
-
-  // calculate the view pos by inversing the view matrix
-  mat4 viewInverse = inverse(view); 
-  // now get the x, y, z
-  ViewPos = vec3(viewInverse[3][0],viewInverse[3][1],viewInverse[3][2]);
-  Selected = aSelected;
+  vec4 viewSpace = view * vec4(FragPos,1.0f);
+  ViewDepth = -viewSpace.z;
+  gl_Position = projection * viewSpace;
+
+  ViewPos = viewPosition.xyz;
+  MaterialIndex = u_MaterialIndex >= 0 ? uint(u_MaterialIndex) : drawMaterials[u_DrawOffset + gl_DrawID];
 }
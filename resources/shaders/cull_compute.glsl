@@ -0,0 +1,89 @@
+#version 460 core
+
+layout(local_size_x = 64) in;
+
+// GPUInstance is not laid out like a std430 struct so the instances are read as raw words
+layout(std430, binding = 5) readonly buffer InstancesIn
+{
+  uint inInstances[];
+};
+
+layout(std430, binding = 6) writeonly buffer InstancesOut
+{
+  uint outInstances[];
+};
+
+// entity of every instance, copied next to the instance so picking still finds it after the packing
+layout(std430, binding = 13) readonly buffer EntitiesIn
+{
+  uint inEntities[];
+};
+
+layout(std430, binding = 12) writeonly buffer EntitiesOut
+{
+  uint outEntities[];
+};
+
+// DrawElementsIndirectCommand is 5 words, instanceCount is the second one
+layout(std430, binding = 7) buffer Commands
+{
+  uint commands[];
+};
+
+uniform mat4 viewProjection;
+uniform vec4 sphere; // mesh space center and radius
+uniform uint instanceCount;
+uniform uint instanceStride; // sizeof(GPUInstance) in words
+uniform uint matrixOffset; // where instanceMatrix starts inside GPUInstance in words
+uniform uint baseInstance;
+uniform uint firstCommand;
+uniform uint commandCount;
+
+void main()
+{
+  uint index = gl_GlobalInvocationID.x;
+  if (index >= instanceCount)
+    return;
+
+  uint base = index * instanceStride;
+  uint matrixBase = base + matrixOffset;
+
+  // the matrix is stored as 4 vec3 columns, the last row is always 0 0 0 1
+  mat4 model;
+  for (int column = 0; column < 4; column++)
+  {
+    model[column] = vec4(uintBitsToFloat(inInstances[matrixBase + column * 3 + 0]),
+                         uintBitsToFloat(inInstances[matrixBase + column * 3 + 1]),
+                         uintBitsToFloat(inInstances[matrixBase + column * 3 + 2]),
+                         column == 3 ? 1.0f : 0.0f);
+  }
+
+  vec3 center = vec3(model * vec4(sphere.xyz, 1.0f));
+
+  // non uniform scale grows the sphere by the largest axis
+  float scale = max(dot(model[0].xyz, model[0].xyz), max(dot(model[1].xyz, model[1].xyz), dot(model[2].xyz, model[2].xyz)));
+  float radius = sphere.w * sqrt(scale);
+
+  // rows of projection * view give the planes, they are not normalized so the radius gets scaled instead
+  mat4 rows = transpose(viewProjection);
+  vec4 planes[6] = vec4[6](rows[3] + rows[0], rows[3] - rows[0],
+                           rows[3] + rows[1], rows[3] - rows[1],
+                           rows[3] + rows[2], rows[3] - rows[2]);
+
+  for (int i = 0; i < 6; i++)
+  {
+    if (dot(planes[i].xyz, center) + planes[i].w < -radius * length(planes[i].xyz))
+      return;
+  }
+
+  // the first command hands out the slot, the other submeshes of the mesh just need the same count
+  uint slot = atomicAdd(commands[firstCommand * 5 + 1], 1);
+  for (uint i = 1; i < commandCount; i++)
+    atomicAdd(commands[(firstCommand + i) * 5 + 1], 1);
+
+  uint outBase = (baseInstance + slot) * instanceStride;
+  for (uint i = 0; i < instanceStride; i++)
+    outInstances[outBase + i] = inInstances[base + i];
+
+  outEntities[baseInstance + slot] = inEntities[index];
+}
@@ -0,0 +1,18 @@
+#version 460 core
+
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 3) out;
+
+flat in uint Layer[];
+
+void main()
+{
+  // the vertex shader already projected the triangle into its cascade, here it only gets routed to that layer
+  for (int i = 0; i < 3; i++)
+  {
+    gl_Layer = int(Layer[i]);
+    gl_Position = gl_in[i].gl_Position;
+    EmitVertex();
+  }
+  EndPrimitive();
+}
@@ -0,0 +1,34 @@
+#version 460 core
+
+layout(location = 0) in vec3 aPos;
+layout(location = 5) in mat4x3 instanceMatrix;
+
+layout(std140, binding = 4) uniform FrameConstants
+{
+  mat4 view;
+  mat4 projection;
+  mat4 lightVP;
+  vec4 viewPosition;
+  mat4 cascadeViewProjection[4];
+  vec4 cascadeSplits;
+  uint cascadeCount;
+};
+
+// the instances of every cascade are packed one after the other, this is where each cascade starts
+uniform uvec4 u_CascadeFirstInstance;
+
+flat out uint Layer;
+
+void main()
+{
+  uint instance = gl_BaseInstance + gl_InstanceID;
+  uint layer = 0u;
+  for (uint i = 1u; i < cascadeCount; i++)
+  {
+    if (instance >= u_CascadeFirstInstance[i])
+      layer = i;
+  }
+
+  Layer = layer;
+  gl_Position = cascadeViewProjection[layer] * vec4(instanceMatrix * vec4(aPos, 1.0), 1.0);
+}
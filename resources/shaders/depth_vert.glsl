@@ -1,13 +1,22 @@
 #version 460 core
 
 layout(location = 0) in vec3 aPos;
-layout(location = 5) in mat4 instanceMatrix;
+layout(location = 5) in mat4x3 instanceMatrix;
 
-// matrix from the light pov, the light is looking at the object
-uniform mat4 projection;
-uniform mat4 view;
+// only lightVP is used here, the layout has to match the other shaders
+layout(std140, binding = 4) uniform FrameConstants
+{
+  mat4 view;
+  mat4 projection;
+  mat4 lightVP;
+  vec4 viewPosition;
+  mat4 cascadeViewProjection[4];
+  vec4 cascadeSplits;
+  uint cascadeCount;
+};
 
 void main()
 {
-    gl_Position = projection * view * instanceMatrix * vec4(aPos, 1.0);
+    // rendered from the light pov, the light is looking at the object
+    gl_Position = lightVP * vec4(instanceMatrix * vec4(aPos, 1.0), 1.0);
 }
@@ -2,10 +2,18 @@
 
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
-layout(location = 3) in uint aSelected;
 
-uniform mat4 view;
-uniform mat4 projection;
+layout(std140, binding = 4) uniform FrameConstants
+{
+  mat4 view;
+  mat4 projection;
+  mat4 lightVP;
+  vec4 viewPosition;
+  mat4 cascadeViewProjection[4];
+  vec4 cascadeSplits;
+  uint cascadeCount;
+};
+
 uniform mat4 instanceMatrix;
 
 out vec3 FragPos;
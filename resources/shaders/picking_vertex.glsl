@@ -1,16 +1,28 @@
 #version 460 core
 layout (location = 0) in vec3 aPos;
-layout (location = 4) in int aEntityId;
-layout (location = 5) in mat4 instanceMatrix;
+layout (location = 5) in mat4x3 instanceMatrix;
 
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 model;
+// entity of every instance, indexed the same way as the instance attributes
+layout(std430, binding = 12) readonly buffer InstanceEntities
+{
+  uint entityIds[];
+};
+
+layout(std140, binding = 4) uniform FrameConstants
+{
+  mat4 view;
+  mat4 projection;
+  mat4 lightVP;
+  vec4 viewPosition;
+  mat4 cascadeViewProjection[4];
+  vec4 cascadeSplits;
+  uint cascadeCount;
+};
 
 out flat int v_entityId;
 
 void main()
 {
-    gl_Position = projection * view * instanceMatrix * vec4(aPos, 1.0);
-    v_entityId = aEntityId;
+    gl_Position = projection * view * vec4(instanceMatrix * vec4(aPos, 1.0), 1.0);
+    v_entityId = int(entityIds[gl_BaseInstance + gl_InstanceID]);
 }
\ No newline at end of file